@@ -0,0 +1,76 @@
+#!/bin/bash
+
+# Export a sealed shard to an archive file, or import an archive as a new shard of a pg, on a running node. The work
+# is done by the node itself in the background (POST /api/v1/shardExport and /api/v1/shardImport), the archive is a
+# file in the shard_archive_dir of that node. The job is then polled (GET /api/v1/shardArchiveJobs) until it is over.
+
+# Parse args
+read -r -d '' USAGE << EOM
+shard-archive.sh [-e host:port] [-i poll_interval_sec] export <shard_id> <archive_file>
+shard-archive.sh [-e host:port] [-i poll_interval_sec] import <pg_id> <archive_file>
+    -e http endpoint of the node, localhost:5000 by default
+    -i seconds between two polls of the job, 2 by default
+    archive_file is a plain file name, in the shard_archive_dir configured on the node
+    export runs on any replica holding the sealed shard, import on the leader of the pg
+EOM
+
+ENDPOINT="localhost:5000"
+POLL_INTERVAL=2
+while getopts "e:i:" opt; do
+    case $opt in
+        e)
+            ENDPOINT=$OPTARG;;
+        i)
+            POLL_INTERVAL=$OPTARG;;
+        *)
+            echo "$USAGE"
+            exit 1;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -ne 3 ]; then
+    echo "$USAGE"
+    exit 1
+fi
+
+case $1 in
+    export)
+        URL="http://${ENDPOINT}/api/v1/shardExport?shard_id=$2";;
+    import)
+        URL="http://${ENDPOINT}/api/v1/shardImport?pg_id=$2";;
+    *)
+        echo "$USAGE"
+        exit 1;;
+esac
+
+# the node answers right away with the id of the job
+RESP=$(curl --silent --show-error --fail-with-body -X POST -G "$URL" --data-urlencode "file=$3")
+if [ $? -ne 0 ]; then
+    echo "$RESP"
+    exit 1
+fi
+JOB_ID=$(echo "$RESP" | grep -o '"job_id": *[0-9]*' | grep -o '[0-9]*$')
+if [ -z "$JOB_ID" ]; then
+    echo "unexpected answer: $RESP"
+    exit 1
+fi
+echo "job_id=$JOB_ID"
+
+# queued -> running -> done / failed, the job holds the json summary of the archive once it is over
+while true; do
+    JOB=$(curl --silent --show-error --fail-with-body "http://${ENDPOINT}/api/v1/shardArchiveJobs?job_id=$JOB_ID")
+    if [ $? -ne 0 ]; then
+        echo "$JOB"
+        exit 1
+    fi
+    case $JOB in
+        *'"state": "done"'*)
+            echo "$JOB"
+            exit 0;;
+        *'"state": "failed"'*)
+            echo "$JOB"
+            exit 1;;
+    esac
+    sleep "$POLL_INTERVAL"
+done
@@ -2,6 +2,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <sisl/fds/buffer.hpp>
 
@@ -9,9 +10,12 @@
 
 namespace homeobject {
 
+// Alignment, in address and length, of the buffers I/O goes to and from directly
+static constexpr uint64_t io_align{512};
+
 ENUM(BlobErrorCode, uint16_t, UNKNOWN = 1, TIMEOUT, INVALID_ARG, UNSUPPORTED_OP, NOT_LEADER, REPLICATION_ERROR,
      UNKNOWN_SHARD, UNKNOWN_BLOB, UNKNOWN_PG, CHECKSUM_MISMATCH, READ_FAILED, INDEX_ERROR, SEALED_SHARD, RETRY_REQUEST,
-     SHUTTING_DOWN, ROLL_BACK);
+     SHUTTING_DOWN, ROLL_BACK, DEADLINE_EXCEEDED, UNKNOWN_UPLOAD);
 struct BlobError {
     BlobErrorCode code;
     // set when we are not the current leader of the PG.
@@ -39,12 +43,82 @@ struct Blob {
     std::optional< peer_id_t > current_leader{std::nullopt};
 };
 
+// What get_into read into the buffers of the caller
+struct BlobRead {
+    uint64_t size{0}; // of the range read, it starts at the start of the buffers
+    std::string user_key{};
+    uint64_t object_off{};
+    std::optional< peer_id_t > current_leader{std::nullopt};
+};
+
+// A part of a multi-part upload as it was written, handed back to complete_upload to assemble the object.
+struct UploadedPart {
+    uint32_t part_no{0};
+    uint64_t size{0};
+    uint32_t crc{0}; // checksum of the part as written, complete_upload fails if it does not match
+};
+
+// A range of a blob read back chunk by chunk, see BlobManager::get_stream. Only a bounded number of chunks is read
+// ahead of the consumer, the stream reads further as the chunks are taken.
+class BlobStream : public Manager< BlobError > {
+public:
+    // Of the blob streamed
+    virtual std::string const& user_key() const = 0;
+    virtual uint64_t object_off() const = 0;
+    // Bytes handed out by the whole stream, the length of the range
+    virtual uint64_t size() const = 0;
+    // The next chunk of the range, an empty one once the range is done. Only one next() may be outstanding at a time
+    // and the stream must outlive it. An error ends the stream, every later next() fails the same way.
+    virtual AsyncResult< sisl::io_blob_safe > next() = 0;
+};
+
 class BlobManager : public Manager< BlobError > {
 public:
-    virtual AsyncResult< blob_id_t > put(shard_id_t shard, Blob&&, trace_id_t tid = 0) = 0;
-    virtual AsyncResult< Blob > get(shard_id_t shard, blob_id_t const& blob, uint64_t off = 0,
-                                    uint64_t len = 0, trace_id_t tid = 0) const = 0;
-    virtual NullAsyncResult del(shard_id_t shard, blob_id_t const& blob, trace_id_t tid = 0) = 0;
+    // An expired deadline fails the operation with DEADLINE_EXCEEDED before its next expensive phase. Once a put or
+    // del has been proposed it is carried through regardless of the deadline.
+    virtual AsyncResult< blob_id_t > put(shard_id_t shard, Blob&&, trace_id_t tid = 0, op_deadline_t deadline = {}) = 0;
+    virtual AsyncResult< Blob > get(shard_id_t shard, blob_id_t const& blob, uint64_t off = 0, uint64_t len = 0,
+                                    trace_id_t tid = 0, op_deadline_t deadline = {}) const = 0;
+    // Like get, but the range (len 0 reads up to the end) is handed out in chunks as they are read instead of once
+    // it is in memory whole. The payload checksum is checked as the chunks go: a corrupt blob fails the stream with
+    // CHECKSUM_MISMATCH before its last chunk is handed out.
+    virtual AsyncResult< std::unique_ptr< BlobStream > > get_stream(shard_id_t shard, blob_id_t const& blob,
+                                                                    uint64_t off = 0, uint64_t len = 0,
+                                                                    trace_id_t tid = 0,
+                                                                    op_deadline_t deadline = {}) const = 0;
+    // Like get, but the range is read into the buffers of the caller, which must hold it and stay valid until the
+    // result is ready. Bytes of the buffers past the range may be overwritten. Reads land in the buffers directly when
+    // off and the buffers are aligned to io_align (the length of the last buffer need not be), see alloc_io_buf;
+    // others go through an intermediate buffer.
+    virtual AsyncResult< BlobRead > get_into(shard_id_t shard, blob_id_t const& blob, sisl::sg_list const& dest,
+                                             uint64_t off = 0, uint64_t len = 0, trace_id_t tid = 0,
+                                             op_deadline_t deadline = {}) const = 0;
+    virtual NullAsyncResult del(shard_id_t shard, blob_id_t const& blob, trace_id_t tid = 0,
+                                op_deadline_t deadline = {}) = 0;
+    // Copy a blob into another shard (of the same or another PG held by this node) without it leaving the server. The
+    // copy is a new blob of the destination shard, put through the same replication path as a client put.
+    virtual AsyncResult< blob_id_t > copy(shard_id_t src_shard, blob_id_t const& src_blob, shard_id_t dst_shard,
+                                          trace_id_t tid = 0, op_deadline_t deadline = {}) = 0;
+
+    // Multi-part upload of an object larger than a single blob may be. Parts are numbered from 1 and written (and
+    // replicated) independently, in parallel or again to replace a part. complete_upload validates the given parts and
+    // publishes the object at once as a new blob, which get() reads back whole or by range. Parts left out of the
+    // object, aborted uploads and uploads neither completed nor aborted in time are garbage collected.
+    virtual AsyncResult< upload_id_t > create_upload(shard_id_t shard, trace_id_t tid = 0) = 0;
+    virtual AsyncResult< UploadedPart > upload_part(shard_id_t shard, upload_id_t upload, uint32_t part_no,
+                                                    sisl::io_blob_safe&& data, trace_id_t tid = 0,
+                                                    op_deadline_t deadline = {}) = 0;
+    virtual AsyncResult< blob_id_t > complete_upload(shard_id_t shard, upload_id_t upload,
+                                                     std::vector< UploadedPart > const& parts,
+                                                     std::string const& user_key = {}, uint64_t object_off = 0,
+                                                     trace_id_t tid = 0) = 0;
+    virtual NullAsyncResult abort_upload(shard_id_t shard, upload_id_t upload, trace_id_t tid = 0) = 0;
+
+    // A buffer of size bytes aligned to io_align, from a pool of this thread. A get_into it goes without an extra copy,
+    // so does a put of it if size is a multiple of io_align. Handing it back once done with it, on the same thread,
+    // lets the pool reuse it; one handed back on another thread is freed.
+    virtual sisl::io_blob_safe alloc_io_buf(uint32_t size) const = 0;
+    virtual void release_io_buf(sisl::io_blob_safe&& buf) const = 0;
 };
 
 } // namespace homeobject
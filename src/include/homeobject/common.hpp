@@ -6,6 +6,7 @@
 #include <folly/futures/Future.h>
 
 #include <sisl/logging/logging.h>
+#include <chrono>
 #include <random>
 
 SISL_LOGGING_DECL(homeobject);
@@ -32,6 +33,15 @@ using shard_id_t = uint64_t;
 using snp_batch_id_t = uint16_t;
 using snp_obj_id_t = uint64_t;
 using trace_id_t = uint64_t;
+using upload_id_t = uint64_t;
+
+// Point in time after which the caller is no longer interested in the result of an operation.
+// A default constructed deadline means no deadline.
+using op_deadline_t = std::chrono::steady_clock::time_point;
+
+inline bool deadline_expired(op_deadline_t deadline) {
+    return deadline != op_deadline_t{} && std::chrono::steady_clock::now() >= deadline;
+}
 
 inline uint64_t generateRandomTraceId() {
     std::random_device rd;
@@ -1,32 +1,124 @@
 #include "homeobject_impl.hpp"
+#include "io_buf_pool.hpp"
 
 namespace homeobject {
 
 std::shared_ptr< BlobManager > HomeObjectImpl::blob_manager() { return shared_from_this(); }
 
 BlobManager::AsyncResult< Blob > HomeObjectImpl::get(shard_id_t shard, blob_id_t const& blob_id, uint64_t off,
-                                                     uint64_t len, trace_id_t tid) const {
+                                                     uint64_t len, trace_id_t tid, op_deadline_t deadline) const {
     return _get_shard(shard, tid).thenValue(
-        [this, blob_id, off, len, tid](auto const e) -> BlobManager::AsyncResult< Blob > {
+        [this, blob_id, off, len, tid, deadline](auto const e) -> BlobManager::AsyncResult< Blob > {
             if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
-            return _get_blob(e.value(), blob_id, off, len, tid);
+            return _get_blob(e.value(), blob_id, off, len, tid, deadline);
         });
 }
 
-BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::put(shard_id_t shard, Blob&& blob, trace_id_t tid) {
+BlobManager::AsyncResult< std::unique_ptr< BlobStream > >
+HomeObjectImpl::get_stream(shard_id_t shard, blob_id_t const& blob_id, uint64_t off, uint64_t len, trace_id_t tid,
+                           op_deadline_t deadline) const {
+    using stream_result = BlobManager::AsyncResult< std::unique_ptr< BlobStream > >;
+    return _get_shard(shard, tid).thenValue([this, blob_id, off, len, tid, deadline](auto const e) -> stream_result {
+        if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+        return _get_stream(e.value(), blob_id, off, len, tid, deadline);
+    });
+}
+
+BlobManager::AsyncResult< BlobRead > HomeObjectImpl::get_into(shard_id_t shard, blob_id_t const& blob_id,
+                                                              sisl::sg_list const& dest, uint64_t off, uint64_t len,
+                                                              trace_id_t tid, op_deadline_t deadline) const {
+    return _get_shard(shard, tid).thenValue(
+        [this, blob_id, dest, off, len, tid, deadline](auto const e) -> BlobManager::AsyncResult< BlobRead > {
+            if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+            if (dest.size == 0) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            return _get_blob_into(e.value(), blob_id, dest, off, len, tid, deadline);
+        });
+}
+
+BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::put(shard_id_t shard, Blob&& blob, trace_id_t tid,
+                                                          op_deadline_t deadline) {
     return _get_shard(shard, tid).thenValue(
-        [this, blob = std::move(blob), tid](auto const e) mutable -> BlobManager::AsyncResult< blob_id_t > {
+        [this, blob = std::move(blob), tid, deadline](auto const e) mutable -> BlobManager::AsyncResult< blob_id_t > {
             if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
             if (ShardInfo::State::SEALED == e.value().state) return folly::makeUnexpected(BlobError(BlobErrorCode::SEALED_SHARD));
             if (blob.body.size() == 0) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
-            return _put_blob(e.value(), std::move(blob), tid);
+            return _put_blob(e.value(), std::move(blob), tid, deadline);
+        });
+}
+
+BlobManager::NullAsyncResult HomeObjectImpl::del(shard_id_t shard, blob_id_t const& blob, trace_id_t tid,
+                                                  op_deadline_t deadline) {
+    return _get_shard(shard, tid).thenValue(
+        [this, blob, tid, deadline](auto const e) mutable -> BlobManager::NullAsyncResult {
+            if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+            return _del_blob(e.value(), blob, tid, deadline);
+        });
+}
+
+BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::copy(shard_id_t src_shard, blob_id_t const& src_blob,
+                                                           shard_id_t dst_shard, trace_id_t tid,
+                                                           op_deadline_t deadline) {
+    return _get_shard(src_shard, tid).thenValue([this, src_blob, dst_shard, tid, deadline](auto const src) mutable {
+        return _get_shard(dst_shard, tid).thenValue(
+            [this, src, src_blob, tid, deadline](auto const dst) mutable -> BlobManager::AsyncResult< blob_id_t > {
+                if (!src || !dst) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+                if (ShardInfo::State::SEALED == dst.value().state)
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::SEALED_SHARD));
+                return _copy_blob(src.value(), src_blob, dst.value(), tid, deadline);
+            });
+    });
+}
+
+sisl::io_blob_safe HomeObjectImpl::alloc_io_buf(uint32_t size) const { return IoBufPool::alloc(size, io_align); }
+
+void HomeObjectImpl::release_io_buf(sisl::io_blob_safe&& buf) const { IoBufPool::release(std::move(buf), io_align); }
+
+BlobManager::AsyncResult< upload_id_t > HomeObjectImpl::create_upload(shard_id_t shard, trace_id_t tid) {
+    return _get_shard(shard, tid).thenValue([this, tid](auto const e) -> BlobManager::AsyncResult< upload_id_t > {
+        if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+        if (ShardInfo::State::SEALED == e.value().state)
+            return folly::makeUnexpected(BlobError(BlobErrorCode::SEALED_SHARD));
+        return _create_upload(e.value(), tid);
+    });
+}
+
+BlobManager::AsyncResult< UploadedPart > HomeObjectImpl::upload_part(shard_id_t shard, upload_id_t upload,
+                                                                     uint32_t part_no, sisl::io_blob_safe&& data,
+                                                                     trace_id_t tid, op_deadline_t deadline) {
+    return _get_shard(shard, tid).thenValue(
+        [this, upload, part_no, data = std::move(data), tid,
+         deadline](auto const e) mutable -> BlobManager::AsyncResult< UploadedPart > {
+            if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+            if (ShardInfo::State::SEALED == e.value().state)
+                return folly::makeUnexpected(BlobError(BlobErrorCode::SEALED_SHARD));
+            if (part_no == 0 || data.size() == 0) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            return _upload_part(e.value(), upload, part_no, std::move(data), tid, deadline);
+        });
+}
+
+BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::complete_upload(shard_id_t shard, upload_id_t upload,
+                                                                      std::vector< UploadedPart > const& parts,
+                                                                      std::string const& user_key, uint64_t object_off,
+                                                                      trace_id_t tid) {
+    return _get_shard(shard, tid).thenValue(
+        [this, upload, parts, user_key, object_off, tid](auto const e) -> BlobManager::AsyncResult< blob_id_t > {
+            if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
+            if (ShardInfo::State::SEALED == e.value().state)
+                return folly::makeUnexpected(BlobError(BlobErrorCode::SEALED_SHARD));
+            // parts are given in object order, each of them once
+            if (parts.empty()) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            for (size_t i = 1; i < parts.size(); ++i) {
+                if (parts[i].part_no <= parts[i - 1].part_no)
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            }
+            return _complete_upload(e.value(), upload, parts, user_key, object_off, tid);
         });
 }
 
-BlobManager::NullAsyncResult HomeObjectImpl::del(shard_id_t shard, blob_id_t const& blob, trace_id_t tid) {
-    return _get_shard(shard, tid).thenValue([this, blob, tid](auto const e) mutable -> BlobManager::NullAsyncResult {
+BlobManager::NullAsyncResult HomeObjectImpl::abort_upload(shard_id_t shard, upload_id_t upload, trace_id_t tid) {
+    return _get_shard(shard, tid).thenValue([this, upload, tid](auto const e) -> BlobManager::NullAsyncResult {
         if (!e) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_SHARD));
-        return _del_blob(e.value(), blob, tid);
+        return _abort_upload(e.value(), upload, tid);
     });
 }
 
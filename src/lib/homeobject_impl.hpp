@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+
 #include "homeobject/homeobject.hpp"
 #include "homeobject/blob_manager.hpp"
 #include "homeobject/pg_manager.hpp"
@@ -38,6 +41,22 @@ inline shard_id_t make_new_shard_id(pg_id_t pg, shard_id_t next_shard) {
     return ((uint64_t)pg << shard_width) | next_shard;
 }
 
+// Copy size bytes from src into the buffers of sgs, from offset on. The buffers must hold them.
+inline void copy_to_sg_list(sisl::sg_list const& sgs, uint64_t offset, uint8_t const* src, uint64_t size) {
+    for (auto const& iov : sgs.iovs) {
+        if (size == 0) { break; }
+        if (offset >= iov.iov_len) {
+            offset -= iov.iov_len;
+            continue;
+        }
+        auto const n = std::min< uint64_t >(size, iov.iov_len - offset);
+        std::memcpy(static_cast< uint8_t* >(iov.iov_base) + offset, src, n);
+        src += n;
+        size -= n;
+        offset = 0;
+    }
+}
+
 struct Shard {
     explicit Shard(ShardInfo info) : info(std::move(info)) {}
     virtual ~Shard() = default;
@@ -90,10 +109,29 @@ class HomeObjectImpl : public HomeObject,
     virtual ShardManager::AsyncResult< ShardInfo > _create_shard(pg_id_t, uint64_t size_bytes, trace_id_t tid) = 0;
     virtual ShardManager::AsyncResult< ShardInfo > _seal_shard(ShardInfo const&, trace_id_t tid) = 0;
 
-    virtual BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&, trace_id_t tid) = 0;
+    virtual BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&, trace_id_t tid,
+                                                            op_deadline_t deadline) = 0;
     virtual BlobManager::AsyncResult< Blob > _get_blob(ShardInfo const&, blob_id_t, uint64_t off, uint64_t len,
-                                                       trace_id_t tid) const = 0;
-    virtual BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t, trace_id_t tid) = 0;
+                                                       trace_id_t tid, op_deadline_t deadline) const = 0;
+    virtual BlobManager::AsyncResult< std::unique_ptr< BlobStream > >
+    _get_stream(ShardInfo const&, blob_id_t, uint64_t off, uint64_t len, trace_id_t tid,
+                op_deadline_t deadline) const = 0;
+    virtual BlobManager::AsyncResult< BlobRead > _get_blob_into(ShardInfo const&, blob_id_t, sisl::sg_list const& dest,
+                                                                uint64_t off, uint64_t len, trace_id_t tid,
+                                                                op_deadline_t deadline) const = 0;
+    virtual BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t, trace_id_t tid,
+                                                   op_deadline_t deadline) = 0;
+    virtual BlobManager::AsyncResult< blob_id_t > _copy_blob(ShardInfo const& src, blob_id_t, ShardInfo const& dst,
+                                                             trace_id_t tid, op_deadline_t deadline) = 0;
+    virtual BlobManager::AsyncResult< upload_id_t > _create_upload(ShardInfo const&, trace_id_t tid) = 0;
+    virtual BlobManager::AsyncResult< UploadedPart > _upload_part(ShardInfo const&, upload_id_t, uint32_t part_no,
+                                                                  sisl::io_blob_safe&& data, trace_id_t tid,
+                                                                  op_deadline_t deadline) = 0;
+    virtual BlobManager::AsyncResult< blob_id_t > _complete_upload(ShardInfo const&, upload_id_t,
+                                                                   std::vector< UploadedPart > const& parts,
+                                                                   std::string const& user_key, uint64_t object_off,
+                                                                   trace_id_t tid) = 0;
+    virtual BlobManager::NullAsyncResult _abort_upload(ShardInfo const&, upload_id_t, trace_id_t tid) = 0;
     ///
 
     virtual PGManager::NullAsyncResult _create_pg(PGInfo&& pg_info, std::set< peer_id_t > const& peers,
@@ -160,10 +198,30 @@ public:
     uint64_t get_current_timestamp();
 
     /// BlobManager
-    BlobManager::AsyncResult< blob_id_t > put(shard_id_t shard, Blob&&, trace_id_t tid) final;
-    BlobManager::AsyncResult< Blob > get(shard_id_t shard, blob_id_t const& blob, uint64_t off,
-                                         uint64_t len, trace_id_t tid) const final;
-    BlobManager::NullAsyncResult del(shard_id_t shard, blob_id_t const& blob, trace_id_t tid) final;
+    BlobManager::AsyncResult< blob_id_t > put(shard_id_t shard, Blob&&, trace_id_t tid, op_deadline_t deadline) final;
+    BlobManager::AsyncResult< Blob > get(shard_id_t shard, blob_id_t const& blob, uint64_t off, uint64_t len,
+                                         trace_id_t tid, op_deadline_t deadline) const final;
+    BlobManager::AsyncResult< std::unique_ptr< BlobStream > > get_stream(shard_id_t shard, blob_id_t const& blob,
+                                                                         uint64_t off, uint64_t len, trace_id_t tid,
+                                                                         op_deadline_t deadline) const final;
+    BlobManager::AsyncResult< BlobRead > get_into(shard_id_t shard, blob_id_t const& blob, sisl::sg_list const& dest,
+                                                  uint64_t off, uint64_t len, trace_id_t tid,
+                                                  op_deadline_t deadline) const final;
+    BlobManager::NullAsyncResult del(shard_id_t shard, blob_id_t const& blob, trace_id_t tid,
+                                     op_deadline_t deadline) final;
+    BlobManager::AsyncResult< blob_id_t > copy(shard_id_t src_shard, blob_id_t const& src_blob, shard_id_t dst_shard,
+                                               trace_id_t tid, op_deadline_t deadline) final;
+    BlobManager::AsyncResult< upload_id_t > create_upload(shard_id_t shard, trace_id_t tid) final;
+    BlobManager::AsyncResult< UploadedPart > upload_part(shard_id_t shard, upload_id_t upload, uint32_t part_no,
+                                                         sisl::io_blob_safe&& data, trace_id_t tid,
+                                                         op_deadline_t deadline) final;
+    BlobManager::AsyncResult< blob_id_t > complete_upload(shard_id_t shard, upload_id_t upload,
+                                                          std::vector< UploadedPart > const& parts,
+                                                          std::string const& user_key, uint64_t object_off,
+                                                          trace_id_t tid) final;
+    BlobManager::NullAsyncResult abort_upload(shard_id_t shard, upload_id_t upload, trace_id_t tid) final;
+    sisl::io_blob_safe alloc_io_buf(uint32_t size) const final;
+    void release_io_buf(sisl::io_blob_safe&& buf) const final;
 };
 
 } // namespace homeobject
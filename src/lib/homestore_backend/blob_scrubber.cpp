@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <map>
+#include <thread>
+
+#include "blob_scrubber.hpp"
+#include "hs_homeobject.hpp"
+#include "hs_backend_config.hpp"
+#include "multipart_upload.hpp"
+
+namespace homeobject {
+
+// How often the timer checks whether a pass is due
+static constexpr uint64_t scrub_check_interval_sec{60};
+
+static uint64_t now_sec() {
+    return std::chrono::duration_cast< std::chrono::seconds >(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+BlobScrubber::~BlobScrubber() { stop(); }
+
+void BlobScrubber::start() {
+    stopping_ = false;
+    executor_ = std::make_shared< folly::IOThreadPoolExecutor >(1);
+    timer_hdl_ = iomanager.schedule_global_timer(
+        scrub_check_interval_sec * 1000 * 1000 * 1000, true, nullptr /*cookie*/, iomgr::reactor_regex::all_user,
+        [this](void*) { on_timer(); }, true /* wait_to_schedule */);
+    LOGINFO("blob scrubber timer has started, last pass started at {}", last_pass_start_);
+}
+
+void BlobScrubber::stop() {
+    stopping_ = true;
+    if (timer_hdl_ != iomgr::null_timer_handle) {
+        iomanager.cancel_timer(timer_hdl_, true);
+        timer_hdl_ = iomgr::null_timer_handle;
+    }
+    if (executor_) {
+        executor_->join();
+        executor_.reset();
+        LOGINFO("blob scrubber stopped");
+    }
+}
+
+void BlobScrubber::on_timer() {
+    if (!HS_BACKEND_DYNAMIC_CONFIG(scrub_enabled) || running_) { return; }
+    uint64_t last_start;
+    {
+        std::scoped_lock lock(mtx_);
+        last_start = last_pass_start_;
+    }
+    if (now_sec() < last_start + HS_BACKEND_DYNAMIC_CONFIG(scrub_interval_sec)) { return; }
+    trigger();
+}
+
+bool BlobScrubber::trigger(std::optional< pg_id_t > pg_id) {
+    if (!executor_ || stopping_) { return false; }
+    if (running_.exchange(true)) { return false; }
+    executor_->add([this, pg_id]() {
+        GAUGE_UPDATE(metrics_, scrub_running, 1);
+        run_pass(pg_id);
+        GAUGE_UPDATE(metrics_, scrub_running, 0);
+        running_ = false;
+    });
+    return true;
+}
+
+void BlobScrubber::run_pass(std::optional< pg_id_t > pg_id) {
+    std::vector< pg_id_t > pg_ids;
+    if (pg_id) {
+        pg_ids.push_back(*pg_id);
+    } else {
+        ho_.pg_manager()->get_pg_ids(pg_ids);
+    }
+
+    {
+        std::scoped_lock lock(mtx_);
+        // what this pass finds replaces what was reported for its pgs
+        std::erase_if(corrupt_, [&pg_ids](CorruptBlob const& c) {
+            return std::find(pg_ids.begin(), pg_ids.end(), c.pg_id) != pg_ids.end();
+        });
+        pass_blobs_ = 0;
+        pass_errors_ = 0;
+    }
+    // a pass over a single pg on demand does not postpone the next full one
+    if (!pg_id) { persist(true /* pass_start */); }
+
+    LOGI("Scrub pass started over {} pgs", pg_ids.size());
+    for (auto const id : pg_ids) {
+        if (stopping_) { break; }
+        scrub_pg(id);
+    }
+
+    if (!pg_id && !stopping_) { persist(false /* pass_start */); }
+    std::scoped_lock lock(mtx_);
+    LOGI("Scrub pass {}, verified {} blobs, {} failed verification", stopping_ ? "interrupted" : "done", pass_blobs_,
+         pass_errors_);
+}
+
+void BlobScrubber::scrub_pg(pg_id_t pg_id) {
+    auto shards = ho_.shard_manager()->list_shards(pg_id).get();
+    if (!shards) {
+        LOGW("Scrub of pg={} skipped, failed to list its shards, err={}", pg_id, shards.error());
+        return;
+    }
+
+    // group the shards by chunk, so that each chunk is read from start to end
+    std::map< homestore::chunk_num_t, std::vector< ShardInfo > > chunk_shards;
+    for (auto const& info : shards.value()) {
+        auto const chunk_id = ho_.get_shard_p_chunk_id(info.id);
+        if (chunk_id) { chunk_shards[*chunk_id].push_back(info); }
+    }
+
+    for (auto& [chunk_id, infos] : chunk_shards) {
+        std::sort(infos.begin(), infos.end());
+        auto const chunk_start = Clock::now();
+        bool chunk_clean{true};
+        homestore::blk_num_t verified_upto{0};
+
+        for (auto const& info : infos) {
+            // the digest is rebuilt on the way if it went stale and the shard stays quiet meanwhile
+            auto const cur = ho_.shard_digests()->get(info.id);
+            auto const rebuild_digest = !cur || cur->stale;
+            auto const digest_version = cur ? cur->version : 0;
+            ShardDigestTable::Digest digest;
+            bool shard_clean{true};
+            // the parts and manifests of multi-part uploads read on the way, to find the orphan parts
+            MultipartUploads::ShardScan multipart_scan;
+
+            blob_id_t next_blob_id{0};
+            while (true) {
+                if (stopping_) { return; }
+                auto blobs = ho_.query_blobs_in_shard(pg_id, HSHomeObject::get_sequence_num_from_shard_id(info.id),
+                                                      next_blob_id, blob_batch_size);
+                if (!blobs) {
+                    LOGW("Scrub of shardID=0x{:x} stopped, failed to query its blobs, err={}", info.id, blobs.error());
+                    shard_clean = false;
+                    break;
+                }
+                if (blobs->empty()) { break; }
+                next_blob_id = blobs->back().blob_id + 1;
+
+                auto& batch = blobs.value();
+                std::sort(batch.begin(), batch.end(),
+                          [](auto const& l, auto const& r) { return l.pbas.blk_num() < r.pbas.blk_num(); });
+                for (auto const& blob : batch) {
+                    if (blob.pbas == HSHomeObject::tombstone_pbas) { continue; }
+                    auto const bytes = blob.pbas.blk_count() * homestore::data_service().get_blk_size();
+                    if (!wait_turn(pg_id, bytes)) { return; }
+                    auto hs_pg = ho_.get_hs_pg(pg_id);
+                    if (hs_pg == nullptr) { return; }
+                    // the pg may be destroyed meanwhile, keep it until the blob is verified
+                    hs_pg->pin();
+
+                    auto const observe = [&multipart_scan, blob_id = blob.blob_id](uint8_t const* image, size_t size) {
+                        multipart_scan.observe(blob_id, image, size);
+                    };
+                    auto r = ho_.verify_blob(hs_pg, blob, observe).get();
+                    hs_pg->unpin();
+                    COUNTER_INCREMENT(metrics_, scrub_blobs_verified, 1);
+                    COUNTER_INCREMENT(metrics_, scrub_bytes_verified, bytes);
+                    {
+                        std::scoped_lock lock(mtx_);
+                        ++pass_blobs_;
+                    }
+                    if (!r) {
+                        shard_clean = false;
+                        record_corrupt(pg_id, info.id, blob.blob_id, r.error().getCode());
+                        continue;
+                    }
+                    verified_upto = std::max(verified_upto, static_cast< homestore::blk_num_t >(
+                                                                blob.pbas.blk_num() + blob.pbas.blk_count()));
+                    if (rebuild_digest) {
+                        auto const e = ShardDigestTable::element(blob.blob_id, r.value());
+                        digest.digest ^= e;
+                        digest.buckets[blob.blob_id / ShardDigestTable::bucket_width] ^= e;
+                        ++digest.blob_count;
+                    }
+                }
+                if (batch.size() < blob_batch_size) { break; }
+            }
+
+            chunk_clean &= shard_clean;
+            auto const num_blobs = digest.blob_count;
+            if (rebuild_digest && shard_clean &&
+                ho_.shard_digests()->rebuild(info.id, digest_version, std::move(digest),
+                                             info.state == ShardInfo::State::SEALED)) {
+                LOGI("Rebuilt the digest of shardID=0x{:x} from its {} blobs", info.id, num_blobs);
+                COUNTER_INCREMENT(metrics_, scrub_digests_rebuilt, 1);
+            }
+            // a manifest which failed verification may list parts that look orphan
+            if (shard_clean) { ho_.multipart_uploads()->sweep(pg_id, info.id, std::move(multipart_scan)); }
+        }
+
+        if (chunk_clean) {
+            chunks_.insert_or_assign(chunk_id, ChunkState{chunk_start, verified_upto});
+        } else {
+            chunks_.erase(chunk_id);
+        }
+    }
+}
+
+bool BlobScrubber::wait_turn(pg_id_t pg_id, uint64_t bytes) {
+    // leave the pg alone while its clients are busy
+    auto const max_inflight = HS_BACKEND_DYNAMIC_CONFIG(scrub_yield_inflight_requests);
+    while (max_inflight != 0) {
+        if (stopping_) { return false; }
+        auto hs_pg = ho_.get_hs_pg(pg_id);
+        if (hs_pg == nullptr) { return false; }
+        if (hs_pg->inflight_requests_.get() <= int64_t(max_inflight)) { break; }
+        COUNTER_INCREMENT(metrics_, scrub_yield_ms, 10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto const mbps = HS_BACKEND_DYNAMIC_CONFIG(scrub_mbps);
+    if (mbps == 0) { return !stopping_; }
+    auto const rate = double(mbps * Mi); // bytes per second
+    auto const now = Clock::now();
+    // allow a burst of one second worth of reads
+    tokens_ = (last_refill_ == Clock::time_point{})
+        ? rate
+        : std::min(rate, tokens_ + std::chrono::duration< double >(now - last_refill_).count() * rate);
+    last_refill_ = now;
+    tokens_ -= bytes;
+    if (tokens_ < 0) {
+        auto const wait = std::chrono::microseconds(static_cast< int64_t >(-tokens_ / rate * 1e6));
+        COUNTER_INCREMENT(metrics_, scrub_throttled_wait_ms, wait.count() / 1000);
+        std::this_thread::sleep_for(wait);
+    }
+    return !stopping_;
+}
+
+void BlobScrubber::record_corrupt(pg_id_t pg_id, shard_id_t shard_id, blob_id_t blob_id, BlobErrorCode error) {
+    LOGE("Scrub found blob_id={} of shardID=0x{:x}, pg={}, shard=0x{:x} unreadable or corrupted, err={}", blob_id,
+         shard_id, pg_id, (shard_id & homeobject::shard_mask), error);
+    if (error == BlobErrorCode::READ_FAILED) {
+        COUNTER_INCREMENT(metrics_, scrub_read_errors, 1);
+    } else {
+        COUNTER_INCREMENT(metrics_, scrub_checksum_errors, 1);
+    }
+
+    std::scoped_lock lock(mtx_);
+    ++pass_errors_;
+    ++corrupt_blobs_found_;
+    if (corrupt_.size() == max_corrupt_reported) { corrupt_.pop_front(); }
+    corrupt_.push_back(CorruptBlob{pg_id, shard_id, blob_id, error, std::chrono::system_clock::now()});
+}
+
+bool BlobScrubber::recently_verified(homestore::MultiBlkId const& blkid) const {
+    auto const window = HS_BACKEND_DYNAMIC_CONFIG(scrub_skip_verify_window_sec);
+    if (window == 0) { return false; }
+    auto it = chunks_.find(blkid.chunk_num());
+    if (it == chunks_.end()) { return false; }
+    return blkid.blk_num() + blkid.blk_count() <= it->second.verified_upto &&
+        Clock::now() - it->second.verified_at < std::chrono::seconds(window);
+}
+
+void BlobScrubber::forget_chunk(homestore::chunk_num_t chunk_id) { chunks_.erase(chunk_id); }
+
+nlohmann::json BlobScrubber::dump() const {
+    nlohmann::json j;
+    j["enabled"] = HS_BACKEND_DYNAMIC_CONFIG(scrub_enabled);
+    j["running"] = running_.load();
+    j["verified_chunks"] = chunks_.size();
+    std::scoped_lock lock(mtx_);
+    j["last_pass_start"] = last_pass_start_;
+    j["last_pass_end"] = last_pass_end_;
+    j["pass_blobs_verified"] = pass_blobs_;
+    j["pass_blobs_failed"] = pass_errors_;
+    j["corrupt_blobs_found"] = corrupt_blobs_found_;
+    auto corrupt = nlohmann::json::array();
+    for (auto const& c : corrupt_) {
+        corrupt.push_back({{"pg_id", c.pg_id},
+                           {"shard_id", c.shard_id},
+                           {"blob_id", c.blob_id},
+                           {"error", fmt::format("{}", c.error)},
+                           {"found_at", std::chrono::duration_cast< std::chrono::seconds >(
+                                            c.found_at.time_since_epoch())
+                                            .count()}});
+    }
+    j["corrupt"] = std::move(corrupt);
+    return j;
+}
+
+void BlobScrubber::persist(bool pass_start) {
+    std::scoped_lock lock(mtx_);
+    if (pass_start) {
+        last_pass_start_ = now_sec();
+    } else {
+        last_pass_end_ = now_sec();
+    }
+    if (sb_.is_empty()) { sb_.create(sizeof(scrubber_superblk)); }
+    sb_->last_pass_start = last_pass_start_;
+    sb_->last_pass_end = last_pass_end_;
+    sb_->corrupt_blobs_found = corrupt_blobs_found_;
+    sb_.write();
+}
+
+void BlobScrubber::on_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf) {
+    std::scoped_lock lock(mtx_);
+    sb_.load(buf, mblk);
+    last_pass_start_ = sb_->last_pass_start;
+    last_pass_end_ = sb_->last_pass_end;
+    corrupt_blobs_found_ = sb_->corrupt_blobs_found;
+}
+
+} // namespace homeobject
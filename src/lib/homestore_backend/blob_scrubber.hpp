@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <homestore/blk.h>
+#include <homestore/superblk_handler.hpp>
+#include <iomgr/iomgr.hpp>
+#include <nlohmann/json.hpp>
+#include <sisl/metrics/metrics.hpp>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+class HSHomeObject;
+
+/**
+ * Background verification of the blob checksums, so that latent sector errors on cold data are found before a client
+ * reads it.
+ *
+ * A pass walks the index of every pg, chunk by chunk, and reads the live blobs of each chunk in block order through
+ * the pg io scheduler as background io. Reads are capped by a token bucket (scrub_mbps) and a pg is left alone while
+ * it has more than scrub_yield_inflight_requests client requests in flight. A new pass starts scrub_interval_sec after
+ * the previous one started, the start time survives restarts.
+ *
+ * Blobs failing verification are only reported (metrics and the http api), a client read of such a blob fails with
+ * CHECKSUM_MISMATCH and is served by another replica.
+ * TODO: repair them from a peer. on_fetch_data / fetch_imported_blobs only serve the data of a log entry to a replica
+ * applying that entry, a follower has no way to pull an arbitrary committed blob nor to ask the leader to replicate it
+ * again. Until there is, a replica holding corrupt blobs is repaired by replacing it (replace_member), the new member
+ * is resynced from the leader.
+ * Shard digests which went stale are rebuilt from the payload crcs read along the way. The parts of multi-part uploads
+ * which no manifest of their shard lists are handed over to MultipartUploads::sweep().
+ *
+ * The chunks whose blobs all verified fine are remembered with the time of the pass and the block up to which they
+ * were verified, client reads of those blocks may then skip checksum verification (scrub_skip_verify_window_sec).
+ */
+class BlobScrubber {
+public:
+    inline static auto const _scrubber_meta_name = std::string("BlobScrubber");
+
+#pragma pack(1)
+    struct scrubber_superblk {
+        uint64_t last_pass_start; // seconds since epoch
+        uint64_t last_pass_end;
+        uint64_t corrupt_blobs_found; // total over all the passes
+    };
+#pragma pack()
+
+    struct ScrubMetrics : public sisl::MetricsGroup {
+        ScrubMetrics() : sisl::MetricsGroup("blob_scrubber", "node") {
+            REGISTER_GAUGE(scrub_running, "Whether a scrub pass is running");
+            REGISTER_COUNTER(scrub_blobs_verified, "Blobs read back and verified by the scrubber");
+            REGISTER_COUNTER(scrub_bytes_verified, "Bytes read back and verified by the scrubber");
+            REGISTER_COUNTER(scrub_checksum_errors, "Blobs found corrupted by the scrubber");
+            REGISTER_COUNTER(scrub_read_errors, "Blobs the scrubber failed to read");
+            REGISTER_COUNTER(scrub_digests_rebuilt, "Stale shard digests rebuilt by the scrubber");
+            REGISTER_COUNTER(scrub_throttled_wait_ms, "Time the scrubber waited for the bandwidth cap");
+            REGISTER_COUNTER(scrub_yield_ms, "Time the scrubber waited for client io to calm down");
+            register_me_to_farm();
+        }
+        ~ScrubMetrics() { deregister_me_from_farm(); }
+        ScrubMetrics(const ScrubMetrics&) = delete;
+        ScrubMetrics(ScrubMetrics&&) noexcept = delete;
+        ScrubMetrics& operator=(const ScrubMetrics&) = delete;
+        ScrubMetrics& operator=(ScrubMetrics&&) noexcept = delete;
+    };
+
+    struct CorruptBlob {
+        pg_id_t pg_id;
+        shard_id_t shard_id;
+        blob_id_t blob_id;
+        BlobErrorCode error;
+        std::chrono::system_clock::time_point found_at;
+    };
+
+    explicit BlobScrubber(HSHomeObject& ho) : ho_(ho) {}
+    ~BlobScrubber();
+    BlobScrubber(const BlobScrubber&) = delete;
+    BlobScrubber(BlobScrubber&&) = delete;
+    BlobScrubber& operator=(const BlobScrubber&) = delete;
+    BlobScrubber& operator=(BlobScrubber&&) = delete;
+
+    void start();
+    // Stops the timer and waits for the running pass, if any, to stop.
+    void stop();
+
+    /**
+     * @brief Start a pass right away, over the given pg only if any, regardless of scrub_enabled.
+     *
+     * @return false if a pass is already running.
+     */
+    bool trigger(std::optional< pg_id_t > pg_id = std::nullopt);
+    bool running() const { return running_.load(); }
+
+    // Whether a client read of the blocks may skip checksum verification, see scrub_skip_verify_window_sec.
+    bool recently_verified(homestore::MultiBlkId const& blkid) const;
+    // The chunk is reset and will be written from scratch, what was verified in it no longer holds.
+    void forget_chunk(homestore::chunk_num_t chunk_id);
+
+    nlohmann::json dump() const;
+    void on_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr uint64_t blob_batch_size{256};
+    static constexpr size_t max_corrupt_reported{1024};
+
+    struct ChunkState {
+        Clock::time_point verified_at;
+        // blocks below it held only blobs which verified fine
+        homestore::blk_num_t verified_upto;
+    };
+
+    void on_timer();
+    void run_pass(std::optional< pg_id_t > pg_id);
+    void scrub_pg(pg_id_t pg_id);
+    // false if the pg is gone or the scrubber is stopping
+    bool wait_turn(pg_id_t pg_id, uint64_t bytes);
+    void record_corrupt(pg_id_t pg_id, shard_id_t shard_id, blob_id_t blob_id, BlobErrorCode error);
+    void persist(bool pass_start);
+
+    HSHomeObject& ho_;
+    std::atomic_bool running_{false};
+    std::atomic_bool stopping_{false};
+    iomgr::timer_handle_t timer_hdl_{iomgr::null_timer_handle};
+    std::shared_ptr< folly::IOThreadPoolExecutor > executor_;
+
+    folly::ConcurrentHashMap< homestore::chunk_num_t, ChunkState > chunks_;
+
+    // bandwidth token bucket, in bytes, only touched by the pass
+    double tokens_{0};
+    Clock::time_point last_refill_{};
+
+    mutable std::mutex mtx_;
+    std::deque< CorruptBlob > corrupt_;
+    uint64_t pass_blobs_{0};
+    uint64_t pass_errors_{0};
+    homestore::superblk< scrubber_superblk > sb_{_scrubber_meta_name};
+    uint64_t last_pass_start_{0};
+    uint64_t last_pass_end_{0};
+    uint64_t corrupt_blobs_found_{0};
+
+    ScrubMetrics metrics_;
+};
+
+} // namespace homeobject
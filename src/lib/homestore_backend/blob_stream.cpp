@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <deque>
+#include <functional>
+
+#include <folly/futures/Future.h>
+#include <homestore/crc.h>
+
+#include "hs_backend_config.hpp"
+#include "hs_homeobject.hpp"
+#include "lib/io_buf_pool.hpp"
+#include "multipart_upload.hpp"
+
+namespace homeobject {
+
+namespace {
+using BlobHeader = HSHomeObject::BlobHeader;
+using chunk_read = folly::Future< BlobManager::Result< pooled_io_buf > >;
+
+/**
+ * A range of a blob read in chunk sized, block aligned reads of its blocks. At most stream_readahead_chunks reads are
+ * in flight or done and not yet taken by the consumer, taking one with next() issues the following one.
+ *
+ * The payload crc is folded in read by read as they are taken. It takes the whole payload, so unless the scrubber has
+ * just verified the blob the reads span the whole payload whatever the range: the reads outside the range are only
+ * folded in, and the chunk holding the end of the range is held back until the crc is checked.
+ */
+class HSBlobStream : public BlobStream {
+public:
+    HSBlobStream(HSHomeObject const& ho, const HSHomeObject::HS_PG* hs_pg, shard_id_t shard_id, blob_id_t blob_id,
+                 homestore::MultiBlkId const& blkid, trace_id_t tid, op_deadline_t deadline) :
+            ho_(ho),
+            hs_pg_(hs_pg),
+            shard_id_(shard_id),
+            blob_id_(blob_id),
+            blkid_(blkid),
+            tid_(tid),
+            deadline_(deadline),
+            blk_size_(hs_pg->repl_dev_->get_blk_size()),
+            image_size_(blkid.blk_count() * blk_size_),
+            chunk_size_(std::max(blk_size_,
+                                 sisl::round_up(uint64_t{HS_BACKEND_DYNAMIC_CONFIG(stream_chunk_size_kb)} * Ki,
+                                                blk_size_))),
+            readahead_(std::max(1u, HS_BACKEND_DYNAMIC_CONFIG(stream_readahead_chunks))) {
+        // the stream outlives the request which opened it, the pg must stay around until it is dropped
+        hs_pg_->pin();
+    }
+
+    // reads still in flight count as requests of the pg themselves
+    ~HSBlobStream() override { hs_pg_->unpin(); }
+
+    std::string const& user_key() const override { return user_key_; }
+    uint64_t object_off() const override { return object_off_; }
+    uint64_t size() const override { return end_ - off_; }
+    bool is_manifest() const { return manifest_; }
+
+    chunk_read read(uint64_t offset, uint64_t size) const {
+        return ho_.read_blob_blocks(hs_pg_, blkid_, offset, size);
+    }
+    // The first read of the stream, it holds the header and user key of any blob short of a huge user key
+    chunk_read read_head() const { return read(0, std::min(chunk_size_, image_size_)); }
+
+    // Take the header and user key off the head of the blob, returns how much of the blob the head has to cover if it
+    // is short of it: the header and user key, and the whole payload for a manifest.
+    BlobManager::Result< uint64_t > parse_head(pooled_io_buf const& head) {
+        auto const header = r_cast< BlobHeader const* >(head.cbytes());
+        if (!header->valid() || header->shard_id != shard_id_ ||
+            uint64_t{header->data_offset} + header->blob_size > image_size_) {
+            LOGE("traceID={}, shardID=0x{:x}, blob={}, invalid header found for stream: [header={}]", tid_, shard_id_,
+                 blob_id_, header->to_string());
+            return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+        }
+        manifest_ = header->type == HSHomeObject::DataHeader::data_type_t::MULTIPART_MANIFEST;
+        uint64_t const head_end = manifest_ ? uint64_t{header->data_offset} + header->blob_size : header->data_offset;
+        auto const needed = sisl::round_up(head_end, blk_size_);
+        if (needed > head.size()) { return needed; }
+
+        algorithm_ = header->hash_algorithm;
+        std::memcpy(hash_, header->hash, BlobHeader::blob_max_hash_len);
+        data_offset_ = header->data_offset;
+        blob_size_ = header->blob_size;
+        object_off_ = header->object_offset;
+        user_key_.assign(r_cast< char const* >(head.cbytes() + sizeof(BlobHeader)), header->user_key_size);
+        return 0;
+    }
+
+    // The parts listed by the manifest in the head, once its payload checks out
+    BlobManager::Result< std::vector< multipart_manifest_entry > > manifest(pooled_io_buf const& head) const {
+        uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
+        ho_.compute_blob_payload_hash(algorithm_, head.cbytes() + data_offset_, blob_size_,
+                                      r_cast< uint8_t const* >(user_key_.data()), user_key_.size(), computed_hash,
+                                      BlobHeader::blob_max_hash_len);
+        if (std::memcmp(computed_hash, hash_, BlobHeader::blob_max_hash_len) != 0) {
+            LOGE("traceID={}, shardID=0x{:x}, blob={}, hash mismatch of multi-part manifest", tid_, shard_id_,
+                 blob_id_);
+            return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+        }
+        auto entries = multipart_manifest_entries(head.cbytes() + data_offset_, blob_size_);
+        if (!entries) {
+            LOGE("traceID={}, shardID=0x{:x}, blob={}, invalid multi-part manifest", tid_, shard_id_, blob_id_);
+            return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+        }
+        return std::move(*entries);
+    }
+
+    // Set the range up and start reading ahead, the head is the first read taken if the range needs it
+    BlobManager::NullResult start(pooled_io_buf&& head, uint64_t off, uint64_t len) {
+        if (off + len > blob_size_) {
+            LOGE("traceID={}, shardID=0x{:x}, blob={}, invalid range requested in stream offset={} len={} size={}",
+                 tid_, shard_id_, blob_id_, off, len, blob_size_);
+            return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+        }
+        off_ = off;
+        end_ = len ? off + len : blob_size_;
+        // blocks the scrubber verified a moment ago are trusted, see scrub_skip_verify_window_sec
+        verify_ = off_ < end_ && algorithm_ == BlobHeader::HashAlgorithm::CRC32 &&
+            !ho_.scrubber()->recently_verified(blkid_);
+        if (off_ == end_) { return folly::Unit(); }
+
+        auto const from = verify_ ? data_offset_ : data_offset_ + off_;
+        auto const to = verify_ ? data_offset_ + blob_size_ : data_offset_ + end_;
+        read_end_ = std::min(image_size_, sisl::round_up(to, blk_size_));
+        if (from < head.size()) {
+            read_pos_ = head.size();
+            reads_.emplace_back(0, folly::makeFuture< BlobManager::Result< pooled_io_buf > >(std::move(head)));
+        } else {
+            read_pos_ = from / blk_size_ * blk_size_;
+        }
+        fill();
+        return folly::Unit();
+    }
+
+    AsyncResult< sisl::io_blob_safe > next() override {
+        if (failed_) { return folly::makeUnexpected(*failed_); }
+        if (reads_.empty()) { return sisl::io_blob_safe{}; }
+        if (deadline_expired(deadline_)) { return fail(BlobErrorCode::DEADLINE_EXCEEDED); }
+
+        auto [pos, chunk] = std::move(reads_.front());
+        reads_.pop_front();
+        fill();
+        return std::move(chunk).thenValue([this, pos = pos](auto&& r) -> AsyncResult< sisl::io_blob_safe > {
+            if (!r) { return fail(r.error()); }
+            return take(pos, r.value());
+        });
+    }
+
+private:
+    void fill() {
+        while (reads_.size() < readahead_ && read_pos_ < read_end_) {
+            auto const n = std::min(chunk_size_, read_end_ - read_pos_);
+            reads_.emplace_back(read_pos_, read(read_pos_, n));
+            read_pos_ += n;
+        }
+    }
+
+    // Fold in and cut the range out of the read of the blob image at pos
+    AsyncResult< sisl::io_blob_safe > take(uint64_t pos, pooled_io_buf const& buf) {
+        auto const buf_end = pos + buf.size();
+        auto const payload_from = std::max(pos, data_offset_);
+        auto const payload_to = std::min(buf_end, data_offset_ + blob_size_);
+        if (verify_ && payload_from < payload_to) {
+            crc_ = crc32_ieee(crc_, buf.cbytes() + (payload_from - pos), payload_to - payload_from);
+        }
+
+        sisl::io_blob_safe out;
+        auto const range_from = std::max(pos, data_offset_ + off_);
+        auto const range_to = std::min(buf_end, data_offset_ + end_);
+        if (range_from < range_to) {
+            out = sisl::io_blob_safe(range_to - range_from);
+            std::memcpy(out.bytes(), buf.cbytes() + (range_from - pos), range_to - range_from);
+        }
+
+        bool const last = reads_.empty();
+        if (verify_ && !last && range_from < range_to && range_to == data_offset_ + end_) {
+            // the end of the range is not handed out before the crc is checked
+            held_ = std::move(out);
+            return next();
+        }
+        if (last && verify_) {
+            if (!crc_matches()) { return fail(BlobErrorCode::CHECKSUM_MISMATCH); }
+            if (held_.size()) { out = std::move(held_); }
+        }
+        if (out.size() == 0) { return last ? AsyncResult< sisl::io_blob_safe >(std::move(out)) : next(); }
+
+        if (!first_chunk_out_) {
+            first_chunk_out_ = true;
+            HISTOGRAM_OBSERVE(hs_pg_->metrics_, blob_stream_first_chunk_latency, get_elapsed_time_us(opened_));
+        }
+        COUNTER_INCREMENT(hs_pg_->metrics_, streamed_bytes, out.size());
+        return out;
+    }
+
+    bool crc_matches() const {
+        auto crc = crc_;
+        if (!user_key_.empty()) { crc = crc32_ieee(crc, r_cast< uint8_t const* >(user_key_.data()), user_key_.size()); }
+        uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
+        std::memcpy(computed_hash, &crc, sizeof(uint32_t));
+        if (std::memcmp(computed_hash, hash_, BlobHeader::blob_max_hash_len) == 0) { return true; }
+        LOGE("traceID={}, shardID=0x{:x}, blob={}, hash mismatch in stream, computed crc={:#x}", tid_, shard_id_,
+             blob_id_, crc);
+        return false;
+    }
+
+    AsyncResult< sisl::io_blob_safe > fail(BlobError const& e) {
+        failed_ = e;
+        reads_.clear();
+        held_ = sisl::io_blob_safe{};
+        return folly::makeUnexpected(e);
+    }
+
+    HSHomeObject const& ho_;
+    const HSHomeObject::HS_PG* hs_pg_;
+    shard_id_t const shard_id_;
+    blob_id_t const blob_id_;
+    homestore::MultiBlkId const blkid_;
+    trace_id_t const tid_;
+    op_deadline_t const deadline_;
+    uint64_t const blk_size_;
+    uint64_t const image_size_;
+    uint64_t const chunk_size_;
+    uint32_t const readahead_;
+
+    // of the header
+    bool manifest_{false};
+    BlobHeader::HashAlgorithm algorithm_{BlobHeader::HashAlgorithm::NONE};
+    uint8_t hash_[BlobHeader::blob_max_hash_len]{};
+    uint64_t data_offset_{0};
+    uint64_t blob_size_{0};
+    uint64_t object_off_{0};
+    std::string user_key_;
+
+    // range of the payload streamed
+    uint64_t off_{0};
+    uint64_t end_{0};
+    bool verify_{false};
+    uint32_t crc_{init_crc32};
+
+    // offsets in the blob image
+    uint64_t read_pos_{0};
+    uint64_t read_end_{0};
+    std::deque< std::pair< uint64_t, chunk_read > > reads_;
+    sisl::io_blob_safe held_;
+    std::optional< BlobError > failed_;
+
+    Clock::time_point const opened_{Clock::now()};
+    bool first_chunk_out_{false};
+};
+
+/**
+ * A range of a multi-part object, streamed from the ranges of the parts it overlaps one part after the other.
+ */
+class MultipartBlobStream : public BlobStream {
+public:
+    struct Piece {
+        blob_id_t blob_id;
+        uint64_t off; // in the part
+        uint64_t len;
+    };
+    using opener_t = std::function< BlobManager::AsyncResult< std::unique_ptr< BlobStream > >(Piece const&) >;
+
+    MultipartBlobStream(std::vector< Piece >&& pieces, std::string&& user_key, uint64_t object_off, opener_t&& open) :
+            pieces_(std::move(pieces)),
+            user_key_(std::move(user_key)),
+            object_off_(object_off),
+            open_(std::move(open)) {
+        for (auto const& p : pieces_) {
+            size_ += p.len;
+        }
+    }
+
+    std::string const& user_key() const override { return user_key_; }
+    uint64_t object_off() const override { return object_off_; }
+    uint64_t size() const override { return size_; }
+
+    AsyncResult< sisl::io_blob_safe > next() override {
+        if (failed_) { return folly::makeUnexpected(*failed_); }
+        if (cur_) {
+            return cur_->next().deferValue([this](auto&& r) -> AsyncResult< sisl::io_blob_safe > {
+                if (!r) { return fail(r.error()); }
+                if (r.value().size()) { return std::move(r.value()); }
+                cur_.reset();
+                ++next_piece_;
+                return next();
+            });
+        }
+        if (next_piece_ == pieces_.size()) { return sisl::io_blob_safe{}; }
+        return open_(pieces_[next_piece_]).deferValue([this](auto&& r) -> AsyncResult< sisl::io_blob_safe > {
+            if (!r) { return fail(r.error()); }
+            cur_ = std::move(r.value());
+            return next();
+        });
+    }
+
+private:
+    AsyncResult< sisl::io_blob_safe > fail(BlobError const& e) {
+        failed_ = e;
+        cur_.reset();
+        return folly::makeUnexpected(e);
+    }
+
+    std::vector< Piece > const pieces_;
+    std::string const user_key_;
+    uint64_t const object_off_;
+    opener_t const open_;
+    uint64_t size_{0};
+
+    size_t next_piece_{0};
+    std::unique_ptr< BlobStream > cur_;
+    std::optional< BlobError > failed_;
+};
+} // namespace
+
+BlobManager::AsyncResult< std::unique_ptr< BlobStream > >
+HSHomeObject::_get_stream(ShardInfo const& shard, blob_id_t blob_id, uint64_t off, uint64_t len, trace_id_t tid,
+                          op_deadline_t deadline) const {
+    if (is_shutting_down()) {
+        LOGI("service is being shutdown");
+        return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
+    }
+    auto hs_pg = get_hs_pg(shard.placement_group);
+    RELEASE_ASSERT(hs_pg, "PG not found");
+    auto repl_dev = hs_pg->repl_dev_;
+    if (!repl_dev->is_ready_for_traffic()) {
+        LOGW("traceID={}, failed to stream blob of shardID=0x{:x}, pg={}, not ready for traffic", tid, shard.id,
+             shard.placement_group);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
+    }
+    auto r = get_blob_from_index_table(hs_pg->index_table_, shard.id, blob_id);
+    if (!r) {
+        LOGE("traceID={}, shardID=0x{:x}, blob={}, blob not found in index during stream", tid, shard.id, blob_id);
+        return folly::makeUnexpected(r.error());
+    }
+    if (shed_expired_request(hs_pg, deadline, tid, shard.id, blob_id, "stream")) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    }
+
+    hot_spot_tracker_->record(shard.id, r.value().blk_count() * repl_dev->get_blk_size());
+    return open_blob_stream(hs_pg, shard.id, blob_id, r.value(), off, len, tid, deadline, false /* from_manifest */);
+}
+
+BlobManager::AsyncResult< std::unique_ptr< BlobStream > >
+HSHomeObject::open_blob_stream(const HS_PG* hs_pg, shard_id_t shard_id, blob_id_t blob_id,
+                               homestore::MultiBlkId const& blkid, uint64_t off, uint64_t len, trace_id_t tid,
+                               op_deadline_t deadline, bool from_manifest) const {
+    auto stream = std::make_unique< HSBlobStream >(*this, hs_pg, shard_id, blob_id, blkid, tid, deadline);
+    auto s = stream.get();
+    // the stream is owned by the last callback of the chain until it is handed out
+    return s->read_head()
+        .thenValue([s](auto&& r) -> chunk_read {
+            if (!r) { return folly::makeFuture(std::move(r)); }
+            auto needed = s->parse_head(r.value());
+            if (!needed) {
+                return folly::makeFuture< BlobManager::Result< pooled_io_buf > >(folly::makeUnexpected(needed.error()));
+            }
+            if (needed.value() == 0) { return folly::makeFuture(std::move(r)); }
+            // a huge user key, or a manifest larger than a chunk
+            return s->read(0, needed.value());
+        })
+        .thenValue([this, hs_pg, shard_id, off, len, tid, deadline, from_manifest, stream = std::move(stream)](
+                       auto&& r) mutable -> BlobManager::AsyncResult< std::unique_ptr< BlobStream > > {
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            auto& head = r.value();
+            if (auto needed = stream->parse_head(head); !needed || needed.value() != 0) {
+                return folly::makeUnexpected(needed ? BlobError(BlobErrorCode::READ_FAILED) : needed.error());
+            }
+            if (!stream->is_manifest()) {
+                if (auto started = stream->start(std::move(head), off, len); !started) {
+                    return folly::makeUnexpected(started.error());
+                }
+                return std::unique_ptr< BlobStream >(std::move(stream));
+            }
+            if (from_manifest) {
+                LOGE("traceID={}, shardID=0x{:x}, a multi-part manifest lists another manifest", tid, shard_id);
+                return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+            }
+
+            // the blob is the manifest of a multi-part object, the range is streamed from the parts it lists
+            auto entries = stream->manifest(head);
+            if (!entries) { return folly::makeUnexpected(entries.error()); }
+            uint64_t object_size{0};
+            for (auto const& e : entries.value()) {
+                object_size += e.size;
+            }
+            if (off + len > object_size) {
+                LOGE("traceID={}, invalid range requested in multi-part object of shardID=0x{:x}, offset={} len={} "
+                     "size={}",
+                     tid, shard_id, off, len, object_size);
+                return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            }
+            auto const end = len ? off + len : object_size;
+            std::vector< MultipartBlobStream::Piece > pieces;
+            uint64_t part_start{0};
+            for (auto const& e : entries.value()) {
+                auto const part_end = part_start + e.size;
+                if (part_end > off && part_start < end) {
+                    auto const from = std::max(off, part_start);
+                    auto const to = std::min(end, part_end);
+                    pieces.push_back({.blob_id = e.blob_id, .off = from - part_start, .len = to - from});
+                }
+                part_start = part_end;
+            }
+            auto open_part = [this, hs_pg, shard_id, tid,
+                              deadline](MultipartBlobStream::Piece const& p)
+                -> BlobManager::AsyncResult< std::unique_ptr< BlobStream > > {
+                auto r = get_blob_from_index_table(hs_pg->index_table_, shard_id, p.blob_id);
+                if (!r) {
+                    LOGE("traceID={}, part blob_id={} of a multi-part object of shardID=0x{:x} is missing", tid,
+                         p.blob_id, shard_id);
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+                }
+                return open_blob_stream(hs_pg, shard_id, p.blob_id, r.value(), p.off, p.len, tid, deadline,
+                                        true /* from_manifest */);
+            };
+            return std::unique_ptr< BlobStream >(std::make_unique< MultipartBlobStream >(
+                std::move(pieces), std::string(stream->user_key()), stream->object_off(), std::move(open_part)));
+        });
+}
+
+} // namespace homeobject
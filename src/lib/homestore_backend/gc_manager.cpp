@@ -352,6 +352,7 @@ void GCManager::pdev_gc_actor::purge_reserved_chunk(chunk_id_t chunk) {
     RELEASE_ASSERT(!vchunk->m_pg_id.has_value(),
                    "chunk_id={} is expected to be a reserved chunk, and not belong to a pg", chunk);
     vchunk->reset(); // reset the chunk to make sure it is empty
+    if (auto scrubber = m_hs_home_object->scrubber(); scrubber) { scrubber->forget_chunk(chunk); }
 
     // clear all the entries of this chunk in the gc index table
     auto start_key = BlobRouteByChunkKey{BlobRouteByChunk(chunk, 0, 0)};
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <tuple>
+
+#include "hot_spot_tracker.hpp"
+#include "hs_backend_config.hpp"
+
+namespace homeobject {
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint32_t configured_sample_rate() {
+    return std::max(uint32_t{1}, HS_BACKEND_DYNAMIC_CONFIG(hot_spot_sample_rate));
+}
+
+HotSpotTracker::HotSpotTracker() :
+        sample_rate_{configured_sample_rate()}, window_start_ns_{now_ns()}, metrics_{*this} {}
+
+HotSpotTracker::~HotSpotTracker() { stop(); }
+
+void HotSpotTracker::start() {
+    timer_hdl_ = iomanager.schedule_global_timer(
+        timer_interval_ms * 1000 * 1000, true, nullptr /*cookie*/, iomgr::reactor_regex::all_user,
+        [this](void*) { on_timer(); }, true /* wait_to_schedule */);
+    LOGINFO("hot spot tracker has started, sample rate {}", sample_rate_.load(std::memory_order_relaxed));
+}
+
+void HotSpotTracker::stop() {
+    if (timer_hdl_ != iomgr::null_timer_handle) {
+        iomanager.cancel_timer(timer_hdl_, true);
+        timer_hdl_ = iomgr::null_timer_handle;
+    }
+}
+
+void HotSpotTracker::record(shard_id_t shard_id, uint64_t bytes) {
+    auto const rate = sample_rate_.load(std::memory_order_relaxed);
+    static thread_local uint32_t skipped{0};
+    if (++skipped < rate) { return; }
+    skipped = 0;
+
+    COUNTER_INCREMENT(metrics_, hot_spot_sampled_ops, 1);
+
+    // every sampled op stands for rate ops
+    auto const pg_id = static_cast< pg_id_t >(shard_id >> shard_width);
+    top_shards_by_ops_.offer(shard_id, shard_ops_.add(shard_id, rate));
+    pg_ops_.add(pg_id, rate);
+    if (bytes) {
+        top_shards_by_bytes_.offer(shard_id, shard_bytes_.add(shard_id, bytes * rate));
+        pg_bytes_.add(pg_id, bytes * rate);
+    }
+}
+
+std::pair< uint64_t, uint64_t > HotSpotTracker::pg_estimate(pg_id_t pg_id) const {
+    return {pg_ops_.estimate(pg_id), pg_bytes_.estimate(pg_id)};
+}
+
+nlohmann::json HotSpotTracker::dump(std::vector< pg_id_t > const& pg_ids) const {
+    auto to_json = [](std::vector< TopEntry > const& entries) {
+        nlohmann::json j = nlohmann::json::array();
+        for (auto const& e : entries) {
+            j.push_back({{"shard_id", e.shard_id},
+                         {"pg_id", e.shard_id >> shard_width},
+                         {"shard_seq", e.shard_id & shard_mask},
+                         {"estimate", e.estimate}});
+        }
+        return j;
+    };
+
+    nlohmann::json j;
+    j["decay_interval_sec"] = HS_BACKEND_DYNAMIC_CONFIG(hot_spot_decay_interval_sec);
+    j["sample_rate"] = HS_BACKEND_DYNAMIC_CONFIG(hot_spot_sample_rate);
+    j["shards_by_ops"] = to_json(top_shards_by_ops_.sorted());
+    j["shards_by_bytes"] = to_json(top_shards_by_bytes_.sorted());
+
+    std::vector< std::tuple< pg_id_t, uint64_t, uint64_t > > pgs;
+    pgs.reserve(pg_ids.size());
+    for (auto const pg_id : pg_ids) {
+        auto const [ops, bytes] = pg_estimate(pg_id);
+        pgs.emplace_back(pg_id, ops, bytes);
+    }
+    std::sort(pgs.begin(), pgs.end(), [](auto const& a, auto const& b) { return std::get< 1 >(a) > std::get< 1 >(b); });
+    j["pgs"] = nlohmann::json::array();
+    for (auto const& [pg_id, ops, bytes] : pgs) {
+        j["pgs"].push_back({{"pg_id", pg_id}, {"ops", ops}, {"bytes", bytes}});
+    }
+    return j;
+}
+
+uint64_t HotSpotTracker::top_shard_ops() const { return top_shards_by_ops_.top(); }
+uint64_t HotSpotTracker::top_shard_bytes() const { return top_shards_by_bytes_.top(); }
+
+void HotSpotTracker::on_timer() {
+    sample_rate_.store(configured_sample_rate(), std::memory_order_relaxed);
+
+    auto const interval_ns = int64_t(HS_BACKEND_DYNAMIC_CONFIG(hot_spot_decay_interval_sec)) * 1'000'000'000;
+    auto start = window_start_ns_.load(std::memory_order_relaxed);
+    auto const now = now_ns();
+    if (interval_ns == 0 || now - start < interval_ns) { return; }
+    // only the run which moves the window forward does the decay
+    if (!window_start_ns_.compare_exchange_strong(start, now, std::memory_order_relaxed)) { return; }
+    decay();
+}
+
+void HotSpotTracker::decay() {
+    shard_ops_.halve();
+    shard_bytes_.halve();
+    pg_ops_.halve();
+    pg_bytes_.halve();
+    top_shards_by_ops_.halve();
+    top_shards_by_bytes_.halve();
+}
+
+size_t HotSpotTracker::CountMinSketch::slot(size_t row, uint64_t key) {
+    // one independent multiplicative hash per row
+    static constexpr std::array< uint64_t, sketch_depth > seeds{0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+                                                                0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL};
+    auto h = (key + row) * seeds[row];
+    h ^= h >> 29;
+    return row * sketch_width + (h % sketch_width);
+}
+
+uint64_t HotSpotTracker::CountMinSketch::add(uint64_t key, uint64_t n) {
+    uint64_t est{std::numeric_limits< uint64_t >::max()};
+    for (size_t row = 0; row < sketch_depth; ++row) {
+        est = std::min(est, counters_[slot(row, key)].fetch_add(n, std::memory_order_relaxed) + n);
+    }
+    return est;
+}
+
+uint64_t HotSpotTracker::CountMinSketch::estimate(uint64_t key) const {
+    uint64_t est{std::numeric_limits< uint64_t >::max()};
+    for (size_t row = 0; row < sketch_depth; ++row) {
+        est = std::min(est, counters_[slot(row, key)].load(std::memory_order_relaxed));
+    }
+    return est;
+}
+
+void HotSpotTracker::CountMinSketch::halve() {
+    // racing adds may be partially lost, which is fine for an estimate
+    for (auto& c : counters_) {
+        c.store(c.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+}
+
+void HotSpotTracker::TopK::offer(shard_id_t shard_id, uint64_t estimate) {
+    if (estimate <= admission_threshold_.load(std::memory_order_relaxed)) { return; }
+
+    std::scoped_lock lock(mtx_);
+    auto it =
+        std::find_if(entries_.begin(), entries_.end(), [shard_id](auto const& e) { return e.shard_id == shard_id; });
+    if (it == entries_.end()) {
+        it = std::min_element(entries_.begin(), entries_.end(),
+                              [](auto const& a, auto const& b) { return a.estimate < b.estimate; });
+        if (estimate <= it->estimate) { return; }
+        it->shard_id = shard_id;
+    }
+    it->estimate = std::max(it->estimate, estimate);
+    auto const min_it = std::min_element(entries_.begin(), entries_.end(),
+                                         [](auto const& a, auto const& b) { return a.estimate < b.estimate; });
+    admission_threshold_.store(min_it->estimate, std::memory_order_relaxed);
+}
+
+std::vector< HotSpotTracker::TopEntry > HotSpotTracker::TopK::sorted() const {
+    std::vector< TopEntry > ret;
+    {
+        std::scoped_lock lock(mtx_);
+        std::copy_if(entries_.begin(), entries_.end(), std::back_inserter(ret),
+                     [](auto const& e) { return e.estimate != 0; });
+    }
+    std::sort(ret.begin(), ret.end(), [](auto const& a, auto const& b) { return a.estimate > b.estimate; });
+    return ret;
+}
+
+uint64_t HotSpotTracker::TopK::top() const {
+    std::scoped_lock lock(mtx_);
+    uint64_t top{0};
+    for (auto const& e : entries_) {
+        top = std::max(top, e.estimate);
+    }
+    return top;
+}
+
+void HotSpotTracker::TopK::halve() {
+    std::scoped_lock lock(mtx_);
+    uint64_t min_est{std::numeric_limits< uint64_t >::max()};
+    for (auto& e : entries_) {
+        e.estimate /= 2;
+        min_est = std::min(min_est, e.estimate);
+    }
+    admission_threshold_.store(min_est, std::memory_order_relaxed);
+}
+
+} // namespace homeobject
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <iomgr/iomgr.hpp>
+#include <nlohmann/json.hpp>
+#include <sisl/metrics/metrics.hpp>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+/**
+ * Tracks which shards and pgs absorb the most blob ops and bytes, in fixed memory.
+ *
+ * Ops are sampled per thread (1 out of hot_spot_sample_rate) and fed into count-min sketches keyed by shard id and by
+ * pg id. The heaviest shards by ops and by bytes are kept in two small top-k sets (admission is by the sketch estimate,
+ * which never under-counts). All counters are halved every hot_spot_decay_interval_sec so the ranking follows the
+ * recent load rather than the lifetime totals. The decay runs on a timer, which also refreshes the settings record()
+ * works with, so recording an op reads no config.
+ */
+class HotSpotTracker {
+public:
+    static constexpr size_t sketch_depth{4};
+    static constexpr size_t sketch_width{1024};
+    static constexpr size_t top_k{16};
+    static constexpr uint64_t timer_interval_ms{1000};
+
+    struct HotSpotMetrics : public sisl::MetricsGroup {
+        explicit HotSpotMetrics(HotSpotTracker const& tracker) :
+                sisl::MetricsGroup("hot_spot", "blob_ops"), tracker_{tracker} {
+            REGISTER_COUNTER(hot_spot_sampled_ops, "Blob ops sampled into the hot spot tracker");
+            REGISTER_GAUGE(hot_spot_top_shard_ops, "Estimated recent ops of the hottest shard");
+            REGISTER_GAUGE(hot_spot_top_shard_bytes, "Estimated recent bytes of the shard with most bytes");
+            register_me_to_farm();
+            attach_gather_cb(std::bind(&HotSpotMetrics::on_gather, this));
+        }
+        ~HotSpotMetrics() { deregister_me_from_farm(); }
+        HotSpotMetrics(const HotSpotMetrics&) = delete;
+        HotSpotMetrics(HotSpotMetrics&&) noexcept = delete;
+        HotSpotMetrics& operator=(const HotSpotMetrics&) = delete;
+        HotSpotMetrics& operator=(HotSpotMetrics&&) noexcept = delete;
+
+        void on_gather() {
+            GAUGE_UPDATE(*this, hot_spot_top_shard_ops, tracker_.top_shard_ops());
+            GAUGE_UPDATE(*this, hot_spot_top_shard_bytes, tracker_.top_shard_bytes());
+        }
+
+    private:
+        HotSpotTracker const& tracker_;
+    };
+
+    HotSpotTracker();
+    ~HotSpotTracker();
+    HotSpotTracker(const HotSpotTracker&) = delete;
+    HotSpotTracker(HotSpotTracker&&) = delete;
+    HotSpotTracker& operator=(const HotSpotTracker&) = delete;
+    HotSpotTracker& operator=(HotSpotTracker&&) = delete;
+
+    /**
+     * @brief Start / stop the timer which decays the counters and picks up changed settings.
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Account one blob op of the given size on a shard. Cheap enough to be called on every op.
+     */
+    void record(shard_id_t shard_id, uint64_t bytes);
+
+    /**
+     * @brief Estimated recent (ops, bytes) of the given pg.
+     */
+    std::pair< uint64_t, uint64_t > pg_estimate(pg_id_t pg_id) const;
+
+    /**
+     * @brief Dump the current top shards by ops and by bytes, plus the estimates of the given pgs.
+     */
+    nlohmann::json dump(std::vector< pg_id_t > const& pg_ids) const;
+
+    uint64_t top_shard_ops() const;
+    uint64_t top_shard_bytes() const;
+
+private:
+    class CountMinSketch {
+    public:
+        // returns the estimate after adding n
+        uint64_t add(uint64_t key, uint64_t n);
+        uint64_t estimate(uint64_t key) const;
+        void halve();
+
+    private:
+        static size_t slot(size_t row, uint64_t key);
+        std::array< std::atomic< uint64_t >, sketch_depth * sketch_width > counters_{};
+    };
+
+    struct TopEntry {
+        shard_id_t shard_id{0};
+        uint64_t estimate{0};
+    };
+
+    class TopK {
+    public:
+        void offer(shard_id_t shard_id, uint64_t estimate);
+        std::vector< TopEntry > sorted() const;
+        uint64_t top() const;
+        void halve();
+
+    private:
+        mutable std::mutex mtx_;
+        std::array< TopEntry, top_k > entries_{};
+        // smallest estimate in entries_, lets most offers skip the lock
+        std::atomic< uint64_t > admission_threshold_{0};
+    };
+
+    // refresh the settings, and decay once hot_spot_decay_interval_sec has passed since the last decay
+    void on_timer();
+    void decay();
+
+    CountMinSketch shard_ops_;
+    CountMinSketch shard_bytes_;
+    CountMinSketch pg_ops_;
+    CountMinSketch pg_bytes_;
+    TopK top_shards_by_ops_;
+    TopK top_shards_by_bytes_;
+    std::atomic< uint32_t > sample_rate_;
+    std::atomic< int64_t > window_start_ns_;
+    iomgr::timer_handle_t timer_hdl_{iomgr::null_timer_handle};
+    HotSpotMetrics metrics_;
+};
+
+} // namespace homeobject
@@ -4,6 +4,7 @@
 #include "replication_state_machine.hpp"
 #include "lib/homeobject_impl.hpp"
 #include "lib/blob_route.hpp"
+#include "lib/io_buf_pool.hpp"
 #include <homestore/homestore.hpp>
 #include <homestore/blkdata_service.hpp>
 
@@ -61,20 +62,45 @@ BlobError toBlobError(ReplServiceError const& e) {
 
 struct put_blob_req_ctx : public repl_result_ctx< BlobManager::Result< HSHomeObject::BlobInfo > > {
     uint32_t blob_header_idx_{0};
+    // index in data_bufs_ of the aligned copy of the blob body, if we had to make one
+    std::optional< uint32_t > body_copy_idx_;
+    op_deadline_t deadline_{};
 
     // Unaligned buffer is good enough for header and key, since they will be explicity copied
     static intrusive< put_blob_req_ctx > make(uint32_t data_hdr_size) {
         return intrusive< put_blob_req_ctx >{new put_blob_req_ctx(data_hdr_size)};
     }
 
+    // Contexts are allocated and freed for every put, recycle their memory per thread.
+    static void* operator new(size_t size) { return ThreadLocalObjPool< put_blob_req_ctx >::alloc(size); }
+    static void operator delete(void* p, size_t size) { ThreadLocalObjPool< put_blob_req_ctx >::free(p, size); }
+
     put_blob_req_ctx(uint32_t data_hdr_size) : repl_result_ctx(0u /* header_extn_size */, sizeof(blob_id_t)) {
         uint32_t aligned_size = uint32_cast(sisl::round_up(data_hdr_size, io_align));
-        sisl::io_blob_safe buf{aligned_size, io_align};
+        sisl::io_blob_safe buf = IoBufPool::alloc(aligned_size, io_align);
         new (buf.bytes()) HSHomeObject::BlobHeader();
         add_data_sg(std::move(buf));
         blob_header_idx_ = data_bufs_.size() - 1;
     }
 
+    ~put_blob_req_ctx() {
+        // Give back the buffers we allocated ourselves, the caller provided blob body is not ours to recycle.
+        IoBufPool::release(std::move(data_bufs_[blob_header_idx_]), io_align);
+        if (body_copy_idx_) { IoBufPool::release(std::move(data_bufs_[*body_copy_idx_]), io_align); }
+    }
+
+    void add_body_copy_sg(sisl::io_blob_safe&& buf) {
+        add_data_sg(std::move(buf));
+        body_copy_idx_ = data_bufs_.size() - 1;
+    }
+
+    // The blocks of an existing blob read back whole, its payload from offset on is written again as is.
+    void add_image_sg(sisl::io_blob_safe&& buf, uint32_t offset, uint32_t size) {
+        add_data_sg(buf.bytes() + offset, size);
+        data_bufs_.emplace_back(std::move(buf));
+        body_copy_idx_ = data_bufs_.size() - 1;
+    }
+
     void copy_user_key(std::string const& user_key) {
         std::memcpy((blob_header_buf().bytes() + sizeof(HSHomeObject::BlobHeader)), user_key.data(), user_key.size());
     }
@@ -83,19 +109,24 @@ struct put_blob_req_ctx : public repl_result_ctx< BlobManager::Result< HSHomeObj
     sisl::io_blob_safe& blob_header_buf() { return data_bufs_[blob_header_idx_]; }
 };
 
-BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& shard, Blob&& blob, trace_id_t tid) {
-
-    if (is_shutting_down()) {
-        LOGI("service is being shut down");
-        return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
-    }
-    incr_pending_request_num();
+BlobManager::Result< blob_id_t > HSHomeObject::start_put(const HS_PG* hs_pg, ShardInfo const& shard, uint64_t size,
+                                                          trace_id_t tid, op_deadline_t deadline) {
     auto& pg_id = shard.placement_group;
     shared< homestore::ReplDev > repl_dev;
     blob_id_t new_blob_id;
+    incr_pending_request_num(hs_pg);
+    hot_spot_tracker_->record(shard.id, size);
+    if (shed_expired_request(hs_pg, deadline, tid, shard.id, 0, "put")) {
+        decr_pending_request_num(hs_pg);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    }
+    // before a blob id is allocated, a throttled put must not burn one
+    if (!hs_pg->admit_write()) {
+        BLOGD(tid, shard.id, 0, "failed to put blob for pg={}, write throttled", pg_id);
+        decr_pending_request_num(hs_pg);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
+    }
     {
-        auto hs_pg = get_hs_pg(pg_id);
-        RELEASE_ASSERT(hs_pg, "PG not found, pg={}", pg_id);
         repl_dev = hs_pg->repl_dev_;
         const_cast< HS_PG* >(hs_pg)->durable_entities_update(
             [&new_blob_id](auto& de) { new_blob_id = de.blob_sequence_num.fetch_add(1, std::memory_order_relaxed); },
@@ -106,29 +137,52 @@ BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& s
     }
     RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
     BLOGD(tid, shard.id, new_blob_id, "Blob Put request: pg={}, group={}, shard=0x{:x}, length={}", pg_id,
-          repl_dev->group_id(), shard.id, blob.body.size());
+          repl_dev->group_id(), shard.id, size);
 
     if (!repl_dev->is_leader()) {
         BLOGW(tid, shard.id, new_blob_id, "failed to put blob for pg={}, not leader", pg_id);
-        decr_pending_request_num();
+        decr_pending_request_num(hs_pg);
         return folly::makeUnexpected(BlobError(BlobErrorCode::NOT_LEADER, repl_dev->get_leader_id()));
     }
 
     if (!repl_dev->is_ready_for_traffic()) {
         BLOGW(tid, shard.id, new_blob_id, "failed to put blob for pg={}, not ready for traffic", pg_id);
-        decr_pending_request_num();
+        decr_pending_request_num(hs_pg);
         return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
     }
+    return new_blob_id;
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& shard, Blob&& blob, trace_id_t tid,
+                                                             op_deadline_t deadline) {
+    return put_blob(shard, std::move(blob), DataHeader::data_type_t::BLOB_INFO, tid, deadline)
+        .deferValue([](auto const& result) -> BlobManager::Result< blob_id_t > {
+            if (!result) { return folly::makeUnexpected(result.error()); }
+            return result.value().blob_id;
+        });
+}
+
+BlobManager::AsyncResult< HSHomeObject::BlobInfo > HSHomeObject::put_blob(ShardInfo const& shard, Blob&& blob,
+                                                                          DataHeader::data_type_t type,
+                                                                          trace_id_t tid, op_deadline_t deadline) {
+    if (is_shutting_down()) {
+        LOGI("service is being shut down");
+        return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
+    }
+    auto& pg_id = shard.placement_group;
+    auto hs_pg = get_hs_pg(pg_id);
+    RELEASE_ASSERT(hs_pg, "PG not found, pg={}", pg_id);
+    auto started = start_put(hs_pg, shard, blob.body.size(), tid, deadline);
+    if (!started) { return folly::makeUnexpected(started.error()); }
+    auto const new_blob_id = started.value();
 
     // Create a put_blob request which allocates for header, key and blob_header, user_key. Data sgs are added later
     auto req = put_blob_req_ctx::make(sizeof(BlobHeader) + blob.user_key.size());
+    req->deadline_ = deadline;
     req->header()->msg_type = ReplicationMessageType::PUT_BLOB_MSG;
-    req->header()->payload_size = 0;
-    req->header()->payload_crc = 0;
     req->header()->shard_id = shard.id;
     req->header()->pg_id = pg_id;
     req->header()->blob_id = new_blob_id;
-    req->header()->seal();
 
     // Serialize blob_id as Replication key
     *(reinterpret_cast< blob_id_t* >(req->key_buf().bytes())) = new_blob_id;
@@ -141,7 +195,7 @@ BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& s
 
     // Blob Header section.
     auto const blob_size = blob.body.size();
-    req->blob_header()->type = DataHeader::data_type_t::BLOB_INFO;
+    req->blob_header()->type = type;
     req->blob_header()->shard_id = shard.id;
     req->blob_header()->blob_id = new_blob_id;
     req->blob_header()->hash_algorithm = BlobHeader::HashAlgorithm::CRC32;
@@ -156,9 +210,11 @@ BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& s
     req->blob_header()->data_offset = req->blob_header_buf().size();
 
     // In case blob body is not aligned, create a new aligned buffer and copy the blob body.
-    if (((r_cast< uintptr_t >(blob.body.cbytes()) % io_align) != 0) || ((blob_size % io_align) != 0)) {
+    bool const body_copied =
+        ((r_cast< uintptr_t >(blob.body.cbytes()) % io_align) != 0) || ((blob_size % io_align) != 0);
+    if (body_copied) {
         // If address or size is not aligned, create a separate aligned buffer and do expensive memcpy.
-        sisl::io_blob_safe new_body = sisl::io_blob_safe(sisl::round_up(blob_size, io_align), io_align);
+        sisl::io_blob_safe new_body = IoBufPool::alloc(sisl::round_up(blob_size, io_align), io_align);
         std::memcpy(new_body.bytes(), blob.body.cbytes(), blob_size);
         blob.body = std::move(new_body);
     }
@@ -169,8 +225,25 @@ BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& s
                               BlobHeader::blob_max_hash_len);
     req->blob_header()->seal();
 
+    // The message header carries the payload crc, every replica folds the blob into its shard digest from it
+    req->header()->payload_size = blob_size;
+    req->header()->payload_crc = req->blob_header()->payload_crc();
+    req->header()->seal();
+
     // Add blob body to the request
-    req->add_data_sg(std::move(blob.body));
+    if (body_copied) {
+        req->add_body_copy_sg(std::move(blob.body));
+    } else {
+        req->add_data_sg(std::move(blob.body));
+    }
+    return propose_put(hs_pg, std::move(req), tid);
+}
+
+BlobManager::AsyncResult< HSHomeObject::BlobInfo >
+HSHomeObject::propose_put(const HS_PG* hs_pg, intrusive< put_blob_req_ctx > req, trace_id_t tid) {
+    auto repl_dev = hs_pg->repl_dev_;
+    auto const shard_id = req->header()->shard_id;
+    auto const new_blob_id = req->header()->blob_id;
 
     // Check if any padding of zeroes needs to be added to be aligned to device block size.
     auto pad_len = sisl::round_up(req->data_sgs().size, repl_dev->get_blk_size()) - req->data_sgs().size;
@@ -181,21 +254,153 @@ BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& s
     BLOGT(tid, req->blob_header()->shard_id, req->blob_header()->blob_id, "Put blob: header={} sgs={}",
           req->blob_header()->to_string(), req->data_sgs_string());
 
-    repl_dev->async_alloc_write(req->cheader_buf(), req->ckey_buf(), req->data_sgs(), req, false /* part_of_batch */,
-                                tid);
+    auto const proposed_bytes = static_cast< int64_t >(req->data_sgs().size);
+    hs_pg->inflight_put_bytes_.increment(proposed_bytes);
+    // the outcome is delivered through req->result(), the future of the issue itself only tells a removed pg
+    auto issued = issue_data_io(
+        hs_pg->pg_info_.id, PGIoScheduler::io_type::WRITE, PGIoScheduler::io_class::FOREGROUND, proposed_bytes,
+        [this, req, repl_dev, hs_pg, tid, shard_id, new_blob_id]() {
+            // Last chance to drop the request, once proposed it is replicated and written regardless of the deadline.
+            // The put may also have waited in the io scheduler for a while.
+            if (shed_expired_request(hs_pg, req->deadline_, tid, shard_id, new_blob_id, "propose")) {
+                req->promise_.setValue(folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED)));
+            } else {
+                repl_dev->async_alloc_write(req->cheader_buf(), req->ckey_buf(), req->data_sgs(), req,
+                                            false /* part_of_batch */, tid);
+            }
+            return folly::makeFuture();
+        });
+    std::ignore = std::move(issued).thenError(folly::tag_t< std::system_error >{}, [req](auto const&) {
+        req->promise_.setValue(folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_PG)));
+    });
     return req->result().deferValue(
-        [this, req, repl_dev, tid](const auto& result) -> BlobManager::AsyncResult< blob_id_t > {
+        [this, req, repl_dev, hs_pg, tid, proposed_bytes](const auto& result) -> BlobManager::Result< BlobInfo > {
+            hs_pg->inflight_put_bytes_.decrement(proposed_bytes);
             if (result.hasError()) {
                 auto err = result.error();
                 if (err.getCode() == BlobErrorCode::NOT_LEADER) { err.current_leader = repl_dev->get_leader_id(); }
-                decr_pending_request_num();
+                decr_pending_request_num(hs_pg);
                 return folly::makeUnexpected(err);
             }
             auto blob_info = result.value();
             BLOGD(tid, blob_info.shard_id, blob_info.blob_id, "Blob Put request: Put blob success blkid={}",
                   blob_info.pbas.to_string());
-            decr_pending_request_num();
-            return blob_info.blob_id;
+            decr_pending_request_num(hs_pg);
+            return blob_info;
+        });
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::_copy_blob(ShardInfo const& src_shard, blob_id_t src_blob,
+                                                              ShardInfo const& dst_shard, trace_id_t tid,
+                                                              op_deadline_t deadline) {
+    // smaller copies are dominated by their latency, their throughput is not reported
+    static constexpr uint64_t copy_throughput_min_size{1 * Mi};
+    if (is_shutting_down()) {
+        LOGI("service is being shut down");
+        return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
+    }
+    auto src_pg = get_hs_pg(src_shard.placement_group);
+    auto dst_pg = get_hs_pg(dst_shard.placement_group);
+    RELEASE_ASSERT(src_pg, "PG not found, pg={}", src_shard.placement_group);
+    RELEASE_ASSERT(dst_pg, "PG not found, pg={}", dst_shard.placement_group);
+    auto repl_dev = src_pg->repl_dev_;
+
+    incr_pending_request_num(src_pg);
+    if (!repl_dev->is_ready_for_traffic()) {
+        BLOGW(tid, src_shard.id, src_blob, "failed to copy blob from pg={}, not ready for traffic",
+              src_shard.placement_group);
+        decr_pending_request_num(src_pg);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
+    }
+    if (shed_expired_request(src_pg, deadline, tid, src_shard.id, src_blob, "copy")) {
+        decr_pending_request_num(src_pg);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    }
+    auto r = get_blob_from_index_table(src_pg->index_table_, src_shard.id, src_blob);
+    if (!r) {
+        BLOGE(tid, src_shard.id, src_blob, "Blob not found in index during copy blob");
+        decr_pending_request_num(src_pg);
+        return folly::makeUnexpected(r.error());
+    }
+    BLOGD(tid, src_shard.id, src_blob, "Blob Copy request: to pg={}, shard=0x{:x}", dst_shard.placement_group,
+          dst_shard.id);
+
+    // The blocks of the blob are read whole, header, user key and payload are then written to the destination in a
+    // single put without going through a Blob: the payload is neither copied nor hashed again.
+    auto const pbas = r.value();
+    auto const total_size = pbas.blk_count() * repl_dev->get_blk_size();
+    sisl::io_blob_safe image = IoBufPool::alloc(total_size, io_align);
+    sisl::sg_list sgs;
+    sgs.size = total_size;
+    sgs.iovs.emplace_back(iovec{.iov_base = image.bytes(), .iov_len = image.size()});
+    auto const copy_start = Clock::now();
+
+    return issue_data_io(src_pg->pg_info_.id, PGIoScheduler::io_type::READ, PGIoScheduler::io_class::FOREGROUND,
+                         total_size,
+                         [repl_dev, pbas, sgs, total_size]() { return repl_dev->async_read(pbas, sgs, total_size); })
+        .thenValue([this, src_pg, dst_pg, src_shard, src_blob, dst_shard, pbas, tid, deadline, copy_start,
+                    image = std::move(image)](auto&& err) mutable -> BlobManager::AsyncResult< blob_id_t > {
+            decr_pending_request_num(src_pg);
+            if (err) {
+                BLOGE(tid, src_shard.id, src_blob, "Failed to read blob to copy: err={}", err.message());
+                IoBufPool::release(std::move(image), io_align);
+                return folly::makeUnexpected(data_io_error(err));
+            }
+            // blocks the scrubber verified a moment ago are trusted, see scrub_skip_verify_window_sec
+            auto const verified = check_blob_image(BlobInfo{src_shard.id, src_blob, pbas}, image.cbytes(),
+                                                   image.size(), !scrubber_->recently_verified(pbas));
+            if (!verified) {
+                IoBufPool::release(std::move(image), io_align);
+                return folly::makeUnexpected(verified.error());
+            }
+
+            auto const* src_header = r_cast< BlobHeader const* >(image.cbytes());
+            // parts and manifests of multi-part uploads only make sense together in their shard
+            if (src_header->type != DataHeader::data_type_t::BLOB_INFO) {
+                BLOGW(tid, src_shard.id, src_blob, "Blob is part of a multi-part object, not copied");
+                IoBufPool::release(std::move(image), io_align);
+                return folly::makeUnexpected(BlobError(BlobErrorCode::UNSUPPORTED_OP));
+            }
+            uint64_t const blob_size = src_header->blob_size;
+            uint32_t const data_offset = src_header->data_offset;
+            auto started = start_put(dst_pg, dst_shard, blob_size, tid, deadline);
+            if (!started) {
+                IoBufPool::release(std::move(image), io_align);
+                return folly::makeUnexpected(started.error());
+            }
+            auto const new_blob_id = started.value();
+
+            auto req = put_blob_req_ctx::make(data_offset);
+            req->deadline_ = deadline;
+            req->header()->msg_type = ReplicationMessageType::PUT_BLOB_MSG;
+            req->header()->shard_id = dst_shard.id;
+            req->header()->pg_id = dst_shard.placement_group;
+            req->header()->blob_id = new_blob_id;
+            *(reinterpret_cast< blob_id_t* >(req->key_buf().bytes())) = new_blob_id;
+
+            // Same blob header, user key and payload hash, only the route of the blob changes
+            std::memcpy(req->blob_header_buf().bytes(), image.cbytes(), data_offset);
+            req->blob_header()->shard_id = dst_shard.id;
+            req->blob_header()->blob_id = new_blob_id;
+            req->blob_header()->seal();
+
+            req->header()->payload_size = blob_size;
+            req->header()->payload_crc = req->blob_header()->payload_crc();
+            req->header()->seal();
+            req->add_image_sg(std::move(image), data_offset, sisl::round_up(blob_size, io_align));
+
+            return propose_put(dst_pg, std::move(req), tid)
+                .deferValue([dst_pg, blob_size, copy_start](auto const& result) -> BlobManager::Result< blob_id_t > {
+                    if (!result) { return folly::makeUnexpected(result.error()); }
+                    COUNTER_INCREMENT(dst_pg->metrics_, copied_blob_count, 1);
+                    COUNTER_INCREMENT(dst_pg->metrics_, copied_bytes, blob_size);
+                    if (auto const elapsed_us = get_elapsed_time_us(copy_start);
+                        blob_size >= copy_throughput_min_size && elapsed_us > 0) {
+                        // bytes per us is MB/s
+                        HISTOGRAM_OBSERVE(dst_pg->metrics_, blob_copy_throughput, blob_size / elapsed_us);
+                    }
+                    return result.value().blob_id;
+                });
         });
 }
 
@@ -205,6 +410,11 @@ bool HSHomeObject::local_add_blob_info(pg_id_t const pg_id, BlobInfo const& blob
     shared< BlobIndexTable > index_table = hs_pg->index_table_;
     RELEASE_ASSERT(index_table != nullptr, "Index table not initialized");
 
+    // Raise blob_sequence_num past this blob before the entry goes into the index table. The index insert is done
+    // under the cp of the entry, so whichever cp persists the entry also persists a pg superblock whose
+    // blob_sequence_num covers it, which is what the replay boundary after a restart is taken from.
+    const_cast< HS_PG* >(hs_pg)->raise_blob_sequence_num(blob_info.blob_id);
+
     // Write to index table with key {shard id, blob id} and value {pba}.
     auto const [exist_already, status] = add_to_index_table(index_table, blob_info);
     BLOGT(tid, blob_info.shard_id, blob_info.blob_id, "blob put commit, exist_already={}, status={}, pbas={}",
@@ -221,24 +431,72 @@ bool HSHomeObject::local_add_blob_info(pg_id_t const pg_id, BlobInfo const& blob
         // to increment now, it will be a duplicate increment, hence ignoring for cases where index already exist
         // for this blob put.
 
-        // Update the durable counters. We need to update the blob_sequence_num here only for replay case, as the
-        // number is already updated in the put_blob call.
+        // Update the durable counters. blob_sequence_num was already raised above.
         const_cast< HS_PG* >(hs_pg)->durable_entities_update([&blob_info](auto& de) {
-            auto existing_blob_id = de.blob_sequence_num.load();
-            auto next_blob_id = blob_info.blob_id + 1;
-            while (next_blob_id > existing_blob_id &&
-                   // we need update the blob_sequence_num to existing_blob_id+1 so that if leader changes, we can
-                   // still get the up-to-date blob_sequence_num
-                   !de.blob_sequence_num.compare_exchange_weak(existing_blob_id, next_blob_id)) {}
             de.active_blob_count.fetch_add(1, std::memory_order_relaxed);
             de.total_occupied_blk_count.fetch_add(blob_info.pbas.blk_count(), std::memory_order_relaxed);
         });
+        shard_digests_->add(blob_info.shard_id, blob_info.blob_id, blob_info.payload_crc);
     } else {
         BLOGT(tid, blob_info.shard_id, blob_info.blob_id, "blob already exists in index table, skip it.");
     }
     return true;
 }
 
+size_t HSHomeObject::local_add_blob_infos(pg_id_t const pg_id, std::vector< BlobInfo >& blob_infos, trace_id_t tid) {
+    if (blob_infos.empty()) { return 0; }
+    auto hs_pg = get_hs_pg(pg_id);
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found");
+    shared< BlobIndexTable > index_table = hs_pg->index_table_;
+    RELEASE_ASSERT(index_table != nullptr, "Index table not initialized");
+
+    // Apply in BlobRoute order so that consecutive inserts land on the same (or adjacent) leaf nodes, which are then
+    // still hot in the index cache, instead of the completion order of the data writes.
+    std::sort(blob_infos.begin(), blob_infos.end(), [](BlobInfo const& lhs, BlobInfo const& rhs) {
+        return BlobRoute{lhs.shard_id, lhs.blob_id} < BlobRoute{rhs.shard_id, rhs.blob_id};
+    });
+
+    // See local_add_blob_info, the sequence has to cover the entries before they are inserted.
+    const_cast< HS_PG* >(hs_pg)->raise_blob_sequence_num(
+        std::max_element(blob_infos.begin(), blob_infos.end(), [](BlobInfo const& lhs, BlobInfo const& rhs) {
+            return lhs.blob_id < rhs.blob_id;
+        })->blob_id);
+
+    size_t applied{0};
+    blob_id_t max_applied_blob_id{0};
+    uint64_t new_blobs{0};
+    uint64_t new_blks{0};
+    for (auto const& blob_info : blob_infos) {
+        auto const [exist_already, status] = add_to_index_table(index_table, blob_info);
+        BLOGT(tid, blob_info.shard_id, blob_info.blob_id, "batched blob add, exist_already={}, status={}, pbas={}",
+              exist_already, status, blob_info.pbas.to_string());
+        if (status != homestore::btree_status_t::success) {
+            BLOGE(tid, blob_info.shard_id, blob_info.blob_id, "Failed to insert into index table, err {}",
+                  enum_name(status));
+            break;
+        }
+        ++applied;
+        max_applied_blob_id = std::max(max_applied_blob_id, blob_info.blob_id);
+        // See local_add_blob_info for why counters are not touched for entries which already exist.
+        if (exist_already) { continue; }
+        shard_digests_->add(blob_info.shard_id, blob_info.blob_id, blob_info.payload_crc);
+        ++new_blobs;
+        new_blks += blob_info.pbas.blk_count();
+    }
+
+    if (new_blobs) {
+        // Update the durable counters once for the whole batch rather than once per blob.
+        const_cast< HS_PG* >(hs_pg)->durable_entities_update([new_blobs, new_blks](auto& de) {
+            de.active_blob_count.fetch_add(new_blobs, std::memory_order_relaxed);
+            de.total_occupied_blk_count.fetch_add(new_blks, std::memory_order_relaxed);
+        });
+    }
+    // Batched adds mostly come from outside the log (baseline resync), so the log may carry these blob ids again.
+    if (applied) { const_cast< HS_PG* >(hs_pg)->raise_replay_blob_id_boundary(max_applied_blob_id + 1); }
+    LOGD("batched blob add to pg={}, applied={}/{}, new_blobs={}", pg_id, applied, blob_infos.size(), new_blobs);
+    return applied;
+}
+
 void HSHomeObject::on_blob_put_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                                       homestore::MultiBlkId const& pbas,
                                       cintrusive< homestore::repl_req_ctx >& hs_ctx) {
@@ -262,25 +520,135 @@ void HSHomeObject::on_blob_put_commit(int64_t lsn, sisl::blob const& header, sis
     blob_info.shard_id = msg_header->shard_id;
     blob_info.blob_id = blob_id;
     blob_info.pbas = pbas;
+    blob_info.payload_crc = msg_header->payload_crc;
 
     bool success = local_add_blob_info(pg_id, blob_info, tid);
 
+    if (ctx && success && recent_write_cache_) {
+        // The cache keeps a reference to the request rather than a copy of its payload, and with it all of its
+        // buffers.
+        uint64_t held_bytes = sizeof(put_blob_req_ctx) + ctx->cheader_buf().size() + ctx->ckey_buf().size();
+        for (auto const& buf : ctx->data_bufs_) {
+            held_bytes += buf.size();
+        }
+        BlobImageRef const image{ctx->data_sgs(), std::shared_ptr< void >(nullptr, [keep = hs_ctx](void*) {}),
+                                 held_bytes};
+        // Keep the payload around on the leader, lagging followers will fetch it shortly.
+        recent_write_cache_->put(BlobRoute{blob_info.shard_id, blob_id}, pbas, image);
+    }
+
     if (ctx) {
         ctx->promise_.setValue(success ? BlobManager::Result< BlobInfo >(blob_info)
                                        : folly::makeUnexpected(BlobError(BlobErrorCode::INDEX_ERROR)));
     }
 }
 
+std::optional< std::vector< ImportedBlobEntry > > HSHomeObject::imported_blob_entries(sisl::blob const& header) {
+    if (header.size() <= sizeof(ReplicationMessageHeader)) { return std::nullopt; }
+    auto msg_header = r_cast< ReplicationMessageHeader const* >(header.cbytes());
+    auto const extn_size = header.size() - sizeof(ReplicationMessageHeader);
+    if (msg_header->payload_size != extn_size || extn_size % sizeof(ImportedBlobEntry) != 0) { return std::nullopt; }
+    auto const extn = header.cbytes() + sizeof(ReplicationMessageHeader);
+    if (crc32_ieee(init_crc32, extn, extn_size) != msg_header->payload_crc) { return std::nullopt; }
+    std::vector< ImportedBlobEntry > entries(extn_size / sizeof(ImportedBlobEntry));
+    std::memcpy(entries.data(), extn, extn_size);
+    return entries;
+}
+
+void HSHomeObject::on_blobs_import_commit(int64_t lsn, sisl::blob const& header, homestore::MultiBlkId const& pbas,
+                                          cintrusive< homestore::repl_req_ctx >& hs_ctx) {
+    repl_result_ctx< BlobManager::Result< BlobInfo > >* ctx{nullptr};
+    if (hs_ctx && hs_ctx->is_proposer()) {
+        ctx = boost::static_pointer_cast< repl_result_ctx< BlobManager::Result< BlobInfo > > >(hs_ctx).get();
+    }
+    trace_id_t tid = hs_ctx ? hs_ctx->traceID() : 0;
+    auto msg_header = r_cast< ReplicationMessageHeader const* >(header.cbytes());
+    auto entries = msg_header->corrupted() ? std::nullopt : imported_blob_entries(header);
+    if (!entries) {
+        LOGE("import_blobs message is corrupted with crc error, lsn={}, traceID={}", lsn, tid);
+        if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH))); }
+        return;
+    }
+    // The blobs are carved out of the blocks of the batch, laid out back to back over its pieces. An index entry
+    // holds a single piece, so a blob split across two pieces by this replica's allocator cannot be indexed.
+    struct piece {
+        uint32_t first_blk;
+        homestore::BlkId blkid;
+    };
+    std::vector< piece > pieces;
+    uint32_t num_blks{0};
+    auto it = pbas.iterate();
+    while (auto const b = it.next()) {
+        pieces.push_back(piece{num_blks, *b});
+        num_blks += b->blk_count();
+    }
+
+    std::vector< BlobInfo > blob_infos;
+    blob_infos.reserve(entries->size());
+    for (auto const& e : *entries) {
+        auto p = std::find_if(pieces.begin(), pieces.end(), [&e](piece const& pc) {
+            return e.blk_offset >= pc.first_blk && e.blk_offset < pc.first_blk + pc.blkid.blk_count();
+        });
+        if (p == pieces.end() || e.blk_offset + e.blk_count > p->first_blk + p->blkid.blk_count()) {
+            LOGE("import_blobs lsn={}, traceID={}: blob_id={} at blk_offset={} blk_count={} spans the pieces of "
+                 "pbas={}, the batch is not imported, shardID=0x{:x} needs a resync on this replica",
+                 lsn, tid, e.blob_id, e.blk_offset, e.blk_count, pbas.to_string(), msg_header->shard_id);
+            if (auto hs_pg = get_hs_pg(msg_header->pg_id); hs_pg) { hs_pg->repl_dev_->async_free_blks(lsn, pbas); }
+            if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError(BlobErrorCode::INDEX_ERROR))); }
+            return;
+        }
+        blob_infos.push_back(BlobInfo{.shard_id = msg_header->shard_id,
+                                      .blob_id = e.blob_id,
+                                      .pbas = homestore::MultiBlkId(p->blkid.blk_num() + (e.blk_offset - p->first_blk),
+                                                                    homestore::blk_count_t(e.blk_count),
+                                                                    p->blkid.chunk_num()),
+                                      .payload_crc = e.payload_crc});
+    }
+    auto const applied = local_add_blob_infos(msg_header->pg_id, blob_infos, tid);
+    auto const success = applied == blob_infos.size();
+    LOGD("import_blobs commit lsn={}, traceID={}, shardID=0x{:x}, blobs={}, applied={}, pbas={}", lsn, tid,
+         msg_header->shard_id, blob_infos.size(), applied, pbas.to_string());
+
+    if (ctx) {
+        // the result stands for the whole batch, its last blob and the blocks of all of them
+        ctx->promise_.setValue(success ? BlobManager::Result< BlobInfo >(
+                                             BlobInfo{msg_header->shard_id, blob_infos.back().blob_id, pbas, 0})
+                                       : folly::makeUnexpected(BlobError(BlobErrorCode::INDEX_ERROR)));
+    }
+}
+
+bool HSHomeObject::read_from_recent_write_cache(shard_id_t shard_id, blob_id_t blob_id,
+                                                homestore::MultiBlkId const& blkid, uint8_t* buf, size_t size) const {
+    if (!recent_write_cache_) { return false; }
+    return recent_write_cache_->get(BlobRoute{shard_id, blob_id}, blkid, buf, size);
+}
+
+bool HSHomeObject::shed_expired_request(const HS_PG* hs_pg, op_deadline_t deadline, trace_id_t tid,
+                                        shard_id_t shard_id, blob_id_t blob_id, std::string_view phase) const {
+    if (!deadline_expired(deadline)) { return false; }
+    BLOGD(tid, shard_id, blob_id, "deadline exceeded before {}, shedding request", phase);
+    COUNTER_INCREMENT(hs_pg->metrics_, shed_request_count, 1);
+    return true;
+}
+
+nlohmann::json HSHomeObject::dump_hot_spots() const {
+    if (!hot_spot_tracker_) { return nlohmann::json::object(); }
+    std::vector< pg_id_t > pg_ids;
+    _get_pg_ids(pg_ids);
+    return hot_spot_tracker_->dump(pg_ids);
+}
+
 BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob(ShardInfo const& shard, blob_id_t blob_id, uint64_t req_offset,
-                                                         uint64_t req_len, trace_id_t tid) const {
+                                                         uint64_t req_len, trace_id_t tid,
+                                                         op_deadline_t deadline) const {
     if (is_shutting_down()) {
         LOGI("service is being shutdown");
         return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
     }
-    incr_pending_request_num();
     auto& pg_id = shard.placement_group;
     auto hs_pg = get_hs_pg(pg_id);
     RELEASE_ASSERT(hs_pg, "PG not found");
+    incr_pending_request_num(hs_pg);
     auto repl_dev = hs_pg->repl_dev_;
     auto index_table = hs_pg->index_table_;
 
@@ -290,7 +658,7 @@ BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob(ShardInfo const& shard,
     if (!repl_dev->is_ready_for_traffic()) {
         LOGW("failed to get blob for pg={}, shardID=0x{:x},pg={},shard=0x{:x}, not ready for traffic", pg_id, shard.id,
              (shard.id >> homeobject::shard_width), (shard.id & homeobject::shard_mask));
-        decr_pending_request_num();
+        decr_pending_request_num(hs_pg);
         return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
     }
 
@@ -299,45 +667,59 @@ BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob(ShardInfo const& shard,
     auto r = get_blob_from_index_table(index_table, shard.id, blob_id);
     if (!r) {
         BLOGE(tid, shard.id, blob_id, "Blob not found in index during get blob");
-        decr_pending_request_num();
+        decr_pending_request_num(hs_pg);
         return folly::makeUnexpected(r.error());
     }
 
-    return _get_blob_data(repl_dev, shard.id, blob_id, req_offset, req_len, r.value() /* blkid*/, tid);
+    hot_spot_tracker_->record(shard.id, r.value().blk_count() * repl_dev->get_blk_size());
+    return _get_blob_data(hs_pg, repl_dev, shard.id, blob_id, req_offset, req_len, r.value() /* blkid*/, tid,
+                          deadline);
 }
 
-BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob_data(const shared< homestore::ReplDev >& repl_dev,
+BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob_data(const HS_PG* hs_pg,
+                                                              const shared< homestore::ReplDev >& repl_dev,
                                                               shard_id_t shard_id, blob_id_t blob_id,
                                                               uint64_t req_offset, uint64_t req_len,
-                                                              const homestore::MultiBlkId& blkid,
-                                                              trace_id_t tid) const {
+                                                              const homestore::MultiBlkId& blkid, trace_id_t tid,
+                                                              op_deadline_t deadline) const {
+    if (shed_expired_request(hs_pg, deadline, tid, shard_id, blob_id, "read")) {
+        decr_pending_request_num(hs_pg);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    }
+
     auto const total_size = blkid.blk_count() * repl_dev->get_blk_size();
-    sisl::io_blob_safe read_buf{total_size, io_align};
+    // The read buffer only lives until the requested range is copied out, hand it back to the pool afterwards.
+    pooled_io_buf read_buf{total_size, io_align};
 
     sisl::sg_list sgs;
     sgs.size = total_size;
     sgs.iovs.emplace_back(iovec{.iov_base = read_buf.bytes(), .iov_len = read_buf.size()});
 
     BLOGD(tid, shard_id, blob_id, "Reading from blkid={} to buf={}", blkid.to_string(), (void*)read_buf.bytes());
-    return repl_dev->async_read(blkid, sgs, total_size)
-        .thenValue([this, tid, blob_id, shard_id, req_len, req_offset, blkid, repl_dev,
+    auto read_done = issue_data_io(hs_pg->pg_info_.id, PGIoScheduler::io_type::READ,
+                                   PGIoScheduler::io_class::FOREGROUND, total_size,
+                                   [repl_dev, blkid, sgs, total_size]() {
+                                       return repl_dev->async_read(blkid, sgs, total_size);
+                                   });
+    return std::move(read_done)
+        .thenValue([this, hs_pg, tid, blob_id, shard_id, req_len, req_offset, blkid, repl_dev, deadline,
                     read_buf = std::move(read_buf)](auto&& result) mutable -> BlobManager::AsyncResult< Blob > {
             if (result) {
                 BLOGE(tid, shard_id, blob_id, "Failed to get blob: err={}", blob_id, shard_id, result.value());
-                decr_pending_request_num();
-                return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+                decr_pending_request_num(hs_pg);
+                return folly::makeUnexpected(data_io_error(result));
             }
 
             BlobHeader const* header = r_cast< BlobHeader const* >(read_buf.cbytes());
             if (!header->valid()) {
                 BLOGE(tid, shard_id, blob_id, "Invalid header found: [header={}]", header->to_string());
-                decr_pending_request_num();
+                decr_pending_request_num(hs_pg);
                 return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
             }
 
             if (header->shard_id != shard_id) {
                 BLOGE(tid, shard_id, blob_id, "Invalid shard_id in header: [header={}]", header->to_string());
-                decr_pending_request_num();
+                decr_pending_request_num(hs_pg);
                 return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
             }
 
@@ -346,22 +728,42 @@ BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob_data(const shared< home
                 ? std::string((const char*)(read_buf.bytes() + sizeof(BlobHeader)), (size_t)header->user_key_size)
                 : std::string{};
 
+            if (shed_expired_request(hs_pg, deadline, tid, shard_id, blob_id, "checksum")) {
+                decr_pending_request_num(hs_pg);
+                return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+            }
+
             uint8_t const* blob_bytes = read_buf.bytes() + header->data_offset;
-            uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
-            compute_blob_payload_hash(header->hash_algorithm, blob_bytes, header->blob_size,
-                                      uintptr_cast(user_key.data()), header->user_key_size, computed_hash,
-                                      BlobHeader::blob_max_hash_len);
-            if (std::memcmp(computed_hash, header->hash, BlobHeader::blob_max_hash_len) != 0) {
-                BLOGE(tid, shard_id, blob_id, "Hash mismatch header, [header={}] [computed={:np}]", header->to_string(),
-                      spdlog::to_hex(computed_hash, computed_hash + BlobHeader::blob_max_hash_len));
-                decr_pending_request_num();
-                return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+            // blocks the scrubber verified a moment ago are trusted, see scrub_skip_verify_window_sec
+            if (!scrubber_->recently_verified(blkid)) {
+                uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
+                compute_blob_payload_hash(header->hash_algorithm, blob_bytes, header->blob_size,
+                                          uintptr_cast(user_key.data()), header->user_key_size, computed_hash,
+                                          BlobHeader::blob_max_hash_len);
+                if (std::memcmp(computed_hash, header->hash, BlobHeader::blob_max_hash_len) != 0) {
+                    BLOGE(tid, shard_id, blob_id, "Hash mismatch header, [header={}] [computed={:np}]",
+                          header->to_string(),
+                          spdlog::to_hex(computed_hash, computed_hash + BlobHeader::blob_max_hash_len));
+                    decr_pending_request_num(hs_pg);
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+                }
+            }
+            if (header->type == DataHeader::data_type_t::MULTIPART_MANIFEST) {
+                // the blob is the manifest of a multi-part object, the range is read from the parts it lists
+                auto entries = multipart_manifest_entries(blob_bytes, header->blob_size);
+                decr_pending_request_num(hs_pg);
+                if (!entries) {
+                    BLOGE(tid, shard_id, blob_id, "Invalid multi-part manifest: [header={}]", header->to_string());
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+                }
+                return read_multipart(hs_pg, repl_dev, shard_id, *entries, req_offset, req_len, std::move(user_key),
+                                      header->object_offset, tid, deadline);
             }
 
             if (req_offset + req_len > header->blob_size) {
                 BLOGE(tid, shard_id, blob_id, "Invalid offset length requested in get blob offset={} len={} size={}",
                       req_offset, req_len, header->blob_size);
-                decr_pending_request_num();
+                decr_pending_request_num(hs_pg);
                 return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
             }
 
@@ -370,10 +772,227 @@ BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob_data(const shared< home
             auto res_len = req_len == 0 ? header->blob_size - req_offset : req_len;
             auto body = sisl::io_blob_safe(res_len);
             std::memcpy(body.bytes(), blob_bytes + req_offset, res_len);
+            auto const object_off = header->object_offset;
 
             BLOGD(tid, blob_id, shard_id, "Blob get success: blkid={}", blkid.to_string());
-            decr_pending_request_num();
-            return Blob(std::move(body), std::move(user_key), header->object_offset, repl_dev->get_leader_id());
+            decr_pending_request_num(hs_pg);
+            return Blob(std::move(body), std::move(user_key), object_off, repl_dev->get_leader_id());
+        });
+}
+
+BlobManager::AsyncResult< BlobRead > HSHomeObject::_get_blob_into(ShardInfo const& shard, blob_id_t blob_id,
+                                                                  sisl::sg_list const& dest, uint64_t req_offset,
+                                                                  uint64_t req_len, trace_id_t tid,
+                                                                  op_deadline_t deadline) const {
+    if (is_shutting_down()) {
+        LOGI("service is being shutdown");
+        return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
+    }
+    auto hs_pg = get_hs_pg(shard.placement_group);
+    RELEASE_ASSERT(hs_pg, "PG not found");
+    auto repl_dev = hs_pg->repl_dev_;
+    if (!repl_dev->is_ready_for_traffic()) {
+        BLOGW(tid, shard.id, blob_id, "failed to get blob into buffers, not ready for traffic");
+        return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
+    }
+    auto r = get_blob_from_index_table(hs_pg->index_table_, shard.id, blob_id);
+    if (!r) {
+        BLOGE(tid, shard.id, blob_id, "Blob not found in index during get blob into buffers");
+        return folly::makeUnexpected(r.error());
+    }
+    if (shed_expired_request(hs_pg, deadline, tid, shard.id, blob_id, "read")) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    }
+    auto const blkid = r.value();
+    auto const blk_size = repl_dev->get_blk_size();
+    auto const total_size = blkid.blk_count() * blk_size;
+
+    // The header and user key of most blobs fit in the first io_align bytes, the payload is read as if it started
+    // there: the range straight into dest, what comes before it and after the part of dest it fits in to buffers of
+    // our own. Multi-part objects, blobs with a longer user key, unaligned requests and blobs of a few blocks (cheaper
+    // to copy than to read twice) go through get instead.
+    auto const range_start = io_align + req_offset;
+    bool aligned = req_offset % io_align == 0;
+    uint64_t direct_size{0};
+    for (size_t i = 0; aligned && i < dest.iovs.size(); ++i) {
+        auto const& iov = dest.iovs[i];
+        bool const last = i + 1 == dest.iovs.size();
+        aligned = (r_cast< uintptr_t >(iov.iov_base) % io_align) == 0 && (last || (iov.iov_len % io_align) == 0);
+        direct_size += iov.iov_len / io_align * io_align;
+    }
+    if (!aligned || range_start >= total_size || total_size <= get_into_copy_max_blks * blk_size) {
+        return get_blob_into_copy(shard, blob_id, dest, req_offset, req_len, tid, deadline);
+    }
+
+    // Nothing is read into dest before the header says the blob fits the direct read, so its first block is read
+    // on its own first.
+    pooled_io_buf probe_buf{blk_size, io_align};
+    sisl::sg_list probe_sgs;
+    probe_sgs.size = blk_size;
+    probe_sgs.iovs.emplace_back(iovec{.iov_base = probe_buf.bytes(), .iov_len = probe_buf.size()});
+    homestore::MultiBlkId const probe_blk{blkid.blk_num(), 1, blkid.chunk_num()};
+    incr_pending_request_num(hs_pg);
+    auto probe_done = issue_data_io(hs_pg->pg_info_.id, PGIoScheduler::io_type::READ,
+                                    PGIoScheduler::io_class::FOREGROUND, blk_size,
+                                    [repl_dev, probe_blk, probe_sgs, blk_size]() {
+                                        return repl_dev->async_read(probe_blk, probe_sgs, blk_size);
+                                    });
+    return std::move(probe_done)
+        .thenValue([this, hs_pg, shard, blob_id, blkid, dest, req_offset, req_len, tid, deadline, total_size,
+                    direct_size,
+                    probe_buf = std::move(probe_buf)](auto&& err) mutable -> BlobManager::AsyncResult< BlobRead > {
+            auto r = [&]() -> BlobManager::AsyncResult< BlobRead > {
+                if (err) {
+                    BLOGE(tid, shard.id, blob_id, "Failed to read blob header: err={}", err.message());
+                    return folly::makeUnexpected(data_io_error(err));
+                }
+                BlobHeader const* header = r_cast< BlobHeader const* >(probe_buf.cbytes());
+                if (!header->valid() || header->shard_id != shard.id ||
+                    uint64_t{header->data_offset} + header->blob_size > total_size) {
+                    BLOGE(tid, shard.id, blob_id, "Invalid header found: [header={}]", header->to_string());
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+                }
+                if (header->data_offset != io_align || header->type == DataHeader::data_type_t::MULTIPART_MANIFEST) {
+                    return get_blob_into_copy(shard, blob_id, dest, req_offset, req_len, tid, deadline);
+                }
+                if (req_offset + req_len > header->blob_size) {
+                    BLOGE(tid, shard.id, blob_id,
+                          "Invalid offset length requested in get blob offset={} len={} size={}", req_offset, req_len,
+                          header->blob_size);
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+                }
+                auto const res_len = req_len == 0 ? header->blob_size - req_offset : req_len;
+                if (res_len > dest.size) {
+                    BLOGE(tid, shard.id, blob_id, "Buffers of {} bytes can not hold the {} bytes requested",
+                          dest.size, res_len);
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+                }
+                return read_blob_into(hs_pg, shard.id, blob_id, blkid, dest, req_offset, res_len,
+                                      std::min(direct_size, sisl::round_up(res_len, io_align)), tid, deadline);
+            }();
+            decr_pending_request_num(hs_pg);
+            return r;
+        });
+}
+
+BlobManager::AsyncResult< BlobRead >
+HSHomeObject::read_blob_into(const HS_PG* hs_pg, shard_id_t shard_id, blob_id_t blob_id,
+                             homestore::MultiBlkId const& blkid, sisl::sg_list const& dest, uint64_t req_offset,
+                             uint64_t res_len, uint64_t direct_size, trace_id_t tid, op_deadline_t deadline) const {
+    auto repl_dev = hs_pg->repl_dev_;
+    auto const blk_size = repl_dev->get_blk_size();
+    auto const total_size = blkid.blk_count() * blk_size;
+    auto const range_start = io_align + req_offset;
+    direct_size = std::min(direct_size, total_size - range_start);
+    // blocks the scrubber verified a moment ago are trusted, see scrub_skip_verify_window_sec. Otherwise the whole
+    // payload is read to verify it, as get does.
+    bool const verify = !scrubber_->recently_verified(blkid);
+    auto const read_size =
+        verify ? total_size : std::min(total_size, sisl::round_up(range_start + res_len, uint64_t{blk_size}));
+
+    pooled_io_buf head_buf{static_cast< uint32_t >(range_start), io_align};
+    sisl::sg_list sgs;
+    sgs.size = read_size;
+    sgs.iovs.emplace_back(iovec{.iov_base = head_buf.bytes(), .iov_len = head_buf.size()});
+    uint64_t left = direct_size;
+    for (auto const& iov : dest.iovs) {
+        if (left == 0) { break; }
+        auto const n = std::min< uint64_t >(left, iov.iov_len / io_align * io_align);
+        sgs.iovs.emplace_back(iovec{.iov_base = iov.iov_base, .iov_len = n});
+        left -= n;
+    }
+    std::optional< pooled_io_buf > tail_buf;
+    if (auto const tail_size = read_size - range_start - direct_size; tail_size) {
+        tail_buf.emplace(static_cast< uint32_t >(tail_size), io_align);
+        sgs.iovs.emplace_back(iovec{.iov_base = tail_buf->bytes(), .iov_len = tail_buf->size()});
+    }
+
+    hot_spot_tracker_->record(shard_id, read_size);
+    homestore::MultiBlkId const read_blks(blkid.blk_num(), homestore::blk_count_t(read_size / blk_size),
+                                          blkid.chunk_num());
+    BLOGD(tid, shard_id, blob_id, "Reading into caller buffers from blkid={}, direct={} of {}", blkid.to_string(),
+          direct_size, read_size);
+    incr_pending_request_num(hs_pg);
+    auto read_done = issue_data_io(hs_pg->pg_info_.id, PGIoScheduler::io_type::READ,
+                                   PGIoScheduler::io_class::FOREGROUND, read_size,
+                                   [repl_dev, read_blks, sgs, read_size]() {
+                                       return repl_dev->async_read(read_blks, sgs, read_size);
+                                   });
+    return std::move(read_done).thenValue(
+        [this, hs_pg, shard_id, blob_id, dest, req_offset, res_len, tid, deadline, direct_size, verify,
+         head_buf = std::move(head_buf),
+         tail_buf = std::move(tail_buf)](auto&& err) mutable -> BlobManager::Result< BlobRead > {
+            decr_pending_request_num(hs_pg);
+            if (err) {
+                BLOGE(tid, shard_id, blob_id, "Failed to get blob into buffers: err={}", err.message());
+                return folly::makeUnexpected(data_io_error(err));
+            }
+            // the blob may have been rewritten since its header was read
+            BlobHeader const* header = r_cast< BlobHeader const* >(head_buf.cbytes());
+            if (!header->valid() || header->shard_id != shard_id || header->data_offset != io_align ||
+                req_offset + res_len > header->blob_size) {
+                BLOGE(tid, shard_id, blob_id, "Invalid header found: [header={}]", header->to_string());
+                return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+            }
+            // what did not fit in the aligned part of dest landed in the tail buffer
+            if (res_len > direct_size) {
+                copy_to_sg_list(dest, direct_size, tail_buf->cbytes(), res_len - direct_size);
+            }
+            std::string user_key = header->user_key_size
+                ? std::string((const char*)(head_buf.cbytes() + sizeof(BlobHeader)), (size_t)header->user_key_size)
+                : std::string{};
+
+            if (verify && header->hash_algorithm == BlobHeader::HashAlgorithm::CRC32) {
+                if (shed_expired_request(hs_pg, deadline, tid, shard_id, blob_id, "checksum")) {
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+                }
+                // the payload is spread over the head buffer, dest and the tail buffer in that order
+                auto crc = crc32_ieee(init_crc32, head_buf.cbytes() + io_align, req_offset);
+                uint64_t left = header->blob_size - req_offset;
+                uint64_t in_dest = std::min(left, direct_size);
+                for (auto const& iov : dest.iovs) {
+                    if (in_dest == 0) { break; }
+                    auto const n = std::min< uint64_t >(in_dest, iov.iov_len);
+                    crc = crc32_ieee(crc, r_cast< uint8_t const* >(iov.iov_base), n);
+                    in_dest -= n;
+                    left -= n;
+                }
+                if (left) { crc = crc32_ieee(crc, tail_buf->cbytes(), left); }
+                if (!user_key.empty()) { crc = crc32_ieee(crc, uintptr_cast(user_key.data()), user_key.size()); }
+                uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
+                std::memcpy(computed_hash, &crc, sizeof(uint32_t));
+                if (std::memcmp(computed_hash, header->hash, BlobHeader::blob_max_hash_len) != 0) {
+                    BLOGE(tid, shard_id, blob_id, "Hash mismatch header, [header={}] [computed={:np}]",
+                          header->to_string(),
+                          spdlog::to_hex(computed_hash, computed_hash + BlobHeader::blob_max_hash_len));
+                    return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+                }
+            }
+
+            COUNTER_INCREMENT(hs_pg->metrics_, get_into_direct_bytes, std::min(res_len, direct_size));
+            BLOGD(tid, shard_id, blob_id, "Blob get into buffers success");
+            return BlobRead{.size = res_len,
+                            .user_key = std::move(user_key),
+                            .object_off = header->object_offset,
+                            .current_leader = hs_pg->repl_dev_->get_leader_id()};
+        });
+}
+
+BlobManager::AsyncResult< BlobRead > HSHomeObject::get_blob_into_copy(ShardInfo const& shard, blob_id_t blob_id,
+                                                                      sisl::sg_list const& dest, uint64_t req_offset,
+                                                                      uint64_t req_len, trace_id_t tid,
+                                                                      op_deadline_t deadline) const {
+    COUNTER_INCREMENT(get_hs_pg(shard.placement_group)->metrics_, get_into_copied_count, 1);
+    return _get_blob(shard, blob_id, req_offset, req_len, tid, deadline)
+        .deferValue([dest](auto&& r) -> BlobManager::Result< BlobRead > {
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            auto& blob = r.value();
+            if (blob.body.size() > dest.size) { return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG)); }
+            copy_to_sg_list(dest, 0, blob.body.cbytes(), blob.body.size());
+            return BlobRead{.size = blob.body.size(),
+                            .user_key = std::move(blob.user_key),
+                            .object_off = blob.object_off,
+                            .current_leader = blob.current_leader};
         });
 }
 
@@ -424,7 +1043,9 @@ HSHomeObject::blob_put_get_blk_alloc_hints(sisl::blob const& header, cintrusive<
     BLOGD(tid, msg_header->shard_id, msg_header->blob_id, "Picked p_chunk_id={}, reserved_blks={}",
           hs_shard->sb_->p_chunk_id, get_reserved_blks());
 
-    if (msg_header->blob_id != 0) {
+    // Only a blob id below the replay boundary can already be in the index table (log replay after restart, or log
+    // entries overlapping a baseline resync). Fresh puts skip the lookup.
+    if (msg_header->blob_id != 0 && hs_pg->may_be_replayed_blob(msg_header->blob_id)) {
         // check if the blob already exists, if yes, return the blk id
         auto r = get_blob_from_index_table(hs_pg->index_table_, msg_header->shard_id, msg_header->blob_id);
         if (r.hasValue()) {
@@ -438,16 +1059,22 @@ HSHomeObject::blob_put_get_blk_alloc_hints(sisl::blob const& header, cintrusive<
     return hints;
 }
 
-BlobManager::NullAsyncResult HSHomeObject::_del_blob(ShardInfo const& shard, blob_id_t blob_id, trace_id_t tid) {
+BlobManager::NullAsyncResult HSHomeObject::_del_blob(ShardInfo const& shard, blob_id_t blob_id, trace_id_t tid,
+                                                    op_deadline_t deadline) {
     if (is_shutting_down()) {
         LOGI("service is being shut down");
         return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
     }
-    incr_pending_request_num();
     BLOGT(tid, shard.id, blob_id, "deleting blob");
     auto& pg_id = shard.placement_group;
     auto hs_pg = get_hs_pg(pg_id);
     RELEASE_ASSERT(hs_pg, "PG not found");
+    incr_pending_request_num(hs_pg);
+    hot_spot_tracker_->record(shard.id, 0);
+    if (shed_expired_request(hs_pg, deadline, tid, shard.id, blob_id, "del")) {
+        decr_pending_request_num(hs_pg);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    }
     auto repl_dev = hs_pg->repl_dev_;
 
     RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
@@ -456,13 +1083,13 @@ BlobManager::NullAsyncResult HSHomeObject::_del_blob(ShardInfo const& shard, blo
 
     if (!repl_dev->is_leader()) {
         BLOGW(tid, shard.id, blob_id, "failed to del blob, not leader");
-        decr_pending_request_num();
+        decr_pending_request_num(hs_pg);
         return folly::makeUnexpected(BlobError(BlobErrorCode::NOT_LEADER, repl_dev->get_leader_id()));
     }
 
     if (!repl_dev->is_ready_for_traffic()) {
         BLOGW(tid, shard.id, blob_id, "failed to del blob, not ready for traffic");
-        decr_pending_request_num();
+        decr_pending_request_num(hs_pg);
         return folly::makeUnexpected(BlobError(BlobErrorCode::RETRY_REQUEST));
     }
 
@@ -482,16 +1109,16 @@ BlobManager::NullAsyncResult HSHomeObject::_del_blob(ShardInfo const& shard, blo
     repl_dev->async_alloc_write(req->cheader_buf(), req->ckey_buf(), sisl::sg_list{}, req, false /* part_of_batch */,
                                 tid);
     return req->result().deferValue(
-        [this, repl_dev, tid](const auto& result) -> folly::Expected< folly::Unit, BlobError > {
+        [this, repl_dev, hs_pg, tid](const auto& result) -> folly::Expected< folly::Unit, BlobError > {
             if (result.hasError()) {
                 auto err = result.error();
                 if (err.getCode() == BlobErrorCode::NOT_LEADER) { err.current_leader = repl_dev->get_leader_id(); }
-                decr_pending_request_num();
+                decr_pending_request_num(hs_pg);
                 return folly::makeUnexpected(err);
             }
             auto blob_info = result.value();
             BLOGT(tid, blob_info.shard_id, blob_info.blob_id, "Delete blob successful");
-            decr_pending_request_num();
+            decr_pending_request_num(hs_pg);
             return folly::Unit();
         });
 }
@@ -534,8 +1161,10 @@ void HSHomeObject::on_blob_del_commit(int64_t lsn, sisl::blob const& header, sis
         }
     }
 
-    auto& multiBlks = r.value();
+    auto const& multiBlks = r->pbas;
     if (multiBlks != tombstone_pbas) {
+        // the crc the blob was added with comes from the index, no need to read the blob
+        shard_digests_->remove(blob_info.shard_id, blob_info.blob_id, r->payload_crc);
         repl_dev->async_free_blks(lsn, multiBlks);
         const_cast< HS_PG* >(hs_pg)->durable_entities_update([](auto& de) {
             de.active_blob_count.fetch_sub(1, std::memory_order_relaxed);
@@ -566,6 +1195,94 @@ void HSHomeObject::compute_blob_payload_hash(BlobHeader::HashAlgorithm algorithm
     }
 }
 
+folly::SemiFuture< BlobManager::Result< uint32_t > >
+HSHomeObject::verify_blob(const HS_PG* hs_pg, BlobInfo const& blob_info,
+                          std::function< void(uint8_t const* image, size_t size) > on_image) const {
+    auto repl_dev = hs_pg->repl_dev_;
+    auto const blkid = blob_info.pbas;
+    auto const total_size = blkid.blk_count() * repl_dev->get_blk_size();
+    pooled_io_buf read_buf{total_size, io_align};
+    sisl::sg_list sgs;
+    sgs.size = total_size;
+    sgs.iovs.emplace_back(iovec{.iov_base = read_buf.bytes(), .iov_len = read_buf.size()});
+
+    return issue_data_io(hs_pg->pg_info_.id, PGIoScheduler::io_type::READ, PGIoScheduler::io_class::BACKGROUND,
+                         total_size,
+                         [repl_dev, blkid, sgs, total_size]() { return repl_dev->async_read(blkid, sgs, total_size); })
+        .thenValue([this, blob_info, on_image = std::move(on_image),
+                    read_buf = std::move(read_buf)](auto&& err) -> BlobManager::Result< uint32_t > {
+            auto const shard_id = blob_info.shard_id;
+            auto const blob_id = blob_info.blob_id;
+            if (err) {
+                BLOGE(0, shard_id, blob_id, "Failed to read blob for verification: err={}", err.message());
+                return folly::makeUnexpected(data_io_error(err));
+            }
+            auto r = check_blob_image(blob_info, read_buf.cbytes(), read_buf.size());
+            if (r && on_image) { on_image(read_buf.cbytes(), read_buf.size()); }
+            return r;
+        });
+}
+
+folly::Future< BlobManager::Result< pooled_io_buf > > HSHomeObject::read_blob_blocks(const HS_PG* hs_pg,
+                                                                                   homestore::MultiBlkId const& blkid,
+                                                                                   uint64_t offset,
+                                                                                   uint64_t size) const {
+    if (is_shutting_down()) {
+        return folly::makeFuture< BlobManager::Result< pooled_io_buf > >(
+            folly::makeUnexpected(BlobError(BlobErrorCode::SHUTTING_DOWN)));
+    }
+    auto repl_dev = hs_pg->repl_dev_;
+    auto const blk_size = repl_dev->get_blk_size();
+    RELEASE_ASSERT(offset % blk_size == 0 && size % blk_size == 0 && offset + size <= blkid.blk_count() * blk_size,
+                   "Unaligned or out of bounds read of blk_id={}, offset={} size={}", blkid.to_string(), offset, size);
+    homestore::MultiBlkId const blks(blkid.blk_num() + offset / blk_size, homestore::blk_count_t(size / blk_size),
+                                     blkid.chunk_num());
+    pooled_io_buf read_buf{static_cast< uint32_t >(size), io_align};
+    sisl::sg_list sgs;
+    sgs.size = size;
+    sgs.iovs.emplace_back(iovec{.iov_base = read_buf.bytes(), .iov_len = read_buf.size()});
+
+    incr_pending_request_num(hs_pg);
+    return issue_data_io(hs_pg->pg_info_.id, PGIoScheduler::io_type::READ, PGIoScheduler::io_class::FOREGROUND, size,
+                         [repl_dev, blks, sgs, size]() { return repl_dev->async_read(blks, sgs, size); })
+        .thenValue([this, hs_pg, blks,
+                    read_buf = std::move(read_buf)](auto&& err) mutable -> BlobManager::Result< pooled_io_buf > {
+            decr_pending_request_num(hs_pg);
+            if (err) {
+                LOGE("Failed to read blk_id={}: err={}", blks.to_string(), err.message());
+                return folly::makeUnexpected(data_io_error(err));
+            }
+            return std::move(read_buf);
+        });
+}
+
+BlobManager::Result< uint32_t > HSHomeObject::check_blob_image(BlobInfo const& blob_info, uint8_t const* buf,
+                                                               size_t size, bool verify_hash) const {
+    auto const shard_id = blob_info.shard_id;
+    auto const blob_id = blob_info.blob_id;
+    auto header = r_cast< BlobHeader const* >(buf);
+    if (size < sizeof(BlobHeader) || !header->valid() || header->shard_id != shard_id) {
+        BLOGE(0, shard_id, blob_id, "Invalid header found: [header={}]", header->to_string());
+        return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+    }
+    if (uint64_t(header->data_offset) + header->blob_size > size) {
+        BLOGE(0, shard_id, blob_id, "Blob size exceeds its blocks: [header={}]", header->to_string());
+        return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+    }
+    if (!verify_hash) { return header->payload_crc(); }
+
+    uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
+    compute_blob_payload_hash(header->hash_algorithm, buf + header->data_offset, header->blob_size,
+                              buf + sizeof(BlobHeader), header->user_key_size, computed_hash,
+                              BlobHeader::blob_max_hash_len);
+    if (std::memcmp(computed_hash, header->hash, BlobHeader::blob_max_hash_len) != 0) {
+        BLOGE(0, shard_id, blob_id, "Hash mismatch header, [header={}] [computed={:np}]", header->to_string(),
+              spdlog::to_hex(computed_hash, computed_hash + BlobHeader::blob_max_hash_len));
+        return folly::makeUnexpected(BlobError(BlobErrorCode::CHECKSUM_MISMATCH));
+    }
+    return header->payload_crc();
+}
+
 void HSHomeObject::on_blob_message_rollback(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                                             cintrusive< homestore::repl_req_ctx >& hs_ctx) {
     repl_result_ctx< BlobManager::Result< BlobInfo > >* ctx{nullptr};
@@ -582,7 +1299,8 @@ void HSHomeObject::on_blob_message_rollback(int64_t lsn, sisl::blob const& heade
 
     switch (msg_header->msg_type) {
     case ReplicationMessageType::PUT_BLOB_MSG:
-    case ReplicationMessageType::DEL_BLOB_MSG: {
+    case ReplicationMessageType::DEL_BLOB_MSG:
+    case ReplicationMessageType::IMPORT_BLOBS_MSG: {
         // TODO:: add rollback logic for put_blob and del_blob if necessary
         LOGI("traceID={}, lsn={}, mes_type={} is rollbacked", tid, lsn, msg_header->msg_type);
         if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError(BlobErrorCode::ROLL_BACK))); }
@@ -51,6 +51,8 @@ folly::Future< bool > HSHomeObject::MyCPCallbacks::cp_flush(CP* cp) {
     for (auto& hs_pg : dirty_pg_list) {
         hs_pg->pg_sb_.write();
     }
+    // digests change along with the durable counters, persist them in the same checkpoint
+    home_obj_.shard_digests_->flush();
     return folly::makeFuture< bool >(true);
 }
 
@@ -129,6 +129,15 @@ void HSHomeObject::init_homestore() {
         .with_http_server();
 
     http_mgr_ = std::make_unique< HttpManager >(*this);
+    recent_write_cache_ = std::make_unique< RecentWriteCache >();
+    hot_spot_tracker_ = std::make_unique< HotSpotTracker >();
+    hot_spot_tracker_->start();
+    io_scheduler_ = std::make_unique< PGIoScheduler >();
+    io_scheduler_->start();
+    resync_throttle_ = std::make_unique< ResyncThrottle >();
+    shard_digests_ = std::make_unique< ShardDigestTable >();
+    scrubber_ = std::make_unique< BlobScrubber >(*this);
+    multipart_uploads_ = std::make_unique< MultipartUploads >(*this);
 
     const uint64_t app_mem_size = app->mem_size();
     RELEASE_ASSERT(app_mem_size > 0, "Invalid app_mem_size");
@@ -270,6 +279,9 @@ void HSHomeObject::init_homestore() {
 
     recovery_done_ = true;
     LOGI("Initialize and start HomeStore is successfully");
+    scrubber_->start();
+    multipart_uploads_->start();
+    start_pg_reclaim_timer();
 
     // Now cache the zero padding bufs to avoid allocating during IO time
     for (size_t i{0}; i < max_zpad_bufs; ++i) {
@@ -293,6 +305,24 @@ void HSHomeObject::on_replica_restart() {
 
         HomeStore::instance()->meta_service().read_sub_sb(_pg_meta_name);
 
+        // recover shard digests
+        HomeStore::instance()->meta_service().register_handler(
+            ShardDigestTable::_shard_digest_meta_name,
+            [this](homestore::meta_blk* mblk, sisl::byte_view buf, size_t size) {
+                shard_digests_->on_meta_blk_found(mblk, std::move(buf));
+            },
+            nullptr, true);
+        HomeStore::instance()->meta_service().read_sub_sb(ShardDigestTable::_shard_digest_meta_name);
+
+        // recover scrub progress
+        HomeStore::instance()->meta_service().register_handler(
+            BlobScrubber::_scrubber_meta_name,
+            [this](homestore::meta_blk* mblk, sisl::byte_view buf, size_t size) {
+                scrubber_->on_meta_blk_found(mblk, std::move(buf));
+            },
+            nullptr, true);
+        HomeStore::instance()->meta_service().read_sub_sb(BlobScrubber::_scrubber_meta_name);
+
         // recover shard
         HomeStore::instance()->meta_service().register_handler(
             _shard_meta_name,
@@ -390,6 +420,12 @@ HSHomeObject::~HSHomeObject() {
 #endif
 
     start_shutting_down();
+    // a running scrub pass issues io of its own, stop it before waiting for the requests to drain
+    if (scrubber_) { scrubber_->stop(); }
+    // and so does a shard export / import
+    if (http_mgr_) { http_mgr_->stop(); }
+    if (multipart_uploads_) { multipart_uploads_->stop(); }
+    stop_pg_reclaim_timer();
     // Wait for all pending requests to complete
     while (true) {
         auto pending_reqs = get_pending_request_num();
@@ -399,6 +435,8 @@ HSHomeObject::~HSHomeObject() {
     }
     LOGI("start shutting down HomeStore");
     gc_mgr_.reset();
+    if (io_scheduler_) { io_scheduler_->stop(); }
+    if (hot_spot_tracker_) { hot_spot_tracker_->stop(); }
 
     LOGI("start shutting down HomeStore");
     homestore::HomeStore::instance()->shutdown();
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <memory>
 #include <mutex>
 
+#include <folly/executors/InlineExecutor.h>
 #include <homestore/homestore.hpp>
 #include <homestore/index/index_table.hpp>
 #include <homestore/superblk_handler.hpp>
@@ -10,10 +13,19 @@
 
 #include "heap_chunk_selector.h"
 #include "lib/homeobject_impl.hpp"
+#include "lib/io_buf_pool.hpp"
 #include "replication_message.hpp"
 #include "homeobject/common.hpp"
 #include "index_kv.hpp"
 #include "gc_manager.hpp"
+#include "recent_write_cache.hpp"
+#include "hot_spot_tracker.hpp"
+#include "pg_io_scheduler.hpp"
+#include "resync_throttle.hpp"
+#include "shard_digest.hpp"
+#include "blob_scrubber.hpp"
+#include "multipart_upload.hpp"
+#include "sharded_counter.hpp"
 #include "generated/resync_pg_data_generated.h"
 #include "generated/resync_shard_data_generated.h"
 #include "generated/resync_blob_data_generated.h"
@@ -31,8 +43,8 @@ class BlobRouteValue;
 using BlobIndexTable = homestore::IndexTable< BlobRouteKey, BlobRouteValue >;
 
 class HttpManager;
+struct put_blob_req_ctx;
 
-static constexpr uint64_t io_align{512};
 PGError toPgError(homestore::ReplServiceError const&);
 BlobError toBlobError(homestore::ReplServiceError const&);
 ShardError toShardError(homestore::ReplServiceError const&);
@@ -56,10 +68,30 @@ private:
     ShardManager::AsyncResult< ShardInfo > _create_shard(pg_id_t, uint64_t size_bytes, trace_id_t tid) override;
     ShardManager::AsyncResult< ShardInfo > _seal_shard(ShardInfo const&, trace_id_t tid) override;
 
-    BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&, trace_id_t tid) override;
+    BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&, trace_id_t tid,
+                                                    op_deadline_t deadline) override;
     BlobManager::AsyncResult< Blob > _get_blob(ShardInfo const&, blob_id_t, uint64_t off, uint64_t len,
-                                               trace_id_t tid) const override;
-    BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t, trace_id_t tid) override;
+                                               trace_id_t tid, op_deadline_t deadline) const override;
+    BlobManager::AsyncResult< std::unique_ptr< BlobStream > > _get_stream(ShardInfo const&, blob_id_t, uint64_t off,
+                                                                          uint64_t len, trace_id_t tid,
+                                                                          op_deadline_t deadline) const override;
+    BlobManager::AsyncResult< BlobRead > _get_blob_into(ShardInfo const&, blob_id_t, sisl::sg_list const& dest,
+                                                        uint64_t off, uint64_t len, trace_id_t tid,
+                                                        op_deadline_t deadline) const override;
+    BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t, trace_id_t tid,
+                                           op_deadline_t deadline) override;
+    BlobManager::AsyncResult< blob_id_t > _copy_blob(ShardInfo const& src_shard, blob_id_t src_blob,
+                                                     ShardInfo const& dst_shard, trace_id_t tid,
+                                                     op_deadline_t deadline) override;
+    BlobManager::AsyncResult< upload_id_t > _create_upload(ShardInfo const&, trace_id_t tid) override;
+    BlobManager::AsyncResult< UploadedPart > _upload_part(ShardInfo const&, upload_id_t, uint32_t part_no,
+                                                          sisl::io_blob_safe&& data, trace_id_t tid,
+                                                          op_deadline_t deadline) override;
+    BlobManager::AsyncResult< blob_id_t > _complete_upload(ShardInfo const&, upload_id_t,
+                                                           std::vector< UploadedPart > const& parts,
+                                                           std::string const& user_key, uint64_t object_off,
+                                                           trace_id_t tid) override;
+    BlobManager::NullAsyncResult _abort_upload(ShardInfo const&, upload_id_t, trace_id_t tid) override;
 
     PGManager::NullAsyncResult _create_pg(PGInfo&& pg_info, std::set< peer_id_t > const& peers,
                                           trace_id_t tid) override;
@@ -156,7 +188,8 @@ public:
         static constexpr uint8_t data_header_version = 0x01;
         static constexpr uint64_t data_header_magic = 0x21fdffdba8d68fc6; // echo "BlobHeader" | md5sum
 
-        enum class data_type_t : uint32_t { SHARD_INFO = 1, BLOB_INFO = 2 };
+        // parts and manifests of multi-part uploads are blobs as well, see multipart_upload.hpp
+        enum class data_type_t : uint32_t { SHARD_INFO = 1, BLOB_INFO = 2, MULTIPART_PART = 3, MULTIPART_MANIFEST = 4 };
 
         bool valid() const { return ((magic == data_header_magic) && (version <= data_header_version)); }
 
@@ -199,6 +232,15 @@ public:
         uint64_t complete_shards{0};
         // The count of the blobs which have been corrupted on the leader side.
         uint64_t corrupted_blobs{0};
+        // Delta resync: what was found in sync with the leader and not transferred, and the local blobs dropped
+        // because the leader deleted them meanwhile.
+        uint64_t skipped_shards{0};
+        uint64_t skipped_blobs{0};
+        uint64_t skipped_bytes{0};
+        uint64_t dropped_blobs{0};
+        // Time spent inserting the received blobs into the index, and the size the index reached.
+        uint64_t index_build_us{0};
+        uint64_t index_size_bytes{0};
         // Used to handle the retried batch message.
         uint64_t cur_batch_blobs{0};
         uint64_t cur_batch_bytes{0};
@@ -223,6 +265,11 @@ public:
         int64_t snp_lsn;
         pg_id_t pg_id;
         durable_snapshot_progress progress;
+        // Set if shard_cursor is the shard being received rather than the next one, every blob up to last_blob_id is
+        // persisted and indexed.
+        uint8_t shard_in_progress;
+        blob_id_t last_blob_id;
+        snp_batch_id_t batch_num;
 
         uint32_t size() const { return sizeof(snapshot_rcvr_info_superblk); }
         static auto name() -> string { return _snp_rcvr_meta_name; }
@@ -277,17 +324,40 @@ public:
                 REGISTER_HISTOGRAM(blobs_per_shard,
                                    "Distribution of blobs per shard"); // TODO: Add a bucket for blob sizes
                 REGISTER_HISTOGRAM(actual_blob_size, "Distribution of actual blob sizes");
+                REGISTER_GAUGE(inflight_request_count, "Number of blob requests in flight on this pg");
+                REGISTER_COUNTER(shed_request_count, "Blob requests failed early because their deadline had passed");
+                REGISTER_COUNTER(throttled_put_count, "Puts rejected because followers lag or too much is in flight");
+                REGISTER_GAUGE(write_throttled, "Whether puts are currently rejected on this pg (1) or not (0)");
+                REGISTER_GAUGE(max_follower_lag, "Log entries the slowest responsive follower is behind the leader");
+                REGISTER_GAUGE(inflight_put_bytes, "Payload bytes of puts proposed and not yet committed");
+                REGISTER_COUNTER(copied_blob_count, "Blobs copied into this pg by server-side copy");
+                REGISTER_COUNTER(copied_bytes, "Payload bytes copied into this pg by server-side copy");
+                REGISTER_HISTOGRAM(blob_copy_throughput, "Throughput of server-side copies of large blobs (MB/s)",
+                                   HistogramBucketsType(DefaultBuckets));
+                REGISTER_COUNTER(streamed_bytes, "Payload bytes handed out by blob streams");
+                REGISTER_COUNTER(get_into_direct_bytes, "Payload bytes read straight into the buffers of get_into");
+                REGISTER_COUNTER(get_into_copied_count, "get_into requests read through an intermediate buffer");
+                REGISTER_HISTOGRAM(blob_stream_first_chunk_latency,
+                                   "Time from opening a blob stream to its first chunk being ready (us)",
+                                   HistogramBucketsType(DefaultBuckets));
 
                 register_me_to_farm();
                 attach_gather_cb(std::bind(&PGMetrics::on_gather, this));
                 blk_size = pg_.repl_dev_->get_blk_size();
             }
-            ~PGMetrics() { deregister_me_from_farm(); }
+            ~PGMetrics() { retire(); }
             PGMetrics(const PGMetrics&) = delete;
             PGMetrics(PGMetrics&&) noexcept = delete;
             PGMetrics& operator=(const PGMetrics&) = delete;
             PGMetrics& operator=(PGMetrics&&) noexcept = delete;
 
+            // Leave the farm once the pg is destroyed, a pg created again with the same id registers its own. The
+            // group stays valid for the requests still updating it.
+            void retire() {
+                if (retired_.exchange(true)) { return; }
+                deregister_me_from_farm();
+            }
+
             void on_gather() {
                 GAUGE_UPDATE(*this, shard_count, pg_.total_shards());
                 GAUGE_UPDATE(*this, open_shard_count, pg_.open_shards());
@@ -298,23 +368,48 @@ public:
                 GAUGE_UPDATE(*this, total_occupied_space,
                              pg_.durable_entities().total_occupied_blk_count.load(std::memory_order_relaxed) *
                                  blk_size);
+                GAUGE_UPDATE(*this, inflight_request_count, std::max(pg_.inflight_requests_.get(), int64_t{0}));
+                GAUGE_UPDATE(*this, write_throttled, pg_.write_throttled_.load(std::memory_order_relaxed) ? 1 : 0);
+                GAUGE_UPDATE(*this, max_follower_lag, pg_.max_follower_lag_.load(std::memory_order_relaxed));
+                GAUGE_UPDATE(*this, inflight_put_bytes, std::max(pg_.inflight_put_bytes_.get(), int64_t{0}));
             }
 
         private:
             HS_PG const& pg_;
             uint32_t blk_size;
+            std::atomic< bool > retired_{false};
         };
 
         homestore::superblk< pg_info_superblk > pg_sb_;
         shared< homestore::ReplDev > repl_dev_;
         std::shared_ptr< BlobIndexTable > index_table_;
-        PGMetrics metrics_;
+        mutable PGMetrics metrics_;
 
         // Snapshot receiver progress info, used as a checkpoint for recovery
         // Placed within HS_PG since HomeObject is unable to locate the ReplicationStateMachine
         mutable homestore::superblk< snapshot_rcvr_info_superblk > snp_rcvr_info_sb_;
         mutable homestore::superblk< snapshot_rcvr_shard_list_superblk > snp_rcvr_shard_list_sb_;
 
+        // Blob ids below this boundary may already be in the index table without this process having committed them
+        // from the log, i.e. they were recovered from the last CP (blob_sequence_num persisted in pg_sb_ always covers
+        // the index entries flushed by the same CP, as it is raised before the insert, see raise_blob_sequence_num)
+        // or installed by a baseline resync. Only puts below it can be replays and need the duplicate lookup; fresh
+        // leader-assigned blob ids are always at or above it.
+        std::atomic< blob_id_t > replay_blob_id_boundary_{0};
+
+        // Blob requests issued on this node and not yet completed.
+        mutable ShardedCounter inflight_requests_;
+
+        // Holders of a pointer to this pg beyond a single blob request, e.g. an open blob stream or the scrub of one
+        // of its blobs. A destroyed pg is not freed while it is pinned, see retired_pgs_.
+        mutable std::atomic< int64_t > pins_{0};
+
+        // Leader side write admission state, refreshed by admit_write().
+        mutable ShardedCounter inflight_put_bytes_;
+        mutable std::atomic< int64_t > write_admission_checked_ns_{0};
+        mutable std::atomic< bool > write_throttled_{false};
+        mutable std::atomic< uint64_t > max_follower_lag_{0};
+
         HS_PG(PGInfo info, shared< homestore::ReplDev > rdev, shared< BlobIndexTable > index_table,
               std::shared_ptr< const std::vector< homestore::chunk_num_t > > pg_chunk_ids);
         HS_PG(homestore::superblk< pg_info_superblk >&& sb, shared< homestore::ReplDev > rdev);
@@ -339,6 +434,50 @@ public:
          * Returns the progress of the baseline resync.
          */
         uint32_t get_snp_progress() const;
+
+        /**
+         * Returns whether a new put may be proposed on this pg, i.e. no responsive follower lags more than
+         * write_throttle_max_follower_lag entries behind and the in-flight put bytes stay under
+         * write_throttle_max_inflight_mb. Only meaningful on the leader. The state is re-evaluated at most every
+         * write_throttle_check_interval_ms, so the limits are soft.
+         */
+        bool admit_write() const;
+
+        /**
+         * Pin this pg for as long as the caller holds on to it, see pins_. The pointer must come from get_hs_pg,
+         * which does not hand out pgs retired for long.
+         */
+        void pin() const { pins_.fetch_add(1, std::memory_order_acq_rel); }
+        void unpin() const { pins_.fetch_sub(1, std::memory_order_acq_rel); }
+
+        /**
+         * Returns whether a put of the given blob id may be a replay of an already indexed blob.
+         */
+        bool may_be_replayed_blob(blob_id_t blob_id) const {
+            return blob_id < replay_blob_id_boundary_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Raise the replay boundary so that blob ids below next_blob_id get the duplicate lookup.
+         */
+        void raise_replay_blob_id_boundary(blob_id_t next_blob_id) {
+            auto cur = replay_blob_id_boundary_.load(std::memory_order_relaxed);
+            while (next_blob_id > cur &&
+                   !replay_blob_id_boundary_.compare_exchange_weak(cur, next_blob_id, std::memory_order_release)) {}
+        }
+
+        /**
+         * Raise blob_sequence_num past blob_id. Called before the blob is inserted into the index table, so that
+         * the cp which persists the index entry also persists a blob_sequence_num covering it, see
+         * replay_blob_id_boundary_. This also keeps the sequence up to date on followers in case the leader changes.
+         */
+        void raise_blob_sequence_num(blob_id_t blob_id) {
+            durable_entities_update([next_blob_id = blob_id + 1](auto& de) {
+                auto existing_blob_id = de.blob_sequence_num.load();
+                while (next_blob_id > existing_blob_id &&
+                       !de.blob_sequence_num.compare_exchange_weak(existing_blob_id, next_blob_id)) {}
+            });
+        }
     };
 
     struct HS_Shard : public Shard {
@@ -401,6 +540,13 @@ public:
             }
         }
 
+        // Leading 32 bits of the payload hash, the crc32 of the payload for CRC32 blobs
+        uint32_t payload_crc() const {
+            uint32_t crc;
+            std::memcpy(&crc, hash, sizeof(uint32_t));
+            return crc;
+        }
+
     private:
         bool _do_seal() const {
             switch (hash_algorithm) {
@@ -426,8 +572,21 @@ public:
         shard_id_t shard_id;
         blob_id_t blob_id;
         homestore::MultiBlkId pbas;
+        // crc of the blob payload, what the shard digest is built from. Kept in the index along with the pbas
+        uint32_t payload_crc{0};
     };
 
+    // Summary of the live blobs of a shard, compared between replicas by delta resync
+    struct ShardSummary {
+        uint64_t blob_count{0};
+        uint64_t total_bytes{0};
+        uint64_t digest{0};
+        // blob_id and running digest after every shard_summary_interval live blobs
+        std::vector< blob_id_t > checkpoint_blob_ids;
+        std::vector< uint64_t > checkpoint_digests;
+    };
+    static constexpr uint64_t shard_summary_interval{1024};
+
     struct BlobInfoData : public BlobInfo {
         Blob blob;
     };
@@ -451,6 +610,8 @@ public:
         PGBlobIterator(HSHomeObject& home_obj, homestore::group_id_t group_id, uint64_t upto_lsn = 0);
         PG* get_pg_metadata();
         bool update_cursor(objId id);
+        // Position the cursor right after the given blob of the current shard, see seek_obj_id
+        bool seek_blob(blob_id_t after_blob_id);
         void reset_cursor();
         objId expected_next_obj_id();
         bool generate_shard_blob_list();
@@ -459,6 +620,8 @@ public:
         bool create_shard_snapshot_data(sisl::io_blob_safe& meta_blob);
         bool create_blobs_snapshot_data(sisl::io_blob_safe& data_blob);
         void pack_resync_message(sisl::io_blob_safe& dest_blob, SyncMessageType type);
+        // Resize the next blob batches after the previous one was acked (or asked to be resent) in e2e_us
+        void adapt_batch_budget(uint64_t e2e_us, bool resend);
         bool end_of_scan() const;
 
         // All of the leader's metrics are in-memory
@@ -477,6 +640,9 @@ public:
                 REGISTER_HISTOGRAM(snp_dnr_batch_e2e_latency,
                                    "Time cost(ms) of a batch end-to-end round trip in baseline resync",
                                    HistogramBucketsType(DefaultBuckets));
+                REGISTER_GAUGE(snp_dnr_batch_size_bytes, "Current byte budget of a blob batch in baseline resync");
+                REGISTER_GAUGE(snp_dnr_batch_size_blobs,
+                               "Current blob count budget of a blob batch in baseline resync");
                 register_me_to_farm();
             }
 
@@ -508,6 +674,17 @@ public:
         pg_id_t pg_id_;
         shared< homestore::ReplDev > repl_dev_;
         uint64_t max_batch_size_;
+
+        // Budgets of the next blob batch, adapted so that a batch round trip takes about
+        // snapshot_batch_target_latency_ms: small batches waste round trips, big ones hold memory for long.
+        // max_batch_size_ stays the hard cap.
+        static constexpr uint64_t min_batch_blobs{16};
+        uint64_t batch_bytes_budget_;
+        uint64_t batch_blobs_budget_{min_batch_blobs};
+        // What the last blob batch carried, 0 blobs if the last object was not a blob batch
+        uint64_t last_batch_bytes_{0};
+        uint64_t last_batch_blobs_{0};
+        bool last_batch_full_{false};
         std::unique_ptr< DonerSnapshotMetrics > metrics_;
     };
 
@@ -521,6 +698,7 @@ public:
             BLOB_DATA_CORRUPTED,
             ADD_BLOB_INDEX_ERR,
             CREATE_PG_ERR,
+            DROP_BLOB_ERR,
         };
 
         constexpr static shard_id_t invalid_shard_id = 0;
@@ -536,6 +714,9 @@ public:
         int64_t get_context_lsn() const;
         pg_id_t get_context_pg_id() const;
 
+        // Whether the local copy of the pg can be caught up with a delta resync rather than rebuilt from scratch
+        bool can_delta_resync(ResyncPGMetaData const& pg_meta) const;
+
         // Try to load existing snapshot context info
         bool load_prev_context_and_metrics();
 
@@ -545,12 +726,24 @@ public:
 
         shard_id_t get_shard_cursor() const;
         shard_id_t get_next_shard() const;
+        // Set once the shard metadata of a partially received shard came again, the blobs after it are to be asked for
+        std::optional< blob_id_t > get_resume_blob_id() const;
 
     private:
         // SnapshotContext is the context data of current snapshot transmission
         struct SnapshotContext {
             shard_id_t shard_cursor{invalid_shard_id};
             snp_batch_id_t cur_batch_num{0};
+            // Last blob persisted and indexed in the shard_cursor shard
+            std::optional< blob_id_t > last_blob_id;
+            std::optional< blob_id_t > resume_blob_id;
+            uint64_t bytes_since_checkpoint{0};
+            // Delta resync: per shard, the last blob of the longest prefix of live blobs in sync with the leader
+            std::unordered_map< shard_id_t, blob_id_t > delta_seek;
+            // Set while receiving a shard which was already here, the local blobs after reconcile_after which the
+            // leader does not send are dropped
+            bool reconciling{false};
+            std::optional< blob_id_t > reconcile_after;
             std::vector< shard_id_t > shard_list;
             const int64_t snp_lsn;
             const pg_id_t pg_id;
@@ -572,6 +765,12 @@ public:
                 REGISTER_GAUGE(snp_rcvr_corrupted_blobs, "Corrupted blobs in baseline resync");
                 REGISTER_GAUGE(snp_rcvr_elapsed_time_sec, "Time cost(seconds) of baseline resync");
                 REGISTER_GAUGE(snp_rcvr_error_count, "Error count in baseline resync");
+                REGISTER_GAUGE(snp_rcvr_skipped_shards, "Shards found in sync and skipped by delta resync");
+                REGISTER_GAUGE(snp_rcvr_skipped_blobs, "Blobs found in sync and skipped by delta resync");
+                REGISTER_GAUGE(snp_rcvr_skipped_bytes, "Bytes of the shards skipped by delta resync");
+                REGISTER_GAUGE(snp_rcvr_dropped_blobs, "Local blobs dropped by delta resync as gone on the leader");
+                REGISTER_GAUGE(snp_rcvr_index_build_ms, "Time cost(ms) of indexing the blobs in baseline resync");
+                REGISTER_GAUGE(snp_rcvr_index_size_bytes, "Size of the index of the pg in baseline resync");
                 REGISTER_HISTOGRAM(snp_rcvr_blob_process_time,
                                    "Time cost(us) of successfully process a blob in baseline resync",
                                    HistogramBucketsType(DefaultBuckets));
@@ -599,6 +798,12 @@ public:
                     GAUGE_UPDATE(*this, snp_rcvr_complete_shards, ctx_->progress.complete_shards);
                     GAUGE_UPDATE(*this, snp_rcvr_corrupted_blobs, ctx_->progress.corrupted_blobs);
                     GAUGE_UPDATE(*this, snp_rcvr_error_count, ctx_->progress.error_count);
+                    GAUGE_UPDATE(*this, snp_rcvr_skipped_shards, ctx_->progress.skipped_shards);
+                    GAUGE_UPDATE(*this, snp_rcvr_skipped_blobs, ctx_->progress.skipped_blobs);
+                    GAUGE_UPDATE(*this, snp_rcvr_skipped_bytes, ctx_->progress.skipped_bytes);
+                    GAUGE_UPDATE(*this, snp_rcvr_dropped_blobs, ctx_->progress.dropped_blobs);
+                    GAUGE_UPDATE(*this, snp_rcvr_index_build_ms, ctx_->progress.index_build_us / 1000);
+                    GAUGE_UPDATE(*this, snp_rcvr_index_size_bytes, ctx_->progress.index_size_bytes);
                     auto duration = get_elapsed_time_ms(ctx_->progress.start_time * 1000) / 1000;
                     GAUGE_UPDATE(*this, snp_rcvr_elapsed_time_sec, duration);
                 }
@@ -614,8 +819,15 @@ public:
         std::shared_ptr< SnapshotContext > ctx_;
         std::unique_ptr< ReceiverSnapshotMetrics > metrics_;
 
-        // Update the snp_info superblock
-        void update_snp_info_sb(bool init = false);
+        // Update the snp_info superblock, in_shard checkpoints the progress inside the current shard
+        void update_snp_info_sb(bool init = false, bool in_shard = false);
+
+        // Delta resync: keep the local pg and only ask for the shards which differ from the leader's
+        int process_pg_delta_snapshot_data(ResyncPGMetaData const& pg_meta);
+        // Delta resync: whether the local shard is identical to the leader's, records how far it is in sync otherwise
+        bool delta_shard_in_sync(ShardDigest const& leader);
+        // Delta resync: drop the local blobs of the current shard up to upto_blob_id which the leader did not send
+        int drop_blobs_gone_on_leader(ResyncBlobDataBatch const& data_blobs, blob_id_t upto_blob_id);
     };
 
 private:
@@ -624,27 +836,145 @@ private:
     shared< HeapChunkSelector > chunk_selector_;
     std::unique_ptr< GCManager > gc_mgr_;
     unique< HttpManager > http_mgr_;
+    unique< RecentWriteCache > recent_write_cache_;
+    unique< HotSpotTracker > hot_spot_tracker_;
+    unique< PGIoScheduler > io_scheduler_;
+    unique< ResyncThrottle > resync_throttle_;
+    unique< ShardDigestTable > shard_digests_;
+    unique< BlobScrubber > scrubber_;
+    unique< MultipartUploads > multipart_uploads_;
     bool recovery_done_{false};
 
+    // pg_id -> HS_PG table, so that lookups on the data path are two atomic loads instead of taking _pg_lock. Pages
+    // of pg_lookup_page_size slots are allocated on first use, so the table grows with the pg ids actually in use.
+    // _pg_map stays the owner; slots are published/cleared under _pg_lock whenever _pg_map gains or loses an entry.
+    static constexpr size_t pg_lookup_page_size{256};
+    static constexpr size_t pg_lookup_pages{(size_t{std::numeric_limits< pg_id_t >::max()} + 1) / pg_lookup_page_size};
+    struct PGLookupPage {
+        std::array< std::atomic< HS_PG* >, pg_lookup_page_size > slots{};
+    };
+    std::array< std::atomic< PGLookupPage* >, pg_lookup_pages > pg_lookup_{};
+    // owns the pages, only touched under _pg_lock
+    std::vector< std::unique_ptr< PGLookupPage > > pg_lookup_page_owner_;
+
+    // A destroyed pg is not freed right away: get_hs_pg hands out raw pointers without any lock, a reader may still
+    // hold one. It is retired here and freed under _pg_lock once it has been retired for pg_reclaim_grace_period and
+    // has no blob request in flight and no pin, or when the home object goes away. Retired pgs are looked at every
+    // pg_reclaim_check_interval, besides whenever a pg is added or destroyed.
+    static constexpr std::chrono::seconds pg_reclaim_grace_period{60};
+    static constexpr std::chrono::seconds pg_reclaim_check_interval{10};
+    iomgr::timer_handle_t pg_reclaim_timer_hdl_{iomgr::null_timer_handle};
+    struct RetiredPG {
+        unique< PG > pg;
+        std::chrono::steady_clock::time_point retired_at;
+    };
+    std::vector< RetiredPG > retired_pgs_;
+
     static constexpr size_t max_zpad_bufs = _data_block_size / io_align;
     std::array< sisl::io_blob_safe, max_zpad_bufs > zpad_bufs_; // Zero padded buffers for blob payload.
 
     static homestore::ReplicationService& hs_repl_service() { return homestore::hs()->repl_service(); }
 
     // blob related
-    BlobManager::AsyncResult< Blob > _get_blob_data(const shared< homestore::ReplDev >& repl_dev, shard_id_t shard_id,
-                                                    blob_id_t blob_id, uint64_t req_offset, uint64_t req_len,
-                                                    const homestore::MultiBlkId& blkid, trace_id_t tid) const;
+    BlobManager::AsyncResult< Blob > _get_blob_data(const HS_PG* hs_pg, const shared< homestore::ReplDev >& repl_dev,
+                                                    shard_id_t shard_id, blob_id_t blob_id, uint64_t req_offset,
+                                                    uint64_t req_len, const homestore::MultiBlkId& blkid,
+                                                    trace_id_t tid, op_deadline_t deadline) const;
+    // Read a range of the multi-part object whose manifest lists the given parts, from the parts.
+    BlobManager::AsyncResult< Blob > read_multipart(const HS_PG* hs_pg, const shared< homestore::ReplDev >& repl_dev,
+                                                    shard_id_t shard_id,
+                                                    std::vector< multipart_manifest_entry > const& entries,
+                                                    uint64_t req_offset, uint64_t req_len, std::string&& user_key,
+                                                    uint64_t object_off, trace_id_t tid,
+                                                    op_deadline_t deadline) const;
+    // get_into reads blobs of up to this many blocks through get, one io and a copy cost less than the two ios of the
+    // direct read
+    static constexpr uint64_t get_into_copy_max_blks{2};
+    // The direct read of get_into once the header of the blob is known to fit it: the range straight into dest, what
+    // comes before it and after the aligned part (direct_size bytes) of dest into buffers of our own.
+    BlobManager::AsyncResult< BlobRead > read_blob_into(const HS_PG* hs_pg, shard_id_t shard_id, blob_id_t blob_id,
+                                                        homestore::MultiBlkId const& blkid, sisl::sg_list const& dest,
+                                                        uint64_t req_offset, uint64_t res_len, uint64_t direct_size,
+                                                        trace_id_t tid, op_deadline_t deadline) const;
+    // get_into through get and a copy, for the requests which can not be read into the buffers of the caller directly
+    BlobManager::AsyncResult< BlobRead > get_blob_into_copy(ShardInfo const& shard, blob_id_t blob_id,
+                                                            sisl::sg_list const& dest, uint64_t req_offset,
+                                                            uint64_t req_len, trace_id_t tid,
+                                                            op_deadline_t deadline) const;
+    // Open a stream over a range of the blob at blkid. A multi-part object is streamed from its parts, part by part,
+    // from_manifest is set for the streams of the parts.
+    BlobManager::AsyncResult< std::unique_ptr< BlobStream > >
+    open_blob_stream(const HS_PG* hs_pg, shard_id_t shard_id, blob_id_t blob_id, homestore::MultiBlkId const& blkid,
+                     uint64_t off, uint64_t len, trace_id_t tid, op_deadline_t deadline, bool from_manifest) const;
+    // Admission of a put on the leader of the pg, returns the id of the new blob. Counted as pending unless it fails.
+    BlobManager::Result< blob_id_t > start_put(const HS_PG* hs_pg, ShardInfo const& shard, uint64_t size,
+                                               trace_id_t tid, op_deadline_t deadline);
+    // Pad, schedule and replicate a put prepared in req, the blob it creates is no longer pending once it completes.
+    BlobManager::AsyncResult< BlobInfo > propose_put(const HS_PG* hs_pg, intrusive< put_blob_req_ctx > req,
+                                                     trace_id_t tid);
+    BlobManager::AsyncResult< BlobInfo > put_blob(ShardInfo const& shard, Blob&& blob, DataHeader::data_type_t type,
+                                                  trace_id_t tid, op_deadline_t deadline);
+
+    /**
+     * @brief Check the deadline of a blob request before starting one of its expensive phases.
+     *
+     * @return true if the deadline has passed, in which case the request has been accounted as shed and the caller
+     * should fail it with DEADLINE_EXCEEDED.
+     */
+    bool shed_expired_request(const HS_PG* hs_pg, op_deadline_t deadline, trace_id_t tid, shard_id_t shard_id,
+                              blob_id_t blob_id, std::string_view phase) const;
+
+    /**
+     * @brief Issue a data io of a pg once the pg io scheduler lets it through.
+     *
+     * @param issue Issues the io and returns the folly::Future of its completion. It runs inline if the io is admitted
+     * right away, otherwise from the scheduler once it is the turn of the pg. If the pg is removed meanwhile, the io is
+     * not issued: an io completing with a std::error_code completes with PGIoScheduler::pg_removed_error(), any other
+     * fails with the std::system_error of it.
+     */
+    template < typename IssueFn >
+    auto issue_data_io(pg_id_t pg_id, PGIoScheduler::io_type type, PGIoScheduler::io_class cls, uint64_t bytes,
+                       IssueFn&& issue) const -> decltype(issue()) {
+        using result_t = typename decltype(issue())::value_type;
+        auto admitted = io_scheduler_ ? io_scheduler_->admit(pg_id, type, cls, bytes) : std::nullopt;
+        if (!admitted) { return issue(); }
+        return std::move(*admitted)
+            .via(&folly::InlineExecutor::instance())
+            .thenTry([issue = std::forward< IssueFn >(issue)](folly::Try< folly::Unit >&& t) mutable {
+                if (t.hasException()) {
+                    if constexpr (std::is_same_v< result_t, std::error_code >) {
+                        return folly::makeFuture< result_t >(PGIoScheduler::pg_removed_error());
+                    } else {
+                        return folly::makeFuture< result_t >(std::move(t.exception()));
+                    }
+                }
+                return issue();
+            });
+    }
+
+    // The error of a blob request whose data io failed with err
+    static BlobError data_io_error(std::error_code const& err) {
+        return BlobError(err == PGIoScheduler::pg_removed_error() ? BlobErrorCode::UNKNOWN_PG
+                                                                  : BlobErrorCode::READ_FAILED);
+    }
 
     // create pg related
     static PGManager::NullAsyncResult do_create_pg(cshared< homestore::ReplDev > repl_dev, PGInfo&& pg_info,
                                                    trace_id_t tid = 0);
+    // sorted_inserts: the index of the pg is about to be filled in key order (baseline resync), its nodes are then
+    // split at snapshot_index_split_pct instead of evenly
     folly::Expected< HSHomeObject::HS_PG*, PGError > local_create_pg(shared< homestore::ReplDev > repl_dev,
-                                                                     PGInfo pg_info, trace_id_t tid = 0);
+                                                                     PGInfo pg_info, trace_id_t tid = 0,
+                                                                     bool sorted_inserts = false);
     static std::string serialize_pg_info(const PGInfo& info);
     static PGInfo deserialize_pg_info(const unsigned char* pg_info_str, size_t size);
     void add_pg_to_map(unique< HS_PG > hs_pg);
     const HS_PG* _get_hs_pg_unlocked(pg_id_t pg_id) const;
+    // NOTE: caller should hold _pg_lock
+    void publish_pg_lookup_unlocked(pg_id_t pg_id, HS_PG* hs_pg);
+    void reclaim_retired_pgs_unlocked();
+    void start_pg_reclaim_timer();
+    void stop_pg_reclaim_timer();
 
     // create shard related
     shard_id_t generate_new_shard_id(pg_id_t pg);
@@ -741,6 +1071,15 @@ public:
      */
     const HS_PG* get_hs_pg(pg_id_t pg_id) const;
 
+    /**
+     * @brief Summarize the live blobs of a shard, so that two replicas can tell whether they hold the same blobs.
+     * @param pg_id The ID of the PG the shard belongs to.
+     * @param shard_id The ID of the shard.
+     * @return The blob count, bytes and digest of the shard, plus a digest checkpoint every shard_summary_interval
+     * blobs. The digest covers the blob ids and the payload crcs, both read from the index.
+     */
+    BlobManager::Result< ShardSummary > compute_shard_summary(pg_id_t pg_id, shard_id_t shard_id);
+
     /**
      * @brief Callback function invoked when a message is committed on a shard.
      *
@@ -819,6 +1158,73 @@ public:
 
     cshared< HeapChunkSelector > chunk_selector() const { return chunk_selector_; }
 
+    /**
+     * @brief Serve the data of a put blob from the leader's recent write cache.
+     *
+     * @return true if buf has been filled with the payload written to blkid, false if it has to be read from disk.
+     */
+    bool read_from_recent_write_cache(shard_id_t shard_id, blob_id_t blob_id, homestore::MultiBlkId const& blkid,
+                                      uint8_t* buf, size_t size) const;
+
+    /**
+     * @brief Dump the shards and pgs which took the most blob ops and bytes recently, see HotSpotTracker.
+     */
+    nlohmann::json dump_hot_spots() const;
+
+    PGIoScheduler* io_scheduler() const { return io_scheduler_.get(); }
+    RecentWriteCache* recent_write_cache() const { return recent_write_cache_.get(); }
+    ResyncThrottle* resync_throttle() const { return resync_throttle_.get(); }
+    ShardDigestTable* shard_digests() const { return shard_digests_.get(); }
+    BlobScrubber* scrubber() const { return scrubber_.get(); }
+    MultipartUploads* multipart_uploads() const { return multipart_uploads_.get(); }
+
+    /**
+     * @brief Dump the digests of the shards of a pg (all of them if shard_id is not given), to be compared with the
+     * ones of another replica by compare_shard_digests().
+     */
+    nlohmann::json dump_shard_digests(pg_id_t pg_id, std::optional< shard_id_t > shard_id = std::nullopt) const;
+
+    /**
+     * @brief Compare the local shard digests of a pg with the ones dumped by another replica, without reading any
+     * blob payload.
+     *
+     * @return The shards in sync, the divergent ones with the blob id ranges which differ, the shards only one side
+     * has and the ones whose digest cannot be trusted on either side.
+     */
+    nlohmann::json compare_shard_digests(pg_id_t pg_id, nlohmann::json const& peer) const;
+
+    struct ShardExportResult {
+        shard_id_t shard_id{0};
+        uint64_t blob_count{0};
+        uint64_t bytes{0};
+        uint64_t elapsed_us{0};
+    };
+
+    struct ShardImportResult {
+        ShardInfo shard;
+        shard_id_t source_shard_id{0};
+        uint64_t blob_count{0};
+        uint64_t bytes{0};
+        uint64_t elapsed_us{0};
+    };
+
+    /**
+     * @brief Write a sealed shard into a self-contained archive file (see shard_archive.hpp) for offline migration.
+     *
+     * Every blob is verified against its checksum before it is written. Blocks the calling thread until done.
+     */
+    ShardManager::Result< ShardExportResult > export_shard(shard_id_t shard_id, std::string const& path,
+                                                           trace_id_t tid = 0);
+
+    /**
+     * @brief Load a shard archive written by export_shard() into a new shard of a pg this node leads.
+     *
+     * The whole archive is checked first, nothing is created from a damaged one. The shard is then created, its blobs
+     * are replicated in large batches (shard_import_batch_mb), each written with one sequential write and added to the
+     * index in one pass, and the shard is sealed. The blobs keep their blob ids. Blocks the calling thread until done.
+     */
+    ShardManager::Result< ShardImportResult > import_shard(pg_id_t pg_id, std::string const& path, trace_id_t tid = 0);
+
     // Blob manager related.
     void on_blob_message_rollback(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                                   cintrusive< homestore::repl_req_ctx >& hs_ctx);
@@ -826,12 +1232,45 @@ public:
                             const homestore::MultiBlkId& pbas, cintrusive< homestore::repl_req_ctx >& hs_ctx);
     void on_blob_del_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                             cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    void on_blobs_import_commit(int64_t lsn, sisl::blob const& header, homestore::MultiBlkId const& pbas,
+                                cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    // The blob list of an import_blobs message, nullopt if it does not match the payload size / crc of the header.
+    static std::optional< std::vector< ImportedBlobEntry > > imported_blob_entries(sisl::blob const& header);
     bool local_add_blob_info(pg_id_t pg_id, BlobInfo const& blob_info, trace_id_t tid = 0);
+    /**
+     * @brief Add a batch of blob infos of the same PG to the index table and PG counters, for the blobs written
+     * outside the put commit path (baseline resync and shard import).
+     *
+     * blob_infos is sorted in BlobRoute order and applied in that order, still one index put per blob: only the PG
+     * lookup and the durable counter updates are done once per batch. Application stops at the first index failure.
+     *
+     * NOTE: the replicated put commit path does not batch, it applies its blobs one by one through local_add_blob_info:
+     * on_commit is called once per lsn and its caller waits for the blob to be indexed, with no notice of where a raft
+     * batch ends to flush a batch at. Batching it needs a batch commit callback from the repl dev.
+     *
+     * @return The number of leading (sorted) entries which were applied; the rest were left untouched.
+     */
+    size_t local_add_blob_infos(pg_id_t pg_id, std::vector< BlobInfo >& blob_infos, trace_id_t tid = 0);
     homestore::ReplResult< homestore::blk_alloc_hints >
     blob_put_get_blk_alloc_hints(sisl::blob const& header, cintrusive< homestore::repl_req_ctx >& ctx);
     void compute_blob_payload_hash(BlobHeader::HashAlgorithm algorithm, const uint8_t* blob_bytes, size_t blob_size,
                                    const uint8_t* user_key_bytes, size_t user_key_size, uint8_t* hash_bytes,
                                    size_t hash_len) const;
+    // Read a whole blob back and verify its header and payload hash, returns its payload crc if it is intact.
+    // on_image is given the blob as read if it is intact.
+    folly::SemiFuture< BlobManager::Result< uint32_t > >
+    verify_blob(const HS_PG* hs_pg, BlobInfo const& blob_info,
+                std::function< void(uint8_t const* image, size_t size) > on_image = {}) const;
+    // Verify the header and payload hash of a blob read into buf, returns its payload crc if it is intact.
+    // verify_hash false checks the header alone, for blocks the scrubber has just verified.
+    BlobManager::Result< uint32_t > check_blob_image(BlobInfo const& blob_info, uint8_t const* buf, size_t size,
+                                                     bool verify_hash = true) const;
+    // Read size bytes from offset of the blob at blkid for a client, both block aligned. Pending until it completes.
+    folly::Future< BlobManager::Result< pooled_io_buf > >
+    read_blob_blocks(const HS_PG* hs_pg, homestore::MultiBlkId const& blkid, uint64_t offset, uint64_t size) const;
+    BlobManager::Result< std::vector< BlobInfo > >
+    query_blobs_in_shard(pg_id_t pg_id, uint64_t cur_shard_seq_num, blob_id_t start_blob_id, uint64_t max_num_in_batch,
+                         blob_id_t end_blob_id = std::numeric_limits< blob_id_t >::max());
 
     std::shared_ptr< homestore::IndexTableBase >
     recover_index_table(homestore::superblk< homestore::index_table_sb >&& sb);
@@ -847,7 +1286,8 @@ public:
     std::shared_ptr< GCBlobIndexTable > get_gc_index_table(std::string uuid) const;
 
 private:
-    std::shared_ptr< BlobIndexTable > create_pg_index_table();
+    // split_pct: where full nodes are split, see snapshot_index_split_pct
+    std::shared_ptr< BlobIndexTable > create_pg_index_table(std::optional< uint8_t > split_pct = std::nullopt);
     std::shared_ptr< GCBlobIndexTable > create_gc_index_table();
 
     std::pair< bool, homestore::btree_status_t > add_to_index_table(shared< BlobIndexTable > index_table,
@@ -856,14 +1296,17 @@ private:
     BlobManager::Result< homestore::MultiBlkId >
     get_blob_from_index_table(shared< BlobIndexTable > index_table, shard_id_t shard_id, blob_id_t blob_id) const;
 
-    BlobManager::Result< homestore::MultiBlkId > move_to_tombstone(shared< BlobIndexTable > index_table,
-                                                                   const BlobInfo& blob_info);
+    // The blocks and the payload crc the blob had, tombstone_pbas if it was deleted already
+    BlobManager::Result< BlobInfo > move_to_tombstone(shared< BlobIndexTable > index_table, const BlobInfo& blob_info);
     void print_btree_index(pg_id_t pg_id) const;
 
+    // Replicate a batch of blobs of a shard archive being imported, data holds their blocks back to back.
+    BlobManager::AsyncResult< BlobInfo > propose_imported_blobs(ShardInfo const& shard,
+                                                                std::vector< ImportedBlobEntry > const& entries,
+                                                                sisl::io_blob_safe&& data, trace_id_t tid);
+
     shared< BlobIndexTable > get_index_table(pg_id_t pg_id);
 
-    BlobManager::Result< std::vector< BlobInfo > >
-    query_blobs_in_shard(pg_id_t pg_id, uint64_t cur_shard_seq_num, blob_id_t start_blob_id, uint64_t max_num_in_batch);
 
     // Zero padding buffer related.
     size_t max_pad_size() const;
@@ -913,22 +1356,33 @@ private:
     // graceful shutdown related
 private:
     std::atomic_bool shutting_down{false};
-    mutable std::atomic_uint64_t pending_request_num{0};
+    // Sharded per thread, since every request on every core touches it. Only shutdown reads the (summed) value.
+    mutable ShardedCounter pending_request_num;
 
     bool is_shutting_down() const { return shutting_down.load(); }
     void start_shutting_down() { shutting_down = true; }
 
-    uint64_t get_pending_request_num() const { return pending_request_num.load(); }
+    // Only used by the shutdown drain. The updates are not checked against the sum: a slot goes negative whenever a
+    // request ends on another thread than it started on, and summing the slots on every request is what the
+    // sharding avoids.
+    uint64_t get_pending_request_num() const {
+        // only report the drain as done once two consecutive sums agree, a single racy sum may undercount
+        auto const now = pending_request_num.get_stable();
+        return now > 0 ? static_cast< uint64_t >(now) : 0;
+    }
 
     // only leader will call incr and decr pending request num
-    void incr_pending_request_num() const {
-        uint64_t now = pending_request_num.fetch_add(1);
-        LOGT("inc pending req, was {}", now);
+    void incr_pending_request_num() const { pending_request_num.increment(); }
+    void decr_pending_request_num() const { pending_request_num.decrement(); }
+
+    // blob requests are also accounted per pg
+    void incr_pending_request_num(const HS_PG* hs_pg) const {
+        incr_pending_request_num();
+        hs_pg->inflight_requests_.increment();
     }
-    void decr_pending_request_num() const {
-        uint64_t now = pending_request_num.fetch_sub(1);
-        LOGT("desc pending req, was {}", now);
-        DEBUG_ASSERT(now > 0, "pending == 0 ");
+    void decr_pending_request_num(const HS_PG* hs_pg) const {
+        hs_pg->inflight_requests_.decrement();
+        decr_pending_request_num();
     }
 };
 
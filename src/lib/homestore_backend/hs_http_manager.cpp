@@ -13,16 +13,21 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <filesystem>
+
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <sisl/version.hpp>
 #include <sisl/settings/settings.hpp>
 
 #include "hs_http_manager.hpp"
 #include "hs_homeobject.hpp"
+#include "hs_backend_config.hpp"
 
 namespace homeobject {
 
-HttpManager::HttpManager(HSHomeObject& ho) : ho_(ho) {
+HttpManager::HttpManager(HSHomeObject& ho) :
+        ho_(ho), archive_executor_(std::make_shared< folly::IOThreadPoolExecutor >(1)) {
     using namespace Pistache;
     using namespace Pistache::Rest;
 
@@ -33,6 +38,23 @@ HttpManager::HttpManager(HSHomeObject& ho) : ho_(ho) {
          Pistache::Rest::Routes::bind(&HttpManager::get_obj_life, this)},
         {Pistache::Http::Method::Get, "/api/v1/mallocStats",
          Pistache::Rest::Routes::bind(&HttpManager::get_malloc_stats, this)},
+        {Pistache::Http::Method::Get, "/api/v1/hotSpots",
+         Pistache::Rest::Routes::bind(&HttpManager::get_hot_spots, this)},
+        {Pistache::Http::Method::Get, "/api/v1/pgQoS", Pistache::Rest::Routes::bind(&HttpManager::get_pg_qos, this)},
+        {Pistache::Http::Method::Post, "/api/v1/pgQoS", Pistache::Rest::Routes::bind(&HttpManager::set_pg_qos, this)},
+        {Pistache::Http::Method::Get, "/api/v1/shardDigest",
+         Pistache::Rest::Routes::bind(&HttpManager::get_shard_digest, this)},
+        {Pistache::Http::Method::Post, "/api/v1/shardDigest/compare",
+         Pistache::Rest::Routes::bind(&HttpManager::compare_shard_digest, this)},
+        {Pistache::Http::Method::Get, "/api/v1/scrub",
+         Pistache::Rest::Routes::bind(&HttpManager::get_scrub_status, this)},
+        {Pistache::Http::Method::Post, "/api/v1/scrub", Pistache::Rest::Routes::bind(&HttpManager::start_scrub, this)},
+        {Pistache::Http::Method::Post, "/api/v1/shardExport",
+         Pistache::Rest::Routes::bind(&HttpManager::export_shard, this)},
+        {Pistache::Http::Method::Post, "/api/v1/shardImport",
+         Pistache::Rest::Routes::bind(&HttpManager::import_shard, this)},
+        {Pistache::Http::Method::Get, "/api/v1/shardArchiveJobs",
+         Pistache::Rest::Routes::bind(&HttpManager::get_shard_archive_jobs, this)},
 #ifdef _PRERELEASE
         {Pistache::Http::Method::Post, "/api/v1/crashSystem",
          Pistache::Rest::Routes::bind(&HttpManager::crash_system, this)},
@@ -49,6 +71,16 @@ HttpManager::HttpManager(HSHomeObject& ho) : ho_(ho) {
     } catch (std::runtime_error const& e) { LOGERROR("setup routes failed, {}", e.what()); }
 }
 
+HttpManager::~HttpManager() { stop(); }
+
+void HttpManager::stop() {
+    stopping_ = true;
+    if (archive_executor_) {
+        archive_executor_->join();
+        archive_executor_.reset();
+    }
+}
+
 void HttpManager::get_obj_life(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
     nlohmann::json j;
     sisl::ObjCounterRegistry::foreach ([&j](const std::string& name, int64_t created, int64_t alive) {
@@ -63,6 +95,291 @@ void HttpManager::get_malloc_stats(const Pistache::Rest::Request& request, Pista
     response.send(Pistache::Http::Code::Ok, sisl::get_malloc_stats_detailed().dump(2));
 }
 
+void HttpManager::get_hot_spots(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    response.send(Pistache::Http::Code::Ok, ho_.dump_hot_spots().dump(2));
+}
+
+void HttpManager::get_pg_qos(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto sched = ho_.io_scheduler();
+    if (!sched) {
+        response.send(Pistache::Http::Code::Service_Unavailable, "io scheduler is not initialized");
+        return;
+    }
+    response.send(Pistache::Http::Code::Ok, sched->dump().dump(2));
+}
+
+// e.g. POST /api/v1/pgQoS?pg_id=1&weight=200&read_iops=1000&write_mbps=100, omitted settings are unlimited / default
+void HttpManager::set_pg_qos(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto sched = ho_.io_scheduler();
+    if (!sched) {
+        response.send(Pistache::Http::Code::Service_Unavailable, "io scheduler is not initialized");
+        return;
+    }
+    auto const pg_id_param = request.query().get("pg_id");
+    if (!pg_id_param) {
+        response.send(Pistache::Http::Code::Bad_Request, "pg_id is required");
+        return;
+    }
+
+    PGIoScheduler::PGQoS qos;
+    pg_id_t pg_id;
+    try {
+        pg_id = boost::lexical_cast< pg_id_t >(pg_id_param.value());
+        auto get_param = [&request](std::string const& name) -> uint64_t {
+            auto const v = request.query().get(name);
+            return v ? boost::lexical_cast< uint64_t >(v.value()) : 0;
+        };
+        qos.weight = static_cast< uint32_t >(get_param("weight"));
+        qos.read_iops = get_param("read_iops");
+        qos.write_iops = get_param("write_iops");
+        qos.read_mbps = get_param("read_mbps");
+        qos.write_mbps = get_param("write_mbps");
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+
+    sched->set_pg_qos(pg_id, qos);
+    response.send(Pistache::Http::Code::Ok, sched->dump().dump(2));
+}
+
+// e.g. GET /api/v1/shardDigest?pg_id=1&shard_id=281474976710657, all shards of the pg if shard_id is omitted
+void HttpManager::get_shard_digest(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto const pg_id_param = request.query().get("pg_id");
+    if (!pg_id_param) {
+        response.send(Pistache::Http::Code::Bad_Request, "pg_id is required");
+        return;
+    }
+    pg_id_t pg_id;
+    std::optional< shard_id_t > shard_id;
+    try {
+        pg_id = boost::lexical_cast< pg_id_t >(pg_id_param.value());
+        auto const shard_id_param = request.query().get("shard_id");
+        if (shard_id_param) { shard_id = boost::lexical_cast< shard_id_t >(shard_id_param.value()); }
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+    response.send(Pistache::Http::Code::Ok, ho_.dump_shard_digests(pg_id, shard_id).dump(2));
+}
+
+// e.g. POST /api/v1/shardDigest/compare?pg_id=1 with the body being the GET /api/v1/shardDigest output of a peer
+void HttpManager::compare_shard_digest(const Pistache::Rest::Request& request,
+                                       Pistache::Http::ResponseWriter response) {
+    auto const pg_id_param = request.query().get("pg_id");
+    if (!pg_id_param) {
+        response.send(Pistache::Http::Code::Bad_Request, "pg_id is required");
+        return;
+    }
+    pg_id_t pg_id;
+    nlohmann::json peer;
+    try {
+        pg_id = boost::lexical_cast< pg_id_t >(pg_id_param.value());
+        peer = nlohmann::json::parse(request.body());
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    } catch (nlohmann::json::exception const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+    response.send(Pistache::Http::Code::Ok, ho_.compare_shard_digests(pg_id, peer).dump(2));
+}
+
+void HttpManager::get_scrub_status(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto scrubber = ho_.scrubber();
+    if (!scrubber) {
+        response.send(Pistache::Http::Code::Service_Unavailable, "scrubber is not initialized");
+        return;
+    }
+    response.send(Pistache::Http::Code::Ok, scrubber->dump().dump(2));
+}
+
+// e.g. POST /api/v1/scrub?pg_id=1, all the pgs if pg_id is omitted
+void HttpManager::start_scrub(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto scrubber = ho_.scrubber();
+    if (!scrubber) {
+        response.send(Pistache::Http::Code::Service_Unavailable, "scrubber is not initialized");
+        return;
+    }
+    std::optional< pg_id_t > pg_id;
+    try {
+        auto const pg_id_param = request.query().get("pg_id");
+        if (pg_id_param) { pg_id = boost::lexical_cast< pg_id_t >(pg_id_param.value()); }
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+    if (!scrubber->trigger(pg_id)) {
+        response.send(Pistache::Http::Code::Conflict, "a scrub pass is already running");
+        return;
+    }
+    response.send(Pistache::Http::Code::Ok, "scrub pass started");
+}
+
+std::optional< std::string > HttpManager::archive_path(std::string const& name) {
+    std::string const dir = HS_BACKEND_DYNAMIC_CONFIG(shard_archive_dir);
+    if (dir.empty() || name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+        return std::nullopt;
+    }
+    // a symlink in the dir must not lead out of it either
+    std::error_code ec;
+    auto const base = std::filesystem::weakly_canonical(dir, ec);
+    if (ec) { return std::nullopt; }
+    auto const path = std::filesystem::weakly_canonical(base / name, ec);
+    if (ec || path.parent_path() != base) { return std::nullopt; }
+    return path.string();
+}
+
+std::optional< uint64_t > HttpManager::add_archive_job(nlohmann::json job, std::function< nlohmann::json() > work) {
+    if (!archive_executor_ || stopping_) { return std::nullopt; }
+    uint64_t job_id;
+    {
+        std::scoped_lock lock(archive_mtx_);
+        job_id = next_archive_job_id_++;
+        job["job_id"] = job_id;
+        job["state"] = "queued";
+        archive_jobs_.emplace(job_id, std::move(job));
+        // forget the oldest finished jobs
+        for (auto it = archive_jobs_.begin(); archive_jobs_.size() > max_archive_jobs && it != archive_jobs_.end();) {
+            auto const& state = it->second["state"];
+            it = (state == "done" || state == "failed") ? archive_jobs_.erase(it) : std::next(it);
+        }
+    }
+
+    auto const set_state = [this, job_id](std::string const& state, nlohmann::json result) {
+        std::scoped_lock lock(archive_mtx_);
+        auto it = archive_jobs_.find(job_id);
+        if (it == archive_jobs_.end()) { return; }
+        it->second["state"] = state;
+        if (!result.is_null()) { it->second["result"] = std::move(result); }
+    };
+    archive_executor_->add([this, set_state, work = std::move(work)]() {
+        if (stopping_) {
+            set_state("failed", nlohmann::json{{"error", "shutting down"}});
+            return;
+        }
+        set_state("running", nullptr);
+        auto result = work();
+        set_state(result.contains("error") ? "failed" : "done", std::move(result));
+    });
+    return job_id;
+}
+
+// e.g. POST /api/v1/shardExport?shard_id=281474976710657&file=shard.hoa, the shard has to be sealed. The archive is
+// written to that file in shard_archive_dir, by a background job whose id is returned.
+void HttpManager::export_shard(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto const shard_id_param = request.query().get("shard_id");
+    auto const file = request.query().get("file");
+    if (!shard_id_param || !file) {
+        response.send(Pistache::Http::Code::Bad_Request, "shard_id and file are required");
+        return;
+    }
+    shard_id_t shard_id;
+    try {
+        shard_id = boost::lexical_cast< shard_id_t >(shard_id_param.value());
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+    auto const path = archive_path(file.value());
+    if (!path) {
+        response.send(Pistache::Http::Code::Forbidden,
+                      "file has to be a plain file name, and shard_archive_dir has to be configured");
+        return;
+    }
+
+    auto const job_id = add_archive_job(nlohmann::json{{"type", "export"}, {"shard_id", shard_id}, {"file", *path}},
+                                        [this, shard_id, path = *path]() {
+                                            auto r = ho_.export_shard(shard_id, path);
+                                            if (!r) { return nlohmann::json{{"error", fmt::format("{}", r.error())}}; }
+                                            nlohmann::json j;
+                                            j["shard_id"] = r->shard_id;
+                                            j["blob_count"] = r->blob_count;
+                                            j["bytes"] = r->bytes;
+                                            j["elapsed_us"] = r->elapsed_us;
+                                            return j;
+                                        });
+    if (!job_id) {
+        response.send(Pistache::Http::Code::Service_Unavailable, "shutting down");
+        return;
+    }
+    response.send(Pistache::Http::Code::Accepted, nlohmann::json{{"job_id", *job_id}}.dump(2));
+}
+
+// e.g. POST /api/v1/shardImport?pg_id=1&file=shard.hoa on the leader of the pg, the archive is read from that file in
+// shard_archive_dir by a background job whose id is returned. The job result holds the id of the new shard.
+void HttpManager::import_shard(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
+    auto const pg_id_param = request.query().get("pg_id");
+    auto const file = request.query().get("file");
+    if (!pg_id_param || !file) {
+        response.send(Pistache::Http::Code::Bad_Request, "pg_id and file are required");
+        return;
+    }
+    pg_id_t pg_id;
+    try {
+        pg_id = boost::lexical_cast< pg_id_t >(pg_id_param.value());
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+    auto const path = archive_path(file.value());
+    if (!path) {
+        response.send(Pistache::Http::Code::Forbidden,
+                      "file has to be a plain file name, and shard_archive_dir has to be configured");
+        return;
+    }
+
+    auto const job_id = add_archive_job(nlohmann::json{{"type", "import"}, {"pg_id", pg_id}, {"file", *path}},
+                                        [this, pg_id, path = *path]() {
+                                            auto r = ho_.import_shard(pg_id, path);
+                                            if (!r) { return nlohmann::json{{"error", fmt::format("{}", r.error())}}; }
+                                            nlohmann::json j;
+                                            j["shard_id"] = r->shard.id;
+                                            j["source_shard_id"] = r->source_shard_id;
+                                            j["blob_count"] = r->blob_count;
+                                            j["bytes"] = r->bytes;
+                                            j["elapsed_us"] = r->elapsed_us;
+                                            return j;
+                                        });
+    if (!job_id) {
+        response.send(Pistache::Http::Code::Service_Unavailable, "shutting down");
+        return;
+    }
+    response.send(Pistache::Http::Code::Accepted, nlohmann::json{{"job_id", *job_id}}.dump(2));
+}
+
+// e.g. GET /api/v1/shardArchiveJobs?job_id=3, all the jobs still remembered if job_id is omitted
+void HttpManager::get_shard_archive_jobs(const Pistache::Rest::Request& request,
+                                         Pistache::Http::ResponseWriter response) {
+    std::optional< uint64_t > job_id;
+    try {
+        auto const job_id_param = request.query().get("job_id");
+        if (job_id_param) { job_id = boost::lexical_cast< uint64_t >(job_id_param.value()); }
+    } catch (boost::bad_lexical_cast const& e) {
+        response.send(Pistache::Http::Code::Bad_Request, e.what());
+        return;
+    }
+
+    nlohmann::json j;
+    {
+        std::scoped_lock lock(archive_mtx_);
+        if (job_id) {
+            if (auto it = archive_jobs_.find(*job_id); it != archive_jobs_.end()) { j = it->second; }
+        } else {
+            j = nlohmann::json::array();
+            for (auto const& [_, job] : archive_jobs_) {
+                j.push_back(job);
+            }
+        }
+    }
+    if (j.is_null()) {
+        response.send(Pistache::Http::Code::Not_Found, fmt::format("unknown job_id={}", *job_id));
+        return;
+    }
+    response.send(Pistache::Http::Code::Ok, j.dump(2));
+}
+
 #ifdef _PRERELEASE
 void HttpManager::crash_system(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
     std::string crash_type;
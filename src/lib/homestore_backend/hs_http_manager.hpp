@@ -13,8 +13,18 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <folly/executors/IOThreadPoolExecutor.h>
 #include <iomgr/io_environment.hpp>
 #include <iomgr/http_server.hpp>
+#include <nlohmann/json.hpp>
 
 namespace homeobject {
 class HSHomeObject;
@@ -22,16 +32,44 @@ class HSHomeObject;
 class HttpManager {
 public:
     HttpManager(HSHomeObject& ho);
+    ~HttpManager();
+
+    // Waits for the running shard archive job, if any, queued ones are dropped.
+    void stop();
 
 private:
     void get_obj_life(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void get_malloc_stats(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void get_hot_spots(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void get_pg_qos(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void set_pg_qos(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void get_shard_digest(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void compare_shard_digest(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void get_scrub_status(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void start_scrub(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void export_shard(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void import_shard(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void get_shard_archive_jobs(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
+    // The archive file of that name in shard_archive_dir, nullopt if the name leads out of it or no dir is configured
+    static std::optional< std::string > archive_path(std::string const& name);
+    // Queue a shard export / import, its state is then under /api/v1/shardArchiveJobs. nullopt once stopping.
+    std::optional< uint64_t > add_archive_job(nlohmann::json job, std::function< nlohmann::json() > work);
 
 #ifdef _PRERELEASE
     void crash_system(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
 #endif
 
 private:
+    static constexpr size_t max_archive_jobs{64};
+
     HSHomeObject& ho_;
+
+    // exports and imports run one at a time, off the http threads
+    std::shared_ptr< folly::IOThreadPoolExecutor > archive_executor_;
+    std::atomic_bool stopping_{false};
+    std::mutex archive_mtx_;
+    uint64_t next_archive_job_id_{1};
+    std::map< uint64_t, nlohmann::json > archive_jobs_; // job id -> state, only the last max_archive_jobs
 };
 } // namespace homeobject
\ No newline at end of file
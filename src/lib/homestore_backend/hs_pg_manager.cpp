@@ -1,5 +1,6 @@
 #include "hs_backend_config.hpp"
 
+#include <algorithm>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/string_generator.hpp>
 #include <homestore/replication_service.hpp>
@@ -162,7 +163,8 @@ PGManager::NullAsyncResult HSHomeObject::do_create_pg(cshared< homestore::ReplDe
 }
 
 folly::Expected< HSHomeObject::HS_PG*, PGError > HSHomeObject::local_create_pg(shared< ReplDev > repl_dev,
-                                                                               PGInfo pg_info, trace_id_t tid) {
+                                                                               PGInfo pg_info, trace_id_t tid,
+                                                                               bool sorted_inserts) {
     auto pg_id = pg_info.id;
     if (auto hs_pg = get_hs_pg(pg_id); hs_pg) {
         LOGW("PG already exists, pg={}, trace_id={}", pg_id, tid);
@@ -189,7 +191,10 @@ folly::Expected< HSHomeObject::HS_PG*, PGError > HSHomeObject::local_create_pg(s
     }
 
     // create index table and pg
-    auto index_table = create_pg_index_table();
+    auto index_table = sorted_inserts
+        ? create_pg_index_table(static_cast< uint8_t >(
+              std::clamp(HS_BACKEND_DYNAMIC_CONFIG(snapshot_index_split_pct), uint32_t{50}, uint32_t{99})))
+        : create_pg_index_table();
     auto uuid_str = boost::uuids::to_string(index_table->uuid());
 
     repl_dev->set_custom_rdev_name(fmt::format("rdev{}", pg_info.id));
@@ -367,7 +372,11 @@ void HSHomeObject::mark_pg_destroyed(pg_id_t pg_id) {
     LOGD("pg={} is marked as destroyed", pg_id);
 }
 
-void HSHomeObject::destroy_hs_resources(pg_id_t pg_id) { chunk_selector_->reset_pg_chunks(pg_id); }
+void HSHomeObject::destroy_hs_resources(pg_id_t pg_id) {
+    chunk_selector_->reset_pg_chunks(pg_id);
+    if (recent_write_cache_) { recent_write_cache_->remove_pg(pg_id); }
+    if (io_scheduler_) { io_scheduler_->remove_pg(pg_id); }
+}
 
 void HSHomeObject::destroy_pg_index_table(pg_id_t pg_id) {
     std::shared_ptr< BlobIndexTable > index_table;
@@ -419,9 +428,13 @@ void HSHomeObject::destroy_pg_superblk(pg_id_t pg_id) {
         hs_pg->snp_rcvr_info_sb_.destroy();
         hs_pg->snp_rcvr_shard_list_sb_.destroy();
 
-        // erase pg in pg map
+        // unpublish from the lookup table, then retire the pg: readers of the table may still hold it
+        publish_pg_lookup_unlocked(pg_id, nullptr);
+        hs_pg->metrics_.retire();
         auto iter = _pg_map.find(pg_id);
+        retired_pgs_.push_back(RetiredPG{std::move(iter->second), std::chrono::steady_clock::now()});
         _pg_map.erase(iter);
+        reclaim_retired_pgs_unlocked();
     }
 }
 
@@ -433,6 +446,51 @@ void HSHomeObject::add_pg_to_map(unique< HS_PG > hs_pg) {
     auto id = hs_pg->pg_info_.id;
     auto [it1, _] = _pg_map.try_emplace(id, std::move(hs_pg));
     RELEASE_ASSERT(_pg_map.end() != it1, "Unknown map insert error!");
+    publish_pg_lookup_unlocked(id, static_cast< HS_PG* >(it1->second.get()));
+    reclaim_retired_pgs_unlocked();
+}
+
+// NOTE: caller should hold _pg_lock
+void HSHomeObject::publish_pg_lookup_unlocked(pg_id_t pg_id, HS_PG* hs_pg) {
+    auto& page = pg_lookup_[pg_id / pg_lookup_page_size];
+    auto p = page.load(std::memory_order_acquire);
+    if (p == nullptr) {
+        if (hs_pg == nullptr) { return; }
+        p = pg_lookup_page_owner_.emplace_back(std::make_unique< PGLookupPage >()).get();
+        page.store(p, std::memory_order_release);
+    }
+    p->slots[pg_id % pg_lookup_page_size].store(hs_pg, std::memory_order_release);
+}
+
+// NOTE: caller should hold _pg_lock
+void HSHomeObject::reclaim_retired_pgs_unlocked() {
+    auto const now = std::chrono::steady_clock::now();
+    std::erase_if(retired_pgs_, [now](RetiredPG const& r) {
+        if (now - r.retired_at < pg_reclaim_grace_period) { return false; }
+        auto hs_pg = static_cast< HS_PG const* >(r.pg.get());
+        if (hs_pg->inflight_requests_.get_stable() > 0 || hs_pg->pins_.load(std::memory_order_acquire) > 0) {
+            return false;
+        }
+        LOGI("reclaimed destroyed pg={}", hs_pg->pg_info_.id);
+        return true;
+    });
+}
+
+void HSHomeObject::start_pg_reclaim_timer() {
+    pg_reclaim_timer_hdl_ = iomanager.schedule_global_timer(
+        std::chrono::duration_cast< std::chrono::nanoseconds >(pg_reclaim_check_interval).count(), true,
+        nullptr /*cookie*/, iomgr::reactor_regex::all_user,
+        [this](void*) {
+            auto lg = std::scoped_lock(_pg_lock);
+            reclaim_retired_pgs_unlocked();
+        },
+        true /* wait_to_schedule */);
+}
+
+void HSHomeObject::stop_pg_reclaim_timer() {
+    if (pg_reclaim_timer_hdl_ == iomgr::null_timer_handle) { return; }
+    iomanager.cancel_timer(pg_reclaim_timer_hdl_, true);
+    pg_reclaim_timer_hdl_ = iomgr::null_timer_handle;
 }
 
 std::string HSHomeObject::serialize_pg_info(const PGInfo& pginfo) {
@@ -565,6 +623,8 @@ HSHomeObject::HS_PG::HS_PG(superblk< pg_info_superblk >&& sb, shared< ReplDev >
     durable_entities_.active_blob_count = pg_sb_->active_blob_count;
     durable_entities_.tombstone_blob_count = pg_sb_->tombstone_blob_count;
     durable_entities_.total_occupied_blk_count = pg_sb_->total_occupied_blk_count;
+    // Anything which may be replayed from the log after restart was assigned a blob id below the persisted sequence
+    replay_blob_id_boundary_.store(pg_sb_->blob_sequence_num, std::memory_order_relaxed);
 }
 
 uint32_t HSHomeObject::HS_PG::total_shards() const { return shards_.size(); }
@@ -583,9 +643,57 @@ const HSHomeObject::HS_PG* HSHomeObject::_get_hs_pg_unlocked(pg_id_t pg_id) cons
     return iter == _pg_map.end() ? nullptr : dynamic_cast< HS_PG* >(iter->second.get());
 }
 
+// Wait-free, does not take _pg_lock. The returned pg stays valid for pg_reclaim_grace_period after it is destroyed
+// through destroy_pg_superblk, and for as long as it has blob requests in flight.
 const HSHomeObject::HS_PG* HSHomeObject::get_hs_pg(pg_id_t pg_id) const {
-    std::shared_lock lck(_pg_lock);
-    return _get_hs_pg_unlocked(pg_id);
+    auto const page = pg_lookup_[pg_id / pg_lookup_page_size].load(std::memory_order_acquire);
+    return page == nullptr ? nullptr : page->slots[pg_id % pg_lookup_page_size].load(std::memory_order_acquire);
+}
+
+bool HSHomeObject::HS_PG::admit_write() const {
+    auto const max_lag = HS_BACKEND_DYNAMIC_CONFIG(write_throttle_max_follower_lag);
+    auto const max_inflight_bytes = HS_BACKEND_DYNAMIC_CONFIG(write_throttle_max_inflight_mb) * Mi;
+    if (max_lag == 0 && max_inflight_bytes == 0) {
+        write_throttled_.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    auto const now = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+    auto const interval_ns = int64_t(HS_BACKEND_DYNAMIC_CONFIG(write_throttle_check_interval_ms)) * 1'000'000;
+    auto last = write_admission_checked_ns_.load(std::memory_order_relaxed);
+    // only one writer refreshes the state, the others go with the current one
+    if (now - last >= interval_ns &&
+        write_admission_checked_ns_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        auto const replication_status = repl_dev_->get_replication_status();
+        uint64_t leader_idx{0};
+        for (auto const& r : replication_status) {
+            leader_idx = std::max(leader_idx, static_cast< uint64_t >(r.replication_idx_));
+        }
+        auto const peer_timeout_us = HS_BACKEND_DYNAMIC_CONFIG(write_throttle_peer_timeout_ms) * 1000;
+        uint64_t lag{0};
+        for (auto const& r : replication_status) {
+            // a follower which stopped responding can not be helped by slowing down writes
+            if (r.last_succ_resp_us_ > peer_timeout_us) { continue; }
+            lag = std::max(lag, leader_idx - static_cast< uint64_t >(r.replication_idx_));
+        }
+        max_follower_lag_.store(lag, std::memory_order_relaxed);
+
+        auto const inflight_bytes = static_cast< uint64_t >(std::max(inflight_put_bytes_.get(), int64_t{0}));
+        bool const throttled =
+            (max_lag != 0 && lag > max_lag) || (max_inflight_bytes != 0 && inflight_bytes > max_inflight_bytes);
+        if (throttled != write_throttled_.exchange(throttled, std::memory_order_relaxed)) {
+            LOGI("write throttle {} for pg={}, max_follower_lag={}, inflight_put_bytes={}",
+                 throttled ? "engaged" : "released", pg_info_.id, lag, inflight_bytes);
+        }
+    }
+
+    if (write_throttled_.load(std::memory_order_relaxed)) {
+        COUNTER_INCREMENT(metrics_, throttled_put_count, 1);
+        return false;
+    }
+    return true;
 }
 
 bool HSHomeObject::_get_stats(pg_id_t id, PGStats& stats) const {
@@ -409,6 +409,7 @@ void HSHomeObject::local_create_shard(ShardInfo shard_info, homestore::chunk_num
     } else {
         SLOGD(tid, shard_info.id, "shard already exist, skip creating shard");
     }
+    shard_digests_->create(shard_info.id);
 
     // update pg's total_occupied_blk_count
     auto hs_pg = get_hs_pg(shard_info.placement_group);
@@ -492,6 +493,8 @@ void HSHomeObject::on_shard_message_commit(int64_t lsn, sisl::blob const& h, hom
             bool res = chunk_selector()->release_chunk(pg_id, v_chunkID.value());
             RELEASE_ASSERT(res, "Failed to release v_chunk_id={}, pg={}", v_chunkID.value(), pg_id);
             update_shard_in_map(shard_info);
+            // no more puts to the shard, its digest as of now is final
+            shard_digests_->seal(shard_info.id);
         } else
             SLOGW(tid, shard_info.id, "try to commit SEAL_SHARD_MSG but shard state is not sealed.");
         if (ctx) { ctx->promise_.setValue(ShardManager::Result< ShardInfo >(shard_info)); }
@@ -649,14 +652,95 @@ void HSHomeObject::destroy_shards(pg_id_t pg_id) {
 
     for (auto& shard : hs_pg->shards_) {
         auto hs_shard = s_cast< HS_Shard* >(shard.get());
+        // the chunk goes back to the pool and will be written from scratch
+        scrubber_->forget_chunk(hs_shard->p_chunk_id());
         // destroy shard super blk
         hs_shard->sb_.destroy();
         // erase shard in shard map
         _shard_map.erase(shard->info.id);
+        shard_digests_->erase(shard->info.id);
     }
     LOGD("Shards in pg={} have all been destroyed", pg_id);
 }
 
+nlohmann::json HSHomeObject::dump_shard_digests(pg_id_t pg_id, std::optional< shard_id_t > shard_id) const {
+    std::vector< shard_id_t > shard_ids;
+    {
+        auto pg_lg = std::shared_lock(_pg_lock);
+        auto shard_lg = std::shared_lock(_shard_lock);
+        auto hs_pg = _get_hs_pg_unlocked(pg_id);
+        if (hs_pg == nullptr) { return nlohmann::json::object(); }
+        for (auto const& shard : hs_pg->shards_) {
+            if (!shard_id || shard->info.id == *shard_id) { shard_ids.push_back(shard->info.id); }
+        }
+    }
+
+    nlohmann::json j;
+    j["pg_id"] = pg_id;
+    auto shards = nlohmann::json::array();
+    for (auto const id : shard_ids) {
+        // a shard missing from the table has no digest we could vouch for
+        auto d = shard_digests_->get(id);
+        if (!d) {
+            d = ShardDigestTable::Digest{};
+            d->stale = true;
+        }
+        shards.push_back(ShardDigestTable::to_json(id, *d));
+    }
+    j["shards"] = std::move(shards);
+    return j;
+}
+
+nlohmann::json HSHomeObject::compare_shard_digests(pg_id_t pg_id, nlohmann::json const& peer) const {
+    auto const local = dump_shard_digests(pg_id);
+    std::map< shard_id_t, ShardDigestTable::Digest > mine, theirs;
+    auto collect = [](nlohmann::json const& dump, std::map< shard_id_t, ShardDigestTable::Digest >& out) {
+        if (!dump.contains("shards")) { return; }
+        for (auto const& s : dump.at("shards")) {
+            if (!s.contains("shard_id")) { continue; }
+            if (auto d = ShardDigestTable::from_json(s); d) { out.emplace(s.at("shard_id").get< shard_id_t >(), *d); }
+        }
+    };
+    collect(local, mine);
+    collect(peer, theirs);
+
+    nlohmann::json j;
+    j["pg_id"] = pg_id;
+    j["in_sync"] = nlohmann::json::array();
+    j["divergent"] = nlohmann::json::array();
+    j["only_local"] = nlohmann::json::array();
+    j["only_peer"] = nlohmann::json::array();
+    j["stale"] = nlohmann::json::array();
+    for (auto const& [id, d] : mine) {
+        auto it = theirs.find(id);
+        if (it == theirs.end()) {
+            j["only_local"].push_back(id);
+            continue;
+        }
+        auto const& p = it->second;
+        if (d.stale || p.stale) {
+            j["stale"].push_back(id);
+        } else if (d.blob_count == p.blob_count && d.digest == p.digest) {
+            j["in_sync"].push_back(id);
+        } else {
+            nlohmann::json div;
+            div["shard_id"] = id;
+            div["local_blobs"] = d.blob_count;
+            div["peer_blobs"] = p.blob_count;
+            auto ranges = nlohmann::json::array();
+            for (auto const& r : ShardDigestTable::divergent_ranges(d, p)) {
+                ranges.push_back({r.first, r.last});
+            }
+            div["ranges"] = std::move(ranges);
+            j["divergent"].push_back(std::move(div));
+        }
+    }
+    for (auto const& [id, _] : theirs) {
+        if (!mine.contains(id)) { j["only_peer"].push_back(id); }
+    }
+    return j;
+}
+
 HSHomeObject::HS_Shard::HS_Shard(ShardInfo shard_info, homestore::chunk_num_t p_chunk_id,
                                  homestore::chunk_num_t v_chunk_id) :
         Shard(std::move(shard_info)), sb_(_shard_meta_name) {
@@ -2,20 +2,23 @@
 #include <boost/uuid/random_generator.hpp>
 #include "hs_homeobject.hpp"
 #include "index_kv.hpp"
+#include <homestore/blkdata_service.hpp>
 
 SISL_LOGGING_DECL(blobmgr)
 
 namespace homeobject {
 
-std::shared_ptr< BlobIndexTable > HSHomeObject::create_pg_index_table() {
+std::shared_ptr< BlobIndexTable > HSHomeObject::create_pg_index_table(std::optional< uint8_t > split_pct) {
     homestore::uuid_t uuid = boost::uuids::random_generator()();
     homestore::uuid_t parent_uuid = boost::uuids::random_generator()();
     std::string uuid_str = boost::uuids::to_string(uuid);
     homestore::BtreeConfig bt_cfg(homestore::hs()->index_service().node_size());
     bt_cfg.m_leaf_node_type = homestore::btree_node_type::FIXED;
     bt_cfg.m_int_node_type = homestore::btree_node_type::FIXED;
+    // not persisted, a recovered index table splits evenly again
+    if (split_pct) { bt_cfg.m_split_pct = *split_pct; }
 
-    return std::make_shared< BlobIndexTable >(uuid, parent_uuid, static_cast< uint32_t >(INDEX_TYPE::BLOB_INDEX),
+    return std::make_shared< BlobIndexTable >(uuid, parent_uuid, static_cast< uint32_t >(INDEX_TYPE::BLOB_INDEX_CRC),
                                               bt_cfg);
 }
 
@@ -29,7 +32,7 @@ std::shared_ptr< GCBlobIndexTable > HSHomeObject::create_gc_index_table() {
 
     // for now, we use the user_sb_size in index_table meta blk to differentiate blob and gc index.
     // TODO: make necessary change if we need adapt to the new index table case.
-    return std::make_shared< GCBlobIndexTable >(uuid, parent_uuid, static_cast< uint32_t >(INDEX_TYPE::GC_BLOB_INDEX),
+    return std::make_shared< GCBlobIndexTable >(uuid, parent_uuid, static_cast< uint32_t >(INDEX_TYPE::GC_BLOB_INDEX_CRC),
                                                 bt_cfg);
 }
 
@@ -41,7 +44,12 @@ HSHomeObject::recover_index_table(homestore::superblk< homestore::index_table_sb
 
     auto uuid_str = boost::uuids::to_string(sb->uuid);
 
-    if (sb->user_sb_size == static_cast< uint32_t >(INDEX_TYPE::BLOB_INDEX)) {
+    // the values of these are laid out without the payload crc, the fixed size node layout does not match any more
+    RELEASE_ASSERT(sb->user_sb_size != static_cast< uint32_t >(INDEX_TYPE::BLOB_INDEX) &&
+                       sb->user_sb_size != static_cast< uint32_t >(INDEX_TYPE::GC_BLOB_INDEX),
+                   "Index table uuid {} is from before payload crcs were indexed, it can not be recovered", uuid_str);
+
+    if (sb->user_sb_size == static_cast< uint32_t >(INDEX_TYPE::BLOB_INDEX_CRC)) {
         auto index_table = std::make_shared< BlobIndexTable >(std::move(sb), bt_cfg);
         // Check if PG is already recovered.
         std::scoped_lock lock_guard(index_lock_);
@@ -52,7 +60,7 @@ HSHomeObject::recover_index_table(homestore::superblk< homestore::index_table_sb
         return index_table;
     }
 
-    if (sb->user_sb_size == static_cast< uint32_t >(INDEX_TYPE::GC_BLOB_INDEX)) {
+    if (sb->user_sb_size == static_cast< uint32_t >(INDEX_TYPE::GC_BLOB_INDEX_CRC)) {
         auto index_table = std::make_shared< GCBlobIndexTable >(std::move(sb), bt_cfg);
         // TODO::for the convinence, we use the same lock as blob index table here. add a new lock if needed.
         std::scoped_lock lock_guard(index_lock_);
@@ -72,7 +80,7 @@ HSHomeObject::recover_index_table(homestore::superblk< homestore::index_table_sb
 std::pair< bool, homestore::btree_status_t > HSHomeObject::add_to_index_table(shared< BlobIndexTable > index_table,
                                                                               const BlobInfo& blob_info) {
     BlobRouteKey index_key{BlobRoute{blob_info.shard_id, blob_info.blob_id}};
-    BlobRouteValue index_value{blob_info.pbas}, existing_value;
+    BlobRouteValue index_value{blob_info.pbas, blob_info.payload_crc}, existing_value;
     homestore::BtreeSinglePutRequest put_req{&index_key, &index_value, homestore::btree_put_type::INSERT,
                                              &existing_value};
     auto status = index_table->put(put_req);
@@ -112,8 +120,8 @@ HSHomeObject::get_blob_from_index_table(shared< BlobIndexTable > index_table, sh
     return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_BLOB));
 }
 
-BlobManager::Result< homestore::MultiBlkId > HSHomeObject::move_to_tombstone(shared< BlobIndexTable > index_table,
-                                                                             const BlobInfo& blob_info) {
+BlobManager::Result< HSHomeObject::BlobInfo > HSHomeObject::move_to_tombstone(shared< BlobIndexTable > index_table,
+                                                                            const BlobInfo& blob_info) {
     BlobRouteKey index_key{BlobRoute{blob_info.shard_id, blob_info.blob_id}};
     BlobRouteValue index_value_get;
     homestore::BtreeSingleGetRequest get_req{&index_key, &index_value_get};
@@ -123,7 +131,7 @@ BlobManager::Result< homestore::MultiBlkId > HSHomeObject::move_to_tombstone(sha
         return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_BLOB));
     }
 
-    BlobRouteValue index_value_put{tombstone_pbas};
+    BlobRouteValue index_value_put{tombstone_pbas, index_value_get.payload_crc()};
     homestore::BtreeSinglePutRequest put_req{&index_key, &index_value_put, homestore::btree_put_type::UPDATE};
     status = index_table->put(put_req);
     if (status != homestore::btree_status_t::success) {
@@ -131,7 +139,10 @@ BlobManager::Result< homestore::MultiBlkId > HSHomeObject::move_to_tombstone(sha
         return folly::makeUnexpected(BlobError(BlobErrorCode::INDEX_ERROR));
     }
 
-    return index_value_get.pbas();
+    return BlobInfo{.shard_id = blob_info.shard_id,
+                    .blob_id = blob_info.blob_id,
+                    .pbas = index_value_get.pbas(),
+                    .payload_crc = index_value_get.payload_crc()};
 }
 
 void HSHomeObject::print_btree_index(pg_id_t pg_id) const {
@@ -156,12 +167,12 @@ shared< BlobIndexTable > HSHomeObject::get_index_table(pg_id_t pg_id) {
 
 BlobManager::Result< std::vector< HSHomeObject::BlobInfo > >
 HSHomeObject::query_blobs_in_shard(pg_id_t pg_id, uint64_t cur_shard_seq_num, blob_id_t start_blob_id,
-                                   uint64_t max_num_in_batch) {
-    // Query all blobs from start_blob_id to the maximum blob_id value.
+                                   uint64_t max_num_in_batch, blob_id_t end_blob_id) {
+    // Query all blobs from start_blob_id to end_blob_id, both inclusive.
     std::vector< std::pair< BlobRouteKey, BlobRouteValue > > out_vector;
     auto shard_id = make_new_shard_id(pg_id, cur_shard_seq_num);
     auto start_key = BlobRouteKey{BlobRoute{shard_id, start_blob_id}};
-    auto end_key = BlobRouteKey{BlobRoute{shard_id, std::numeric_limits< uint64_t >::max()}};
+    auto end_key = BlobRouteKey{BlobRoute{shard_id, end_blob_id}};
     homestore::BtreeQueryRequest< BlobRouteKey > query_req{
         homestore::BtreeKeyRange< BlobRouteKey >{std::move(start_key), true /* inclusive */, std::move(end_key),
                                                  true /* inclusive */},
@@ -176,10 +187,37 @@ HSHomeObject::query_blobs_in_shard(pg_id_t pg_id, uint64_t cur_shard_seq_num, bl
     std::vector< BlobInfo > blob_info_vec;
     blob_info_vec.reserve(out_vector.size());
     for (auto& [r, v] : out_vector) {
-        blob_info_vec.push_back(BlobInfo{r.key().shard, r.key().blob, v.pbas()});
+        blob_info_vec.push_back(BlobInfo{
+            .shard_id = r.key().shard, .blob_id = r.key().blob, .pbas = v.pbas(), .payload_crc = v.payload_crc()});
     }
 
     return blob_info_vec;
 }
 
+BlobManager::Result< HSHomeObject::ShardSummary > HSHomeObject::compute_shard_summary(pg_id_t pg_id,
+                                                                                     shard_id_t shard_id) {
+    ShardSummary d;
+    auto const shard_seq = get_sequence_num_from_shard_id(shard_id);
+    auto const blk_size = homestore::data_service().get_blk_size();
+    blob_id_t next_blob_id{0};
+    while (true) {
+        auto r = query_blobs_in_shard(pg_id, shard_seq, next_blob_id, shard_summary_interval);
+        if (!r) { return folly::makeUnexpected(r.error()); }
+        for (auto const& info : r.value()) {
+            if (info.pbas == tombstone_pbas) { continue; }
+            // chained, so that equal digests at the n-th live blob mean equal first n live blobs
+            auto h = (d.digest ^ ShardDigestTable::element(info.blob_id, info.payload_crc)) * 0x9E3779B97F4A7C15ULL;
+            d.digest = h ^ (h >> 31);
+            d.total_bytes += info.pbas.blk_count() * blk_size;
+            if (++d.blob_count % shard_summary_interval == 0) {
+                d.checkpoint_blob_ids.push_back(info.blob_id);
+                d.checkpoint_digests.push_back(d.digest);
+            }
+        }
+        if (r->size() < shard_summary_interval) { break; }
+        next_blob_id = r->back().blob_id + 1;
+    }
+    return d;
+}
+
 } // namespace homeobject
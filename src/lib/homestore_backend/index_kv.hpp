@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cstring>
+
 #include <homestore/btree/btree_kv.hpp>
 #include <homestore/index/index_internal.hpp>
 #include <homestore/index_service.hpp>
@@ -7,7 +10,8 @@
 
 namespace homeobject {
 
-ENUM(INDEX_TYPE, uint32_t, BLOB_INDEX = 0, GC_BLOB_INDEX);
+// BLOB_INDEX and GC_BLOB_INDEX are the index tables from before the payload crc was part of BlobRouteValue
+ENUM(INDEX_TYPE, uint32_t, BLOB_INDEX = 0, GC_BLOB_INDEX, BLOB_INDEX_CRC, GC_BLOB_INDEX_CRC);
 
 class BlobRouteKey : public homestore::BtreeKey {
 private:
@@ -95,39 +99,60 @@ public:
     BlobRouteByChunk key() const { return key_; }
 };
 
+// The blocks of a blob and the crc of its payload, so that a delete or a shard summary finds the crc without reading
+// the blob. A tombstone keeps the crc of the blob it replaced.
+// NOTE: the crc is part of the fixed size of the value, index tables from before it (see INDEX_TYPE) can not be read.
 class BlobRouteValue : public homestore::BtreeValue {
 public:
     BlobRouteValue() = default;
-    BlobRouteValue(const homestore::MultiBlkId& pbas) : pbas_(pbas) {}
-    BlobRouteValue(const BlobRouteValue& other) : homestore::BtreeValue() { pbas_ = other.pbas_; };
+    BlobRouteValue(const homestore::MultiBlkId& pbas, uint32_t payload_crc = 0) :
+            pbas_(pbas), payload_crc_(payload_crc) {}
+    BlobRouteValue(const BlobRouteValue& other) : homestore::BtreeValue() {
+        pbas_ = other.pbas_;
+        payload_crc_ = other.payload_crc_;
+    };
     BlobRouteValue(const sisl::blob& b, bool copy) : homestore::BtreeValue() { deserialize(b, copy); }
     BlobRouteValue(const homestore::BtreeValue& other) : BlobRouteValue(other.serialize(), true) {}
     virtual ~BlobRouteValue() = default;
 
     BlobRouteValue& operator=(const BlobRouteValue& other) {
         pbas_ = other.pbas_;
+        payload_crc_ = other.payload_crc_;
         return *this;
     }
 
     sisl::blob serialize() const override {
-        auto& pba = const_cast< homestore::MultiBlkId& >(pbas_);
-        return pba.serialize();
+        auto const pba = const_cast< homestore::MultiBlkId& >(pbas_).serialize();
+        DEBUG_ASSERT_LE(pba.size() + sizeof(uint32_t), buf_.size(), "pbas too large for a blob index value");
+        std::memcpy(buf_.data(), pba.cbytes(), pba.size());
+        std::memcpy(buf_.data() + pba.size(), &payload_crc_, sizeof(uint32_t));
+        return sisl::blob{buf_.data(), static_cast< uint32_t >(pba.size() + sizeof(uint32_t))};
     }
 
-    uint32_t serialized_size() const override { return pbas_.serialized_size(); }
-    static uint32_t get_fixed_size() { return homestore::MultiBlkId::expected_serialized_size(1 /* num_pieces */); }
+    uint32_t serialized_size() const override { return pbas_.serialized_size() + sizeof(uint32_t); }
+    static uint32_t get_fixed_size() {
+        return homestore::MultiBlkId::expected_serialized_size(1 /* num_pieces */) + sizeof(uint32_t);
+    }
 
-    void deserialize(const sisl::blob& b, bool copy) override { pbas_.deserialize(b, copy); }
-    std::string to_string() const override { return fmt::format("{}", pbas_.to_string()); }
+    void deserialize(const sisl::blob& b, bool copy) override {
+        auto const pba_size = b.size() - sizeof(uint32_t);
+        pbas_.deserialize(sisl::blob{b.cbytes(), static_cast< uint32_t >(pba_size)}, true);
+        std::memcpy(&payload_crc_, b.cbytes() + pba_size, sizeof(uint32_t));
+    }
+    std::string to_string() const override { return fmt::format("{} crc={:#x}", pbas_.to_string(), payload_crc_); }
     friend std::ostream& operator<<(std::ostream& os, const BlobRouteValue& v) {
-        os << v.pbas().to_string();
+        os << v.to_string();
         return os;
     }
 
     homestore::MultiBlkId pbas() const { return pbas_; }
+    uint32_t payload_crc() const { return payload_crc_; }
 
 private:
     homestore::MultiBlkId pbas_;
+    uint32_t payload_crc_{0};
+    // serialize() hands out a view, the pbas and the crc have to be contiguous
+    mutable std::array< uint8_t, 64 > buf_;
 };
 
 } // namespace homeobject
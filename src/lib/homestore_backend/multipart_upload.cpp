@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <random>
+
+#include <folly/futures/Future.h>
+
+#include "hs_backend_config.hpp"
+#include "hs_homeobject.hpp"
+#include "multipart_upload.hpp"
+
+namespace homeobject {
+
+// How often the timer looks for expired uploads
+static constexpr uint64_t upload_check_interval_sec{60};
+
+static uint64_t now_sec() {
+    return std::chrono::duration_cast< std::chrono::seconds >(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::optional< std::vector< multipart_manifest_entry > > multipart_manifest_entries(uint8_t const* payload,
+                                                                                    size_t size) {
+    if (size < sizeof(multipart_manifest_header)) { return std::nullopt; }
+    multipart_manifest_header header;
+    std::memcpy(&header, payload, sizeof(header));
+    if (header.magic != MULTIPART_MANIFEST_MAGIC || header.version > MULTIPART_MANIFEST_VERSION_V1 ||
+        size != sizeof(header) + uint64_t(header.part_count) * sizeof(multipart_manifest_entry)) {
+        return std::nullopt;
+    }
+    std::vector< multipart_manifest_entry > entries(header.part_count);
+    std::memcpy(entries.data(), payload + sizeof(header), header.part_count * sizeof(multipart_manifest_entry));
+    uint64_t object_size{0};
+    for (auto const& e : entries) {
+        object_size += e.size;
+    }
+    if (object_size != header.object_size) { return std::nullopt; }
+    return entries;
+}
+
+void MultipartUploads::ShardScan::observe(blob_id_t blob_id, uint8_t const* image, size_t size) {
+    auto const header = r_cast< HSHomeObject::BlobHeader const* >(image);
+    switch (header->type) {
+    case HSHomeObject::DataHeader::data_type_t::MULTIPART_PART: {
+        if (header->user_key_size != sizeof(multipart_part_key)) { return; }
+        multipart_part_key key;
+        std::memcpy(&key, image + sizeof(HSHomeObject::BlobHeader), sizeof(key));
+        parts.emplace_back(blob_id, key.upload_id);
+        break;
+    }
+    case HSHomeObject::DataHeader::data_type_t::MULTIPART_MANIFEST: {
+        if (uint64_t(header->data_offset) + header->blob_size > size) { return; }
+        auto entries = multipart_manifest_entries(image + header->data_offset, header->blob_size);
+        if (!entries) { return; }
+        for (auto const& e : *entries) {
+            listed.insert(e.blob_id);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+MultipartUploads::~MultipartUploads() { stop(); }
+
+void MultipartUploads::start() {
+    next_seq_ = std::random_device{}();
+    timer_hdl_ = iomanager.schedule_global_timer(
+        upload_check_interval_sec * 1000 * 1000 * 1000, true, nullptr /*cookie*/, iomgr::reactor_regex::all_user,
+        [this](void*) { on_timer(); }, true /* wait_to_schedule */);
+    LOGINFO("multipart upload timer has started");
+}
+
+void MultipartUploads::stop() {
+    if (timer_hdl_ != iomgr::null_timer_handle) {
+        iomanager.cancel_timer(timer_hdl_, true);
+        timer_hdl_ = iomgr::null_timer_handle;
+    }
+}
+
+upload_id_t MultipartUploads::create(shard_id_t shard_id) {
+    std::scoped_lock lock(mtx_);
+    upload_id_t upload_id;
+    do {
+        upload_id = (now_sec() << upload_id_seq_bits) | (next_seq_++ & ((1u << upload_id_seq_bits) - 1));
+    } while (uploads_.contains(upload_id));
+    uploads_.emplace(upload_id, Upload{.shard_id = shard_id, .created = Clock::now(), .parts = {}});
+    GAUGE_UPDATE(metrics_, uploads_in_progress, uploads_.size());
+    return upload_id;
+}
+
+bool MultipartUploads::in_progress(upload_id_t upload_id, shard_id_t shard_id) const {
+    std::scoped_lock lock(mtx_);
+    auto it = uploads_.find(upload_id);
+    return it != uploads_.end() && it->second.shard_id == shard_id && !it->second.completing;
+}
+
+BlobManager::Result< std::optional< blob_id_t > >
+MultipartUploads::add_part(upload_id_t upload_id, shard_id_t shard_id, uint32_t part_no, Part const& part) {
+    std::scoped_lock lock(mtx_);
+    auto it = uploads_.find(upload_id);
+    if (it == uploads_.end() || it->second.shard_id != shard_id || it->second.completing) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+    }
+    COUNTER_INCREMENT(metrics_, parts_uploaded, 1);
+    COUNTER_INCREMENT(metrics_, part_bytes_uploaded, part.size);
+    std::optional< blob_id_t > replaced;
+    if (auto [p_it, added] = it->second.parts.try_emplace(part_no, part); !added) {
+        replaced = p_it->second.blob_id;
+        p_it->second = part;
+    }
+    return replaced;
+}
+
+BlobManager::Result< MultipartUploads::PartMap > MultipartUploads::begin_complete(upload_id_t upload_id,
+                                                                                  shard_id_t shard_id) {
+    std::scoped_lock lock(mtx_);
+    auto it = uploads_.find(upload_id);
+    if (it == uploads_.end() || it->second.shard_id != shard_id || it->second.completing) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+    }
+    it->second.completing = true;
+    return it->second.parts;
+}
+
+void MultipartUploads::end_complete(upload_id_t upload_id, bool success, uint64_t object_size) {
+    std::scoped_lock lock(mtx_);
+    auto it = uploads_.find(upload_id);
+    if (it == uploads_.end()) { return; }
+    if (!success) {
+        // the client may try again
+        it->second.completing = false;
+        return;
+    }
+    auto const elapsed_us =
+        std::chrono::duration_cast< std::chrono::microseconds >(Clock::now() - it->second.created).count();
+    // bytes per us is MB/s
+    if (elapsed_us > 0) { HISTOGRAM_OBSERVE(metrics_, upload_ingest_throughput, object_size / elapsed_us); }
+    COUNTER_INCREMENT(metrics_, uploads_completed, 1);
+    uploads_.erase(it);
+    completed_.insert_or_assign(upload_id, now_sec());
+    GAUGE_UPDATE(metrics_, uploads_in_progress, uploads_.size());
+}
+
+BlobManager::Result< MultipartUploads::PartMap > MultipartUploads::remove(upload_id_t upload_id, shard_id_t shard_id) {
+    std::scoped_lock lock(mtx_);
+    auto it = uploads_.find(upload_id);
+    if (it == uploads_.end() || it->second.shard_id != shard_id || it->second.completing) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+    }
+    auto parts = std::move(it->second.parts);
+    uploads_.erase(it);
+    COUNTER_INCREMENT(metrics_, uploads_aborted, 1);
+    GAUGE_UPDATE(metrics_, uploads_in_progress, uploads_.size());
+    return parts;
+}
+
+void MultipartUploads::drop_parts(shard_id_t shard_id, std::vector< blob_id_t > blob_ids, trace_id_t tid) {
+    if (blob_ids.empty()) { return; }
+    std::vector< BlobManager::NullAsyncResult > dels;
+    dels.reserve(blob_ids.size());
+    for (auto const blob_id : blob_ids) {
+        dels.emplace_back(ho_.del(shard_id, blob_id, tid, {}));
+    }
+    folly::collectAll(std::move(dels))
+        .via(&folly::InlineExecutor::instance())
+        .thenValue([shard_id, tid](auto&& results) {
+            auto const failed = std::count_if(results.begin(), results.end(),
+                                              [](auto const& r) { return r.hasException() || r.value().hasError(); });
+            if (failed != 0) {
+                LOGW("traceID={}, failed to delete {} of {} parts in shardID=0x{:x}, left to the scrubber", tid, failed,
+                     results.size(), shard_id);
+            }
+        });
+}
+
+void MultipartUploads::sweep(pg_id_t pg_id, shard_id_t shard_id, ShardScan&& scan) {
+    if (scan.parts.empty()) { return; }
+    auto hs_pg = ho_.get_hs_pg(pg_id);
+    if (hs_pg == nullptr || !hs_pg->repl_dev_->is_leader()) { return; }
+
+    auto const now = now_sec();
+    auto const ttl = HS_BACKEND_DYNAMIC_CONFIG(multipart_upload_ttl_sec);
+    std::vector< blob_id_t > orphans;
+    {
+        std::scoped_lock lock(mtx_);
+        for (auto const& [blob_id, upload_id] : scan.parts) {
+            // an upload younger than the ttl may still be in progress on the leader which created it
+            if (scan.listed.contains(blob_id) || created_sec(upload_id) + ttl > now) { continue; }
+            if (uploads_.contains(upload_id) || completed_.contains(upload_id)) { continue; }
+            orphans.push_back(blob_id);
+        }
+    }
+    if (orphans.empty()) { return; }
+    LOGI("Deleting {} orphan parts of multi-part uploads in shardID=0x{:x}", orphans.size(), shard_id);
+    COUNTER_INCREMENT(metrics_, orphan_parts_collected, orphans.size());
+    drop_parts(shard_id, std::move(orphans));
+}
+
+void MultipartUploads::on_timer() {
+    auto const now = now_sec();
+    auto const ttl = HS_BACKEND_DYNAMIC_CONFIG(multipart_upload_ttl_sec);
+    std::vector< std::pair< shard_id_t, std::vector< blob_id_t > > > expired;
+    {
+        std::scoped_lock lock(mtx_);
+        std::erase_if(completed_, [now, ttl](auto const& c) { return c.second + ttl <= now; });
+        for (auto it = uploads_.begin(); it != uploads_.end();) {
+            if (it->second.completing || created_sec(it->first) + ttl > now) {
+                ++it;
+                continue;
+            }
+            std::vector< blob_id_t > blob_ids;
+            for (auto const& [_, part] : it->second.parts) {
+                blob_ids.push_back(part.blob_id);
+            }
+            LOGI("Multi-part upload {} of shardID=0x{:x} expired, deleting its {} parts", it->first,
+                 it->second.shard_id, blob_ids.size());
+            expired.emplace_back(it->second.shard_id, std::move(blob_ids));
+            it = uploads_.erase(it);
+        }
+        if (!expired.empty()) {
+            COUNTER_INCREMENT(metrics_, uploads_expired, expired.size());
+            GAUGE_UPDATE(metrics_, uploads_in_progress, uploads_.size());
+        }
+    }
+    for (auto& [shard_id, blob_ids] : expired) {
+        drop_parts(shard_id, std::move(blob_ids));
+    }
+}
+
+BlobManager::AsyncResult< upload_id_t > HSHomeObject::_create_upload(ShardInfo const& shard, trace_id_t tid) {
+    if (is_shutting_down()) {
+        LOGI("service is being shut down");
+        return folly::makeUnexpected(BlobErrorCode::SHUTTING_DOWN);
+    }
+    auto hs_pg = get_hs_pg(shard.placement_group);
+    RELEASE_ASSERT(hs_pg, "PG not found, pg={}", shard.placement_group);
+    // the upload lives on this node only, its parts and completion must be proposed here
+    if (!hs_pg->repl_dev_->is_leader()) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::NOT_LEADER, hs_pg->repl_dev_->get_leader_id()));
+    }
+    auto const upload_id = multipart_uploads_->create(shard.id);
+    LOGD("traceID={}, created multi-part upload {} in shardID=0x{:x}", tid, upload_id, shard.id);
+    return upload_id;
+}
+
+BlobManager::AsyncResult< UploadedPart > HSHomeObject::_upload_part(ShardInfo const& shard, upload_id_t upload_id,
+                                                                    uint32_t part_no, sisl::io_blob_safe&& data,
+                                                                    trace_id_t tid, op_deadline_t deadline) {
+    if (part_no > HS_BACKEND_DYNAMIC_CONFIG(multipart_max_parts)) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+    }
+    if (!multipart_uploads_->in_progress(upload_id, shard.id)) {
+        return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+    }
+
+    multipart_part_key const key{.upload_id = upload_id, .part_no = part_no};
+    auto const size = uint32_cast(data.size());
+    Blob part{std::move(data), std::string(r_cast< char const* >(&key), sizeof(key)), 0};
+    return put_blob(shard, std::move(part), DataHeader::data_type_t::MULTIPART_PART, tid, deadline)
+        .deferValue([this, shard_id = shard.id, upload_id, part_no, size,
+                     tid](auto const& result) -> BlobManager::Result< UploadedPart > {
+            if (!result) { return folly::makeUnexpected(result.error()); }
+            auto const& info = result.value();
+            auto added = multipart_uploads_->add_part(upload_id, shard_id, part_no,
+                                                      {.blob_id = info.blob_id, .size = size, .crc = info.payload_crc});
+            if (!added) {
+                // completed or aborted while the part was written
+                multipart_uploads_->drop_parts(shard_id, {info.blob_id}, tid);
+                return folly::makeUnexpected(added.error());
+            }
+            if (auto const replaced = added.value(); replaced) {
+                multipart_uploads_->drop_parts(shard_id, {*replaced}, tid);
+            }
+            return UploadedPart{.part_no = part_no, .size = size, .crc = info.payload_crc};
+        });
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::_complete_upload(ShardInfo const& shard, upload_id_t upload_id,
+                                                                     std::vector< UploadedPart > const& parts,
+                                                                     std::string const& user_key, uint64_t object_off,
+                                                                     trace_id_t tid) {
+    auto claimed = multipart_uploads_->begin_complete(upload_id, shard.id);
+    if (!claimed) { return folly::makeUnexpected(claimed.error()); }
+    auto uploaded = std::move(claimed.value());
+
+    // the manifest lists the given parts as they were written, the other parts of the upload are dropped
+    auto const manifest_size = sizeof(multipart_manifest_header) + parts.size() * sizeof(multipart_manifest_entry);
+    sisl::io_blob_safe manifest(uint32_cast(manifest_size), io_align);
+    multipart_manifest_header header{.upload_id = upload_id, .part_count = uint32_cast(parts.size())};
+    auto entry = r_cast< multipart_manifest_entry* >(manifest.bytes() + sizeof(header));
+    for (auto const& p : parts) {
+        auto it = uploaded.find(p.part_no);
+        if (it == uploaded.end() || it->second.size != p.size || it->second.crc != p.crc) {
+            LOGW("traceID={}, part {} of multi-part upload {} in shardID=0x{:x} does not match what was uploaded",
+                 tid, p.part_no, upload_id, shard.id);
+            multipart_uploads_->end_complete(upload_id, false /* success */, 0);
+            return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+        }
+        *entry++ = multipart_manifest_entry{
+            .part_no = p.part_no, .blob_id = it->second.blob_id, .size = it->second.size, .crc = it->second.crc};
+        header.object_size += p.size;
+        uploaded.erase(it);
+    }
+    std::memcpy(manifest.bytes(), &header, sizeof(header));
+
+    std::vector< blob_id_t > unused;
+    for (auto const& [_, part] : uploaded) {
+        unused.push_back(part.blob_id);
+    }
+    auto const object_size = header.object_size;
+    return put_blob(shard, Blob(std::move(manifest), user_key, object_off), DataHeader::data_type_t::MULTIPART_MANIFEST,
+                    tid, {})
+        .deferValue([this, shard_id = shard.id, upload_id, object_size, unused = std::move(unused),
+                     tid](auto const& result) mutable -> BlobManager::Result< blob_id_t > {
+            if (!result) {
+                multipart_uploads_->end_complete(upload_id, false /* success */, 0);
+                return folly::makeUnexpected(result.error());
+            }
+            multipart_uploads_->end_complete(upload_id, true /* success */, object_size);
+            multipart_uploads_->drop_parts(shard_id, std::move(unused), tid);
+            LOGD("traceID={}, completed multi-part upload {} in shardID=0x{:x} as blob_id={}, object_size={}", tid,
+                 upload_id, shard_id, result.value().blob_id, object_size);
+            return result.value().blob_id;
+        });
+}
+
+BlobManager::NullAsyncResult HSHomeObject::_abort_upload(ShardInfo const& shard, upload_id_t upload_id,
+                                                         trace_id_t tid) {
+    auto removed = multipart_uploads_->remove(upload_id, shard.id);
+    if (!removed) { return folly::makeUnexpected(removed.error()); }
+
+    std::vector< BlobManager::NullAsyncResult > dels;
+    for (auto const& [_, part] : removed.value()) {
+        dels.emplace_back(del(shard.id, part.blob_id, tid, {}));
+    }
+    LOGD("traceID={}, aborting multi-part upload {} in shardID=0x{:x}, deleting its {} parts", tid, upload_id, shard.id,
+         dels.size());
+    return folly::collectAll(std::move(dels)).deferValue([](auto&& results) -> BlobManager::Result< folly::Unit > {
+        for (auto const& r : results) {
+            if (r.hasException()) { return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN)); }
+            if (r.value().hasError()) { return folly::makeUnexpected(r.value().error()); }
+        }
+        return folly::Unit();
+    });
+}
+
+BlobManager::AsyncResult< Blob >
+HSHomeObject::read_multipart(const HS_PG* hs_pg, const shared< homestore::ReplDev >& repl_dev, shard_id_t shard_id,
+                             std::vector< multipart_manifest_entry > const& entries, uint64_t req_offset,
+                             uint64_t req_len, std::string&& user_key, uint64_t object_off, trace_id_t tid,
+                             op_deadline_t deadline) const {
+    uint64_t object_size{0};
+    for (auto const& e : entries) {
+        object_size += e.size;
+    }
+    if (req_offset + req_len > object_size) {
+        LOGE("traceID={}, invalid range requested in multi-part object of shardID=0x{:x}, offset={} len={} size={}",
+             tid, shard_id, req_offset, req_len, object_size);
+        return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+    }
+    auto const res_len = req_len == 0 ? object_size - req_offset : req_len;
+    auto const req_end = req_offset + res_len;
+
+    // read the range of every part overlapping the requested range, they are copied in place once all are read
+    std::vector< BlobManager::AsyncResult< Blob > > reads;
+    std::vector< uint64_t > dest_offsets;
+    uint64_t part_start{0};
+    for (auto const& e : entries) {
+        auto const part_end = part_start + e.size;
+        if (part_end > req_offset && part_start < req_end) {
+            auto const from = std::max(req_offset, part_start);
+            auto const to = std::min(req_end, part_end);
+            incr_pending_request_num(hs_pg);
+            auto r = get_blob_from_index_table(hs_pg->index_table_, shard_id, e.blob_id);
+            if (!r) {
+                LOGE("traceID={}, part {} (blob_id={}) of a multi-part object of shardID=0x{:x} is missing", tid,
+                     e.part_no, e.blob_id, shard_id);
+                decr_pending_request_num(hs_pg);
+                return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+            }
+            reads.emplace_back(_get_blob_data(hs_pg, repl_dev, shard_id, e.blob_id, from - part_start, to - from,
+                                              r.value(), tid, deadline));
+            dest_offsets.push_back(from - req_offset);
+        }
+        part_start = part_end;
+    }
+
+    return folly::collectAll(std::move(reads))
+        .deferValue([res_len, dest_offsets = std::move(dest_offsets), user_key = std::move(user_key), object_off,
+                     leader = repl_dev->get_leader_id()](auto&& results) mutable -> BlobManager::Result< Blob > {
+            auto body = sisl::io_blob_safe(res_len);
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (results[i].hasException()) { return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED)); }
+                auto& part = results[i].value();
+                if (!part) { return folly::makeUnexpected(part.error()); }
+                std::memcpy(body.bytes() + dest_offsets[i], part->body.cbytes(), part->body.size());
+            }
+            return Blob(std::move(body), std::move(user_key), object_off, leader);
+        });
+}
+
+} // namespace homeobject
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <iomgr/iomgr.hpp>
+#include <sisl/metrics/metrics.hpp>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+class HSHomeObject;
+
+/**
+ * Layout of the blobs of a multi-part upload.
+ *
+ * Every part is a blob of the shard of the upload (DataHeader type MULTIPART_PART), its user key is a
+ * multipart_part_key. Completing the upload puts one more blob of the shard, the manifest (type MULTIPART_MANIFEST):
+ * its user key and object offset are the ones of the object, its payload a multipart_manifest_header followed by one
+ * multipart_manifest_entry per part, in object order. The manifest is the object, reading it reads the parts it lists.
+ */
+
+// magic num comes from the first 8 bytes of 'echo homeobject_multipart_manifest | md5sum'
+static constexpr uint64_t MULTIPART_MANIFEST_MAGIC = 0xbd842c0689e0e348;
+static constexpr uint32_t MULTIPART_MANIFEST_VERSION_V1 = 0x01;
+
+#pragma pack(1)
+struct multipart_part_key {
+    upload_id_t upload_id{0};
+    uint32_t part_no{0};
+};
+
+struct multipart_manifest_header {
+    uint64_t magic{MULTIPART_MANIFEST_MAGIC};
+    uint32_t version{MULTIPART_MANIFEST_VERSION_V1};
+    upload_id_t upload_id{0};
+    uint64_t object_size{0};
+    uint32_t part_count{0};
+};
+
+struct multipart_manifest_entry {
+    uint32_t part_no{0};
+    blob_id_t blob_id{0};
+    uint32_t size{0};
+    uint32_t crc{0}; // payload crc of the part blob
+};
+#pragma pack()
+
+// The parts listed by the payload of a manifest blob, nullopt if it is not a well formed manifest.
+std::optional< std::vector< multipart_manifest_entry > > multipart_manifest_entries(uint8_t const* payload,
+                                                                                    size_t size);
+
+/**
+ * The multi-part uploads in progress on this node.
+ *
+ * An upload is only known to the leader which created it, in memory: a part may only be uploaded and the upload
+ * completed there. Uploads neither completed nor aborted within multipart_upload_ttl_sec are aborted by a timer.
+ *
+ * The parts an upload is left with when its leader changes or restarts are found by the scrubber, which hands over
+ * the parts and manifests it reads in each shard (ShardScan) to sweep(): a part older than the ttl which no manifest
+ * of its shard lists and whose upload is not in progress here is deleted. The upload id carries its creation time for
+ * that purpose.
+ */
+class MultipartUploads {
+public:
+    struct UploadMetrics : public sisl::MetricsGroup {
+        UploadMetrics() : sisl::MetricsGroup("multipart_uploads", "node") {
+            REGISTER_GAUGE(uploads_in_progress, "Multi-part uploads created and neither completed nor aborted");
+            REGISTER_COUNTER(parts_uploaded, "Parts written by multi-part uploads");
+            REGISTER_COUNTER(part_bytes_uploaded, "Bytes of the parts written by multi-part uploads");
+            REGISTER_COUNTER(uploads_completed, "Multi-part uploads completed into an object");
+            REGISTER_COUNTER(uploads_aborted, "Multi-part uploads aborted by the client");
+            REGISTER_COUNTER(uploads_expired, "Multi-part uploads aborted because they were not completed in time");
+            REGISTER_COUNTER(orphan_parts_collected, "Parts of lost uploads found and deleted");
+            REGISTER_HISTOGRAM(upload_ingest_throughput,
+                               "Object size over time from create to complete of multi-part uploads (MB/s)",
+                               HistogramBucketsType(DefaultBuckets));
+            register_me_to_farm();
+        }
+        ~UploadMetrics() { deregister_me_from_farm(); }
+        UploadMetrics(const UploadMetrics&) = delete;
+        UploadMetrics(UploadMetrics&&) noexcept = delete;
+        UploadMetrics& operator=(const UploadMetrics&) = delete;
+        UploadMetrics& operator=(UploadMetrics&&) noexcept = delete;
+    };
+
+    struct Part {
+        blob_id_t blob_id;
+        uint32_t size;
+        uint32_t crc;
+    };
+    using PartMap = std::map< uint32_t, Part >;
+
+    // What the scrubber read of the multi-part uploads in a shard
+    struct ShardScan {
+        std::vector< std::pair< blob_id_t, upload_id_t > > parts;
+        std::unordered_set< blob_id_t > listed; // by a manifest
+
+        // Take note of the blob if it is a part or a manifest, image is the blob as read from disk
+        void observe(blob_id_t blob_id, uint8_t const* image, size_t size);
+    };
+
+    explicit MultipartUploads(HSHomeObject& ho) : ho_(ho) {}
+    ~MultipartUploads();
+    MultipartUploads(const MultipartUploads&) = delete;
+    MultipartUploads(MultipartUploads&&) = delete;
+    MultipartUploads& operator=(const MultipartUploads&) = delete;
+    MultipartUploads& operator=(MultipartUploads&&) = delete;
+
+    void start();
+    void stop();
+
+    upload_id_t create(shard_id_t shard_id);
+    bool in_progress(upload_id_t upload_id, shard_id_t shard_id) const;
+    /**
+     * @brief Record a part once its blob is written.
+     *
+     * @return The blob of the part it replaces if any, UNKNOWN_UPLOAD if the upload is no longer in progress, in which
+     * case the part is left to the caller.
+     */
+    BlobManager::Result< std::optional< blob_id_t > > add_part(upload_id_t upload_id, shard_id_t shard_id,
+                                                               uint32_t part_no, Part const& part);
+    // Claim the upload for completion, no part may be added to it or it be aborted until end_complete().
+    BlobManager::Result< PartMap > begin_complete(upload_id_t upload_id, shard_id_t shard_id);
+    void end_complete(upload_id_t upload_id, bool success, uint64_t object_size);
+    // Forget the upload and return its parts, for the caller to delete them.
+    BlobManager::Result< PartMap > remove(upload_id_t upload_id, shard_id_t shard_id);
+
+    // Delete the blobs of the parts, in the background.
+    void drop_parts(shard_id_t shard_id, std::vector< blob_id_t > blob_ids, trace_id_t tid = 0);
+    // Delete the orphan parts of the shard found by the scrubber, on the leader of its pg only.
+    void sweep(pg_id_t pg_id, shard_id_t shard_id, ShardScan&& scan);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr uint32_t upload_id_seq_bits{24};
+
+    struct Upload {
+        shard_id_t shard_id;
+        Clock::time_point created;
+        PartMap parts;
+        bool completing{false};
+    };
+
+    static uint64_t created_sec(upload_id_t upload_id) { return upload_id >> upload_id_seq_bits; }
+    void on_timer();
+
+    HSHomeObject& ho_;
+    iomgr::timer_handle_t timer_hdl_{iomgr::null_timer_handle};
+
+    mutable std::mutex mtx_;
+    std::unordered_map< upload_id_t, Upload > uploads_;
+    // completed recently, with the time they completed at, so that sweep() leaves their parts alone
+    std::unordered_map< upload_id_t, uint64_t > completed_;
+    uint32_t next_seq_{0}; // starts at random, so that the ids of different leaders hardly ever collide
+
+    UploadMetrics metrics_;
+};
+
+} // namespace homeobject
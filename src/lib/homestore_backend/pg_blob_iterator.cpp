@@ -20,6 +20,12 @@ HSHomeObject::PGBlobIterator::PGBlobIterator(HSHomeObject& home_obj, homestore::
     metrics_ = make_unique< DonerSnapshotMetrics >(pg_id_);
     max_batch_size_ = HS_BACKEND_DYNAMIC_CONFIG(max_snapshot_batch_size_mb) * Mi;
     if (max_batch_size_ == 0) { max_batch_size_ = DEFAULT_MAX_BATCH_SIZE_MB * Mi; }
+    // start small and let the round trips of the first batches tell how big a batch should be
+    batch_bytes_budget_ = std::min(max_batch_size_, HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_min_size_kb) * Ki);
+    if (HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_target_latency_ms) == 0) {
+        batch_bytes_budget_ = max_batch_size_;
+        batch_blobs_budget_ = std::max(min_batch_blobs, HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_max_blobs));
+    }
 
     if (upto_lsn != 0) {
         // Iterate all shards and its blobs which have lsn <= upto_lsn
@@ -39,11 +45,16 @@ HSHomeObject::PGBlobIterator::PGBlobIterator(HSHomeObject& home_obj, homestore::
 // result represents if the objId is valid and the cursors are updated
 bool HSHomeObject::PGBlobIterator::update_cursor(objId id) {
     if (cur_batch_start_time_ != Clock::time_point{}) {
-        HISTOGRAM_OBSERVE(*metrics_, snp_dnr_batch_e2e_latency, get_elapsed_time_us(cur_batch_start_time_));
+        auto const e2e_us = get_elapsed_time_us(cur_batch_start_time_);
+        HISTOGRAM_OBSERVE(*metrics_, snp_dnr_batch_e2e_latency, e2e_us);
+        if (last_batch_blobs_ != 0) { adapt_batch_budget(e2e_us, id.value == cur_obj_id_.value); }
     }
+    last_batch_bytes_ = 0;
+    last_batch_blobs_ = 0;
     cur_batch_start_time_ = Clock::now();
 
     if (id.value == LAST_OBJ_ID) { return true; }
+    if (is_seek_obj_id(id.value)) { return seek_blob(seek_obj_blob_id(id.value)); }
     // resend batch
     if (id.value == cur_obj_id_.value) {
         LOGT("resend the same batch, objId={}, cur_obj_id={}", id.to_string(), cur_obj_id_.to_string());
@@ -51,10 +62,12 @@ bool HSHomeObject::PGBlobIterator::update_cursor(objId id) {
         return true;
     }
 
-    // If cur_obj_id_ == 0|0 (PG meta), this may be a request for resuming from specific shard
-    if (cur_obj_id_.shard_seq_num == 0 && id.shard_seq_num != 0 && id.batch_id == 0) {
+    // If cur_obj_id_ == 0|0 (PG meta), this may be a request for resuming from specific shard. Otherwise a shard
+    // metadata request may also skip ahead over the shards a returning follower already has (delta resync).
+    if (id.shard_seq_num != 0 && id.batch_id == 0 &&
+        (cur_obj_id_.shard_seq_num == 0 || id.value != expected_next_obj_id().value)) {
         bool found = false;
-        for (size_t i = 0; i < shard_list_.size(); i++) {
+        for (size_t i = cur_shard_idx_ < 0 ? 0 : cur_shard_idx_ + 1; i < shard_list_.size(); i++) {
             if (get_sequence_num_from_shard_id(shard_list_[i].info.id) == id.shard_seq_num) {
                 found = true;
                 cur_shard_idx_ = i;
@@ -86,6 +99,23 @@ bool HSHomeObject::PGBlobIterator::update_cursor(objId id) {
     return true;
 }
 
+bool HSHomeObject::PGBlobIterator::seek_blob(blob_id_t after_blob_id) {
+    // The blob list of the shard is generated along with its metadata message, which always comes before a seek
+    if (cur_shard_idx_ < 0 || cur_obj_id_.shard_seq_num == 0) {
+        LOGE("seek after blob_id={} without a current shard, cur_obj_id={}", after_blob_id, cur_obj_id_.to_string());
+        return false;
+    }
+    // the blob list is in blob_id order
+    auto it = std::upper_bound(cur_blob_list_.begin(), cur_blob_list_.end(), after_blob_id,
+                               [](blob_id_t id, BlobInfo const& info) { return id < info.blob_id; });
+    cur_start_blob_idx_ = static_cast< uint64_t >(std::distance(cur_blob_list_.begin(), it));
+    cur_batch_blob_count_ = 0;
+    cur_obj_id_ = objId(cur_obj_id_.shard_seq_num, 1);
+    LOGI("seek shard_seq_num={} after blob_id={}, skipping {} of {} blobs", cur_obj_id_.shard_seq_num, after_blob_id,
+         cur_start_blob_idx_, cur_blob_list_.size());
+    return true;
+}
+
 void HSHomeObject::PGBlobIterator::reset_cursor() {
     cur_obj_id_ = {0, 0};
     cur_shard_idx_ = -1;
@@ -153,9 +183,27 @@ bool HSHomeObject::PGBlobIterator::create_pg_snapshot_data(sisl::io_blob_safe& m
         shard_ids.push_back(shard.info.id);
     }
 
+    // Let a follower which still holds the pg tell which shards it already has, see delta resync
+    std::vector< ::flatbuffers::Offset< homeobject::ShardDigest > > shard_digests;
+    if (HS_BACKEND_DYNAMIC_CONFIG(snapshot_delta_resync_enabled)) {
+        for (auto& shard : shard_list_) {
+            auto d = home_obj_.compute_shard_summary(pg_id_, shard.info.id);
+            if (!d) {
+                LOGW("Failed to compute digest of shardID=0x{:x}, pg={}, leader will not offer delta resync",
+                     shard.info.id, pg_id_);
+                shard_digests.clear();
+                break;
+            }
+            shard_digests.push_back(CreateShardDigestDirect(builder_, shard.info.id,
+                                                            static_cast< uint8_t >(shard.info.state), d->blob_count,
+                                                            d->total_bytes, d->digest, &d->checkpoint_blob_ids,
+                                                            &d->checkpoint_digests));
+        }
+    }
+
     auto pg_entry = CreateResyncPGMetaDataDirect(builder_, pg_info.id, &uuid, pg_info.size, pg_info.chunk_size,
                                                  pg->durable_entities().blob_sequence_num, pg->shard_sequence_num_,
-                                                 &members, &shard_ids, total_blobs, total_bytes);
+                                                 &members, &shard_ids, total_blobs, total_bytes, &shard_digests);
     builder_.FinishSizePrefixed(pg_entry);
 
     pack_resync_message(meta_blob, SyncMessageType::PG_META);
@@ -201,14 +249,19 @@ BlobManager::AsyncResult< blob_read_result > HSHomeObject::PGBlobIterator::load_
 
     LOGD("Blob get request: shardID=0x{:x}, pg={}, shard=0x{:x}, blob_id={}, blkid={}", shard_id,
          (shard_id >> homeobject::shard_width), (shard_id & homeobject::shard_mask), blob_id, blkid.to_string());
-    return repl_dev_->async_read(blkid, sgs, total_size)
+    // resync reads are background io, they must not starve the client io of this and the other pgs
+    auto read_done = home_obj_.issue_data_io(pg_id_, PGIoScheduler::io_type::READ, PGIoScheduler::io_class::BACKGROUND,
+                                             total_size, [repl_dev = repl_dev_, blkid, sgs, total_size]() {
+                                                 return repl_dev->async_read(blkid, sgs, total_size);
+                                             });
+    return std::move(read_done)
         .thenValue([this, blob_id, shard_id, read_buf = std::move(read_buf)](auto&& result) mutable
                        -> BlobManager::AsyncResult< HSHomeObject::PGBlobIterator::blob_read_result > {
             if (result) {
                 LOGE("Failed to get blob, shardID=0x{:x}, pg={}, shard=0x{:x}, blob_id={}, err={}", shard_id,
                      (shard_id >> homeobject::shard_width), (shard_id & homeobject::shard_mask), blob_id,
                      result.value());
-                return folly::makeUnexpected(BlobError(BlobErrorCode::READ_FAILED));
+                return folly::makeUnexpected(data_io_error(result));
             }
 
             BlobHeader const* header = r_cast< BlobHeader const* >(read_buf.cbytes());
@@ -262,7 +315,8 @@ bool HSHomeObject::PGBlobIterator::create_blobs_snapshot_data(sisl::io_blob_safe
     std::vector< BlobManager::AsyncResult< blob_read_result > > futs;
     auto total_blobs = 0;
     auto skipped_blobs = 0;
-    while (total_bytes < max_batch_size_ && idx < cur_blob_list_.size()) {
+    auto const bytes_limit = std::min(batch_bytes_budget_, max_batch_size_);
+    while (total_bytes < bytes_limit && uint64_t(total_blobs) < batch_blobs_budget_ && idx < cur_blob_list_.size()) {
         auto info = cur_blob_list_[idx++];
         total_blobs++;
         // handle deleted object
@@ -338,6 +392,9 @@ bool HSHomeObject::PGBlobIterator::create_blobs_snapshot_data(sisl::io_blob_safe
     // should include the deleted blobs
     cur_batch_blob_count_ = idx - cur_start_blob_idx_;
     if (idx == cur_blob_list_.size()) { end_of_shard = true; }
+    last_batch_bytes_ = total_bytes;
+    last_batch_blobs_ = cur_batch_blob_count_;
+    last_batch_full_ = !end_of_shard;
     builder_.FinishSizePrefixed(CreateResyncBlobDataBatchDirect(builder_, &blob_entries, end_of_shard));
 
     LOGD("create blobs snapshot data batch: shard_seq_num={}, batch_num={}, total_bytes={}, blob_num={}, "
@@ -351,6 +408,31 @@ bool HSHomeObject::PGBlobIterator::create_blobs_snapshot_data(sisl::io_blob_safe
     return true;
 }
 
+void HSHomeObject::PGBlobIterator::adapt_batch_budget(uint64_t e2e_us, bool resend) {
+    auto const target_us = HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_target_latency_ms) * 1000;
+    auto const max_blobs = std::max(min_batch_blobs, HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_max_blobs));
+    if (target_us == 0) {
+        batch_bytes_budget_ = max_batch_size_;
+        batch_blobs_budget_ = max_blobs;
+    } else {
+        // Scale towards the target round trip, by at most a factor of 2 per batch. Only grow on batches which were cut
+        // by a budget, a short batch at the end of a shard says nothing about a bigger one.
+        auto ratio = resend ? 0.5 : std::clamp(double(target_us) / std::max(e2e_us, uint64_t{1}), 0.5, 2.0);
+        if (!last_batch_full_) { ratio = std::min(ratio, 1.0); }
+        auto scale = [ratio](uint64_t budget, uint64_t last) {
+            // shrink from what was actually sent, the budget which was not hit may be far above it
+            return static_cast< uint64_t >(double(ratio < 1.0 ? std::min(budget, last) : budget) * ratio);
+        };
+        auto const min_bytes = std::min(max_batch_size_, HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_min_size_kb) * Ki);
+        batch_bytes_budget_ = std::clamp(scale(batch_bytes_budget_, last_batch_bytes_), min_bytes, max_batch_size_);
+        batch_blobs_budget_ = std::clamp(scale(batch_blobs_budget_, last_batch_blobs_), min_batch_blobs, max_blobs);
+    }
+    LOGD("batch budget of pg={} is now bytes={} blobs={}, last batch bytes={} blobs={} e2e_us={} resend={}", pg_id_,
+         batch_bytes_budget_, batch_blobs_budget_, last_batch_bytes_, last_batch_blobs_, e2e_us, resend);
+    GAUGE_UPDATE(*metrics_, snp_dnr_batch_size_bytes, batch_bytes_budget_);
+    GAUGE_UPDATE(*metrics_, snp_dnr_batch_size_blobs, batch_blobs_budget_);
+}
+
 void HSHomeObject::PGBlobIterator::pack_resync_message(sisl::io_blob_safe& dest_blob, SyncMessageType type) {
     SyncMessageHeader header;
     header.msg_type = type;
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "pg_io_scheduler.hpp"
+#include "hs_backend_config.hpp"
+
+namespace homeobject {
+
+// Token buckets hold at most this much of their rate, i.e. the burst an idle pg / node may issue at once.
+static constexpr double qos_burst_sec{0.1};
+// An io costs one unit plus one per this many bytes when computing the fair share.
+static constexpr double qos_cost_unit_bytes{64 * Ki};
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool PGIoScheduler::TokenBucket::available(uint64_t rate, int64_t now) {
+    if (rate == 0) { return true; }
+    auto const burst = std::max(1.0, rate * qos_burst_sec);
+    if (last_refill_ns == 0) {
+        tokens = burst;
+    } else {
+        tokens = std::min(burst, tokens + (now - last_refill_ns) * double(rate) / 1e9);
+    }
+    last_refill_ns = now;
+    return tokens > 0;
+}
+
+void PGIoScheduler::TokenBucket::consume(uint64_t rate, double n) {
+    // going into debt is fine, it is paid back before the next io gets through
+    if (rate != 0) { tokens -= n; }
+}
+
+PGIoScheduler::PGIoScheduler() : metrics_{*this} {}
+
+PGIoScheduler::~PGIoScheduler() { stop(); }
+
+void PGIoScheduler::start() {
+    auto const interval_us = std::max(uint64_t{100}, HS_BACKEND_DYNAMIC_CONFIG(io_qos_dispatch_interval_us));
+    dispatch_timer_hdl_ = iomanager.schedule_global_timer(
+        interval_us * 1000, true, nullptr /*cookie*/, iomgr::reactor_regex::all_user, [this](void*) { dispatch(); },
+        true /* wait_to_schedule */);
+    LOGINFO("pg io scheduler has started, dispatch interval is {} us, enabled={}", interval_us,
+            HS_BACKEND_DYNAMIC_CONFIG(io_qos_enabled));
+}
+
+void PGIoScheduler::stop() {
+    if (dispatch_timer_hdl_ != iomgr::null_timer_handle) {
+        iomanager.cancel_timer(dispatch_timer_hdl_, true);
+        dispatch_timer_hdl_ = iomgr::null_timer_handle;
+    }
+
+    std::vector< folly::Promise< folly::Unit > > released;
+    for (auto& lane : lanes_) {
+        std::scoped_lock lock(lane.mtx);
+        for (auto& [_, pl] : lane.pgs) {
+            for (auto& flow : pl.flows) {
+                for (auto& p : flow.queue) {
+                    released.emplace_back(std::move(p.promise));
+                }
+                flow.queue.clear();
+            }
+        }
+        lane.queued = 0;
+    }
+    for (auto& p : released) {
+        p.setValue();
+    }
+}
+
+std::optional< folly::SemiFuture< folly::Unit > > PGIoScheduler::admit(pg_id_t pg_id, io_type type, io_class cls,
+                                                                       uint64_t bytes) {
+    if (!HS_BACKEND_DYNAMIC_CONFIG(io_qos_enabled)) { return std::nullopt; }
+
+    auto& lane = lanes_[static_cast< size_t >(type)];
+    std::unique_lock lock(lane.mtx);
+    auto const now = now_ns();
+    auto& pl = get_pg_lane(lane, pg_id);
+    auto& flow = pl.flows[static_cast< size_t >(cls)];
+
+    // nothing is waiting in the lane, so going first does not overtake anyone, of this pg or any other
+    if (lane.queued == 0 && node_available(lane, type, now) && pg_available(pl, type, now)) {
+        charge(lane, pl, type, bytes);
+        lock.unlock();
+        COUNTER_INCREMENT(metrics_, qos_admitted_inline, 1);
+        return std::nullopt;
+    }
+
+    auto const start_tag = std::max(lane.virtual_time, flow.last_finish_tag);
+    flow.last_finish_tag = start_tag + (1.0 + bytes / qos_cost_unit_bytes) / flow_weight(pl, cls);
+    auto [promise, future] = folly::makePromiseContract< folly::Unit >();
+    flow.queue.push_back(Pending{bytes, start_tag, now, std::move(promise)});
+    ++lane.queued;
+    return std::move(future);
+}
+
+void PGIoScheduler::dispatch() {
+    dispatch(io_type::READ);
+    dispatch(io_type::WRITE);
+}
+
+void PGIoScheduler::dispatch(io_type type) {
+    auto& lane = lanes_[static_cast< size_t >(type)];
+    std::vector< folly::Promise< folly::Unit > > admitted;
+    {
+        std::scoped_lock lock(lane.mtx);
+        if (lane.queued == 0) { return; }
+        auto const enabled = HS_BACKEND_DYNAMIC_CONFIG(io_qos_enabled);
+        auto const now = now_ns();
+        while (lane.queued != 0) {
+            // qos turned off on the fly, let everything through
+            if (enabled && !node_available(lane, type, now)) { break; }
+
+            // pick the head with the smallest start tag among the pgs within their own limits
+            PGLane* best_pl{nullptr};
+            Flow* best_flow{nullptr};
+            for (auto& [_, pl] : lane.pgs) {
+                if (std::all_of(pl.flows.begin(), pl.flows.end(), [](auto const& f) { return f.queue.empty(); })) {
+                    continue;
+                }
+                if (enabled && !pg_available(pl, type, now)) { continue; }
+                for (auto& flow : pl.flows) {
+                    if (!flow.queue.empty() &&
+                        (!best_flow || flow.queue.front().start_tag < best_flow->queue.front().start_tag)) {
+                        best_pl = &pl;
+                        best_flow = &flow;
+                    }
+                }
+            }
+            if (!best_flow) { break; }
+
+            auto p = std::move(best_flow->queue.front());
+            best_flow->queue.pop_front();
+            --lane.queued;
+            lane.virtual_time = std::max(lane.virtual_time, p.start_tag);
+            charge(lane, *best_pl, type, p.bytes);
+            HISTOGRAM_OBSERVE(metrics_, qos_queue_wait_us, (now - p.enqueue_ns) / 1000);
+            admitted.emplace_back(std::move(p.promise));
+        }
+    }
+
+    // the continuations may issue the io inline, do not hold the lane meanwhile
+    COUNTER_INCREMENT(metrics_, qos_admitted_queued, admitted.size());
+    for (auto& p : admitted) {
+        p.setValue();
+    }
+}
+
+void PGIoScheduler::set_pg_qos(pg_id_t pg_id, PGQoS const& qos) {
+    {
+        std::scoped_lock lock(qos_mtx_);
+        pg_qos_[pg_id] = qos;
+    }
+    for (auto& lane : lanes_) {
+        std::scoped_lock lock(lane.mtx);
+        if (auto it = lane.pgs.find(pg_id); it != lane.pgs.end()) { it->second.qos = qos; }
+    }
+    LOGINFO("set io qos of pg={}: weight={}, read_iops={}, write_iops={}, read_mbps={}, write_mbps={}", pg_id,
+            qos.weight, qos.read_iops, qos.write_iops, qos.read_mbps, qos.write_mbps);
+}
+
+PGIoScheduler::PGQoS PGIoScheduler::get_pg_qos(pg_id_t pg_id) const {
+    std::scoped_lock lock(qos_mtx_);
+    auto it = pg_qos_.find(pg_id);
+    return it == pg_qos_.end() ? PGQoS{} : it->second;
+}
+
+void PGIoScheduler::remove_pg(pg_id_t pg_id) {
+    std::vector< folly::Promise< folly::Unit > > released;
+    for (auto& lane : lanes_) {
+        std::scoped_lock lock(lane.mtx);
+        auto it = lane.pgs.find(pg_id);
+        if (it == lane.pgs.end()) { continue; }
+        for (auto& flow : it->second.flows) {
+            for (auto& p : flow.queue) {
+                released.emplace_back(std::move(p.promise));
+            }
+            lane.queued -= flow.queue.size();
+        }
+        lane.pgs.erase(it);
+    }
+    {
+        std::scoped_lock lock(qos_mtx_);
+        pg_qos_.erase(pg_id);
+    }
+    // the pg is gone, its ios must not be issued
+    for (auto& p : released) {
+        p.setException(std::system_error(pg_removed_error()));
+    }
+}
+
+uint64_t PGIoScheduler::queued(io_type type) const {
+    auto const& lane = lanes_[static_cast< size_t >(type)];
+    std::scoped_lock lock(lane.mtx);
+    return lane.queued;
+}
+
+nlohmann::json PGIoScheduler::dump() const {
+    nlohmann::json j;
+    j["enabled"] = HS_BACKEND_DYNAMIC_CONFIG(io_qos_enabled);
+    j["node"] = {{"read_iops", HS_BACKEND_DYNAMIC_CONFIG(io_qos_read_iops)},
+                 {"write_iops", HS_BACKEND_DYNAMIC_CONFIG(io_qos_write_iops)},
+                 {"read_mbps", HS_BACKEND_DYNAMIC_CONFIG(io_qos_read_mbps)},
+                 {"write_mbps", HS_BACKEND_DYNAMIC_CONFIG(io_qos_write_mbps)},
+                 {"default_pg_weight", HS_BACKEND_DYNAMIC_CONFIG(io_qos_default_pg_weight)},
+                 {"background_weight_pct", HS_BACKEND_DYNAMIC_CONFIG(io_qos_background_weight_pct)}};
+
+    nlohmann::json pgs = nlohmann::json::object();
+    {
+        std::scoped_lock lock(qos_mtx_);
+        for (auto const& [pg_id, qos] : pg_qos_) {
+            pgs[std::to_string(pg_id)] = {{"weight", qos.weight},         {"read_iops", qos.read_iops},
+                                          {"write_iops", qos.write_iops}, {"read_mbps", qos.read_mbps},
+                                          {"write_mbps", qos.write_mbps}};
+        }
+    }
+    j["pgs"] = std::move(pgs);
+    j["queued_reads"] = queued(io_type::READ);
+    j["queued_writes"] = queued(io_type::WRITE);
+    return j;
+}
+
+// NOTE: caller should hold lane.mtx
+PGIoScheduler::PGLane& PGIoScheduler::get_pg_lane(Lane& lane, pg_id_t pg_id) {
+    auto it = lane.pgs.find(pg_id);
+    if (it != lane.pgs.end()) { return it->second; }
+    auto& pl = lane.pgs[pg_id];
+    pl.qos = get_pg_qos(pg_id);
+    return pl;
+}
+
+// NOTE: caller should hold lane.mtx
+bool PGIoScheduler::node_available(Lane& lane, io_type type, int64_t now) {
+    auto const read = (type == io_type::READ);
+    auto const iops = read ? HS_BACKEND_DYNAMIC_CONFIG(io_qos_read_iops) : HS_BACKEND_DYNAMIC_CONFIG(io_qos_write_iops);
+    auto const mbps = read ? HS_BACKEND_DYNAMIC_CONFIG(io_qos_read_mbps) : HS_BACKEND_DYNAMIC_CONFIG(io_qos_write_mbps);
+    // evaluate both so that both buckets get refilled
+    auto const iops_ok = lane.node_iops.available(iops, now);
+    auto const bytes_ok = lane.node_bytes.available(mbps * Mi, now);
+    return iops_ok && bytes_ok;
+}
+
+// NOTE: caller should hold the lane lock
+bool PGIoScheduler::pg_available(PGLane& pl, io_type type, int64_t now) {
+    auto const read = (type == io_type::READ);
+    auto const iops_ok = pl.iops.available(read ? pl.qos.read_iops : pl.qos.write_iops, now);
+    auto const bytes_ok = pl.bytes.available((read ? pl.qos.read_mbps : pl.qos.write_mbps) * Mi, now);
+    return iops_ok && bytes_ok;
+}
+
+// NOTE: caller should hold lane.mtx
+void PGIoScheduler::charge(Lane& lane, PGLane& pl, io_type type, uint64_t bytes) {
+    auto const read = (type == io_type::READ);
+    lane.node_iops.consume(read ? HS_BACKEND_DYNAMIC_CONFIG(io_qos_read_iops)
+                                : HS_BACKEND_DYNAMIC_CONFIG(io_qos_write_iops),
+                           1);
+    lane.node_bytes.consume((read ? HS_BACKEND_DYNAMIC_CONFIG(io_qos_read_mbps)
+                                  : HS_BACKEND_DYNAMIC_CONFIG(io_qos_write_mbps)) *
+                                Mi,
+                            bytes);
+    pl.iops.consume(read ? pl.qos.read_iops : pl.qos.write_iops, 1);
+    pl.bytes.consume((read ? pl.qos.read_mbps : pl.qos.write_mbps) * Mi, bytes);
+}
+
+double PGIoScheduler::flow_weight(PGLane const& pl, io_class cls) {
+    double weight = pl.qos.weight ? pl.qos.weight : HS_BACKEND_DYNAMIC_CONFIG(io_qos_default_pg_weight);
+    if (cls == io_class::BACKGROUND) {
+        weight = weight * HS_BACKEND_DYNAMIC_CONFIG(io_qos_background_weight_pct) / 100;
+    }
+    return std::max(weight, 1.0);
+}
+
+} // namespace homeobject
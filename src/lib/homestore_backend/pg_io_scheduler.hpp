@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <unordered_map>
+
+#include <folly/futures/Future.h>
+#include <iomgr/iomgr.hpp>
+#include <nlohmann/json.hpp>
+#include <sisl/metrics/metrics.hpp>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+/**
+ * Admission control of the data io issued on behalf of the pgs of this node.
+ *
+ * Reads and writes are scheduled independently, each through a node wide iops / bandwidth budget (io_qos_* in
+ * hs_backend_config) shared between the pgs in proportion to their weight with start time fair queueing. A pg can
+ * additionally be capped with its own iops / bandwidth limits. Every pg has a foreground (client) and a background
+ * (resync, ...) flow, the background flow weighs io_qos_background_weight_pct percent of its pg, so it makes progress
+ * but yields to client io.
+ *
+ * An io which is within budget and has nothing queued ahead of it in its lane is admitted inline. Otherwise it waits
+ * for the dispatcher, which runs every io_qos_dispatch_interval_us. Budgets are token buckets which may go into debt,
+ * so an io bigger than the burst size is never stuck. With io_qos_enabled off, everything is admitted inline.
+ */
+class PGIoScheduler {
+public:
+    enum class io_type : uint8_t { READ = 0, WRITE = 1 };
+    enum class io_class : uint8_t { FOREGROUND = 0, BACKGROUND = 1 };
+
+    // Per pg settings, a limit of 0 means unlimited.
+    struct PGQoS {
+        uint32_t weight{0}; // 0 means io_qos_default_pg_weight
+        uint64_t read_iops{0};
+        uint64_t write_iops{0};
+        uint64_t read_mbps{0};
+        uint64_t write_mbps{0};
+    };
+
+    struct PGIoSchedulerMetrics : public sisl::MetricsGroup {
+        explicit PGIoSchedulerMetrics(PGIoScheduler const& sched) :
+                sisl::MetricsGroup("pg_io_scheduler", "node"), sched_{sched} {
+            REGISTER_COUNTER(qos_admitted_inline, "IOs admitted without waiting");
+            REGISTER_COUNTER(qos_admitted_queued, "IOs admitted after waiting in the scheduler");
+            REGISTER_GAUGE(qos_queued_reads, "Reads currently waiting in the scheduler");
+            REGISTER_GAUGE(qos_queued_writes, "Writes currently waiting in the scheduler");
+            REGISTER_HISTOGRAM(qos_queue_wait_us, "Time spent by an io waiting in the scheduler",
+                               HistogramBucketsType(DefaultBuckets));
+            register_me_to_farm();
+            attach_gather_cb(std::bind(&PGIoSchedulerMetrics::on_gather, this));
+        }
+        ~PGIoSchedulerMetrics() { deregister_me_from_farm(); }
+        PGIoSchedulerMetrics(const PGIoSchedulerMetrics&) = delete;
+        PGIoSchedulerMetrics(PGIoSchedulerMetrics&&) noexcept = delete;
+        PGIoSchedulerMetrics& operator=(const PGIoSchedulerMetrics&) = delete;
+        PGIoSchedulerMetrics& operator=(PGIoSchedulerMetrics&&) noexcept = delete;
+
+        void on_gather() {
+            GAUGE_UPDATE(*this, qos_queued_reads, sched_.queued(io_type::READ));
+            GAUGE_UPDATE(*this, qos_queued_writes, sched_.queued(io_type::WRITE));
+        }
+
+    private:
+        PGIoScheduler const& sched_;
+    };
+
+    PGIoScheduler();
+    ~PGIoScheduler();
+    PGIoScheduler(const PGIoScheduler&) = delete;
+    PGIoScheduler(PGIoScheduler&&) = delete;
+    PGIoScheduler& operator=(const PGIoScheduler&) = delete;
+    PGIoScheduler& operator=(PGIoScheduler&&) = delete;
+
+    void start();
+
+    // Stop the dispatcher and admit whatever is still waiting.
+    void stop();
+
+    /**
+     * @brief Ask for the permission to issue an io of the given size.
+     *
+     * @return std::nullopt if the io can be issued right away, otherwise a future fulfilled once it is its turn.
+     */
+    std::optional< folly::SemiFuture< folly::Unit > > admit(pg_id_t pg_id, io_type type, io_class cls, uint64_t bytes);
+
+    void set_pg_qos(pg_id_t pg_id, PGQoS const& qos);
+    PGQoS get_pg_qos(pg_id_t pg_id) const;
+
+    // Forget the pg, anything it still has queued fails with pg_removed_error().
+    void remove_pg(pg_id_t pg_id);
+
+    // The error the ios still queued for a pg are failed with when the pg is removed
+    static std::error_code pg_removed_error() { return std::make_error_code(std::errc::no_such_device); }
+
+    uint64_t queued(io_type type) const;
+    nlohmann::json dump() const;
+
+private:
+    struct TokenBucket {
+        double tokens{0};
+        int64_t last_refill_ns{0};
+
+        // rate is per second, 0 means unlimited
+        bool available(uint64_t rate, int64_t now_ns);
+        void consume(uint64_t rate, double n);
+    };
+
+    struct Pending {
+        uint64_t bytes;
+        double start_tag;
+        int64_t enqueue_ns;
+        folly::Promise< folly::Unit > promise;
+    };
+
+    struct Flow {
+        std::deque< Pending > queue;
+        double last_finish_tag{0};
+    };
+
+    struct PGLane {
+        PGQoS qos;
+        TokenBucket iops;
+        TokenBucket bytes;
+        std::array< Flow, 2 > flows; // indexed by io_class
+    };
+
+    struct Lane {
+        mutable std::mutex mtx;
+        TokenBucket node_iops;
+        TokenBucket node_bytes;
+        std::unordered_map< pg_id_t, PGLane > pgs;
+        double virtual_time{0};
+        uint64_t queued{0};
+    };
+
+    static bool node_available(Lane& lane, io_type type, int64_t now_ns);
+    static bool pg_available(PGLane& pl, io_type type, int64_t now_ns);
+    static void charge(Lane& lane, PGLane& pl, io_type type, uint64_t bytes);
+    static double flow_weight(PGLane const& pl, io_class cls);
+    PGLane& get_pg_lane(Lane& lane, pg_id_t pg_id);
+    void dispatch();
+    void dispatch(io_type type);
+
+    std::array< Lane, 2 > lanes_; // indexed by io_type
+
+    // The settings of the pgs, copied into their lanes. May be taken with a lane lock held, never the other way round.
+    mutable std::mutex qos_mtx_;
+    std::unordered_map< pg_id_t, PGQoS > pg_qos_;
+
+    iomgr::timer_handle_t dispatch_timer_hdl_{iomgr::null_timer_handle};
+    PGIoSchedulerMetrics metrics_;
+};
+
+} // namespace homeobject
@@ -0,0 +1,85 @@
+#include "recent_write_cache.hpp"
+#include "hs_backend_config.hpp"
+#include "hs_homeobject.hpp"
+
+namespace homeobject {
+
+RecentWriteCache::RecentWriteCache() : metrics_{*this} {}
+
+void RecentWriteCache::put(BlobRoute const& route, homestore::MultiBlkId const& blkid, BlobImageRef const& image) {
+    auto const capacity = HS_BACKEND_DYNAMIC_CONFIG(recent_write_cache_size_mb) * Mi;
+    auto const size = image.charge();
+    if (image.sgs.size == 0 || size > capacity) {
+        // cache disabled (or shrunk to 0 on the fly) or payload can never fit
+        if (capacity == 0) {
+            std::scoped_lock lock(mtx_);
+            evict_to(0);
+        }
+        return;
+    }
+
+    std::scoped_lock lock(mtx_);
+    if (auto it = entries_.find(route); it != entries_.end()) { erase_unlocked(it); }
+    evict_to(capacity - size);
+    fifo_.push_back(route);
+    entries_.emplace(route, Entry{blkid, image, std::prev(fifo_.end())});
+    cached_bytes_ += size;
+}
+
+bool RecentWriteCache::get(BlobRoute const& route, homestore::MultiBlkId const& blkid, uint8_t* buf, size_t size) {
+    std::optional< BlobImageRef > image;
+    {
+        std::scoped_lock lock(mtx_);
+        auto it = entries_.find(route);
+        if (it != entries_.end() && it->second.blkid == blkid && it->second.image.sgs.size == size) {
+            image = it->second.image;
+        }
+    }
+
+    if (!image) {
+        COUNTER_INCREMENT(metrics_, rwc_miss_count, 1);
+        return false;
+    }
+
+    // the entry may be evicted meanwhile, the reference to the request keeps the payload alive until the copy is done
+    image->copy_to(buf);
+    COUNTER_INCREMENT(metrics_, rwc_hit_count, 1);
+    COUNTER_INCREMENT(metrics_, rwc_hit_bytes, size);
+    return true;
+}
+
+void RecentWriteCache::remove_pg(pg_id_t pg_id) {
+    std::scoped_lock lock(mtx_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        auto next = std::next(it);
+        if ((it->first.shard >> shard_width) == pg_id) { erase_unlocked(it); }
+        it = next;
+    }
+}
+
+uint64_t RecentWriteCache::cached_bytes() const {
+    std::scoped_lock lock(mtx_);
+    return cached_bytes_;
+}
+
+uint64_t RecentWriteCache::cached_entries() const {
+    std::scoped_lock lock(mtx_);
+    return entries_.size();
+}
+
+// NOTE: caller should hold mtx_
+void RecentWriteCache::evict_to(uint64_t capacity) {
+    while (cached_bytes_ > capacity && !fifo_.empty()) {
+        erase_unlocked(entries_.find(fifo_.front()));
+        COUNTER_INCREMENT(metrics_, rwc_evict_count, 1);
+    }
+}
+
+// NOTE: caller should hold mtx_
+void RecentWriteCache::erase_unlocked(std::unordered_map< BlobRoute, Entry >::iterator it) {
+    cached_bytes_ -= it->second.image.charge();
+    fifo_.erase(it->second.fifo_it);
+    entries_.erase(it);
+}
+
+} // namespace homeobject
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <homestore/blk.h>
+#include <sisl/fds/buffer.hpp>
+#include <sisl/metrics/metrics.hpp>
+
+#include "lib/blob_route.hpp"
+
+namespace homeobject {
+
+/**
+ * The block image of a blob (blob header, user key, data and padding) as it sits in the buffers of the put request
+ * which wrote it. owner keeps the request alive as long as the image is referenced, so caching an image never copies
+ * it. held_bytes is the memory owner keeps alive, which is more than the image since owner is the whole request.
+ */
+struct BlobImageRef {
+    sisl::sg_list sgs;
+    std::shared_ptr< void > owner;
+    uint64_t held_bytes{0};
+
+    // what a cache holding this image is charged for, never less than the image itself
+    uint64_t charge() const { return std::max< uint64_t >(held_bytes, sgs.size); }
+
+    void copy_to(uint8_t* buf) const {
+        for (auto const& iov : sgs.iovs) {
+            std::memcpy(buf, iov.iov_base, iov.iov_len);
+            buf += iov.iov_len;
+        }
+    }
+};
+
+/**
+ * Bounded, memory capped cache of the payloads of blobs recently put through this node as leader.
+ *
+ * A lagging follower fetches the data of log entries it did not receive through push_data. Those are almost always
+ * recent writes, so the leader serves them from here instead of reading them back from disk. An entry references the
+ * buffers of the put request itself, it holds the request until it is evicted and is charged for all of the request's
+ * memory, not only the payload. Entries are evicted in insertion order once the charged bytes exceed
+ * recent_write_cache_size_mb. A capacity of 0 disables the cache.
+ */
+class RecentWriteCache {
+public:
+    struct RecentWriteCacheMetrics : public sisl::MetricsGroup {
+        explicit RecentWriteCacheMetrics(RecentWriteCache const& cache) :
+                sisl::MetricsGroup("recent_write_cache", "leader"), cache_{cache} {
+            REGISTER_COUNTER(rwc_hit_count, "Fetch data requests served from the recent write cache");
+            REGISTER_COUNTER(rwc_miss_count, "Fetch data requests which had to read from disk");
+            REGISTER_COUNTER(rwc_hit_bytes, "Bytes served to followers from the recent write cache");
+            REGISTER_COUNTER(rwc_evict_count, "Entries evicted from the recent write cache");
+            REGISTER_GAUGE(rwc_cached_bytes, "Bytes currently held by the recent write cache, requests included");
+            REGISTER_GAUGE(rwc_cached_entries, "Entries currently held in the recent write cache");
+            register_me_to_farm();
+            attach_gather_cb(std::bind(&RecentWriteCacheMetrics::on_gather, this));
+        }
+        ~RecentWriteCacheMetrics() { deregister_me_from_farm(); }
+        RecentWriteCacheMetrics(const RecentWriteCacheMetrics&) = delete;
+        RecentWriteCacheMetrics(RecentWriteCacheMetrics&&) noexcept = delete;
+        RecentWriteCacheMetrics& operator=(const RecentWriteCacheMetrics&) = delete;
+        RecentWriteCacheMetrics& operator=(RecentWriteCacheMetrics&&) noexcept = delete;
+
+        void on_gather() {
+            GAUGE_UPDATE(*this, rwc_cached_bytes, cache_.cached_bytes());
+            GAUGE_UPDATE(*this, rwc_cached_entries, cache_.cached_entries());
+        }
+
+    private:
+        RecentWriteCache const& cache_;
+    };
+
+    RecentWriteCache();
+    ~RecentWriteCache() = default;
+    RecentWriteCache(const RecentWriteCache&) = delete;
+    RecentWriteCache(RecentWriteCache&&) = delete;
+    RecentWriteCache& operator=(const RecentWriteCache&) = delete;
+    RecentWriteCache& operator=(RecentWriteCache&&) = delete;
+
+    /**
+     * @brief Cache the block-rounded payload of a committed blob put.
+     *
+     * @param route The shard and blob id of the blob.
+     * @param blkid The blocks the payload was written to on this node.
+     * @param image The payload exactly as it was written, i.e. blob header, user key, data and padding, and the
+     * request owning its buffers. The entry is charged image.charge() bytes.
+     */
+    void put(BlobRoute const& route, homestore::MultiBlkId const& blkid, BlobImageRef const& image);
+
+    /**
+     * @brief Copy a cached payload into buf.
+     *
+     * The entry only matches if it was written to the same blkid, so a payload is never served for blocks which were
+     * reused after gc or pg destroy.
+     *
+     * @return true if the payload was found and copied, false otherwise.
+     */
+    bool get(BlobRoute const& route, homestore::MultiBlkId const& blkid, uint8_t* buf, size_t size);
+
+    /**
+     * @brief Drop all the entries belonging to the given pg.
+     */
+    void remove_pg(pg_id_t pg_id);
+
+    uint64_t cached_bytes() const;
+    uint64_t cached_entries() const;
+
+private:
+    struct Entry {
+        homestore::MultiBlkId blkid;
+        BlobImageRef image;
+        std::list< BlobRoute >::iterator fifo_it;
+    };
+
+    void evict_to(uint64_t capacity);
+    void erase_unlocked(std::unordered_map< BlobRoute, Entry >::iterator it);
+
+    mutable std::mutex mtx_;
+    std::unordered_map< BlobRoute, Entry > entries_;
+    std::list< BlobRoute > fifo_;
+    uint64_t cached_bytes_{0};
+    RecentWriteCacheMetrics metrics_;
+};
+
+} // namespace homeobject
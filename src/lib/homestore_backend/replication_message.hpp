@@ -10,7 +10,7 @@
 namespace homeobject {
 
 VENUM(ReplicationMessageType, uint16_t, CREATE_PG_MSG = 0, CREATE_SHARD_MSG = 1, SEAL_SHARD_MSG = 2, PUT_BLOB_MSG = 3,
-      DEL_BLOB_MSG = 4, UNKNOWN_MSG = 5);
+      DEL_BLOB_MSG = 4, UNKNOWN_MSG = 5, IMPORT_BLOBS_MSG = 6);
 VENUM(SyncMessageType, uint16_t, PG_META = 0, SHARD_META = 1, SHARD_BATCH = 2,  LAST_MSG = 3);
 VENUM(ResyncBlobState, uint8_t, NORMAL = 0, DELETED = 1, CORRUPTED = 2);
 
@@ -20,8 +20,18 @@ static constexpr uint64_t HOMEOBJECT_REPLICATION_MAGIC = 0x11153ca24efc8d34;
 static constexpr uint64_t HOMEOBJECT_RESYNC_MAGIC = 0xbb6813cb4a339f30;
 static constexpr uint32_t HOMEOBJECT_REPLICATION_PROTOCOL_VERSION_V1 = 0x01;
 static constexpr uint32_t HOMEOBJECT_RESYNC_PROTOCOL_VERSION_V1 = 0x01;
+// Minor versions of the replication message header, they only give meaning to bytes which used to be zeroed padding,
+// so that replicas running different minor versions still understand each other.
+// 1: adds flags
+static constexpr uint8_t HOMEOBJECT_REPLICATION_HEADER_MINOR_VERSION = 0x01;
+// A DEL_BLOB_MSG with this flag carries the crc of the payload of the deleted blob in payload_crc. No longer set, every
+// replica finds the crc in its blob index, the bit stays reserved
+static constexpr uint8_t REPLICATION_MSG_FLAG_PAYLOAD_CRC = 0x01;
 static constexpr uint32_t init_crc32 = 0;
 static constexpr uint64_t LAST_OBJ_ID =ULLONG_MAX;
+// Older followers which could not take the snapshot object yet asked for this one, the leader fails the read so that
+// nuraft retries the resync with a later heartbeat. Followers now ask for the same object again instead.
+static constexpr uint64_t BUSY_OBJ_ID = LAST_OBJ_ID - 1;
 static constexpr uint64_t DEFAULT_MAX_BATCH_SIZE_MB =128;
 
 #pragma pack(1)
@@ -65,10 +75,15 @@ struct ReplicationMessageHeader : public BaseMessageHeader<ReplicationMessageHea
     }
     ReplicationMessageType msg_type;
     pg_id_t pg_id{0};
-    uint8_t reserved_pad[4]{};
+    uint8_t minor_version{HOMEOBJECT_REPLICATION_HEADER_MINOR_VERSION};
+    uint8_t flags{0};
+    uint8_t reserved_pad[2]{};
     shard_id_t shard_id{0};
     blob_id_t blob_id{0};
 
+    // headers of minor version 0 have the flags zeroed
+    bool has_flag(uint8_t flag) const { return minor_version >= 1 && (flags & flag) != 0; }
+
     bool corrupted() const{
         if (magic_num != HOMEOBJECT_REPLICATION_MAGIC || protocol_version != HOMEOBJECT_REPLICATION_PROTOCOL_VERSION_V1) {
             return true;
@@ -78,8 +93,10 @@ struct ReplicationMessageHeader : public BaseMessageHeader<ReplicationMessageHea
 
     std::string to_string() const {
         return fmt::format(
-            "magic={:#x} version={} msg_type={} pg={} shard_id={} payload_size={} payload_crc={} header_crc={}\n",
-            magic_num, protocol_version, enum_name(msg_type), pg_id, shard_id, payload_size, payload_crc, header_crc);
+            "magic={:#x} version={}.{} msg_type={} pg={} shard_id={} flags={:#x} payload_size={} payload_crc={} "
+            "header_crc={}\n",
+            magic_num, protocol_version, minor_version, enum_name(msg_type), pg_id, shard_id, flags, payload_size,
+            payload_crc, header_crc);
     }
 };
 
@@ -104,6 +121,15 @@ struct SyncMessageHeader : public BaseMessageHeader<SyncMessageHeader> {
             magic_num, protocol_version, enum_name(msg_type), payload_size, payload_crc, header_crc);
     }
 };
+
+// An IMPORT_BLOBS_MSG carries an array of these in its header extension, payload_size and payload_crc cover the array.
+// The blobs are laid out back to back in the data of the message, blk_offset is where a blob starts in it.
+struct ImportedBlobEntry {
+    blob_id_t blob_id;
+    uint32_t blk_offset;
+    uint32_t blk_count;
+    uint32_t payload_crc;
+};
 #pragma pack()
 
 // objId is the logical offset of the snapshot in baseline resync
@@ -134,4 +160,18 @@ struct objId {
     }
 };
 
+// A follower resuming inside a shard asks for the blobs after the last one it has with a seek obj_id
+// seek obj_id (64 bits) = type_bit (1 bit) | seek_bit (1 bit) | blob_id (62 bits)
+// It is sent in reply to the shard metadata message, the leader answers with the blob batch starting right after that
+// blob and both sides carry on as if it was batch 1 of the shard. Shard sequence numbers never reach bit 47, so a seek
+// obj_id can not be mistaken for a regular one.
+static constexpr uint64_t SEEK_OBJ_ID_BIT = 1ULL << 62;
+static constexpr blob_id_t MAX_SEEK_BLOB_ID = SEEK_OBJ_ID_BIT - 3;
+
+inline bool is_seek_obj_id(snp_obj_id_t value) {
+    return value < BUSY_OBJ_ID && (value & (1ULL << 63)) && (value & SEEK_OBJ_ID_BIT);
+}
+inline snp_obj_id_t seek_obj_id(blob_id_t after_blob_id) { return 1ULL << 63 | SEEK_OBJ_ID_BIT | after_blob_id; }
+inline blob_id_t seek_obj_blob_id(snp_obj_id_t value) { return value & (SEEK_OBJ_ID_BIT - 1); }
+
 } // namespace homeobject
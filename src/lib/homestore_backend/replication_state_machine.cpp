@@ -33,6 +33,10 @@ void ReplicationStateMachine::on_commit(int64_t lsn, const sisl::blob& header, c
         home_object_->on_blob_put_commit(lsn, header, key, pbas[0], ctx);
         break;
     }
+    case ReplicationMessageType::IMPORT_BLOBS_MSG: {
+        home_object_->on_blobs_import_commit(lsn, header, pbas[0], ctx);
+        break;
+    }
     case ReplicationMessageType::DEL_BLOB_MSG:
         home_object_->on_blob_del_commit(lsn, header, key, ctx);
         break;
@@ -121,7 +125,8 @@ void ReplicationStateMachine::on_rollback(int64_t lsn, sisl::blob const& header,
     }
 
     case ReplicationMessageType::PUT_BLOB_MSG:
-    case ReplicationMessageType::DEL_BLOB_MSG: {
+    case ReplicationMessageType::DEL_BLOB_MSG:
+    case ReplicationMessageType::IMPORT_BLOBS_MSG: {
         home_object_->on_blob_message_rollback(lsn, header, key, ctx);
         break;
     }
@@ -188,7 +193,8 @@ void ReplicationStateMachine::on_error(ReplServiceError error, const sisl::blob&
         break;
     }
 
-    case ReplicationMessageType::PUT_BLOB_MSG: {
+    case ReplicationMessageType::PUT_BLOB_MSG:
+    case ReplicationMessageType::IMPORT_BLOBS_MSG: {
         auto result_ctx =
             boost::static_pointer_cast< repl_result_ctx< BlobManager::Result< HSHomeObject::BlobInfo > > >(ctx).get();
         result_ctx->promise_.setValue(folly::makeUnexpected(toBlobError(error)));
@@ -253,6 +259,7 @@ ReplicationStateMachine::get_blk_alloc_hints(sisl::blob const& header, uint32_t
     }
 
     case ReplicationMessageType::PUT_BLOB_MSG:
+    case ReplicationMessageType::IMPORT_BLOBS_MSG:
         return home_object_->blob_put_get_blk_alloc_hints(header, hs_ctx);
 
     case ReplicationMessageType::DEL_BLOB_MSG:
@@ -302,6 +309,8 @@ bool ReplicationStateMachine::apply_snapshot(std::shared_ptr< homestore::snapsho
         std::this_thread::sleep_for(std::chrono::milliseconds(delay.get()));
     }
 #endif
+    home_object_->resync_throttle()->release(ResyncThrottle::direction::INCOMING,
+                                             {m_snp_rcv_handler->get_context_pg_id()});
     m_snp_rcv_handler->destroy_context_and_metrics();
 
     std::lock_guard lk(m_snapshot_lock);
@@ -346,13 +355,36 @@ int ReplicationStateMachine::read_snapshot_obj(std::shared_ptr< homestore::snaps
     // Once all the shards are done, follower will return next obj Id = LAST_OBJ_ID(ULLONG_MAX) as a end marker,
     // leader will stop sending the snapshot data.
     auto log_str = fmt::format("group={}, lsn={},", uuids::to_string(repl_dev()->group_id()), context->get_lsn());
+    auto throttle = home_object_->resync_throttle();
+    // every follower resyncs in a sync context of its own
+    ResyncThrottle::ResyncKey const resync_key{pg_iter->pg_id_, reinterpret_cast< uint64_t >(snp_obj->user_ctx)};
     if (snp_obj->offset == LAST_OBJ_ID) {
         // No more shards to read, baseline resync is finished after this.
         snp_obj->is_last_obj = true;
+        throttle->release(ResyncThrottle::direction::OUTGOING, resync_key);
         LOGD("Read snapshot end, {}", log_str);
         return 0;
     }
 
+    // Followers of an older version ask for BUSY_OBJ_ID when they can not take more yet. Fail the read so that nuraft
+    // drops the sync context and starts over with a later heartbeat, the follower resumes from where it stopped.
+    if (snp_obj->offset == BUSY_OBJ_ID) {
+        LOGD("Follower is busy, retry the resync later, {}", log_str);
+        return -1;
+    }
+
+    // Too many resyncs are served by this node, wait a bit for a slot. Failing the read costs the sync context and the
+    // blob iterator of this follower, so only do it once the wait is over.
+    if (!throttle->wait_acquire(ResyncThrottle::direction::OUTGOING, resync_key)) {
+        LOGD("Outgoing resync is queued, {} queue_position={}", log_str,
+             throttle->queue_position(ResyncThrottle::direction::OUTGOING, resync_key));
+        return -1;
+    }
+    // Over the bandwidth cap, hold the read back until the cap allows more. The object is sent anyway afterwards.
+    if (!throttle->pace(ResyncThrottle::direction::OUTGOING)) {
+        LOGD("Outgoing resync is still over the bandwidth cap, {}", log_str);
+    }
+
     auto obj_id = objId(snp_obj->offset);
     log_str = fmt::format("{} shard_seq_num=0x{:x} batch_num={}", log_str, obj_id.shard_seq_num, obj_id.batch_id);
 
@@ -371,6 +403,8 @@ int ReplicationStateMachine::read_snapshot_obj(std::shared_ptr< homestore::snaps
         pg_iter->reset_cursor();
         return 0;
     }
+    // a seek lands on the first batch of the current shard
+    obj_id = pg_iter->cur_obj_id_;
 
     // pg metadata message
     // shardId starts from 1
@@ -400,6 +434,7 @@ int ReplicationStateMachine::read_snapshot_obj(std::shared_ptr< homestore::snaps
         LOGE("Failed to create blob batch data for snapshot read, {}", log_str);
         return -1;
     }
+    throttle->consume_bandwidth(ResyncThrottle::direction::OUTGOING, snp_obj->blob.size());
     return 0;
 }
 
@@ -417,6 +452,10 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
     }
 
     auto obj_id = objId(snp_obj->offset);
+    if (is_seek_obj_id(snp_obj->offset)) {
+        // Reply to our seek, it is the first batch of the resumed shard
+        obj_id = objId(HSHomeObject::get_sequence_num_from_shard_id(m_snp_rcv_handler->get_shard_cursor()), 1);
+    }
     auto log_suffix =
         fmt::format("group={} lsn={} shard=0x{:x} batch_num={} size={}", uuids::to_string(r_dev->group_id()),
                     context->get_lsn(), obj_id.shard_seq_num, obj_id.batch_id, snp_obj->blob.size());
@@ -424,6 +463,8 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
 
     if (snp_obj->is_last_obj) {
         LOGD("Write snapshot reached is_last_obj true {}", log_suffix);
+        home_object_->resync_throttle()->release(ResyncThrottle::direction::INCOMING,
+                                                 {m_snp_rcv_handler->get_context_pg_id()});
         set_snapshot_context(context); // Update the snapshot context in case apply_snapshot is not called
         return;
     }
@@ -450,6 +491,18 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
     }
     auto data_buf = snp_obj->blob.cbytes() + sizeof(SyncMessageHeader);
 
+    // Too many resyncs are received by this node, wait a bit for a slot. If there is none yet, leave the offset as it
+    // is so that the leader sends the same object again, nothing of it is processed. The leader keeps its sync
+    // context, the wait here and the round trip pace the retries.
+    auto throttle = home_object_->resync_throttle();
+    auto const pg_id = obj_id.shard_seq_num == 0 ? GetSizePrefixedResyncPGMetaData(data_buf)->pg_id()
+                                                 : m_snp_rcv_handler->get_context_pg_id();
+    if (!throttle->wait_acquire(ResyncThrottle::direction::INCOMING, {pg_id})) {
+        LOGI("Incoming resync is queued, pg={} queue_position={} {}", pg_id,
+             throttle->queue_position(ResyncThrottle::direction::INCOMING, {pg_id}), log_suffix);
+        return;
+    }
+
     if (obj_id.shard_seq_num == 0) {
         // PG metadata & shard list message
         RELEASE_ASSERT(obj_id.batch_id == 0, "Invalid obj_id");
@@ -457,7 +510,7 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
         auto pg_data = GetSizePrefixedResyncPGMetaData(data_buf);
 
         if (m_snp_rcv_handler->get_context_lsn() == context->get_lsn() && m_snp_rcv_handler->get_shard_cursor() != 0) {
-            // Request to resume from the beginning of shard
+            // Request to resume from the shard, the blobs of it which are already here are skipped after its metadata
             snp_obj->offset =
                 m_snp_rcv_handler->get_shard_cursor() == HSHomeObject::SnapshotReceiveHandler::shard_list_end_marker
                 ? LAST_OBJ_ID
@@ -469,8 +522,9 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
         }
 
         // Init a new transmission
-        // If PG already exists, clean the stale pg resources. Let's resync on a pristine base
-        if (home_object_->pg_exists(pg_data->pg_id())) {
+        // If PG already exists and cannot be caught up with a delta resync, clean the stale pg resources. Let's
+        // resync on a pristine base
+        if (home_object_->pg_exists(pg_data->pg_id()) && !m_snp_rcv_handler->can_delta_resync(*pg_data)) {
             LOGI("pg already exists, clean pg resources before snapshot, pg={} {}", pg_data->pg_id(), log_suffix);
             home_object_->pg_destroy(pg_data->pg_id());
         }
@@ -484,8 +538,11 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
                  context->get_lsn(), obj_id.value, obj_id.shard_seq_num, obj_id.batch_id, ret);
             return;
         }
-        snp_obj->offset =
-            objId(HSHomeObject::get_sequence_num_from_shard_id(m_snp_rcv_handler->get_next_shard()), 0).value;
+        // A delta resync may find every shard in sync already
+        auto const next_shard = m_snp_rcv_handler->get_next_shard();
+        snp_obj->offset = next_shard == HSHomeObject::SnapshotReceiveHandler::shard_list_end_marker
+            ? LAST_OBJ_ID
+            : objId(HSHomeObject::get_sequence_num_from_shard_id(next_shard), 0).value;
         LOGI("Write snapshot, processed PG data pg={} {}", pg_data->pg_id(), log_suffix);
         return;
     }
@@ -504,8 +561,9 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
                  context->get_lsn(), obj_id.value, obj_id.shard_seq_num, obj_id.batch_id, ret);
             return;
         }
-        // Request for the next batch
-        snp_obj->offset = objId(obj_id.shard_seq_num, 1).value;
+        // Request for the next batch, or for what comes after the last persisted blob of a partially received shard
+        auto const resume_blob_id = m_snp_rcv_handler->get_resume_blob_id();
+        snp_obj->offset = resume_blob_id ? seek_obj_id(*resume_blob_id) : objId(obj_id.shard_seq_num, 1).value;
         LOGD("Write snapshot, processed shard data shard_seq_num:0x{:x} {}", obj_id.shard_seq_num, log_suffix);
         return;
     }
@@ -516,8 +574,11 @@ void ReplicationStateMachine::write_snapshot_obj(std::shared_ptr< homestore::sna
                        HSHomeObject::get_sequence_num_from_shard_id(m_snp_rcv_handler->get_shard_cursor()),
                    "Shard id not matching with the current shard cursor");
     auto blob_batch = GetSizePrefixedResyncBlobDataBatch(data_buf);
+    throttle->consume_bandwidth(ResyncThrottle::direction::INCOMING, snp_obj->blob.size());
     auto ret =
         m_snp_rcv_handler->process_blobs_snapshot_data(*blob_batch, obj_id.batch_id, blob_batch->is_last_batch());
+    // Over the bandwidth cap, the batch is kept but the reply which asks for the next one is held back
+    throttle->pace(ResyncThrottle::direction::INCOMING);
     if (ret) {
         // Do not proceed, will request for resending the current blob batch
         LOGE("Failed to process blob snapshot data lsn={} obj_id={} shard 0x{:x} batch={}, err={}", context->get_lsn(),
@@ -549,6 +610,10 @@ void ReplicationStateMachine::free_user_snp_ctx(void*& user_snp_ctx) {
     auto pg_iter_ptr = static_cast<std::shared_ptr<HSHomeObject::PGBlobIterator>*>(user_snp_ctx);
     LOGD("Freeing snapshot iterator={}, pg={} group={}", user_snp_ctx, (*pg_iter_ptr)->pg_id_,
          boost::uuids::to_string((*pg_iter_ptr)->group_id_));
+    // The resync either finished or will start over in a new context, give the slot to the next one in the queue
+    home_object_->resync_throttle()->release(ResyncThrottle::direction::OUTGOING,
+                                             {(*pg_iter_ptr)->pg_id_, reinterpret_cast< uint64_t >(user_snp_ctx)},
+                                             true /* drop_queued */);
     delete pg_iter_ptr;
     user_snp_ctx = nullptr;
 }
@@ -609,6 +674,7 @@ folly::Future< std::error_code > ReplicationStateMachine::on_fetch_data(const in
     // 1 create_shard : will write a shard header to a chunk
     // 2 seal_shard : will write a shard footer to a chunk
     // 3 put_blob: will write user data to a chunk
+    // 4 import_blobs: will write a batch of blobs imported from a shard archive to a chunk
 
     // for any type that writes data to a chunk, we need to handle the fetch_data request for it.
 
@@ -643,6 +709,12 @@ folly::Future< std::error_code > ReplicationStateMachine::on_fetch_data(const in
         const auto shard_id = msg_header->shard_id;
 
         LOGD("fetch data with blob_id={}, shard=0x{:x}", blob_id, shard_id);
+        // recently written blobs are served from memory, no need to read and validate them from disk
+        if (home_object_->read_from_recent_write_cache(shard_id, blob_id, local_blk_id, given_buffer, total_size)) {
+            LOGD("fetch data served from recent write cache, lsn={}, blob_id={}, shard=0x{:x}", lsn, blob_id,
+                 shard_id);
+            return folly::makeFuture< std::error_code >(std::error_code{});
+        }
         // we first try to read data according to the local_blk_id to see if it matches the blob_id
         return std::move(homestore::data_service().async_read(local_blk_id, given_buffer, total_size))
             .via(folly::getGlobalIOExecutor())
@@ -742,6 +814,9 @@ folly::Future< std::error_code > ReplicationStateMachine::on_fetch_data(const in
                 return ec;
             });
     }
+    case ReplicationMessageType::IMPORT_BLOBS_MSG:
+        return fetch_imported_blobs(lsn, header, local_blk_id, given_buffer, total_size);
+
     default: {
         LOGW("msg type={}, should not happen in fetch_data rpc", msg_header->msg_type);
         return folly::makeFuture< std::error_code >(std::make_error_code(std::errc::operation_not_supported));
@@ -768,6 +843,71 @@ bool ReplicationStateMachine::validate_blob(shard_id_t shard_id, blob_id_t blob_
     return true;
 }
 
+folly::Future< std::error_code >
+ReplicationStateMachine::fetch_imported_blobs(int64_t lsn, sisl::blob const& header,
+                                              homestore::MultiBlkId const& local_blk_id, uint8_t* buf, size_t size) {
+    auto entries = HSHomeObject::imported_blob_entries(header);
+    if (!entries) {
+        LOGW("import_blobs message does not carry a valid blob list, lsn={}", lsn);
+        return folly::makeFuture< std::error_code >(std::make_error_code(std::errc::bad_message));
+    }
+    auto const shard_id = r_cast< ReplicationMessageHeader const* >(header.cbytes())->shard_id;
+    auto const blk_size = repl_dev()->get_blk_size();
+    LOGD("fetch data of {} imported blobs, lsn={}, shard=0x{:x}", entries->size(), lsn, shard_id);
+
+    // The whole batch is read from where it was written first, only the blobs gc moved since are then looked up in the
+    // index table and read one by one.
+    return std::move(homestore::data_service().async_read(local_blk_id, buf, size))
+        .via(folly::getGlobalIOExecutor())
+        .thenValue([this, lsn, shard_id, entries = std::move(*entries), buf, blk_size](
+                       auto&& err) -> folly::Future< std::error_code > {
+            if (err) { return folly::makeFuture< std::error_code >(std::move(err)); }
+
+            auto hs_pg = home_object_->get_hs_pg(shard_id >> homeobject::shard_width);
+            std::vector< folly::Future< std::error_code > > reads;
+            for (auto const& e : entries) {
+                auto const blob_buf = buf + uint64_t(e.blk_offset) * blk_size;
+                auto const blob_size = uint64_t(e.blk_count) * blk_size;
+                if (validate_blob(shard_id, e.blob_id, blob_buf, blob_size)) { continue; }
+                if (!hs_pg) { return folly::makeFuture(std::make_error_code(std::errc::bad_address)); }
+
+                BlobRouteKey index_key{BlobRoute{shard_id, e.blob_id}};
+                BlobRouteValue index_value;
+                homestore::BtreeSingleGetRequest get_req{&index_key, &index_value};
+                if (hs_pg->index_table_->get(get_req) != homestore::btree_status_t::success ||
+                    index_value.pbas() == HSHomeObject::tombstone_pbas) {
+                    // blob never committed or deleted since, client will never read it
+                    continue;
+                }
+                auto const pbas = index_value.pbas();
+                if (pbas.blk_count() != e.blk_count) {
+                    return folly::makeFuture(std::make_error_code(std::errc::resource_unavailable_try_again));
+                }
+                LOGD("imported blob moved since, reading it from the index table, lsn={}, blob_id={}, shard=0x{:x}",
+                     lsn, e.blob_id, shard_id);
+                reads.emplace_back(
+                    std::move(homestore::data_service().async_read(pbas, blob_buf, blob_size))
+                        .via(folly::getGlobalIOExecutor())
+                        .thenValue([this, shard_id, blob_id = e.blob_id, blob_buf, blob_size](auto&& err) {
+                            if (err) { return err; }
+                            // gc moved it again after the lookup, let the follower retry
+                            return validate_blob(shard_id, blob_id, blob_buf, blob_size)
+                                ? std::error_code{}
+                                : std::make_error_code(std::errc::resource_unavailable_try_again);
+                        }));
+            }
+            return folly::collectAll(std::move(reads))
+                .via(folly::getGlobalIOExecutor())
+                .thenValue([](auto&& results) {
+                    for (auto& r : results) {
+                        if (r.hasException()) { return std::make_error_code(std::errc::io_error); }
+                        if (r.value()) { return r.value(); }
+                    }
+                    return std::error_code{};
+                });
+        });
+}
+
 sisl::io_blob_safe HSHomeObject::get_snapshot_sb_data(homestore::group_id_t group_id) {
     std::shared_lock lk(snp_sbs_lock_);
     auto it = snp_ctx_sbs_.find(group_id);
@@ -233,6 +233,11 @@ private:
     void set_snapshot_context(std::shared_ptr< homestore::snapshot_context > context);
 
     bool validate_blob(shard_id_t shard_id, blob_id_t blob_id, void* data, size_t size) const;
+    // Fill buf with the blobs of an import_blobs message, read from local_blk_id or, for the ones gc moved since, from
+    // where the index table points to.
+    folly::Future< std::error_code > fetch_imported_blobs(int64_t lsn, sisl::blob const& header,
+                                                          homestore::MultiBlkId const& local_blk_id, uint8_t* buf,
+                                                          size_t size);
 
     /* no space left error handling*/
 private:
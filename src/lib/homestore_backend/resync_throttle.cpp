@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <optional>
+#include <thread>
+
+#include "resync_throttle.hpp"
+#include "hs_backend_config.hpp"
+
+namespace homeobject {
+
+static uint32_t max_concurrent_resyncs(ResyncThrottle::direction dir) {
+    return dir == ResyncThrottle::direction::OUTGOING ? HS_BACKEND_DYNAMIC_CONFIG(max_concurrent_outgoing_resyncs)
+                                                      : HS_BACKEND_DYNAMIC_CONFIG(max_concurrent_incoming_resyncs);
+}
+
+bool ResyncThrottle::try_acquire(direction dir, ResyncKey const& key) {
+    // metrics of expired entries are dropped outside of the lock
+    std::vector< Entry > expired;
+    std::scoped_lock lock(mtx_);
+    auto& lane = lanes_[static_cast< size_t >(dir)];
+    auto const now = Clock::now();
+    expire_idle(dir, lane, now, expired);
+
+    auto by_key = [&key](Entry const& e) { return e.key == key; };
+    if (auto it = std::find_if(lane.active.begin(), lane.active.end(), by_key); it != lane.active.end()) {
+        it->last_seen = now;
+        return true;
+    }
+
+    auto wit = std::find_if(lane.waiting.begin(), lane.waiting.end(), by_key);
+    if (wit == lane.waiting.end()) {
+        lane.waiting.push_back(Entry{key, now,
+                                     std::make_unique< ResyncQueueMetrics >(
+                                         fmt::format("{}_pg_{}_{:x}", dir_name(dir), key.pg_id, key.ctx))});
+        LOGI("{} resync of pg={} ctx={:x} queued, active={} queued={}", dir_name(dir), key.pg_id, key.ctx,
+             lane.active.size(), lane.waiting.size());
+    } else {
+        wit->last_seen = now;
+    }
+
+    // hand the free slots out in arrival order
+    auto const cap = max_concurrent_resyncs(dir);
+    bool admitted{false};
+    while (!lane.waiting.empty() && (cap == 0 || lane.active.size() < cap)) {
+        auto& e = lane.waiting.front();
+        LOGI("{} resync of pg={} ctx={:x} admitted, active={}", dir_name(dir), e.key.pg_id, e.key.ctx,
+             lane.active.size() + 1);
+        admitted |= (e.key == key);
+        lane.active.push_back(std::move(e));
+        lane.waiting.pop_front();
+    }
+    update_gauges(dir, lane);
+    return admitted;
+}
+
+bool ResyncThrottle::wait_acquire(direction dir, ResyncKey const& key) {
+    static constexpr auto retry_interval = std::chrono::milliseconds(100);
+    auto const deadline = Clock::now() + std::chrono::milliseconds(HS_BACKEND_DYNAMIC_CONFIG(resync_pace_max_wait_ms));
+    while (!try_acquire(dir, key)) {
+        if (Clock::now() + retry_interval > deadline) { return false; }
+        std::this_thread::sleep_for(retry_interval);
+    }
+    return true;
+}
+
+void ResyncThrottle::release(direction dir, ResyncKey const& key, bool drop_queued) {
+    std::optional< Entry > released;
+    {
+        std::scoped_lock lock(mtx_);
+        auto& lane = lanes_[static_cast< size_t >(dir)];
+        auto by_key = [&key](Entry const& e) { return e.key == key; };
+        if (auto it = std::find_if(lane.active.begin(), lane.active.end(), by_key); it != lane.active.end()) {
+            released = std::move(*it);
+            lane.active.erase(it);
+        } else if (auto wit = std::find_if(lane.waiting.begin(), lane.waiting.end(), by_key);
+                   drop_queued && wit != lane.waiting.end()) {
+            released = std::move(*wit);
+            lane.waiting.erase(wit);
+        } else {
+            return;
+        }
+        update_gauges(dir, lane);
+        LOGI("{} resync of pg={} ctx={:x} released its slot, active={} queued={}", dir_name(dir), key.pg_id, key.ctx,
+             lane.active.size(), lane.waiting.size());
+    }
+}
+
+bool ResyncThrottle::bandwidth_available(direction dir) {
+    auto const r = rate(dir);
+    if (r == 0) { return true; }
+    {
+        std::scoped_lock lock(mtx_);
+        auto& lane = lanes_[static_cast< size_t >(dir)];
+        refill(lane, double(r), Clock::now());
+        if (lane.tokens > 0) { return true; }
+    }
+    COUNTER_INCREMENT(metrics_, resync_throttled_count, 1);
+    return false;
+}
+
+void ResyncThrottle::consume_bandwidth(direction dir, uint64_t bytes) {
+    auto const r = rate(dir);
+    if (r == 0 || bytes == 0) { return; }
+    std::scoped_lock lock(mtx_);
+    auto& lane = lanes_[static_cast< size_t >(dir)];
+    refill(lane, double(r), Clock::now());
+    // going into debt is fine, nothing goes through until it is paid back
+    lane.tokens -= bytes;
+}
+
+bool ResyncThrottle::pace(direction dir) {
+    auto const r = rate(dir);
+    if (r == 0) { return true; }
+    auto const max_wait = std::chrono::milliseconds(HS_BACKEND_DYNAMIC_CONFIG(resync_pace_max_wait_ms));
+    std::chrono::microseconds wait{0};
+    {
+        std::scoped_lock lock(mtx_);
+        auto& lane = lanes_[static_cast< size_t >(dir)];
+        refill(lane, double(r), Clock::now());
+        if (lane.tokens > 0) { return true; }
+        // time to pay the debt back, and a bit so that the bucket is positive again
+        wait = std::chrono::microseconds(static_cast< int64_t >(-lane.tokens / double(r) * 1e6) + 1);
+    }
+    COUNTER_INCREMENT(metrics_, resync_throttled_count, 1);
+    auto const paced = std::min< std::chrono::microseconds >(wait, max_wait);
+    COUNTER_INCREMENT(metrics_, resync_paced_ms,
+                      std::chrono::duration_cast< std::chrono::milliseconds >(paced).count());
+    std::this_thread::sleep_for(paced);
+    return paced == wait;
+}
+
+uint32_t ResyncThrottle::queue_position(direction dir, ResyncKey const& key) const {
+    std::scoped_lock lock(mtx_);
+    auto const& lane = lanes_[static_cast< size_t >(dir)];
+    for (size_t i = 0; i < lane.waiting.size(); ++i) {
+        if (lane.waiting[i].key == key) { return static_cast< uint32_t >(i + 1); }
+    }
+    return 0;
+}
+
+// bytes per second, 0 means unlimited
+uint64_t ResyncThrottle::rate(direction dir) {
+    return (dir == direction::OUTGOING ? HS_BACKEND_DYNAMIC_CONFIG(resync_outgoing_mbps)
+                                       : HS_BACKEND_DYNAMIC_CONFIG(resync_incoming_mbps)) *
+        Mi;
+}
+
+// NOTE: caller should hold mtx_
+void ResyncThrottle::refill(Lane& lane, double rate, Clock::time_point now) {
+    // allow a burst of one second worth of data
+    lane.tokens = (lane.last_refill == Clock::time_point{})
+        ? rate
+        : std::min(rate, lane.tokens + std::chrono::duration< double >(now - lane.last_refill).count() * rate);
+    lane.last_refill = now;
+}
+
+// NOTE: caller should hold mtx_
+void ResyncThrottle::expire_idle(direction dir, Lane& lane, Clock::time_point now, std::vector< Entry >& expired) {
+    auto const timeout = std::chrono::seconds(HS_BACKEND_DYNAMIC_CONFIG(resync_slot_idle_timeout_sec));
+    auto idle = [&](Entry const& e) { return now - e.last_seen > timeout; };
+    for (auto it = lane.active.begin(); it != lane.active.end();) {
+        if (idle(*it)) {
+            LOGW("{} resync of pg={} ctx={:x} made no progress for {}s, reclaiming its slot", dir_name(dir),
+                 it->key.pg_id, it->key.ctx, timeout.count());
+            expired.push_back(std::move(*it));
+            it = lane.active.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = lane.waiting.begin(); it != lane.waiting.end();) {
+        if (idle(*it)) {
+            LOGW("{} resync of pg={} ctx={:x} stopped asking for a slot, dropping it from the queue", dir_name(dir),
+                 it->key.pg_id, it->key.ctx);
+            expired.push_back(std::move(*it));
+            it = lane.waiting.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// NOTE: caller should hold mtx_
+void ResyncThrottle::update_gauges(direction dir, Lane const& lane) {
+    if (dir == direction::OUTGOING) {
+        GAUGE_UPDATE(metrics_, resync_outgoing_active, lane.active.size());
+        GAUGE_UPDATE(metrics_, resync_outgoing_queued, lane.waiting.size());
+    } else {
+        GAUGE_UPDATE(metrics_, resync_incoming_active, lane.active.size());
+        GAUGE_UPDATE(metrics_, resync_incoming_queued, lane.waiting.size());
+    }
+    for (auto const& e : lane.active) {
+        GAUGE_UPDATE(*e.metrics, resync_queue_position, 0);
+    }
+    for (size_t i = 0; i < lane.waiting.size(); ++i) {
+        GAUGE_UPDATE(*lane.waiting[i].metrics, resync_queue_position, i + 1);
+    }
+}
+
+} // namespace homeobject
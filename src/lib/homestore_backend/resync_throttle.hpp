@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sisl/metrics/metrics.hpp>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+/**
+ * Node wide admission and bandwidth control of baseline resyncs.
+ *
+ * At most max_concurrent_outgoing_resyncs resyncs are served as donor and max_concurrent_incoming_resyncs are received
+ * at the same time, the others queue up in arrival order. A resync is identified by its pg and its sync context, so
+ * that two followers of the same pg resyncing from this node take a slot each. A resync holds its slot from its first
+ * snapshot object until it finishes, and gives it back if it makes no progress for resync_slot_idle_timeout_sec (e.g.
+ * the peer is gone). The snapshot data going through each direction is additionally capped by a token bucket
+ * (resync_outgoing_mbps / resync_incoming_mbps).
+ *
+ * try_acquire and bandwidth_available never block. A snapshot callback which has to wait uses wait_acquire and pace
+ * instead: they hold the raft thread for at most resync_pace_max_wait_ms, which defers the reply to the peer rather
+ * than failing the object. A failed object costs the leader its sync context, and the follower the batch it received.
+ */
+class ResyncThrottle {
+public:
+    enum class direction : uint8_t { OUTGOING = 0, INCOMING = 1 };
+
+    struct ResyncThrottleMetrics : public sisl::MetricsGroup {
+        ResyncThrottleMetrics() : sisl::MetricsGroup("resync_throttle", "node") {
+            REGISTER_GAUGE(resync_outgoing_active, "Baseline resyncs currently served by this node");
+            REGISTER_GAUGE(resync_outgoing_queued, "Baseline resyncs waiting for a donor slot on this node");
+            REGISTER_GAUGE(resync_incoming_active, "Baseline resyncs currently received by this node");
+            REGISTER_GAUGE(resync_incoming_queued, "Baseline resyncs waiting for a receiver slot on this node");
+            REGISTER_COUNTER(resync_throttled_count, "Snapshot objects deferred because of the bandwidth cap");
+            REGISTER_COUNTER(resync_paced_ms, "Time snapshot objects were held back by the bandwidth cap (ms)");
+            register_me_to_farm();
+        }
+        ~ResyncThrottleMetrics() { deregister_me_from_farm(); }
+        ResyncThrottleMetrics(const ResyncThrottleMetrics&) = delete;
+        ResyncThrottleMetrics(ResyncThrottleMetrics&&) noexcept = delete;
+        ResyncThrottleMetrics& operator=(const ResyncThrottleMetrics&) = delete;
+        ResyncThrottleMetrics& operator=(ResyncThrottleMetrics&&) noexcept = delete;
+    };
+
+    // Per resync, alive while the resync is queued or running.
+    struct ResyncQueueMetrics : public sisl::MetricsGroup {
+        explicit ResyncQueueMetrics(std::string const& name) : sisl::MetricsGroup("resync_queue", name) {
+            REGISTER_GAUGE(resync_queue_position, "Position of the resync in the queue, 0 once it is running");
+            register_me_to_farm();
+        }
+        ~ResyncQueueMetrics() { deregister_me_from_farm(); }
+        ResyncQueueMetrics(const ResyncQueueMetrics&) = delete;
+        ResyncQueueMetrics(ResyncQueueMetrics&&) noexcept = delete;
+        ResyncQueueMetrics& operator=(const ResyncQueueMetrics&) = delete;
+        ResyncQueueMetrics& operator=(ResyncQueueMetrics&&) noexcept = delete;
+    };
+
+    ResyncThrottle() = default;
+    ~ResyncThrottle() = default;
+    ResyncThrottle(const ResyncThrottle&) = delete;
+    ResyncThrottle(ResyncThrottle&&) = delete;
+    ResyncThrottle& operator=(const ResyncThrottle&) = delete;
+    ResyncThrottle& operator=(ResyncThrottle&&) = delete;
+
+    // A resync: the pg and the sync context it runs in. An incoming resync has no other context than its pg, 0.
+    struct ResyncKey {
+        pg_id_t pg_id;
+        uint64_t ctx{0};
+        bool operator==(ResyncKey const&) const = default;
+    };
+
+    /**
+     * @brief Called on every snapshot object of a resync, before doing any work for it.
+     *
+     * @return true if the resync holds a slot and may proceed, false if it is (still) queued.
+     */
+    bool try_acquire(direction dir, ResyncKey const& key);
+
+    /**
+     * @brief try_acquire, retried until the resync is admitted or resync_pace_max_wait_ms has passed.
+     */
+    bool wait_acquire(direction dir, ResyncKey const& key);
+
+    /**
+     * @brief Give back the slot held by the resync, if any. A queued resync keeps its place unless drop_queued is set.
+     */
+    void release(direction dir, ResyncKey const& key, bool drop_queued = false);
+
+    /**
+     * @brief Whether snapshot data may go through, false as long as the bandwidth cap is exceeded. Never blocks.
+     */
+    bool bandwidth_available(direction dir);
+
+    // Account snapshot data which went through, it may put the direction in debt.
+    void consume_bandwidth(direction dir, uint64_t bytes);
+
+    /**
+     * @brief Wait until the debt of the direction is paid back, for at most resync_pace_max_wait_ms.
+     *
+     * @return true if data may go through again, false if the wait was cut short.
+     */
+    bool pace(direction dir);
+
+    // 0 if the resync is running or unknown, its 1-based position in the queue otherwise.
+    uint32_t queue_position(direction dir, ResyncKey const& key) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        ResyncKey key;
+        Clock::time_point last_seen;
+        std::unique_ptr< ResyncQueueMetrics > metrics;
+    };
+
+    struct Lane {
+        std::vector< Entry > active;
+        std::deque< Entry > waiting;
+        // bandwidth token bucket, in bytes
+        double tokens{0};
+        Clock::time_point last_refill{};
+    };
+
+    static char const* dir_name(direction dir) { return dir == direction::OUTGOING ? "outgoing" : "incoming"; }
+    static uint64_t rate(direction dir);
+    // NOTE: caller should hold mtx_
+    static void refill(Lane& lane, double rate, Clock::time_point now);
+    void expire_idle(direction dir, Lane& lane, Clock::time_point now, std::vector< Entry >& expired);
+    void update_gauges(direction dir, Lane const& lane);
+
+    mutable std::mutex mtx_;
+    std::array< Lane, 2 > lanes_; // indexed by direction
+    ResyncThrottleMetrics metrics_;
+};
+
+} // namespace homeobject
@@ -0,0 +1,421 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <homestore/homestore.hpp>
+
+#include "hs_backend_config.hpp"
+#include "hs_homeobject.hpp"
+#include "replication_state_machine.hpp"
+#include "shard_archive.hpp"
+
+namespace homeobject {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// blobs read from disk at once by an export
+constexpr uint64_t export_batch_size{64};
+// cap of the blob list carried in the header of one import_blobs log entry
+constexpr size_t max_import_batch_blobs{1024};
+
+uint64_t elapsed_us(Clock::time_point start) {
+    return std::chrono::duration_cast< std::chrono::microseconds >(Clock::now() - start).count();
+}
+
+ShardError to_shard_error(BlobError const& e) {
+    switch (e.getCode()) {
+    case BlobErrorCode::NOT_LEADER:
+        return ShardError::NOT_LEADER;
+    case BlobErrorCode::TIMEOUT:
+        return ShardError::TIMEOUT;
+    case BlobErrorCode::UNKNOWN_PG:
+        return ShardError::UNKNOWN_PG;
+    case BlobErrorCode::UNKNOWN_SHARD:
+        return ShardError::UNKNOWN_SHARD;
+    case BlobErrorCode::CHECKSUM_MISMATCH:
+        return ShardError::CRC_MISMATCH;
+    case BlobErrorCode::RETRY_REQUEST:
+        return ShardError::RETRY_REQUEST;
+    case BlobErrorCode::SHUTTING_DOWN:
+        return ShardError::SHUTTING_DOWN;
+    default:
+        return ShardError::UNKNOWN;
+    }
+}
+
+template < typename T >
+bool read_struct(std::ifstream& in, T& t) {
+    return static_cast< bool >(in.read(reinterpret_cast< char* >(&t), sizeof(T)));
+}
+
+template < typename T >
+bool write_struct(std::ofstream& out, T const& t) {
+    return static_cast< bool >(out.write(reinterpret_cast< char const* >(&t), sizeof(T)));
+}
+
+// The parts of an archive which describe it, read and checked by load_archive_meta()
+struct archive_meta {
+    shard_archive_header header;
+    shard_archive_footer footer;
+    std::vector< shard_archive_index_entry > index;
+    uint64_t data_bytes{0};
+};
+
+std::optional< archive_meta > load_archive_meta(std::ifstream& in, std::string const& path) {
+    archive_meta meta;
+    in.seekg(0, std::ios::end);
+    auto const file_size = static_cast< uint64_t >(in.tellg());
+    in.seekg(0);
+    if (file_size < sizeof(shard_archive_header) + sizeof(shard_archive_footer) || !read_struct(in, meta.header) ||
+        meta.header.magic != SHARD_ARCHIVE_MAGIC || meta.header.version != SHARD_ARCHIVE_VERSION_V1 ||
+        meta.header.crc != shard_archive_crc(meta.header) || meta.header.blk_size == 0) {
+        LOGE("shard archive {} has no valid header", path);
+        return std::nullopt;
+    }
+
+    in.seekg(file_size - sizeof(shard_archive_footer));
+    if (!read_struct(in, meta.footer) || meta.footer.magic != SHARD_ARCHIVE_MAGIC ||
+        meta.footer.crc != shard_archive_crc(meta.footer) ||
+        meta.footer.index_offset + meta.footer.blob_count * sizeof(shard_archive_index_entry) +
+                sizeof(shard_archive_footer) !=
+            file_size) {
+        LOGE("shard archive {} has no valid footer, it may be truncated", path);
+        return std::nullopt;
+    }
+
+    meta.index.resize(meta.footer.blob_count);
+    in.seekg(meta.footer.index_offset);
+    auto const index_bytes = meta.index.size() * sizeof(shard_archive_index_entry);
+    if (!in.read(reinterpret_cast< char* >(meta.index.data()), index_bytes) ||
+        crc32_ieee(0, reinterpret_cast< unsigned char const* >(meta.index.data()), index_bytes) !=
+            meta.footer.index_crc) {
+        LOGE("shard archive {} has a corrupted index", path);
+        return std::nullopt;
+    }
+    for (auto const& e : meta.index) {
+        meta.data_bytes += uint64_t(e.blk_count) * meta.header.blk_size;
+    }
+    return meta;
+}
+} // namespace
+
+ShardManager::Result< HSHomeObject::ShardExportResult > HSHomeObject::export_shard(shard_id_t shard_id,
+                                                                                   std::string const& path,
+                                                                                   trace_id_t tid) {
+    auto const start = Clock::now();
+    auto shard = get_shard(shard_id, tid).get();
+    if (!shard) { return folly::makeUnexpected(shard.error()); }
+    auto const& info = shard.value();
+    // only a sealed shard is guaranteed not to change while it is exported
+    if (info.state != ShardInfo::State::SEALED) {
+        LOGW("traceID={}, shardID=0x{:x} is not sealed, can not export it", tid, shard_id);
+        return folly::makeUnexpected(ShardError::INVALID_ARG);
+    }
+    auto hs_pg = get_hs_pg(info.placement_group);
+    if (hs_pg == nullptr) { return folly::makeUnexpected(ShardError::UNKNOWN_PG); }
+    auto repl_dev = hs_pg->repl_dev_;
+    auto const blk_size = repl_dev->get_blk_size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LOGE("traceID={}, failed to open {} to export shardID=0x{:x}", tid, path, shard_id);
+        return folly::makeUnexpected(ShardError::INVALID_ARG);
+    }
+    // no partial archive is left behind
+    auto const abort_export = [&](ShardError err) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return folly::makeUnexpected(err);
+    };
+    auto const write_failed = [&]() {
+        LOGE("traceID={}, failed to write {} while exporting shardID=0x{:x}", tid, path, shard_id);
+        return abort_export(ShardError::UNKNOWN);
+    };
+
+    shard_archive_header header;
+    header.blk_size = blk_size;
+    header.shard_id = shard_id;
+    header.created_time = info.created_time;
+    header.last_modified_time = info.last_modified_time;
+    header.total_capacity_bytes = info.total_capacity_bytes;
+    shard_archive_seal(header);
+    if (!write_struct(out, header)) { return write_failed(); }
+
+    std::vector< shard_archive_index_entry > index;
+    uint64_t offset{sizeof(shard_archive_header)};
+    uint64_t digest{0};
+    blob_id_t next_blob_id{0};
+    while (true) {
+        if (is_shutting_down()) { return abort_export(ShardError::SHUTTING_DOWN); }
+        auto blobs = query_blobs_in_shard(info.placement_group, get_sequence_num_from_shard_id(shard_id),
+                                          next_blob_id, export_batch_size);
+        if (!blobs) {
+            LOGE("traceID={}, failed to query the blobs of shardID=0x{:x}, err={}", tid, shard_id, blobs.error());
+            return abort_export(ShardError::UNKNOWN);
+        }
+        if (blobs->empty()) { break; }
+        next_blob_id = blobs->back().blob_id + 1;
+
+        // read the batch at once, write it out in blob id order
+        std::vector< BlobInfo > live;
+        for (auto const& b : blobs.value()) {
+            if (b.pbas != tombstone_pbas) { live.push_back(b); }
+        }
+        std::vector< sisl::io_blob_safe > bufs;
+        bufs.reserve(live.size());
+        std::vector< folly::Future< std::error_code > > reads;
+        for (auto const& b : live) {
+            auto const size = b.pbas.blk_count() * blk_size;
+            auto& buf = bufs.emplace_back(size, io_align);
+            sisl::sg_list sgs;
+            sgs.size = size;
+            sgs.iovs.emplace_back(iovec{.iov_base = buf.bytes(), .iov_len = size});
+            reads.emplace_back(issue_data_io(
+                info.placement_group, PGIoScheduler::io_type::READ, PGIoScheduler::io_class::BACKGROUND, size,
+                [repl_dev, pbas = b.pbas, sgs, size]() { return repl_dev->async_read(pbas, sgs, size); }));
+        }
+        auto results = folly::collectAll(std::move(reads)).get();
+
+        for (size_t i = 0; i < live.size(); ++i) {
+            auto const& b = live[i];
+            if (results[i].hasException() || results[i].value()) {
+                LOGE("traceID={}, failed to read blob_id={} of shardID=0x{:x} for export", tid, b.blob_id, shard_id);
+                return abort_export(ShardError::UNKNOWN);
+            }
+            // a corrupted blob is not carried over to another node
+            auto payload_crc = check_blob_image(b, bufs[i].cbytes(), bufs[i].size());
+            if (!payload_crc) {
+                LOGE("traceID={}, blob_id={} of shardID=0x{:x} is corrupted, export aborted", tid, b.blob_id,
+                     shard_id);
+                return abort_export(ShardError::CRC_MISMATCH);
+            }
+
+            shard_archive_blob_record record;
+            record.blob_id = b.blob_id;
+            record.blk_count = b.pbas.blk_count();
+            record.payload_crc = payload_crc.value();
+            record.data_crc = crc32_ieee(0, bufs[i].cbytes(), bufs[i].size());
+            shard_archive_seal(record);
+            if (!write_struct(out, record) ||
+                !out.write(reinterpret_cast< char const* >(bufs[i].cbytes()), bufs[i].size())) {
+                return write_failed();
+            }
+            index.push_back(shard_archive_index_entry{b.blob_id, offset, record.blk_count});
+            offset += sizeof(shard_archive_blob_record) + bufs[i].size();
+            digest ^= ShardDigestTable::element(b.blob_id, record.payload_crc);
+        }
+        if (blobs->size() < export_batch_size) { break; }
+    }
+
+    auto const index_bytes = index.size() * sizeof(shard_archive_index_entry);
+    shard_archive_footer footer;
+    footer.blob_count = index.size();
+    footer.index_offset = offset;
+    footer.digest = digest;
+    footer.index_crc = crc32_ieee(0, reinterpret_cast< unsigned char const* >(index.data()), index_bytes);
+    shard_archive_seal(footer);
+    if (!out.write(reinterpret_cast< char const* >(index.data()), index_bytes) || !write_struct(out, footer) ||
+        !out.flush()) {
+        return write_failed();
+    }
+    out.close();
+
+    ShardExportResult result{.shard_id = shard_id,
+                             .blob_count = index.size(),
+                             .bytes = offset + index_bytes + sizeof(shard_archive_footer),
+                             .elapsed_us = elapsed_us(start)};
+    LOGI("traceID={}, exported shardID=0x{:x} to {}: blobs={}, bytes={}, elapsed_us={}", tid, shard_id, path,
+         result.blob_count, result.bytes, result.elapsed_us);
+    return result;
+}
+
+BlobManager::AsyncResult< HSHomeObject::BlobInfo >
+HSHomeObject::propose_imported_blobs(ShardInfo const& shard, std::vector< ImportedBlobEntry > const& entries,
+                                     sisl::io_blob_safe&& data, trace_id_t tid) {
+    auto hs_pg = get_hs_pg(shard.placement_group);
+    if (hs_pg == nullptr) { return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_PG)); }
+    auto repl_dev = hs_pg->repl_dev_;
+
+    auto const extn_size = uint32_cast(entries.size() * sizeof(ImportedBlobEntry));
+    auto req = repl_result_ctx< BlobManager::Result< BlobInfo > >::make(extn_size, 0u /* key_size */);
+    req->header()->msg_type = ReplicationMessageType::IMPORT_BLOBS_MSG;
+    req->header()->pg_id = shard.placement_group;
+    req->header()->shard_id = shard.id;
+    // blob_id stays 0, there is no single blob whose blocks could be reused on a re-proposal
+    std::memcpy(req->header_extn(), entries.data(), extn_size);
+    req->header()->payload_size = extn_size;
+    req->header()->payload_crc = crc32_ieee(init_crc32, req->header_extn(), extn_size);
+    req->header()->seal();
+
+    auto const bytes = data.size();
+    req->add_data_sg(std::move(data));
+    incr_pending_request_num(hs_pg);
+    std::ignore = issue_data_io(shard.placement_group, PGIoScheduler::io_type::WRITE,
+                                PGIoScheduler::io_class::BACKGROUND, bytes, [req, repl_dev, tid]() {
+                                    repl_dev->async_alloc_write(req->cheader_buf(), sisl::blob{}, req->data_sgs(), req,
+                                                                false /* part_of_batch */, tid);
+                                    return folly::makeFuture();
+                                });
+    return req->result().deferValue([this, req, hs_pg](auto const& result) {
+        decr_pending_request_num(hs_pg);
+        return result;
+    });
+}
+
+ShardManager::Result< HSHomeObject::ShardImportResult > HSHomeObject::import_shard(pg_id_t pg_id,
+                                                                                   std::string const& path,
+                                                                                   trace_id_t tid) {
+    auto const start = Clock::now();
+    auto hs_pg = get_hs_pg(pg_id);
+    if (hs_pg == nullptr) { return folly::makeUnexpected(ShardError::UNKNOWN_PG); }
+    auto repl_dev = hs_pg->repl_dev_;
+    if (!repl_dev->is_leader()) { return folly::makeUnexpected(ShardError::NOT_LEADER); }
+    auto const blk_size = repl_dev->get_blk_size();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        LOGE("traceID={}, failed to open shard archive {}", tid, path);
+        return folly::makeUnexpected(ShardError::INVALID_ARG);
+    }
+    auto meta = load_archive_meta(in, path);
+    if (!meta) { return folly::makeUnexpected(ShardError::CRC_MISMATCH); }
+    auto const source_shard_id = meta->header.shard_id;
+    if (meta->header.blk_size != blk_size) {
+        LOGE("traceID={}, shard archive {} has blk_size={}, this node {}", tid, path, meta->header.blk_size, blk_size);
+        return folly::makeUnexpected(ShardError::INVALID_ARG);
+    }
+
+    // Reads the record and blocks of the next blob into buf, checking them against the index entry.
+    auto const read_blob = [&](shard_archive_index_entry const& e, uint8_t* buf) -> std::optional< uint32_t > {
+        shard_archive_blob_record record;
+        auto const size = uint64_t(e.blk_count) * blk_size;
+        if (static_cast< uint64_t >(in.tellg()) != e.offset || !read_struct(in, record) ||
+            record.crc != shard_archive_crc(record) || record.blob_id != e.blob_id ||
+            record.blk_count != e.blk_count || !in.read(reinterpret_cast< char* >(buf), size) ||
+            crc32_ieee(0, buf, size) != record.data_crc) {
+            LOGE("traceID={}, shard archive {} has a corrupted record for blob_id={}", tid, path, e.blob_id);
+            return std::nullopt;
+        }
+        return record.payload_crc;
+    };
+
+    // Check the whole archive before anything is created from it.
+    {
+        in.seekg(sizeof(shard_archive_header));
+        uint64_t digest{0};
+        sisl::io_blob_safe buf;
+        for (auto const& e : meta->index) {
+            auto const size = uint64_t(e.blk_count) * blk_size;
+            if (buf.size() < size) { buf = sisl::io_blob_safe(size, io_align); }
+            auto payload_crc = read_blob(e, buf.bytes());
+            if (!payload_crc) { return folly::makeUnexpected(ShardError::CRC_MISMATCH); }
+            auto image_crc = check_blob_image(BlobInfo{source_shard_id, e.blob_id, {}, 0}, buf.cbytes(), size);
+            if (!image_crc || image_crc.value() != *payload_crc) {
+                return folly::makeUnexpected(ShardError::CRC_MISMATCH);
+            }
+            digest ^= ShardDigestTable::element(e.blob_id, *payload_crc);
+        }
+        if (digest != meta->footer.digest) {
+            LOGE("traceID={}, shard archive {} does not match its digest", tid, path);
+            return folly::makeUnexpected(ShardError::CRC_MISMATCH);
+        }
+    }
+    auto const verified_us = elapsed_us(start);
+
+    auto const size_bytes = std::clamp(std::max(meta->header.total_capacity_bytes, meta->data_bytes), uint64_t(1),
+                                       max_shard_size());
+    auto shard = create_shard(pg_id, size_bytes, tid).get();
+    if (!shard) {
+        LOGE("traceID={}, failed to create the shard to import {} into, err={}", tid, path, shard.error());
+        return folly::makeUnexpected(shard.error());
+    }
+    auto const shard_id = shard->id;
+    LOGI("traceID={}, importing shard archive {} of shardID=0x{:x} into shardID=0x{:x}, blobs={}, data_bytes={}", tid,
+         path, source_shard_id, shard_id, meta->index.size(), meta->data_bytes);
+
+    // Batches are cut along the index, the next one is read from the file while the previous one replicates.
+    auto const batch_bytes = std::max(uint64_t(HS_BACKEND_DYNAMIC_CONFIG(shard_import_batch_mb)) * Mi, uint64_t(1));
+    in.clear();
+    in.seekg(sizeof(shard_archive_header));
+    std::optional< BlobManager::AsyncResult< BlobInfo > > inflight;
+    auto const wait_inflight = [&]() -> std::optional< BlobError > {
+        if (!inflight) { return std::nullopt; }
+        auto r = std::move(*inflight).get();
+        inflight.reset();
+        if (!r) { return r.error(); }
+        return std::nullopt;
+    };
+
+    size_t next{0};
+    while (next < meta->index.size()) {
+        uint64_t bytes{0};
+        auto end = next;
+        while (end < meta->index.size() && end - next < max_import_batch_blobs) {
+            auto const size = uint64_t(meta->index[end].blk_count) * blk_size;
+            if (end != next && bytes + size > batch_bytes) { break; }
+            bytes += size;
+            ++end;
+        }
+
+        sisl::io_blob_safe data(bytes, io_align);
+        std::vector< ImportedBlobEntry > entries;
+        entries.reserve(end - next);
+        uint32_t blk_offset{0};
+        for (auto i = next; i < end; ++i) {
+            auto const& e = meta->index[i];
+            auto const buf = data.bytes() + uint64_t(blk_offset) * blk_size;
+            auto payload_crc = read_blob(e, buf);
+            if (!payload_crc) {
+                std::ignore = wait_inflight();
+                return folly::makeUnexpected(ShardError::CRC_MISMATCH);
+            }
+            // the blob now belongs to the new shard, the payload and its hash stay as they are
+            auto blob_header = r_cast< BlobHeader* >(buf);
+            blob_header->shard_id = shard_id;
+            blob_header->seal();
+            entries.push_back(ImportedBlobEntry{e.blob_id, blk_offset, e.blk_count, *payload_crc});
+            blk_offset += e.blk_count;
+        }
+
+        if (auto err = wait_inflight(); err) {
+            LOGE("traceID={}, import of {} into shardID=0x{:x} failed, err={}", tid, path, shard_id, err->getCode());
+            return folly::makeUnexpected(to_shard_error(*err));
+        }
+        inflight = propose_imported_blobs(shard.value(), entries, std::move(data), tid);
+        next = end;
+    }
+    if (auto err = wait_inflight(); err) {
+        LOGE("traceID={}, import of {} into shardID=0x{:x} failed, err={}", tid, path, shard_id, err->getCode());
+        return folly::makeUnexpected(to_shard_error(*err));
+    }
+
+    auto sealed = seal_shard(shard_id, tid).get();
+    if (!sealed) {
+        LOGE("traceID={}, failed to seal shardID=0x{:x} imported from {}, err={}", tid, shard_id, path,
+             sealed.error());
+        return folly::makeUnexpected(sealed.error());
+    }
+
+    // the blobs keep their ids and payloads, so the digest of the new shard is the one of the exported shard
+    auto const d = shard_digests_->get(shard_id);
+    if (d && !d->stale && (d->digest != meta->footer.digest || d->blob_count != meta->index.size())) {
+        LOGE("traceID={}, shardID=0x{:x} imported from {} does not match the archive digest", tid, shard_id, path);
+        return folly::makeUnexpected(ShardError::CRC_MISMATCH);
+    }
+
+    ShardImportResult result{.shard = sealed.value(),
+                             .source_shard_id = source_shard_id,
+                             .blob_count = meta->index.size(),
+                             .bytes = meta->data_bytes,
+                             .elapsed_us = elapsed_us(start)};
+    auto const secs = std::max(double(result.elapsed_us) / 1e6, 1e-6);
+    LOGI("traceID={}, imported shardID=0x{:x} from {} as shardID=0x{:x}: blobs={}, bytes={}, verify_us={}, "
+         "elapsed_us={}, {:.1f} MB/s, {:.0f} blobs/s",
+         tid, source_shard_id, path, shard_id, result.blob_count, result.bytes, verified_us, result.elapsed_us,
+         double(result.bytes) / Mi / secs, double(result.blob_count) / secs);
+    return result;
+}
+
+} // namespace homeobject
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+
+#include <homestore/crc.h>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+/**
+ * Layout of a shard archive, the file a sealed shard is exported to and imported from for offline data migration
+ * (HSHomeObject::export_shard / import_shard).
+ *
+ * The file is written and read front to back:
+ *   shard_archive_header
+ *   per blob, in blob id order: a shard_archive_blob_record followed by the blocks of the blob exactly as they are on
+ *   disk (BlobHeader, user key, payload and zero padding)
+ *   shard_archive_index_entry[blob_count], where the record of every blob starts in the file
+ *   shard_archive_footer
+ *
+ * Every part carries its own crc. The footer also carries the digest of the blobs (see ShardDigestTable), so that the
+ * imported shard can be checked against the exported one end to end.
+ */
+
+// magic num comes from the first 8 bytes of 'echo homeobject_shard_archive | md5sum'
+static constexpr uint64_t SHARD_ARCHIVE_MAGIC = 0xb1f50afba3b6ac49;
+static constexpr uint32_t SHARD_ARCHIVE_VERSION_V1 = 0x01;
+
+#pragma pack(1)
+struct shard_archive_header {
+    uint64_t magic{SHARD_ARCHIVE_MAGIC};
+    uint32_t version{SHARD_ARCHIVE_VERSION_V1};
+    uint32_t blk_size{0}; // blobs are padded to it
+    shard_id_t shard_id{0};
+    uint64_t created_time{0};
+    uint64_t last_modified_time{0};
+    uint64_t total_capacity_bytes{0};
+    uint32_t crc{0};
+};
+
+struct shard_archive_blob_record {
+    blob_id_t blob_id{0};
+    uint32_t blk_count{0};
+    uint32_t payload_crc{0};
+    uint32_t data_crc{0}; // of the blocks following the record
+    uint32_t crc{0};
+};
+
+struct shard_archive_index_entry {
+    blob_id_t blob_id{0};
+    uint64_t offset{0}; // of the blob record
+    uint32_t blk_count{0};
+};
+
+struct shard_archive_footer {
+    uint64_t magic{SHARD_ARCHIVE_MAGIC};
+    uint64_t blob_count{0};
+    uint64_t index_offset{0};
+    uint64_t digest{0};
+    uint32_t index_crc{0};
+    uint32_t crc{0};
+};
+#pragma pack()
+
+// crc of all the fields but the trailing crc itself
+template < typename T >
+uint32_t shard_archive_crc(T const& t) {
+    static_assert(offsetof(T, crc) + sizeof(uint32_t) == sizeof(T), "crc must be the last field");
+    return crc32_ieee(0, reinterpret_cast< unsigned char const* >(&t), offsetof(T, crc));
+}
+
+template < typename T >
+void shard_archive_seal(T& t) {
+    t.crc = shard_archive_crc(t);
+}
+
+} // namespace homeobject
@@ -0,0 +1,245 @@
+#include <algorithm>
+
+#include "shard_digest.hpp"
+
+namespace homeobject {
+
+uint64_t ShardDigestTable::element(blob_id_t blob_id, uint32_t payload_crc) {
+    // splitmix64 finalizer, so that nearby ids / crcs do not cancel out each other under XOR
+    uint64_t x = blob_id * 0x9E3779B97F4A7C15ULL + payload_crc;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+size_t ShardDigestTable::stripe_idx(shard_id_t shard_id) {
+    // consecutive shards of a pg land on different stripes, and so do the first shards of different pgs
+    return (shard_id ^ (shard_id >> shard_width)) % num_stripes;
+}
+
+// NOTE: caller should hold the lock of the stripe
+ShardDigestTable::Digest* ShardDigestTable::tracked(Stripe& s, shard_id_t shard_id) {
+    auto it = s.digests.find(shard_id);
+    if (it == s.digests.end()) {
+        // shard from before digests existed, start tracking but do not trust it
+        it = s.digests.emplace(shard_id, Digest{}).first;
+        it->second.stale = true;
+    }
+    s.dirty[shard_id] = false;
+    ++it->second.version;
+    return &it->second;
+}
+
+void ShardDigestTable::create(shard_id_t shard_id) {
+    auto& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    // creation may be replayed from the log, keep what is already known then
+    if (s.digests.try_emplace(shard_id).second) { s.dirty[shard_id] = false; }
+}
+
+void ShardDigestTable::add(shard_id_t shard_id, blob_id_t blob_id, uint32_t payload_crc) {
+    auto const e = element(blob_id, payload_crc);
+    auto& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    auto d = tracked(s, shard_id);
+    d->digest ^= e;
+    d->buckets[blob_id / bucket_width] ^= e;
+    ++d->blob_count;
+}
+
+void ShardDigestTable::remove(shard_id_t shard_id, blob_id_t blob_id, uint32_t payload_crc) {
+    auto const e = element(blob_id, payload_crc);
+    auto& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    auto d = tracked(s, shard_id);
+    if (d->blob_count != 0) { --d->blob_count; }
+    d->digest ^= e;
+    auto const idx = blob_id / bucket_width;
+    if ((d->buckets[idx] ^= e) == 0) { d->buckets.erase(idx); }
+}
+
+void ShardDigestTable::seal(shard_id_t shard_id) {
+    auto& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    auto d = tracked(s, shard_id);
+    if (!d->sealed) { d->sealed = std::make_pair(d->blob_count, d->digest); }
+}
+
+void ShardDigestTable::erase(shard_id_t shard_id) {
+    auto& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    s.digests.erase(shard_id);
+    s.dirty[shard_id] = true;
+}
+
+bool ShardDigestTable::rebuild(shard_id_t shard_id, uint64_t version, Digest d, bool sealed) {
+    auto& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    auto it = s.digests.find(shard_id);
+    if (it == s.digests.end()) {
+        // never tracked is fine, erased (the pg is being destroyed) is not
+        if (auto d_it = s.dirty.find(shard_id); d_it != s.dirty.end() && d_it->second) { return false; }
+        if (version != 0) { return false; }
+    } else if (it->second.version != version) {
+        return false;
+    }
+    d.stale = false;
+    d.sealed = sealed ? std::make_optional(std::make_pair(d.blob_count, d.digest)) : std::nullopt;
+    d.version = version + 1;
+    s.digests.insert_or_assign(shard_id, std::move(d));
+    s.dirty[shard_id] = false;
+    return true;
+}
+
+std::optional< ShardDigestTable::Digest > ShardDigestTable::get(shard_id_t shard_id) const {
+    auto const& s = stripe(shard_id);
+    std::scoped_lock lock(s.mtx);
+    auto it = s.digests.find(shard_id);
+    if (it == s.digests.end()) { return std::nullopt; }
+    return it->second;
+}
+
+std::vector< ShardDigestTable::BlobRange > ShardDigestTable::divergent_ranges(Digest const& lhs, Digest const& rhs) {
+    std::vector< uint64_t > idxs;
+    auto l = lhs.buckets.begin();
+    auto r = rhs.buckets.begin();
+    while (l != lhs.buckets.end() || r != rhs.buckets.end()) {
+        if (r == rhs.buckets.end() || (l != lhs.buckets.end() && l->first < r->first)) {
+            idxs.push_back((l++)->first);
+        } else if (l == lhs.buckets.end() || r->first < l->first) {
+            idxs.push_back((r++)->first);
+        } else {
+            if (l->second != r->second) { idxs.push_back(l->first); }
+            ++l;
+            ++r;
+        }
+    }
+
+    std::vector< BlobRange > ranges;
+    for (auto const idx : idxs) {
+        blob_id_t const first = idx * bucket_width;
+        if (!ranges.empty() && ranges.back().last + 1 == first) {
+            ranges.back().last = first + bucket_width - 1;
+        } else {
+            ranges.push_back(BlobRange{first, first + bucket_width - 1});
+        }
+    }
+    return ranges;
+}
+
+nlohmann::json ShardDigestTable::to_json(shard_id_t shard_id, Digest const& d) {
+    nlohmann::json j;
+    j["shard_id"] = shard_id;
+    j["blob_count"] = d.blob_count;
+    j["digest"] = d.digest;
+    j["stale"] = d.stale;
+    if (d.sealed) {
+        j["sealed_blob_count"] = d.sealed->first;
+        j["sealed_digest"] = d.sealed->second;
+    }
+    auto buckets = nlohmann::json::array();
+    for (auto const& [idx, digest] : d.buckets) {
+        buckets.push_back({idx, digest});
+    }
+    j["buckets"] = std::move(buckets);
+    return j;
+}
+
+std::optional< ShardDigestTable::Digest > ShardDigestTable::from_json(nlohmann::json const& j) {
+    try {
+        Digest d;
+        d.blob_count = j.at("blob_count").get< uint64_t >();
+        d.digest = j.at("digest").get< uint64_t >();
+        d.stale = j.value("stale", false);
+        if (j.contains("sealed_digest")) {
+            d.sealed = std::make_pair(j.at("sealed_blob_count").get< uint64_t >(),
+                                      j.at("sealed_digest").get< uint64_t >());
+        }
+        if (j.contains("buckets")) {
+            for (auto const& b : j.at("buckets")) {
+                d.buckets.emplace(b.at(0).get< uint64_t >(), b.at(1).get< uint64_t >());
+            }
+        }
+        return d;
+    } catch (nlohmann::json::exception const& e) {
+        LOGW("Malformed shard digest {}, err={}", j.dump(), e.what());
+        return std::nullopt;
+    }
+}
+
+void ShardDigestTable::flush() {
+    std::scoped_lock sb_lock(sb_mtx_);
+    std::vector< std::pair< shard_id_t, std::optional< Digest > > > changed;
+    for (auto& s : stripes_) {
+        std::scoped_lock lock(s.mtx);
+        for (auto const& [shard_id, erased] : s.dirty) {
+            if (erased) {
+                changed.emplace_back(shard_id, std::nullopt);
+            } else {
+                changed.emplace_back(shard_id, s.digests.at(shard_id));
+            }
+        }
+        s.dirty.clear();
+    }
+
+    for (auto& [shard_id, d] : changed) {
+        auto it = sbs_.find(shard_id);
+        if (!d) {
+            if (it != sbs_.end()) {
+                it->second.destroy();
+                sbs_.erase(it);
+            }
+            continue;
+        }
+
+        auto const num_buckets = static_cast< uint32_t >(d->buckets.size());
+        if (it == sbs_.end()) {
+            it = sbs_.emplace(shard_id, homestore::superblk< shard_digest_superblk >{_shard_digest_meta_name}).first;
+        }
+        auto& sb = it->second;
+        // buckets come and go, recreate the meta blk whenever their number changes
+        if (!sb.is_empty() && sb->num_buckets != num_buckets) { sb.destroy(); }
+        if (sb.is_empty()) {
+            sb.create(sizeof(shard_digest_superblk) + (std::max(num_buckets, 1u) - 1) * sizeof(digest_bucket));
+        }
+
+        sb->shard_id = shard_id;
+        sb->blob_count = d->blob_count;
+        sb->digest = d->digest;
+        sb->stale = d->stale ? 1 : 0;
+        sb->sealed = d->sealed ? 1 : 0;
+        sb->sealed_blob_count = d->sealed ? d->sealed->first : 0;
+        sb->sealed_digest = d->sealed ? d->sealed->second : 0;
+        sb->num_buckets = num_buckets;
+        uint32_t i{0};
+        for (auto const& [idx, digest] : d->buckets) {
+            sb->buckets[i++] = digest_bucket{idx, digest};
+        }
+        sb.write();
+    }
+}
+
+void ShardDigestTable::on_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf) {
+    homestore::superblk< shard_digest_superblk > sb(_shard_digest_meta_name);
+    sb.load(buf, mblk);
+
+    Digest d;
+    d.blob_count = sb->blob_count;
+    d.digest = sb->digest;
+    d.stale = sb->stale != 0;
+    if (sb->sealed) { d.sealed = std::make_pair(sb->sealed_blob_count, sb->sealed_digest); }
+    for (uint32_t i = 0; i < sb->num_buckets; ++i) {
+        d.buckets.emplace(sb->buckets[i].idx, sb->buckets[i].digest);
+    }
+
+    auto const shard_id = sb->shard_id;
+    {
+        auto& s = stripe(shard_id);
+        std::scoped_lock lock(s.mtx);
+        s.digests.insert_or_assign(shard_id, std::move(d));
+    }
+    std::scoped_lock sb_lock(sb_mtx_);
+    sbs_.insert_or_assign(shard_id, std::move(sb));
+}
+
+} // namespace homeobject
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <homestore/superblk_handler.hpp>
+#include <nlohmann/json.hpp>
+
+#include "lib/homeobject_impl.hpp"
+
+namespace homeobject {
+
+/**
+ * Per shard digests of the live blobs, so that replicas can check they hold identical data without reading it.
+ *
+ * The digest of a shard is the XOR of one element per live blob, mixed from its blob_id and the crc of its payload.
+ * It is kept up to date as blobs are committed: a put folds the element of its blob in, a delete folds it back out.
+ * The payload crc travels in the replication message header of a put and is kept in the blob index along with the
+ * pbas, where a delete finds it. No payload is read for it. Elements are also folded
+ * into buckets of bucket_width consecutive blob ids, comparing the buckets of two replicas narrows a divergent shard
+ * down to blob id ranges. The digest as of the seal of a shard is kept aside, it never changes afterwards.
+ *
+ * Digests are persisted in one meta blk per shard on every checkpoint, along with the durable counters of the pgs.
+ * A shard without digest (created before digests existed) is reported as stale until the scrubber, which reads all
+ * its blobs anyway, rebuilds it.
+ *
+ * Shards are spread over num_stripes stripes, each with a lock of its own, so that commits to different shards seldom
+ * wait for each other.
+ */
+class ShardDigestTable {
+public:
+    static constexpr blob_id_t bucket_width{1024};
+    static constexpr size_t num_stripes{64};
+    inline static auto const _shard_digest_meta_name = std::string("ShardDigest");
+
+#pragma pack(1)
+    struct digest_bucket {
+        uint64_t idx;
+        uint64_t digest;
+    };
+
+    struct shard_digest_superblk {
+        shard_id_t shard_id;
+        uint64_t blob_count;
+        uint64_t digest;
+        uint8_t stale;
+        uint8_t sealed;
+        uint64_t sealed_blob_count;
+        uint64_t sealed_digest;
+        uint32_t num_buckets;
+        digest_bucket buckets[1];
+    };
+#pragma pack()
+
+    struct Digest {
+        uint64_t blob_count{0};
+        uint64_t digest{0};
+        bool stale{false};
+        // (blob_count, digest) as of the seal of the shard
+        std::optional< std::pair< uint64_t, uint64_t > > sealed;
+        // bucket index -> digest of the blobs in [idx * bucket_width, (idx + 1) * bucket_width)
+        std::map< uint64_t, uint64_t > buckets;
+        // bumped on every change, not persisted
+        uint64_t version{0};
+    };
+
+    struct BlobRange {
+        blob_id_t first;
+        blob_id_t last;
+    };
+
+    ShardDigestTable() = default;
+    ~ShardDigestTable() = default;
+    ShardDigestTable(const ShardDigestTable&) = delete;
+    ShardDigestTable(ShardDigestTable&&) = delete;
+    ShardDigestTable& operator=(const ShardDigestTable&) = delete;
+    ShardDigestTable& operator=(ShardDigestTable&&) = delete;
+
+    static uint64_t element(blob_id_t blob_id, uint32_t payload_crc);
+
+    // A shard starts tracked with an empty digest when it is created, a no-op if it is tracked already.
+    void create(shard_id_t shard_id);
+    void add(shard_id_t shard_id, blob_id_t blob_id, uint32_t payload_crc);
+    void remove(shard_id_t shard_id, blob_id_t blob_id, uint32_t payload_crc);
+    void seal(shard_id_t shard_id);
+    void erase(shard_id_t shard_id);
+
+    /**
+     * @brief Replace the digest of a shard with one computed from its blobs.
+     *
+     * @param version The version of the digest when the computation started, nothing is replaced (false returned) if
+     * the shard changed meanwhile.
+     * @param sealed Whether the shard is sealed, the rebuilt digest is then also the one as of the seal.
+     */
+    bool rebuild(shard_id_t shard_id, uint64_t version, Digest d, bool sealed);
+
+    // nullopt if the shard is not tracked
+    std::optional< Digest > get(shard_id_t shard_id) const;
+
+    /**
+     * @brief The blob id ranges whose buckets differ between two digests of the same shard, adjacent ones merged.
+     */
+    static std::vector< BlobRange > divergent_ranges(Digest const& lhs, Digest const& rhs);
+
+    static nlohmann::json to_json(shard_id_t shard_id, Digest const& d);
+    static std::optional< Digest > from_json(nlohmann::json const& j);
+
+    // Persist the digests changed since the last call, called on checkpoint flush.
+    void flush();
+    void on_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf);
+
+private:
+    struct Stripe {
+        mutable std::mutex mtx;
+        std::unordered_map< shard_id_t, Digest > digests;
+        std::unordered_map< shard_id_t, bool > dirty; // shard -> whether it was erased meanwhile
+    };
+
+    Stripe& stripe(shard_id_t shard_id) { return stripes_[stripe_idx(shard_id)]; }
+    Stripe const& stripe(shard_id_t shard_id) const { return stripes_[stripe_idx(shard_id)]; }
+    static size_t stripe_idx(shard_id_t shard_id);
+
+    // NOTE: caller should hold the lock of the stripe
+    static Digest* tracked(Stripe& s, shard_id_t shard_id);
+
+    std::array< Stripe, num_stripes > stripes_;
+
+    // serializes flushes, guards sbs_
+    std::mutex sb_mtx_;
+    std::unordered_map< shard_id_t, homestore::superblk< shard_digest_superblk > > sbs_;
+};
+
+} // namespace homeobject
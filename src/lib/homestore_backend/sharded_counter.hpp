@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace homeobject {
+
+/**
+ * Counter split into cache line sized slots, each thread updates the slot it was assigned on first use.
+ *
+ * Increments and decrements of the same logical unit may happen on different threads (e.g. a request finished on a
+ * future continuation), so a single slot can go negative; only the sum over all slots is meaningful. Reads are meant
+ * to be rare (metrics, shutdown drain) and sum all the slots. The slots are not summed under a snapshot, a read racing
+ * with updates may be off by the updates in flight; get_stable() retries until two consecutive sums agree.
+ */
+class ShardedCounter {
+public:
+    static constexpr size_t num_slots{64};
+
+    ShardedCounter() = default;
+    ShardedCounter(const ShardedCounter&) = delete;
+    ShardedCounter(ShardedCounter&&) = delete;
+    ShardedCounter& operator=(const ShardedCounter&) = delete;
+    ShardedCounter& operator=(ShardedCounter&&) = delete;
+
+    void increment(int64_t n = 1) { slots_[slot_index()].value.fetch_add(n, std::memory_order_relaxed); }
+    void decrement(int64_t n = 1) { slots_[slot_index()].value.fetch_sub(n, std::memory_order_relaxed); }
+
+    int64_t get() const {
+        int64_t sum{0};
+        for (auto const& s : slots_) {
+            sum += s.value.load(std::memory_order_acquire);
+        }
+        return sum;
+    }
+
+    int64_t get_stable() const {
+        auto prev = get();
+        while (true) {
+            auto const now = get();
+            if (now == prev) { return now; }
+            prev = now;
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic< int64_t > value{0};
+    };
+
+    static size_t slot_index() {
+        static std::atomic< size_t > next_slot{0};
+        static thread_local size_t idx = next_slot.fetch_add(1, std::memory_order_relaxed) % num_slots;
+        return idx;
+    }
+
+    std::array< Slot, num_slots > slots_;
+};
+
+} // namespace homeobject
@@ -1,7 +1,9 @@
+#include <unordered_set>
 #include <utility>
 
 #include "hs_homeobject.hpp"
 #include "replication_state_machine.hpp"
+#include "hs_backend_config.hpp"
 
 #include <boost/uuid/random_generator.hpp>
 #include <homestore/blkdata_service.hpp>
@@ -12,12 +14,89 @@ HSHomeObject::SnapshotReceiveHandler::SnapshotReceiveHandler(HSHomeObject& home_
                                                              shared< homestore::ReplDev > repl_dev) :
         home_obj_(home_obj), repl_dev_(std::move(repl_dev)) {}
 
+bool HSHomeObject::SnapshotReceiveHandler::can_delta_resync(ResyncPGMetaData const& pg_meta) const {
+    if (!HS_BACKEND_DYNAMIC_CONFIG(snapshot_delta_resync_enabled)) { return false; }
+    auto const digests = pg_meta.shard_digests();
+    if (digests == nullptr || digests->size() != pg_meta.shard_ids()->size()) { return false; }
+
+    auto hs_pg = home_obj_.get_hs_pg(pg_meta.pg_id());
+    if (hs_pg == nullptr) { return false; }
+    if (!std::equal(hs_pg->pg_info_.replica_set_uuid.begin(), hs_pg->pg_info_.replica_set_uuid.end(),
+                    pg_meta.replica_set_uuid()->data())) {
+        LOGI("pg={} belongs to another replica set here, no delta resync", pg_meta.pg_id());
+        return false;
+    }
+
+    // Every local shard must still be known by the leader, in a state it can move on from
+    std::unordered_map< shard_id_t, ShardInfo::State > leader_shards;
+    for (unsigned int i = 0; i < digests->size(); i++) {
+        leader_shards.emplace(digests->Get(i)->shard_id(), static_cast< ShardInfo::State >(digests->Get(i)->state()));
+    }
+    std::scoped_lock lock_guard(home_obj_._shard_lock);
+    for (auto const& shard : hs_pg->shards_) {
+        auto it = leader_shards.find(shard->info.id);
+        if (it == leader_shards.end() ||
+            (shard->info.state == ShardInfo::State::SEALED && it->second != ShardInfo::State::SEALED)) {
+            LOGI("shardID=0x{:x} of pg={} diverged from the leader, no delta resync", shard->info.id,
+                 pg_meta.pg_id());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HSHomeObject::SnapshotReceiveHandler::delta_shard_in_sync(ShardDigest const& leader) {
+    auto const shard_id = leader.shard_id();
+    std::optional< ShardInfo::State > state;
+    {
+        std::scoped_lock lock_guard(home_obj_._shard_lock);
+        if (auto it = home_obj_._shard_map.find(shard_id); it != home_obj_._shard_map.end()) {
+            state = (*it->second)->info.state;
+        }
+    }
+    if (!state) { return false; }
+
+    auto local = home_obj_.compute_shard_summary(ctx_->pg_id, shard_id);
+    if (!local) {
+        LOGW("Failed to compute local digest of shardID=0x{:x}, resync it all, err={}", shard_id, local.error());
+        return false;
+    }
+    if (local->blob_count == leader.blob_count() && local->digest == leader.digest() &&
+        static_cast< uint8_t >(*state) == leader.state()) {
+        return true;
+    }
+
+    // The blobs up to the last checkpoint both sides agree on need not be sent again
+    auto const ids = leader.checkpoint_blob_ids();
+    auto const digests = leader.checkpoint_digests();
+    size_t n = std::min(local->checkpoint_blob_ids.size(), ids ? ids->size() : 0);
+    if (digests) { n = std::min(n, static_cast< size_t >(digests->size())); }
+    size_t common = 0;
+    while (common < n && local->checkpoint_blob_ids[common] == ids->Get(common) &&
+           local->checkpoint_digests[common] == digests->Get(common)) {
+        ++common;
+    }
+    if (common != 0) {
+        ctx_->delta_seek[shard_id] = local->checkpoint_blob_ids[common - 1];
+        std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
+        ctx_->progress.skipped_blobs += common * shard_summary_interval;
+    }
+    LOGI("shardID=0x{:x} differs from the leader, local blobs={} leader blobs={}, in sync up to blob_id={}", shard_id,
+         local->blob_count, leader.blob_count(),
+         common != 0 ? std::to_string(local->checkpoint_blob_ids[common - 1]) : "none");
+    return false;
+}
+
 int HSHomeObject::SnapshotReceiveHandler::process_pg_snapshot_data(ResyncPGMetaData const& pg_meta) {
     LOGI("process_pg_snapshot_data pg={}", pg_meta.pg_id());
 
     // Init shard list
     ctx_->shard_list.clear();
+    ctx_->delta_seek.clear();
     const auto ids = pg_meta.shard_ids();
+    if (can_delta_resync(pg_meta)) {
+        return process_pg_delta_snapshot_data(pg_meta);
+    }
     for (unsigned int i = 0; i < ids->size(); i++) {
         ctx_->shard_list.push_back(ids->Get(i));
     }
@@ -43,7 +122,7 @@ int HSHomeObject::SnapshotReceiveHandler::process_pg_snapshot_data(ResyncPGMetaD
         return CREATE_PG_ERR;
     }
 #endif
-    auto ret = home_obj_.local_create_pg(repl_dev_, pg_info);
+    auto ret = home_obj_.local_create_pg(repl_dev_, pg_info, 0 /* tid */, true /* sorted_inserts */);
     if (ret.hasError()) {
         LOGE("Failed to create pg={}, err {}", pg_meta.pg_id(), ret.error());
         return CREATE_PG_ERR;
@@ -54,6 +133,9 @@ int HSHomeObject::SnapshotReceiveHandler::process_pg_snapshot_data(ResyncPGMetaD
     hs_pg->shard_sequence_num_ = pg_meta.shard_seq_num();
     hs_pg->durable_entities_update(
         [&pg_meta](auto& de) { de.blob_sequence_num.store(pg_meta.blob_seq_num(), std::memory_order_relaxed); });
+    // Blobs installed by the snapshot are not committed from the log, log entries following the snapshot may carry
+    // them again.
+    hs_pg->raise_replay_blob_id_boundary(pg_meta.blob_seq_num());
 
     // update metrics
     std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
@@ -66,10 +148,96 @@ int HSHomeObject::SnapshotReceiveHandler::process_pg_snapshot_data(ResyncPGMetaD
     return 0;
 }
 
+int HSHomeObject::SnapshotReceiveHandler::process_pg_delta_snapshot_data(ResyncPGMetaData const& pg_meta) {
+    auto hs_pg = const_cast< HS_PG* >(home_obj_.get_hs_pg(pg_meta.pg_id()));
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found, pg={}", pg_meta.pg_id());
+    LOGI("pg={} is still here, delta resync against {} shards of the leader", pg_meta.pg_id(),
+         pg_meta.shard_ids()->size());
+
+    // Only catch up the sequence numbers, the local ones may only be behind
+    if (pg_meta.shard_seq_num() > hs_pg->shard_sequence_num_) { hs_pg->shard_sequence_num_ = pg_meta.shard_seq_num(); }
+    hs_pg->durable_entities_update([&pg_meta](auto& de) {
+        if (pg_meta.blob_seq_num() > de.blob_sequence_num.load(std::memory_order_relaxed)) {
+            de.blob_sequence_num.store(pg_meta.blob_seq_num(), std::memory_order_relaxed);
+        }
+    });
+    hs_pg->raise_replay_blob_id_boundary(pg_meta.blob_seq_num());
+
+    // Ask the leader only for the shards which differ
+    uint64_t skipped_shards{0}, skipped_blobs{0}, skipped_bytes{0};
+    auto const digests = pg_meta.shard_digests();
+    for (unsigned int i = 0; i < digests->size(); i++) {
+        auto const d = digests->Get(i);
+        if (delta_shard_in_sync(*d)) {
+            LOGD("shardID=0x{:x} is in sync with the leader, skip it", d->shard_id());
+            ++skipped_shards;
+            skipped_blobs += d->blob_count();
+            skipped_bytes += d->total_bytes();
+            continue;
+        }
+        ctx_->shard_list.push_back(d->shard_id());
+    }
+
+    std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
+    ctx_->progress.start_time =
+        std::chrono::duration_cast< std::chrono::seconds >(std::chrono::system_clock::now().time_since_epoch()).count();
+    ctx_->progress.total_shards = ctx_->shard_list.size();
+    ctx_->progress.skipped_shards = skipped_shards;
+    ctx_->progress.skipped_blobs += skipped_blobs;
+    ctx_->progress.skipped_bytes = skipped_bytes;
+    auto const sub = [](uint64_t a, uint64_t b) { return a > b ? a - b : 0; };
+    ctx_->progress.total_blobs = sub(pg_meta.total_blobs_to_transfer(), ctx_->progress.skipped_blobs);
+    ctx_->progress.total_bytes = sub(pg_meta.total_bytes_to_transfer(), skipped_bytes);
+    LOGI("Delta resync of pg={}: {} shards to transfer, skipped shards={} blobs={} bytes={}", pg_meta.pg_id(),
+         ctx_->shard_list.size(), skipped_shards, ctx_->progress.skipped_blobs, skipped_bytes);
+    return 0;
+}
+
 int HSHomeObject::SnapshotReceiveHandler::process_shard_snapshot_data(ResyncShardMetaData const& shard_meta) {
     LOGI("process_shard_snapshot_data shardID=0x{:x}, pg={}, shard=0x{:x}", shard_meta.shard_id(),
          (shard_meta.shard_id() >> homeobject::shard_width), (shard_meta.shard_id() & homeobject::shard_mask));
 
+    // A shard we already hold (part of): a resumed one, or one a delta resync found out of sync. Ask for the blobs
+    // after the last one known to be in sync, and drop the local ones the leader no longer has on the way.
+    std::optional< ShardInfo > local_info;
+    {
+        std::scoped_lock lock_guard(home_obj_._shard_lock);
+        if (auto it = home_obj_._shard_map.find(shard_meta.shard_id()); it != home_obj_._shard_map.end()) {
+            local_info = (*it->second)->info;
+        }
+    }
+    if (local_info) {
+        std::optional< blob_id_t > after;
+        if (shard_meta.shard_id() == ctx_->shard_cursor && ctx_->last_blob_id) {
+            after = ctx_->last_blob_id;
+        } else if (auto it = ctx_->delta_seek.find(shard_meta.shard_id()); it != ctx_->delta_seek.end()) {
+            after = it->second;
+        }
+        if (after && *after > MAX_SEEK_BLOB_ID) { after.reset(); }
+        LOGI("Reconcile existing shardID=0x{:x} after blob_id={}", shard_meta.shard_id(),
+             after ? std::to_string(*after) : "none");
+
+        auto const leader_state = static_cast< ShardInfo::State >(shard_meta.state());
+        if (local_info->state == ShardInfo::State::OPEN && leader_state == ShardInfo::State::SEALED) {
+            // its chunk is released once all of its blobs are in, like for a shard received sealed
+            local_info->state = ShardInfo::State::SEALED;
+            local_info->last_modified_time = shard_meta.last_modified_time();
+            home_obj_.update_shard_in_map(*local_info);
+        }
+        ctx_->shard_cursor = shard_meta.shard_id();
+        ctx_->cur_batch_num = 0;
+        ctx_->last_blob_id = after;
+        ctx_->resume_blob_id = after;
+        ctx_->reconciling = true;
+        ctx_->reconcile_after = after;
+        return 0;
+    }
+    ctx_->last_blob_id.reset();
+    ctx_->resume_blob_id.reset();
+    ctx_->reconciling = false;
+    ctx_->reconcile_after.reset();
+    ctx_->bytes_since_checkpoint = 0;
+
     // Persist shard meta on chunk data
     sisl::io_blob_safe aligned_buf(sisl::round_up(sizeof(shard_info_superblk), io_align), io_align);
     shard_info_superblk* shard_sb = r_cast< shard_info_superblk* >(aligned_buf.bytes());
@@ -175,6 +343,9 @@ int HSHomeObject::SnapshotReceiveHandler::process_blobs_snapshot_data(ResyncBlob
 
     std::vector< folly::Future< std::error_code > > futs;
     std::vector< std::shared_ptr< sisl::io_blob_safe > > data_bufs;
+    std::vector< BlobInfo > written_blobs;
+    std::mutex written_blobs_mtx;
+    written_blobs.reserve(data_blobs.blob_list()->size());
 
     auto skipped_blobs = 0;
     for (unsigned int i = 0; i < data_blobs.blob_list()->size(); i++) {
@@ -285,13 +456,20 @@ int HSHomeObject::SnapshotReceiveHandler::process_blobs_snapshot_data(ResyncBlob
         }
 #endif
         auto blob_id = blob->blob_id();
+        auto const payload_crc = r_cast< BlobHeader const* >(blob_data)->payload_crc();
         LOGW("Writing Blob {} to blk_id {}", blob_id, blk_id.to_string());
 
         // ToDo: limit the max concurrent?
         futs.emplace_back(
-            homestore::data_service()
-                .async_write(r_cast< char const* >(aligned_buf->cbytes()), aligned_buf->size(), blk_id)
-                .thenValue([this, blk_id, start, blob_id](auto&& err) -> folly::Future< std::error_code > {
+            home_obj_
+                .issue_data_io(ctx_->pg_id, PGIoScheduler::io_type::WRITE, PGIoScheduler::io_class::BACKGROUND,
+                               aligned_buf->size(),
+                               [aligned_buf, blk_id]() {
+                                   return homestore::data_service().async_write(
+                                       r_cast< char const* >(aligned_buf->cbytes()), aligned_buf->size(), blk_id);
+                               })
+                .thenValue([this, blk_id, start, blob_id, payload_crc, &written_blobs,
+                            &written_blobs_mtx](auto&& err) -> folly::Future< std::error_code > {
                     // TODO: do we need to update repl_dev metrics?
                     if (err) {
                         LOGE("Failed to write blob info to blk_id={}, free the blk.", blk_id.to_string());
@@ -305,13 +483,10 @@ int HSHomeObject::SnapshotReceiveHandler::process_blobs_snapshot_data(ResyncBlob
                         homestore::data_service().async_free_blk(blk_id).get();
                         return err;
                     }
-                    // Add local blob info to index & PG
-                    bool success =
-                        home_obj_.local_add_blob_info(ctx_->pg_id, BlobInfo{ctx_->shard_cursor, blob_id, blk_id});
-                    if (!success) {
-                        LOGE("Failed to add blob info for blob_id={}", blob_id);
-                        homestore::data_service().async_free_blk(blk_id).get();
-                        return err;
+                    // Index & PG update is applied for the whole batch once all data writes are done
+                    {
+                        std::scoped_lock lock(written_blobs_mtx);
+                        written_blobs.push_back(BlobInfo{ctx_->shard_cursor, blob_id, blk_id, payload_crc});
                     }
 
                     auto duration = get_elapsed_time_us(start);
@@ -325,6 +500,22 @@ int HSHomeObject::SnapshotReceiveHandler::process_blobs_snapshot_data(ResyncBlob
     // when there is a allocation failure it breaks the while loop earlier.
     auto all_io_submitted = (futs.size() + skipped_blobs == data_blobs.blob_list()->size());
 
+    // Add all persisted blobs of this batch to index & PG in one sorted pass
+    auto const index_start = Clock::now();
+    auto const applied = home_obj_.local_add_blob_infos(ctx_->pg_id, written_blobs);
+    if (applied != written_blobs.size()) {
+        LOGE("Failed to add blob info for {} of {} blobs, first failed blob_id={}", written_blobs.size() - applied,
+             written_blobs.size(), written_blobs[applied].blob_id);
+        for (auto i = applied; i < written_blobs.size(); ++i) {
+            homestore::data_service().async_free_blk(written_blobs[i].pbas).get();
+        }
+        std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
+        ctx_->progress.error_count++;
+        return ADD_BLOB_INDEX_ERR;
+    }
+    auto const index_us = get_elapsed_time_us(index_start);
+    LOGD("Indexed {} blobs of the batch in {}us", applied, index_us);
+
     if (!all_io_submitted || ec != std::error_code{}) {
         if (!all_io_submitted) {
             LOGE("Errors in submitting the batch, expect {} blobs, submitted {}.", data_blobs.blob_list()->size(),
@@ -346,6 +537,28 @@ int HSHomeObject::SnapshotReceiveHandler::process_blobs_snapshot_data(ResyncBlob
         ctx_->progress.cur_batch_bytes = total_bytes;
         ctx_->progress.complete_blobs += ctx_->progress.cur_batch_blobs;
         ctx_->progress.complete_bytes += ctx_->progress.cur_batch_bytes;
+        ctx_->progress.index_build_us += index_us;
+        if (auto hs_pg = home_obj_.get_hs_pg(ctx_->pg_id); hs_pg) {
+            ctx_->progress.index_size_bytes = hs_pg->index_table_->used_size();
+        }
+    }
+
+    // Every blob of the batch is persisted and indexed by now, drop what the leader deleted meanwhile up to its end
+    if (ctx_->reconciling) {
+        auto const n = data_blobs.blob_list()->size();
+        auto const upto = is_last_batch || n == 0 ? std::numeric_limits< blob_id_t >::max()
+                                                  : data_blobs.blob_list()->Get(n - 1)->blob_id();
+        if (auto const r = drop_blobs_gone_on_leader(data_blobs, upto); r != 0) { return r; }
+        ctx_->reconcile_after = upto;
+    }
+    ctx_->resume_blob_id.reset();
+    if (auto const n = data_blobs.blob_list()->size(); n != 0) {
+        ctx_->last_blob_id = data_blobs.blob_list()->Get(n - 1)->blob_id();
+    }
+    ctx_->bytes_since_checkpoint += total_bytes;
+    auto const checkpoint_bytes = HS_BACKEND_DYNAMIC_CONFIG(snapshot_resume_checkpoint_mb) * Mi;
+    if (!is_last_batch && checkpoint_bytes != 0 && ctx_->bytes_since_checkpoint >= checkpoint_bytes) {
+        update_snp_info_sb(false, true /* in_shard */);
     }
 
     if (is_last_batch) {
@@ -371,6 +584,56 @@ int HSHomeObject::SnapshotReceiveHandler::process_blobs_snapshot_data(ResyncBlob
     return 0;
 }
 
+int HSHomeObject::SnapshotReceiveHandler::drop_blobs_gone_on_leader(ResyncBlobDataBatch const& data_blobs,
+                                                                     blob_id_t upto_blob_id) {
+    if (ctx_->reconcile_after && *ctx_->reconcile_after >= upto_blob_id) { return 0; }
+    auto const from = ctx_->reconcile_after ? *ctx_->reconcile_after + 1 : 0;
+
+    auto local = home_obj_.query_blobs_in_shard(ctx_->pg_id, get_sequence_num_from_shard_id(ctx_->shard_cursor),
+                                                from, UINT64_MAX, upto_blob_id);
+    if (!local) {
+        LOGE("Failed to list local blobs of shardID=0x{:x} in [{}, {}], err={}", ctx_->shard_cursor, from,
+             upto_blob_id, local.error());
+        std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
+        ctx_->progress.error_count++;
+        return DROP_BLOB_ERR;
+    }
+
+    std::unordered_set< blob_id_t > alive;
+    for (unsigned int i = 0; i < data_blobs.blob_list()->size(); i++) {
+        auto const blob = data_blobs.blob_list()->Get(i);
+        if (blob->state() != static_cast< uint8_t >(ResyncBlobState::DELETED)) { alive.insert(blob->blob_id()); }
+    }
+
+    auto hs_pg = const_cast< HS_PG* >(home_obj_.get_hs_pg(ctx_->pg_id));
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found for pg={}", ctx_->pg_id);
+    uint64_t dropped{0};
+    for (auto const& info : local.value()) {
+        if (info.pbas == tombstone_pbas || alive.contains(info.blob_id)) { continue; }
+        auto r = home_obj_.move_to_tombstone(hs_pg->index_table_, info);
+        if (!r) {
+            LOGE("Failed to drop blob_id={} of shardID=0x{:x} gone on the leader, err={}", info.blob_id,
+                 ctx_->shard_cursor, r.error());
+            std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
+            ctx_->progress.error_count++;
+            return DROP_BLOB_ERR;
+        }
+        LOGD("Dropped blob_id={} of shardID=0x{:x}, deleted on the leader", info.blob_id, ctx_->shard_cursor);
+        home_obj_.shard_digests()->remove(ctx_->shard_cursor, info.blob_id, r->payload_crc);
+        homestore::data_service().async_free_blk(r->pbas).get();
+        hs_pg->durable_entities_update([](auto& de) {
+            de.active_blob_count.fetch_sub(1, std::memory_order_relaxed);
+            de.tombstone_blob_count.fetch_add(1, std::memory_order_relaxed);
+        });
+        ++dropped;
+    }
+    if (dropped != 0) {
+        std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
+        ctx_->progress.dropped_blobs += dropped;
+    }
+    return 0;
+}
+
 int64_t HSHomeObject::SnapshotReceiveHandler::get_context_lsn() const { return ctx_ ? ctx_->snp_lsn : -1; }
 pg_id_t HSHomeObject::SnapshotReceiveHandler::get_context_pg_id() const { return ctx_ ? ctx_->pg_id : 0; }
 
@@ -396,15 +659,19 @@ bool HSHomeObject::SnapshotReceiveHandler::load_prev_context_and_metrics() {
 
     ctx_ = std::make_shared< SnapshotContext >(hs_pg->snp_rcvr_info_sb_->snp_lsn, hs_pg->snp_rcvr_info_sb_->pg_id);
     ctx_->shard_cursor = hs_pg->snp_rcvr_info_sb_->shard_cursor;
-    ctx_->cur_batch_num = 0; // Always resume from the beginning of the shard
+    ctx_->cur_batch_num = 0;
+    // Resume after the last checkpointed blob if the shard was partially received, from its beginning otherwise
+    if (hs_pg->snp_rcvr_info_sb_->shard_in_progress) { ctx_->last_blob_id = hs_pg->snp_rcvr_info_sb_->last_blob_id; }
     ctx_->index_table = hs_pg->index_table_;
     ctx_->shard_list = hs_pg->snp_rcvr_shard_list_sb_->get_shard_list();
     ctx_->progress = snapshot_progress(hs_pg->snp_rcvr_info_sb_->progress);
     metrics_ = std::make_unique< ReceiverSnapshotMetrics >(ctx_);
 
-    LOGINFO("Resuming snapshot receiver context from lsn={} pg={} shardID=0x{:x}, pg={}, shard=0x{:x}", ctx_->snp_lsn,
-            hs_pg->snp_rcvr_info_sb_->pg_id, ctx_->shard_cursor, (ctx_->shard_cursor >> homeobject::shard_width),
-            (ctx_->shard_cursor & homeobject::shard_mask));
+    LOGINFO("Resuming snapshot receiver context from lsn={} pg={} shardID=0x{:x}, pg={}, shard=0x{:x}, "
+            "last_blob_id={}",
+            ctx_->snp_lsn, hs_pg->snp_rcvr_info_sb_->pg_id, ctx_->shard_cursor,
+            (ctx_->shard_cursor >> homeobject::shard_width), (ctx_->shard_cursor & homeobject::shard_mask),
+            ctx_->last_blob_id ? std::to_string(*ctx_->last_blob_id) : "none");
     return true;
 }
 
@@ -418,6 +685,11 @@ void HSHomeObject::SnapshotReceiveHandler::destroy_context_and_metrics() {
     metrics_.reset();
     auto hs_pg = home_obj_.get_hs_pg(ctx_->pg_id);
     if (hs_pg == nullptr) { return; }
+    {
+        std::shared_lock< std::shared_mutex > lock(ctx_->progress_lock);
+        LOGI("Baseline resync of pg={} indexed {} blobs in {}ms, index size={} bytes", ctx_->pg_id,
+             ctx_->progress.complete_blobs, ctx_->progress.index_build_us / 1000, hs_pg->index_table_->used_size());
+    }
     hs_pg->snp_rcvr_info_sb_.destroy();
     hs_pg->snp_rcvr_shard_list_sb_.destroy();
     ctx_.reset();
@@ -425,6 +697,10 @@ void HSHomeObject::SnapshotReceiveHandler::destroy_context_and_metrics() {
 
 shard_id_t HSHomeObject::SnapshotReceiveHandler::get_shard_cursor() const { return ctx_->shard_cursor; }
 
+std::optional< blob_id_t > HSHomeObject::SnapshotReceiveHandler::get_resume_blob_id() const {
+    return ctx_->resume_blob_id;
+}
+
 shard_id_t HSHomeObject::SnapshotReceiveHandler::get_next_shard() const {
     if (ctx_->shard_list.empty()) { return shard_list_end_marker; }
 
@@ -439,11 +715,19 @@ shard_id_t HSHomeObject::SnapshotReceiveHandler::get_next_shard() const {
     return invalid_shard_id;
 }
 
-void HSHomeObject::SnapshotReceiveHandler::update_snp_info_sb(bool init) {
+void HSHomeObject::SnapshotReceiveHandler::update_snp_info_sb(bool init, bool in_shard) {
     auto hs_pg = home_obj_.get_hs_pg(ctx_->pg_id);
     RELEASE_ASSERT(hs_pg != nullptr, "PG not found, pg={}", ctx_->pg_id);
 
+    // Ensure all the index/data updates covered by the checkpoint are on disk before the superblk claims them
+    auto fut = homestore::hs()->cp_mgr().trigger_cp_flush(true /* force */);
+    auto const flushed = std::move(fut).get();
+    LOGINFO("Update snp_info sb, in_shard={}, CP Flush {}", in_shard, flushed ? "success" : "failed");
+    if (!flushed && in_shard) { return; }
+
     auto* sb = hs_pg->snp_rcvr_info_sb_.get();
+    // a checkpoint inside the first shard comes before the one at its end
+    if (hs_pg->snp_rcvr_info_sb_.is_empty()) { init = true; }
     if (init) {
         if (!hs_pg->snp_rcvr_info_sb_.is_empty()) { hs_pg->snp_rcvr_info_sb_.destroy(); }
         if (!hs_pg->snp_rcvr_shard_list_sb_.is_empty()) { hs_pg->snp_rcvr_shard_list_sb_.destroy(); }
@@ -460,7 +744,18 @@ void HSHomeObject::SnapshotReceiveHandler::update_snp_info_sb(bool init) {
     RELEASE_ASSERT(sb != nullptr, "Snapshot info superblk not found");
     sb->snp_lsn = ctx_->snp_lsn;
     sb->pg_id = ctx_->pg_id;
-    sb->shard_cursor = get_next_shard();
+    if (in_shard) {
+        sb->shard_cursor = ctx_->shard_cursor;
+        sb->shard_in_progress = 1;
+        sb->last_blob_id = ctx_->last_blob_id.value_or(0);
+        sb->batch_num = ctx_->cur_batch_num;
+    } else {
+        sb->shard_cursor = get_next_shard();
+        sb->shard_in_progress = 0;
+        sb->last_blob_id = 0;
+        sb->batch_num = 0;
+    }
+    ctx_->bytes_since_checkpoint = 0;
 
     {
         std::unique_lock< std::shared_mutex > lock(ctx_->progress_lock);
@@ -475,10 +770,6 @@ void HSHomeObject::SnapshotReceiveHandler::update_snp_info_sb(bool init) {
     }
 
     hs_pg->snp_rcvr_info_sb_.write();
-
-    // Ensure all the superblk & corresponding index/data update have been written to disk
-    auto fut = homestore::hs()->cp_mgr().trigger_cp_flush(true /* force */);
-    LOGINFO("Update snp_info sb, CP Flush {}", std::move(fut).get() ? "success" : "failed");
 }
 
 void HSHomeObject::on_snp_rcvr_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf) {
@@ -237,6 +237,20 @@ public:
         }
     }
 
+    // A new pg with a single shard holding num_blobs blobs, blob ids 0 to num_blobs - 1. put_us, if given, is set to
+    // the time the puts took.
+    ShardInfo create_pg_with_blobs(pg_id_t pg_id, uint64_t num_blobs, uint64_t* put_us = nullptr) {
+        create_pg(pg_id);
+        auto shard = create_shard(pg_id, 64 * Mi);
+        std::map< pg_id_t, std::vector< shard_id_t > > pg_shard_id_vec{{pg_id, {shard.id}}};
+        std::map< pg_id_t, blob_id_t > pg_blob_id{{pg_id, 0}};
+        auto const put_start = std::chrono::steady_clock::now();
+        put_blobs(pg_shard_id_vec, num_blobs, pg_blob_id);
+        auto const elapsed = std::chrono::steady_clock::now() - put_start;
+        if (put_us) { *put_us = std::chrono::duration_cast< std::chrono::microseconds >(elapsed).count(); }
+        return shard;
+    }
+
     // TODO:make this run in parallel
     void put_blobs(std::map< pg_id_t, std::vector< shard_id_t > > const& pg_shard_id_vec,
                    uint64_t const num_blobs_per_shard, std::map< pg_id_t, blob_id_t >& pg_blob_id,
@@ -405,6 +419,13 @@ public:
             }
         }
         ASSERT_FALSE(pg_exist(pg_id));
+        // unpublished from the lookup table, but retired rather than freed while readers may still hold it
+        ASSERT_EQ(_obj_inst->get_hs_pg(pg_id), nullptr);
+        {
+            auto lg = std::shared_lock(_obj_inst->_pg_lock);
+            ASSERT_TRUE(std::any_of(_obj_inst->retired_pgs_.begin(), _obj_inst->retired_pgs_.end(),
+                                    [pg_id](auto const& r) { return r.pg->pg_info_.id == pg_id; }));
+        }
         ASSERT_EQ(_obj_inst->index_table_pg_map_.find(index_table_uuid_str), _obj_inst->index_table_pg_map_.end());
         // check shards
         auto e = _obj_inst->shard_manager()->list_shards(pg_id).get();
@@ -1,5 +1,10 @@
 #include "homeobj_fixture.hpp"
 #include "generated/resync_blob_data_generated.h"
+#include "lib/homestore_backend/hs_backend_config.hpp"
+#include "lib/homestore_backend/shard_archive.hpp"
+#include <filesystem>
+#include <folly/ScopeGuard.h>
+#include <fstream>
 #include <homestore/replication_service.hpp>
 
 // CP related tests
@@ -193,6 +198,465 @@ TEST_F(HomeObjectFixture, PGBlobIterator) {
     ASSERT_TRUE(pg_iter->update_cursor(objId(LAST_OBJ_ID)));
 }
 
+TEST_F(HomeObjectFixture, PGBlobIteratorAdaptiveBatchSize) {
+    constexpr pg_id_t pg_id{1};
+    constexpr uint64_t num_blobs{200};
+    auto shard = create_pg_with_blobs(pg_id, num_blobs);
+
+    // Every round trip in this test is far below the target, so every full batch doubles the budget
+    auto const orig_target_latency_ms = HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_target_latency_ms);
+    auto const orig_min_size_kb = HS_BACKEND_DYNAMIC_CONFIG(snapshot_batch_min_size_kb);
+    auto restore_settings = folly::makeGuard([orig_target_latency_ms, orig_min_size_kb]() {
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([&](auto& s) {
+            s.snapshot_batch_target_latency_ms = orig_target_latency_ms;
+            s.snapshot_batch_min_size_kb = orig_min_size_kb;
+        });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+    });
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.snapshot_batch_target_latency_ms = 60000;
+        s.snapshot_batch_min_size_kb = 1024;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    auto pg = _obj_inst->get_hs_pg(pg_id);
+    ASSERT_TRUE(pg != nullptr);
+    auto pg_iter = std::make_shared< HSHomeObject::PGBlobIterator >(*_obj_inst, pg->pg_info_.replica_set_uuid,
+                                                                    pg->shards_.back()->info.lsn);
+    auto const shard_seq_num = HSHomeObject::get_sequence_num_from_shard_id(shard.id);
+    ASSERT_TRUE(pg_iter->update_cursor(objId(shard_seq_num, 0)));
+    ASSERT_TRUE(pg_iter->generate_shard_blob_list());
+    ASSERT_EQ(pg_iter->cur_blob_list_.size(), num_blobs);
+
+    auto next_batch = [&](snp_batch_id_t batch_id) {
+        EXPECT_TRUE(pg_iter->update_cursor(objId(shard_seq_num, batch_id)));
+        sisl::io_blob_safe blob_batch;
+        EXPECT_TRUE(pg_iter->create_blobs_snapshot_data(blob_batch));
+        auto blob_msg = GetSizePrefixedResyncBlobDataBatch(blob_batch.cbytes() + sizeof(SyncMessageHeader));
+        return blob_msg->blob_list()->size();
+    };
+
+    // Blobs are at most 16KB, so the blob count budget is the one which cuts the batches
+    auto const min_blobs = HSHomeObject::PGBlobIterator::min_batch_blobs;
+    ASSERT_EQ(next_batch(1), min_blobs);
+    ASSERT_EQ(next_batch(2), 2 * min_blobs);
+    // A resend means the batch did not make it, the budget is halved
+    ASSERT_EQ(next_batch(2), min_blobs);
+    ASSERT_EQ(next_batch(3), 2 * min_blobs);
+}
+
+TEST_F(HomeObjectFixture, PGBlobIteratorSeek) {
+    constexpr pg_id_t pg_id{1};
+    constexpr uint64_t num_blobs{20};
+    auto shard = create_pg_with_blobs(pg_id, num_blobs);
+
+    auto pg = _obj_inst->get_hs_pg(pg_id);
+    ASSERT_TRUE(pg != nullptr);
+    auto pg_iter = std::make_shared< HSHomeObject::PGBlobIterator >(*_obj_inst, pg->pg_info_.replica_set_uuid,
+                                                                    pg->shards_.back()->info.lsn);
+    auto const shard_seq_num = HSHomeObject::get_sequence_num_from_shard_id(shard.id);
+    ASSERT_FALSE(is_seek_obj_id(objId(shard_seq_num, 3).value));
+    ASSERT_FALSE(is_seek_obj_id(LAST_OBJ_ID));
+
+    // A seek is only valid once the shard metadata was sent
+    ASSERT_FALSE(pg_iter->update_cursor(objId(seek_obj_id(5))));
+    ASSERT_TRUE(pg_iter->update_cursor(objId(shard_seq_num, 0)));
+    ASSERT_TRUE(pg_iter->generate_shard_blob_list());
+
+    constexpr blob_id_t last_persisted{12};
+    ASSERT_TRUE(pg_iter->update_cursor(objId(seek_obj_id(last_persisted))));
+    ASSERT_EQ(pg_iter->cur_obj_id_.value, objId(shard_seq_num, 1).value);
+    sisl::io_blob_safe blob_batch;
+    ASSERT_TRUE(pg_iter->create_blobs_snapshot_data(blob_batch));
+    auto blob_msg = GetSizePrefixedResyncBlobDataBatch(blob_batch.cbytes() + sizeof(SyncMessageHeader));
+    ASSERT_EQ(blob_msg->blob_list()->size(), num_blobs - last_persisted - 1);
+    ASSERT_EQ(blob_msg->blob_list()->Get(0)->blob_id(), last_persisted + 1);
+    ASSERT_TRUE(blob_msg->is_last_batch());
+    ASSERT_TRUE(pg_iter->update_cursor(objId(LAST_OBJ_ID)));
+}
+
+TEST_F(HomeObjectFixture, IndexSplitPctOnSortedInserts) {
+    // The same sorted keys, as a baseline resync inserts them, into an evenly split index and a skewed one
+    auto even = _obj_inst->create_pg_index_table();
+    auto skewed = _obj_inst->create_pg_index_table(90);
+    homestore::hs()->index_service().add_index_table(even);
+    homestore::hs()->index_service().add_index_table(skewed);
+
+    constexpr shard_id_t shard_id{1};
+    constexpr blob_id_t num_blobs{20000};
+    for (blob_id_t blob_id = 0; blob_id < num_blobs; ++blob_id) {
+        HSHomeObject::BlobInfo info{.shard_id = shard_id, .blob_id = blob_id};
+        info.pbas = homestore::MultiBlkId{static_cast< homestore::blk_num_t >(blob_id), 1, 0};
+        ASSERT_EQ(_obj_inst->add_to_index_table(even, info).second, homestore::btree_status_t::success);
+        ASSERT_EQ(_obj_inst->add_to_index_table(skewed, info).second, homestore::btree_status_t::success);
+    }
+
+    // every node left behind by a split at the right edge is 90% full instead of half full
+    LOGINFO("index of {} sorted blobs: even split {} bytes, 90% split {} bytes", num_blobs, even->used_size(),
+            skewed->used_size());
+    ASSERT_LT(skewed->used_size() * 10, even->used_size() * 7);
+    for (blob_id_t blob_id = 0; blob_id < num_blobs; blob_id += 997) {
+        auto pbas = _obj_inst->get_blob_from_index_table(skewed, shard_id, blob_id);
+        ASSERT_TRUE(pbas.hasValue());
+        ASSERT_EQ(pbas->blk_num(), blob_id);
+    }
+
+    for (auto& table : {even, skewed}) {
+        homestore::hs()->index_service().remove_index_table(table);
+        table->destroy();
+    }
+}
+
+TEST_F(HomeObjectFixture, DeltaResyncShardDigest) {
+    constexpr pg_id_t pg_id{1};
+    constexpr uint64_t num_blobs{10};
+    auto shard = create_pg_with_blobs(pg_id, num_blobs);
+
+    auto const orig_enabled = HS_BACKEND_DYNAMIC_CONFIG(snapshot_delta_resync_enabled);
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.snapshot_delta_resync_enabled = true; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    auto restore_settings = folly::makeGuard([orig_enabled]() {
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings(
+            [&](auto& s) { s.snapshot_delta_resync_enabled = orig_enabled; });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+    });
+
+    auto before = _obj_inst->compute_shard_summary(pg_id, shard.id);
+    ASSERT_TRUE(before.hasValue());
+    ASSERT_EQ(before->blob_count, num_blobs);
+    ASSERT_TRUE(before->checkpoint_blob_ids.empty());
+    del_blob(pg_id, shard.id, 3);
+    auto after = _obj_inst->compute_shard_summary(pg_id, shard.id);
+    ASSERT_TRUE(after.hasValue());
+    ASSERT_EQ(after->blob_count, num_blobs - 1);
+    ASSERT_NE(after->digest, before->digest);
+
+    // The same blob ids with another payload do not summarize the same
+    auto const tamper = [&]() {
+        auto const first =
+            _obj_inst->query_blobs_in_shard(pg_id, HSHomeObject::get_sequence_num_from_shard_id(shard.id), 0, 1);
+        ASSERT_TRUE(first.hasValue() && !first->empty());
+        BlobRouteKey key{BlobRoute{shard.id, first->front().blob_id}};
+        BlobRouteValue value{first->front().pbas, first->front().payload_crc ^ 1};
+        homestore::BtreeSinglePutRequest put_req{&key, &value, homestore::btree_put_type::UPDATE};
+        ASSERT_EQ(_obj_inst->get_index_table(pg_id)->put(put_req), homestore::btree_status_t::success);
+    };
+    tamper();
+    auto tampered = _obj_inst->compute_shard_summary(pg_id, shard.id);
+    ASSERT_TRUE(tampered.hasValue());
+    ASSERT_EQ(tampered->blob_count, after->blob_count);
+    ASSERT_NE(tampered->digest, after->digest);
+    tamper();
+
+    // The crcs are in the index, a restart does not lose them
+    restart();
+    auto restarted = _obj_inst->compute_shard_summary(pg_id, shard.id);
+    ASSERT_TRUE(restarted.hasValue());
+    ASSERT_EQ(restarted->digest, after->digest);
+
+    // A follower holding the very same pg has nothing to ask for
+    auto pg = _obj_inst->get_hs_pg(pg_id);
+    ASSERT_TRUE(pg != nullptr);
+    auto pg_iter = std::make_shared< HSHomeObject::PGBlobIterator >(*_obj_inst, pg->pg_info_.replica_set_uuid,
+                                                                    pg->shards_.back()->info.lsn);
+    sisl::io_blob_safe meta_blob;
+    pg_iter->create_pg_snapshot_data(meta_blob);
+    auto pg_msg = GetSizePrefixedResyncPGMetaData(meta_blob.cbytes() + sizeof(SyncMessageHeader));
+    ASSERT_EQ(pg_msg->shard_digests()->size(), 1);
+
+    PGStats stats;
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, stats));
+    auto r_dev = homestore::HomeStore::instance()->repl_service().get_repl_dev(stats.replica_set_uuid);
+    ASSERT_TRUE(r_dev.hasValue());
+    auto handler = std::make_unique< homeobject::HSHomeObject::SnapshotReceiveHandler >(*_obj_inst, r_dev.value());
+    handler->reset_context_and_metrics(1, pg_id);
+    ASSERT_TRUE(handler->can_delta_resync(*pg_msg));
+    ASSERT_EQ(handler->process_pg_snapshot_data(*pg_msg), 0);
+    ASSERT_EQ(handler->get_next_shard(), HSHomeObject::SnapshotReceiveHandler::shard_list_end_marker);
+    ASSERT_TRUE(_obj_inst->get_hs_pg(pg_id) != nullptr);
+}
+
+TEST_F(HomeObjectFixture, ShardDigestAntiEntropy) {
+    constexpr pg_id_t pg_id{1};
+    constexpr uint64_t num_blobs{10};
+    auto shard = create_pg_with_blobs(pg_id, num_blobs);
+
+    auto before = _obj_inst->shard_digests()->get(shard.id);
+    ASSERT_TRUE(before.has_value());
+    ASSERT_FALSE(before->stale);
+    ASSERT_EQ(before->blob_count, num_blobs);
+    ASSERT_NE(before->digest, 0);
+
+    // the delete carries the crc of the payload, the digest stays trusted
+    del_blob(pg_id, shard.id, 3);
+    auto after = _obj_inst->shard_digests()->get(shard.id);
+    ASSERT_TRUE(after.has_value());
+    ASSERT_FALSE(after->stale);
+    ASSERT_EQ(after->blob_count, num_blobs - 1);
+    ASSERT_NE(after->digest, before->digest);
+
+    seal_shard(shard.id);
+    auto sealed = _obj_inst->shard_digests()->get(shard.id);
+    ASSERT_TRUE(sealed->sealed.has_value());
+    ASSERT_EQ(sealed->sealed->second, after->digest);
+
+    // a replica holding the same data is in sync, one missing a blob is pointed at its bucket
+    auto const dump = _obj_inst->dump_shard_digests(pg_id);
+    auto cmp = _obj_inst->compare_shard_digests(pg_id, dump);
+    ASSERT_EQ(cmp["in_sync"].size(), 1);
+    ASSERT_TRUE(cmp["divergent"].empty());
+
+    auto peer = *after;
+    auto const e = ShardDigestTable::element(5, 0xdeadbeef);
+    peer.digest ^= e;
+    peer.buckets[5 / ShardDigestTable::bucket_width] ^= e;
+    ++peer.blob_count;
+    nlohmann::json peer_dump;
+    peer_dump["pg_id"] = pg_id;
+    peer_dump["shards"] = nlohmann::json::array({ShardDigestTable::to_json(shard.id, peer)});
+    cmp = _obj_inst->compare_shard_digests(pg_id, peer_dump);
+    ASSERT_EQ(cmp["divergent"].size(), 1);
+    auto const ranges = ShardDigestTable::divergent_ranges(*after, peer);
+    ASSERT_EQ(ranges.size(), 1);
+    ASSERT_EQ(ranges[0].first, 0);
+    ASSERT_EQ(ranges[0].last, ShardDigestTable::bucket_width - 1);
+
+    // the crc of a blob added before a restart is still in the index, deleting it keeps the digest trusted
+    restart();
+    del_blob(pg_id, shard.id, 4);
+    auto restarted = _obj_inst->shard_digests()->get(shard.id);
+    ASSERT_TRUE(restarted.has_value());
+    ASSERT_FALSE(restarted->stale);
+    ASSERT_EQ(restarted->blob_count, num_blobs - 2);
+    // the tombstone keeps the crc of the blob it replaced
+    auto const tombstone =
+        _obj_inst->query_blobs_in_shard(pg_id, HSHomeObject::get_sequence_num_from_shard_id(shard.id), 4, 1);
+    ASSERT_TRUE(tombstone.hasValue() && !tombstone->empty());
+    ASSERT_EQ(tombstone->front().pbas, HSHomeObject::tombstone_pbas);
+    ASSERT_EQ(restarted->digest, after->digest ^ ShardDigestTable::element(4, tombstone->front().payload_crc));
+}
+
+TEST_F(HomeObjectFixture, ScrubVerifiesBlobsAndRebuildsDigest) {
+    constexpr pg_id_t pg_id{1};
+    constexpr uint64_t num_blobs{10};
+    auto shard = create_pg_with_blobs(pg_id, num_blobs);
+
+    auto const expected = _obj_inst->shard_digests()->get(shard.id);
+    ASSERT_TRUE(expected.has_value());
+    // a shard from before digests existed, the digest can not be trusted
+    _obj_inst->shard_digests_->stripe(shard.id).digests.at(shard.id).stale = true;
+    ASSERT_TRUE(_obj_inst->shard_digests()->get(shard.id)->stale);
+
+    auto scrubber = _obj_inst->scrubber();
+    ASSERT_TRUE(scrubber->trigger(pg_id));
+    while (scrubber->running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    auto const status = scrubber->dump();
+    ASSERT_EQ(status["pass_blobs_verified"].get< uint64_t >(), num_blobs);
+    ASSERT_EQ(status["pass_blobs_failed"].get< uint64_t >(), 0);
+    ASSERT_TRUE(status["corrupt"].empty());
+
+    // the scrub read every blob, the digest is rebuilt from their crcs
+    auto const rebuilt = _obj_inst->shard_digests()->get(shard.id);
+    ASSERT_FALSE(rebuilt->stale);
+    ASSERT_EQ(rebuilt->blob_count, expected->blob_count);
+    ASSERT_EQ(rebuilt->digest, expected->digest);
+}
+
+TEST_F(HomeObjectFixture, ShardExportImport) {
+    constexpr pg_id_t pg_id{1};
+    constexpr uint64_t num_blobs{20};
+    uint64_t put_us{0};
+    auto shard = create_pg_with_blobs(pg_id, num_blobs, &put_us);
+    seal_shard(shard.id);
+
+    run_on_pg_leader(pg_id, [&]() {
+        auto const path =
+            fmt::format("/tmp/shard_archive_{}.hoa", boost::uuids::to_string(g_helper->my_replica_id()));
+        ASSERT_FALSE(_obj_inst->import_shard(pg_id, path + ".missing"));
+
+        auto exported = _obj_inst->export_shard(shard.id, path);
+        ASSERT_TRUE(exported);
+        ASSERT_EQ(exported->blob_count, num_blobs);
+
+        auto imported = _obj_inst->import_shard(pg_id, path);
+        ASSERT_TRUE(imported);
+        ASSERT_EQ(imported->source_shard_id, shard.id);
+        ASSERT_EQ(imported->blob_count, num_blobs);
+        ASSERT_EQ(imported->shard.state, ShardInfo::State::SEALED);
+        LOGINFO("{} blobs: per blob puts took {}us, the import {}us", num_blobs, put_us, imported->elapsed_us);
+
+        // the same blobs under the same blob ids
+        for (blob_id_t blob_id = 0; blob_id < num_blobs; ++blob_id) {
+            auto src = _obj_inst->blob_manager()->get(shard.id, blob_id).get();
+            auto dst = _obj_inst->blob_manager()->get(imported->shard.id, blob_id).get();
+            ASSERT_TRUE(src && dst);
+            ASSERT_EQ(src->user_key, dst->user_key);
+            ASSERT_EQ(src->body.size(), dst->body.size());
+            ASSERT_EQ(std::memcmp(src->body.cbytes(), dst->body.cbytes(), src->body.size()), 0);
+        }
+        ASSERT_EQ(_obj_inst->shard_digests()->get(imported->shard.id)->digest,
+                  _obj_inst->shard_digests()->get(shard.id)->digest);
+
+        // flip a byte of the first blob, the archive is refused
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            auto const pos = sizeof(shard_archive_header) + sizeof(shard_archive_blob_record) + 100;
+            f.seekg(pos);
+            auto const c = static_cast< char >(f.get());
+            f.seekp(pos);
+            f.put(static_cast< char >(~c));
+        }
+        auto r = _obj_inst->import_shard(pg_id, path);
+        ASSERT_FALSE(r);
+        ASSERT_EQ(r.error(), ShardError::CRC_MISMATCH);
+        std::filesystem::remove(path);
+    });
+}
+
+TEST_F(HomeObjectFixture, HotSpotTrackerReportsSkewedShard) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto hot_shard = create_shard(pg_id, 64 * Mi).id;
+    auto cold_shard = create_shard(pg_id, 64 * Mi).id;
+    put_blob(hot_shard, build_blob(0));
+    put_blob(cold_shard, build_blob(1));
+
+    // sample every op and keep the counts, the tracker picks the settings up on its next timer run
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.hot_spot_sample_rate = 1;
+        s.hot_spot_decay_interval_sec = 0;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    auto restore = folly::makeGuard([] {
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+            s.hot_spot_sample_rate = 16;
+            s.hot_spot_decay_interval_sec = 60;
+        });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+    });
+    _obj_inst->hot_spot_tracker_->on_timer();
+    ASSERT_EQ(_obj_inst->hot_spot_tracker_->sample_rate_.load(), 1);
+
+    run_on_pg_leader(pg_id, [&]() {
+        auto bm = _obj_inst->blob_manager();
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(bm->get(hot_shard, 0).get());
+            if (i % 20 == 0) { ASSERT_TRUE(bm->get(cold_shard, 1).get()); }
+        }
+
+        auto const report = _obj_inst->dump_hot_spots();
+        auto const& by_ops = report["shards_by_ops"];
+        ASSERT_GE(by_ops.size(), 2);
+        EXPECT_EQ(by_ops[0]["shard_id"].get< shard_id_t >(), hot_shard);
+        EXPECT_GE(by_ops[0]["estimate"].get< uint64_t >(), 200);
+        auto const& by_bytes = report["shards_by_bytes"];
+        ASSERT_GE(by_bytes.size(), 1);
+        EXPECT_EQ(by_bytes[0]["shard_id"].get< shard_id_t >(), hot_shard);
+        ASSERT_EQ(report["pgs"].size(), 1);
+        EXPECT_EQ(report["pgs"][0]["pg_id"].get< pg_id_t >(), pg_id);
+        EXPECT_GE(report["pgs"][0]["ops"].get< uint64_t >(), 210);
+    });
+}
+
+TEST_F(HomeObjectFixture, ResyncThrottleQueueAndCaps) {
+    using dir = ResyncThrottle::direction;
+    using key = ResyncThrottle::ResyncKey;
+    auto throttle = _obj_inst->resync_throttle();
+    ASSERT_TRUE(throttle != nullptr);
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.max_concurrent_outgoing_resyncs = 2;
+        s.max_concurrent_incoming_resyncs = 1;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    // two followers of the same pg take a donor slot each, the third resync waits
+    key const first{1, 0x100}, second{1, 0x200}, third{2, 0x300};
+    ASSERT_TRUE(throttle->try_acquire(dir::OUTGOING, first));
+    ASSERT_TRUE(throttle->try_acquire(dir::OUTGOING, second));
+    ASSERT_FALSE(throttle->try_acquire(dir::OUTGOING, third));
+    ASSERT_EQ(throttle->queue_position(dir::OUTGOING, third), 1);
+    ASSERT_EQ(throttle->queue_position(dir::OUTGOING, first), 0);
+
+    // the queued resync gets the first slot given back
+    throttle->release(dir::OUTGOING, first);
+    ASSERT_TRUE(throttle->try_acquire(dir::OUTGOING, third));
+    ASSERT_EQ(throttle->queue_position(dir::OUTGOING, third), 0);
+
+    // a dropped sync context gives up its place in the queue
+    key const fourth{3, 0x400};
+    ASSERT_FALSE(throttle->try_acquire(dir::OUTGOING, fourth));
+    throttle->release(dir::OUTGOING, fourth);
+    ASSERT_EQ(throttle->queue_position(dir::OUTGOING, fourth), 1);
+    throttle->release(dir::OUTGOING, fourth, true /* drop_queued */);
+    ASSERT_EQ(throttle->queue_position(dir::OUTGOING, fourth), 0);
+    throttle->release(dir::OUTGOING, second);
+    throttle->release(dir::OUTGOING, third);
+
+    // directions are capped independently
+    ASSERT_TRUE(throttle->try_acquire(dir::INCOMING, key{1}));
+    ASSERT_FALSE(throttle->try_acquire(dir::INCOMING, key{2}));
+    ASSERT_TRUE(throttle->try_acquire(dir::OUTGOING, key{2, 0x500}));
+    throttle->release(dir::INCOMING, key{1});
+    ASSERT_TRUE(throttle->try_acquire(dir::INCOMING, key{2}));
+    throttle->release(dir::INCOMING, key{2});
+    throttle->release(dir::OUTGOING, key{2, 0x500});
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.max_concurrent_outgoing_resyncs = 4;
+        s.max_concurrent_incoming_resyncs = 4;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, ResyncThrottleBandwidth) {
+    using dir = ResyncThrottle::direction;
+    auto throttle = _obj_inst->resync_throttle();
+    ASSERT_TRUE(throttle != nullptr);
+
+    // unlimited by default
+    throttle->consume_bandwidth(dir::OUTGOING, 64 * Mi);
+    ASSERT_TRUE(throttle->bandwidth_available(dir::OUTGOING));
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.resync_outgoing_mbps = 1; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    // a burst of a second worth of data goes through, then the direction is in debt for a second, without blocking
+    ASSERT_TRUE(throttle->bandwidth_available(dir::OUTGOING));
+    auto const start = std::chrono::steady_clock::now();
+    throttle->consume_bandwidth(dir::OUTGOING, 2 * Mi);
+    ASSERT_FALSE(throttle->bandwidth_available(dir::OUTGOING));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    // the other direction is not affected
+    ASSERT_TRUE(throttle->bandwidth_available(dir::INCOMING));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    ASSERT_TRUE(throttle->bandwidth_available(dir::OUTGOING));
+
+    // pace holds the caller back until the debt is paid, instead of failing it
+    throttle->consume_bandwidth(dir::OUTGOING, 2 * Mi);
+    auto const paced = std::chrono::steady_clock::now();
+    ASSERT_TRUE(throttle->pace(dir::OUTGOING));
+    ASSERT_GE(std::chrono::steady_clock::now() - paced, std::chrono::milliseconds(800));
+    ASSERT_TRUE(throttle->bandwidth_available(dir::OUTGOING));
+
+    // but never for longer than resync_pace_max_wait_ms
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.resync_pace_max_wait_ms = 100; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    throttle->consume_bandwidth(dir::OUTGOING, 4 * Mi);
+    auto const cut = std::chrono::steady_clock::now();
+    ASSERT_FALSE(throttle->pace(dir::OUTGOING));
+    ASSERT_LT(std::chrono::steady_clock::now() - cut, std::chrono::milliseconds(1000));
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.resync_outgoing_mbps = 0;
+        s.resync_pace_max_wait_ms = 2000;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
 TEST_F(HomeObjectFixture, SnapshotReceiveHandler) {
     constexpr uint64_t snp_lsn = 1;
     constexpr uint64_t num_shards_per_pg = 3;
@@ -1,6 +1,7 @@
 #include "homeobj_fixture.hpp"
 
 #include "lib/homestore_backend/index_kv.hpp"
+#include "lib/homestore_backend/hs_backend_config.hpp"
 #include <homestore/replication_service.hpp>
 
 TEST_F(HomeObjectFixture, BasicEquivalence) {
@@ -138,6 +139,513 @@ TEST_F(HomeObjectFixture, BasicPutGetDelBlobWithRestart) {
     verify_obj_count(num_pgs, num_blobs_per_shard * 2, num_shards_per_pg, true /* deleted */);
 }
 
+TEST_F(HomeObjectFixture, BlobOpsWithExpiredDeadline) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto shard_id = create_shard(pg_id, 64 * Mi).id;
+    blob_id_t blob_id{0};
+    put_blob(shard_id, build_blob(blob_id));
+
+    auto const expired = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    auto const far_away = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    run_on_pg_leader(pg_id, [&]() {
+        auto p = _obj_inst->blob_manager()->put(shard_id, build_blob(blob_id + 1), 0, expired).get();
+        ASSERT_FALSE(p);
+        EXPECT_EQ(BlobErrorCode::DEADLINE_EXCEEDED, p.error().getCode());
+
+        auto g = _obj_inst->blob_manager()->get(shard_id, blob_id, 0, 0, 0, expired).get();
+        ASSERT_FALSE(g);
+        EXPECT_EQ(BlobErrorCode::DEADLINE_EXCEEDED, g.error().getCode());
+
+        auto d = _obj_inst->blob_manager()->del(shard_id, blob_id, 0, expired).get();
+        ASSERT_FALSE(d);
+        EXPECT_EQ(BlobErrorCode::DEADLINE_EXCEEDED, d.error().getCode());
+
+        // the blob is untouched by the shed requests
+        g = _obj_inst->blob_manager()->get(shard_id, blob_id, 0, 0, 0, far_away).get();
+        ASSERT_TRUE(g);
+    });
+}
+
+TEST_F(HomeObjectFixture, ReplayedPutAfterRestartKeepsBlocks) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto shard_id = create_shard(pg_id, 64 * Mi).id;
+    blob_id_t const num_blobs{10};
+    for (blob_id_t blob_id = 0; blob_id < num_blobs; ++blob_id) {
+        put_blob(shard_id, build_blob(blob_id));
+    }
+
+    // the checkpoint holding the index entries holds a blob sequence covering them
+    trigger_cp(true);
+    EXPECT_GE(_obj_inst->get_hs_pg(pg_id)->pg_sb_->blob_sequence_num, num_blobs);
+
+    restart();
+
+    auto hs_pg = _obj_inst->get_hs_pg(pg_id);
+    ASSERT_TRUE(hs_pg);
+    PGStats stats_before;
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, stats_before));
+    auto const occupied_before = hs_pg->durable_entities().total_occupied_blk_count.load();
+    auto const avail_before = _obj_inst->chunk_selector()->avail_blks(pg_id);
+
+    // Replay every put the way the log does after a restart: the allocation hints must carry the blocks the index
+    // already has, otherwise new blocks are allocated and leaked when the commit finds the existing entry.
+    cintrusive< homestore::repl_req_ctx > no_ctx;
+    for (blob_id_t blob_id = 1; blob_id < num_blobs; ++blob_id) {
+        EXPECT_TRUE(hs_pg->may_be_replayed_blob(blob_id));
+        auto pbas = _obj_inst->get_blob_from_index_table(hs_pg->index_table_, shard_id, blob_id);
+        ASSERT_TRUE(pbas);
+
+        ReplicationMessageHeader header;
+        header.msg_type = ReplicationMessageType::PUT_BLOB_MSG;
+        header.pg_id = pg_id;
+        header.shard_id = shard_id;
+        header.blob_id = blob_id;
+        header.seal();
+        auto hints = _obj_inst->blob_put_get_blk_alloc_hints(
+            sisl::blob{r_cast< uint8_t* >(&header), sizeof(ReplicationMessageHeader)}, no_ctx);
+        ASSERT_TRUE(hints);
+        ASSERT_TRUE(hints->committed_blk_id.has_value());
+        EXPECT_EQ(pbas.value(), hints->committed_blk_id.value());
+
+        EXPECT_TRUE(_obj_inst->local_add_blob_info(pg_id, HSHomeObject::BlobInfo{shard_id, blob_id, pbas.value()}, 0));
+    }
+
+    PGStats stats_after;
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, stats_after));
+    EXPECT_EQ(stats_before.num_active_objects, stats_after.num_active_objects);
+    EXPECT_EQ(occupied_before, hs_pg->durable_entities().total_occupied_blk_count.load());
+    EXPECT_EQ(avail_before, _obj_inst->chunk_selector()->avail_blks(pg_id));
+}
+
+TEST_F(HomeObjectFixture, CopyBlobWithinAndAcrossPGs) {
+    create_pg(1);
+    create_pg(2);
+    auto src_shard = create_shard(1, 64 * Mi).id;
+    auto same_pg_shard = create_shard(1, 64 * Mi).id;
+    auto other_pg_shard = create_shard(2, 64 * Mi).id;
+    auto sealed_shard = create_shard(2, 64 * Mi).id;
+    seal_shard(sealed_shard);
+
+    // a small blob and one large enough for the throughput of its copy to be reported
+    std::vector< Blob > expected;
+    expected.emplace_back(build_blob(0));
+    expected.emplace_back(sisl::io_blob_safe(4 * Mi, 512), "large_blob", 0ul);
+    BitsGenerator::gen_blob_bits(expected.back().body, 1);
+    for (auto const& blob : expected) {
+        put_blob(src_shard, blob.clone());
+    }
+
+    for (auto const& dst : std::vector< std::pair< pg_id_t, shard_id_t > >{
+             {1, src_shard}, {1, same_pg_shard}, {2, other_pg_shard}}) {
+        auto const dst_shard = dst.second;
+        run_on_pg_leader(dst.first, [&]() {
+            for (blob_id_t src_blob = 0; src_blob < expected.size(); ++src_blob) {
+                auto c = _obj_inst->blob_manager()->copy(src_shard, src_blob, dst_shard).get();
+                ASSERT_TRUE(c) << "copy blob fail, dst shard " << dst_shard << " blob_id " << src_blob;
+                auto g = _obj_inst->blob_manager()->get(dst_shard, c.value()).get();
+                ASSERT_TRUE(g);
+                auto const& blob = expected[src_blob];
+                ASSERT_EQ(g->body.size(), blob.body.size());
+                EXPECT_EQ(std::memcmp(g->body.cbytes(), blob.body.cbytes(), blob.body.size()), 0);
+                EXPECT_EQ(g->user_key, blob.user_key);
+                EXPECT_EQ(g->object_off, blob.object_off);
+            }
+        });
+    }
+
+    run_on_pg_leader(2, [&]() {
+        auto c = _obj_inst->blob_manager()->copy(src_shard, 0, sealed_shard).get();
+        ASSERT_FALSE(c);
+        EXPECT_EQ(BlobErrorCode::SEALED_SHARD, c.error().getCode());
+
+        c = _obj_inst->blob_manager()->copy(src_shard, 1000 /* never put */, other_pg_shard).get();
+        ASSERT_FALSE(c);
+        EXPECT_EQ(BlobErrorCode::UNKNOWN_BLOB, c.error().getCode());
+    });
+}
+
+TEST_F(HomeObjectFixture, GetIntoCallerBuffers) {
+    create_pg(1);
+    auto shard_id = create_shard(1, 64 * Mi).id;
+    Blob blob{sisl::io_blob_safe(Mi + 300, 512), "blob_read_into", 7ul};
+    BitsGenerator::gen_blob_bits(blob.body, 1);
+    put_blob(shard_id, blob.clone());
+
+    auto bm = _obj_inst->blob_manager();
+    auto buf = bm->alloc_io_buf(blob.body.size());
+    ASSERT_EQ(reinterpret_cast< uintptr_t >(buf.cbytes()) % io_align, 0u);
+    auto const sg_of = [](std::vector< std::pair< uint8_t*, uint64_t > > const& bufs) {
+        sisl::sg_list sgs;
+        sgs.size = 0;
+        for (auto const& [p, n] : bufs) {
+            sgs.iovs.emplace_back(iovec{.iov_base = p, .iov_len = n});
+            sgs.size += n;
+        }
+        return sgs;
+    };
+
+    // the whole blob into one buffer, the blob id is 0 on every replica
+    auto r = bm->get_into(shard_id, 0, sg_of({{buf.bytes(), buf.size()}})).get();
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->size, blob.body.size());
+    EXPECT_EQ(std::memcmp(buf.cbytes(), blob.body.cbytes(), blob.body.size()), 0);
+    EXPECT_EQ(r->user_key, blob.user_key);
+    EXPECT_EQ(r->object_off, blob.object_off);
+
+    // aligned and unaligned ranges across two buffers
+    for (uint64_t const off : {uint64_t{4096}, uint64_t{100}}) {
+        uint64_t const len = 64 * Ki + 10;
+        std::memset(buf.bytes(), 0, buf.size());
+        auto const sgs = sg_of({{buf.bytes(), 32 * Ki}, {buf.bytes() + 32 * Ki, 64 * Ki}});
+        r = bm->get_into(shard_id, 0, sgs, off, len).get();
+        ASSERT_TRUE(r);
+        ASSERT_EQ(r->size, len);
+        EXPECT_EQ(std::memcmp(buf.cbytes(), blob.body.cbytes() + off, len), 0);
+    }
+
+    // buffers too small for the range, found out before anything is read into them
+    std::memset(buf.bytes(), 0xab, 4 * Ki);
+    r = bm->get_into(shard_id, 0, sg_of({{buf.bytes(), 4 * Ki}})).get();
+    ASSERT_FALSE(r);
+    EXPECT_EQ(BlobErrorCode::INVALID_ARG, r.error().getCode());
+    EXPECT_TRUE(std::all_of(buf.cbytes(), buf.cbytes() + 4 * Ki, [](uint8_t b) { return b == 0xab; }));
+    bm->release_io_buf(std::move(buf));
+}
+
+TEST_F(HomeObjectFixture, StreamGetLargeBlob) {
+    create_pg(1);
+    auto shard_id = create_shard(1, 64 * Mi).id;
+    Blob blob{sisl::io_blob_safe(8 * Mi + 512, 512), "streamed_blob", 0ul};
+    BitsGenerator::gen_blob_bits(blob.body, 1);
+    put_blob(shard_id, blob.clone());
+
+    constexpr uint32_t chunk_size_kb{512};
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.stream_chunk_size_kb = chunk_size_kb; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    // the whole blob and a range across chunks, the blob id is 0 on every replica
+    for (auto const& [off, len] : std::vector< std::pair< uint64_t, uint64_t > >{{0, 0}, {Mi - 100, 3 * Mi}}) {
+        auto s = _obj_inst->blob_manager()->get_stream(shard_id, 0, off, len).get();
+        ASSERT_TRUE(s);
+        auto& stream = s.value();
+        auto const expected_size = len ? len : blob.body.size();
+        EXPECT_EQ(stream->size(), expected_size);
+        EXPECT_EQ(stream->user_key(), blob.user_key);
+
+        uint64_t pos{0};
+        uint32_t chunks{0};
+        while (true) {
+            auto chunk = stream->next().get();
+            ASSERT_TRUE(chunk);
+            if (chunk->size() == 0) { break; }
+            ASSERT_LE(chunk->size(), chunk_size_kb * Ki);
+            ASSERT_LE(pos + chunk->size(), expected_size);
+            EXPECT_EQ(std::memcmp(chunk->cbytes(), blob.body.cbytes() + off + pos, chunk->size()), 0);
+            pos += chunk->size();
+            ++chunks;
+        }
+        EXPECT_EQ(pos, expected_size);
+        EXPECT_GT(chunks, 1u);
+    }
+
+    auto s = _obj_inst->blob_manager()->get_stream(shard_id, 0, blob.body.size(), 1).get();
+    ASSERT_FALSE(s);
+    EXPECT_EQ(BlobErrorCode::INVALID_ARG, s.error().getCode());
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.stream_chunk_size_kb = 1024; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, MultipartUpload) {
+    create_pg(1);
+    auto shard_id = create_shard(1, 64 * Mi).id;
+
+    constexpr uint32_t part_count{8};
+    constexpr uint64_t part_size{1 * Mi};
+    sisl::io_blob_safe object(part_count * part_size, 512);
+    BitsGenerator::gen_blob_bits(object, 1);
+
+    run_on_pg_leader(1, [&]() {
+        auto bm = _obj_inst->blob_manager();
+        auto u = bm->create_upload(shard_id).get();
+        ASSERT_TRUE(u);
+        auto const upload = u.value();
+
+        // all the parts at once, last to first
+        auto const start = std::chrono::steady_clock::now();
+        std::vector< folly::SemiFuture< BlobManager::Result< UploadedPart > > > futs;
+        for (uint32_t part_no = part_count; part_no > 0; --part_no) {
+            sisl::io_blob_safe data(part_size, 512);
+            std::memcpy(data.bytes(), object.cbytes() + (part_no - 1) * part_size, part_size);
+            futs.emplace_back(bm->upload_part(shard_id, upload, part_no, std::move(data)));
+        }
+        std::vector< UploadedPart > parts;
+        for (auto& r : folly::collectAll(futs).get()) {
+            ASSERT_TRUE(r.hasValue() && r.value());
+            parts.push_back(r.value().value());
+        }
+        std::sort(parts.begin(), parts.end(), [](auto const& a, auto const& b) { return a.part_no < b.part_no; });
+        auto c = bm->complete_upload(shard_id, upload, parts, "multipart_object").get();
+        ASSERT_TRUE(c);
+        auto const elapsed_us =
+            std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() - start).count();
+        LOGINFO("multi-part upload of {} parts of {} bytes took {}us, {} MB/s", part_count, part_size, elapsed_us,
+                elapsed_us ? object.size() / elapsed_us : 0);
+
+        auto g = bm->get(shard_id, c.value()).get();
+        ASSERT_TRUE(g);
+        ASSERT_EQ(g->body.size(), object.size());
+        EXPECT_EQ(std::memcmp(g->body.cbytes(), object.cbytes(), object.size()), 0);
+        EXPECT_EQ(g->user_key, "multipart_object");
+
+        // a range across a part boundary
+        uint64_t const off = part_size - 4096;
+        uint64_t const len = 2 * 4096;
+        g = bm->get(shard_id, c.value(), off, len).get();
+        ASSERT_TRUE(g);
+        ASSERT_EQ(g->body.size(), len);
+        EXPECT_EQ(std::memcmp(g->body.cbytes(), object.cbytes() + off, len), 0);
+
+        // and streamed, part after part
+        auto s = bm->get_stream(shard_id, c.value()).get();
+        ASSERT_TRUE(s);
+        ASSERT_EQ(s.value()->size(), object.size());
+        uint64_t pos{0};
+        for (auto chunk = s.value()->next().get(); chunk && chunk->size(); chunk = s.value()->next().get()) {
+            ASSERT_LE(pos + chunk->size(), object.size());
+            EXPECT_EQ(std::memcmp(chunk->cbytes(), object.cbytes() + pos, chunk->size()), 0);
+            pos += chunk->size();
+        }
+        EXPECT_EQ(pos, object.size());
+
+        // a completed upload is gone
+        auto p = bm->upload_part(shard_id, upload, 1, sisl::io_blob_safe(4096, 512)).get();
+        ASSERT_FALSE(p);
+        EXPECT_EQ(BlobErrorCode::UNKNOWN_UPLOAD, p.error().getCode());
+
+        // so is an aborted one
+        u = bm->create_upload(shard_id).get();
+        ASSERT_TRUE(u);
+        sisl::io_blob_safe data(4096, 512);
+        BitsGenerator::gen_blob_bits(data, 2);
+        auto part = bm->upload_part(shard_id, u.value(), 1, std::move(data)).get();
+        ASSERT_TRUE(part);
+        ASSERT_TRUE(bm->abort_upload(shard_id, u.value()).get());
+        c = bm->complete_upload(shard_id, u.value(), {part.value()}).get();
+        ASSERT_FALSE(c);
+        EXPECT_EQ(BlobErrorCode::UNKNOWN_UPLOAD, c.error().getCode());
+    });
+}
+
+TEST_F(HomeObjectFixture, RecentWriteCache) {
+    create_pg(1);
+    auto shard_id = create_shard(1, 64 * Mi).id;
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.recent_write_cache_size_mb = 1; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    run_on_pg_leader(1, [&]() {
+        auto bm = _obj_inst->blob_manager();
+        auto rwc = _obj_inst->recent_write_cache();
+        auto hs_pg = _obj_inst->get_hs_pg(1);
+        auto const blk_size = hs_pg->repl_dev_->get_blk_size();
+
+        sisl::io_blob_safe data(64 * Ki, 512);
+        BitsGenerator::gen_blob_bits(data, 1);
+        sisl::io_blob_safe body(64 * Ki, 512);
+        std::memcpy(body.bytes(), data.cbytes(), data.size());
+        auto p = bm->put(shard_id, Blob{std::move(body), "rwc_blob", 0}).get();
+        ASSERT_TRUE(p);
+        EXPECT_EQ(rwc->cached_entries(), 1);
+
+        // the cached image is the one written, served from the buffers of the put request
+        auto pbas = _obj_inst->get_blob_from_index_table(hs_pg->index_table_, shard_id, p.value());
+        ASSERT_TRUE(pbas);
+        auto const size = pbas->blk_count() * blk_size;
+        sisl::io_blob_safe image(size, 512);
+        ASSERT_TRUE(rwc->get(BlobRoute{shard_id, p.value()}, pbas.value(), image.bytes(), size));
+        auto header = r_cast< HSHomeObject::BlobHeader const* >(image.cbytes());
+        ASSERT_TRUE(header->valid());
+        EXPECT_EQ(header->blob_id, p.value());
+        EXPECT_EQ(std::memcmp(image.cbytes() + header->data_offset, data.cbytes(), data.size()), 0);
+        // the entry is charged for the whole request it holds, not only the image
+        EXPECT_GT(rwc->cached_bytes(), size);
+
+        // the cache stays under its cap, the oldest puts go first
+        for (uint32_t i = 0; i < 32; ++i) {
+            sisl::io_blob_safe more(64 * Ki, 512);
+            BitsGenerator::gen_blob_bits(more, i);
+            ASSERT_TRUE(bm->put(shard_id, Blob{std::move(more), "", 0}).get());
+        }
+        EXPECT_LE(rwc->cached_bytes(), Mi);
+        EXPECT_FALSE(rwc->get(BlobRoute{shard_id, p.value()}, pbas.value(), image.bytes(), size));
+    });
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.recent_write_cache_size_mb = 0; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, WriteAdmission) {
+    create_pg(1);
+    auto shard_id = create_shard(1, 64 * Mi).id;
+
+    run_on_pg_leader(1, [&]() {
+        auto bm = _obj_inst->blob_manager();
+        auto hs_pg = _obj_inst->get_hs_pg(1);
+        ASSERT_NE(hs_pg, nullptr);
+        auto const next_blob_id = [hs_pg]() {
+            return hs_pg->durable_entities().blob_sequence_num.load(std::memory_order_relaxed);
+        };
+
+        // off by default, a backlog of proposed puts does not reject anything
+        hs_pg->inflight_put_bytes_.increment(2 * Mi);
+        ASSERT_TRUE(bm->put(shard_id, build_blob(0)).get());
+        ASSERT_FALSE(hs_pg->write_throttled_.load());
+
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+            s.write_throttle_max_inflight_mb = 1;
+            s.write_throttle_check_interval_ms = 0;
+        });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+
+        // rejected before a blob id is allocated
+        auto const blob_id_before = next_blob_id();
+        auto p = bm->put(shard_id, build_blob(1)).get();
+        ASSERT_FALSE(p);
+        ASSERT_EQ(p.error().code, BlobErrorCode::RETRY_REQUEST);
+        ASSERT_TRUE(hs_pg->write_throttled_.load());
+        ASSERT_EQ(next_blob_id(), blob_id_before);
+
+        // released once the backlog is committed
+        hs_pg->inflight_put_bytes_.decrement(2 * Mi);
+        ASSERT_TRUE(bm->put(shard_id, build_blob(2)).get());
+        ASSERT_FALSE(hs_pg->write_throttled_.load());
+
+        // a single replica never lags itself
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+            s.write_throttle_max_inflight_mb = 0;
+            s.write_throttle_max_follower_lag = 1;
+        });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+        if (g_helper->members().size() == 1) { ASSERT_TRUE(bm->put(shard_id, build_blob(3)).get()); }
+
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+            s.write_throttle_max_follower_lag = 0;
+            s.write_throttle_check_interval_ms = 100;
+        });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+    });
+}
+
+TEST_F(HomeObjectFixture, PGIoQoSWeightedFairShare) {
+    // Two pgs with the same backlogged read load, the heavy one weighs three times the light one.
+    pg_id_t const light_pg{1};
+    pg_id_t const heavy_pg{2};
+    std::map< pg_id_t, shard_id_t > shards;
+    for (auto const pg_id : {light_pg, heavy_pg}) {
+        create_pg(pg_id);
+        shards[pg_id] = create_shard(pg_id, 64 * Mi).id;
+        put_blob(shards[pg_id], build_blob(0));
+    }
+
+    constexpr uint64_t node_read_iops{2000};
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.io_qos_enabled = true;
+        s.io_qos_read_iops = node_read_iops;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    auto sched = _obj_inst->io_scheduler();
+    ASSERT_TRUE(sched != nullptr);
+    sched->set_pg_qos(light_pg, PGIoScheduler::PGQoS{.weight = 100});
+    sched->set_pg_qos(heavy_pg, PGIoScheduler::PGQoS{.weight = 300});
+
+    // Every replica drives reads against its own scheduler, the only blob of each pg has blob id 0.
+    constexpr uint32_t readers_per_pg{8};
+    constexpr uint64_t run_secs{5};
+    auto const stop_at = std::chrono::steady_clock::now() + std::chrono::seconds(run_secs);
+    std::map< pg_id_t, std::vector< uint64_t > > latencies_us;
+    std::mutex mtx;
+    std::vector< std::thread > readers;
+    for (auto const pg_id : {light_pg, heavy_pg}) {
+        for (uint32_t i = 0; i < readers_per_pg; ++i) {
+            readers.emplace_back([&, pg_id]() {
+                std::vector< uint64_t > lat;
+                while (std::chrono::steady_clock::now() < stop_at) {
+                    auto const start = std::chrono::steady_clock::now();
+                    auto g = _obj_inst->blob_manager()->get(shards.at(pg_id), 0).get();
+                    ASSERT_TRUE(g);
+                    lat.push_back(std::chrono::duration_cast< std::chrono::microseconds >(
+                                      std::chrono::steady_clock::now() - start)
+                                      .count());
+                }
+                std::scoped_lock lock(mtx);
+                latencies_us[pg_id].insert(latencies_us[pg_id].end(), lat.begin(), lat.end());
+            });
+        }
+    }
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    auto p99 = [](std::vector< uint64_t >& v) {
+        std::sort(v.begin(), v.end());
+        return v.empty() ? 0ul : v[v.size() * 99 / 100];
+    };
+    auto const light_ops = latencies_us[light_pg].size();
+    auto const heavy_ops = latencies_us[heavy_pg].size();
+    LOGINFO("light pg: ops={} p99={}us, heavy pg: ops={} p99={}us", light_ops, p99(latencies_us[light_pg]),
+            heavy_ops, p99(latencies_us[heavy_pg]));
+
+    ASSERT_GT(light_ops, 0u);
+    auto const ratio = static_cast< double >(heavy_ops) / light_ops;
+    EXPECT_GT(ratio, 2.0);
+    EXPECT_LT(ratio, 4.0);
+    // the node budget holds, give or take the initial burst
+    EXPECT_LE(light_ops + heavy_ops, node_read_iops * (run_secs + 1));
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.io_qos_enabled = false;
+        s.io_qos_read_iops = 0;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, PGIoQoSRemovePG) {
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.io_qos_enabled = true; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    auto sched = _obj_inst->io_scheduler();
+    ASSERT_TRUE(sched != nullptr);
+
+    // the scheduler only sees pg ids, these pgs do not need to exist
+    pg_id_t const removed_pg{200};
+    pg_id_t const other_pg{201};
+    using io_type = PGIoScheduler::io_type;
+    using io_class = PGIoScheduler::io_class;
+    sched->set_pg_qos(removed_pg, PGIoScheduler::PGQoS{.read_mbps = 1});
+
+    // the first io puts the pg a minute into debt, the next one waits
+    ASSERT_FALSE(sched->admit(removed_pg, io_type::READ, io_class::FOREGROUND, 64 * Mi));
+    auto removed = sched->admit(removed_pg, io_type::READ, io_class::FOREGROUND, 4096);
+    ASSERT_TRUE(removed);
+
+    // within every budget, but an io of another pg is waiting in the lane, so it does not go first
+    auto other = sched->admit(other_pg, io_type::READ, io_class::FOREGROUND, 4096);
+    ASSERT_TRUE(other);
+    ASSERT_TRUE(std::move(*other).getTry().hasValue());
+
+    sched->remove_pg(removed_pg);
+    auto r = std::move(*removed).getTry();
+    ASSERT_TRUE(r.hasException());
+    ASSERT_TRUE(r.exception().with_exception(
+        [](std::system_error const& e) { ASSERT_EQ(e.code(), PGIoScheduler::pg_removed_error()); }));
+    ASSERT_EQ(sched->queued(io_type::READ), 0);
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.io_qos_enabled = false; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
 #ifdef _PRERELEASE
 TEST_F(HomeObjectFixture, BasicPutGetBlobWithPushDataDisabled) {
     // disable leader push data. As a result, followers have to fetch data to exercise the fetch_data implementation of
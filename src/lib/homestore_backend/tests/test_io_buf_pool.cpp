@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <sisl/options/options.h>
+#include <sisl/logging/logging.h>
+#include <folly/init/Init.h>
+
+#include <thread>
+#include <vector>
+
+#include "homeobject/common.hpp"
+#define protected public
+#define private public
+#include "lib/io_buf_pool.hpp"
+
+SISL_LOGGING_DEF(HOMEOBJECT_LOG_MODS)
+SISL_LOGGING_INIT(HOMEOBJECT_LOG_MODS)
+SISL_OPTIONS_ENABLE(logging)
+
+using namespace homeobject;
+
+struct TestCtx {
+    uint64_t a;
+    uint64_t b;
+};
+using TestObjPool = ThreadLocalObjPool< TestCtx >;
+
+static constexpr uint32_t test_align{512};
+
+TEST(ThreadLocalObjPoolTest, ReuseOnSameThread) {
+    auto p = TestObjPool::alloc(sizeof(TestCtx));
+    ASSERT_EQ(reinterpret_cast< uintptr_t >(p) % alignof(TestCtx), 0);
+    TestObjPool::free(p, sizeof(TestCtx));
+    auto const cached = TestObjPool::free_list().ptrs.size();
+    ASSERT_GE(cached, 1);
+
+    auto q = TestObjPool::alloc(sizeof(TestCtx));
+    ASSERT_EQ(p, q);
+    ASSERT_EQ(TestObjPool::free_list().ptrs.size(), cached - 1);
+    TestObjPool::free(q, sizeof(TestCtx));
+
+    // a size other than T's, e.g. a derived class, bypasses the pool
+    auto r = TestObjPool::alloc(sizeof(TestCtx) * 2);
+    TestObjPool::free(r, sizeof(TestCtx) * 2);
+    ASSERT_EQ(TestObjPool::free_list().ptrs.size(), cached);
+}
+
+TEST(ThreadLocalObjPoolTest, CapPerThread) {
+    std::vector< void* > ptrs;
+    for (size_t i = 0; i < TestObjPool::max_cached_per_thread + 100; ++i) {
+        ptrs.push_back(TestObjPool::alloc(sizeof(TestCtx)));
+    }
+    ASSERT_EQ(TestObjPool::free_list().ptrs.size(), 0);
+    for (auto p : ptrs) {
+        TestObjPool::free(p, sizeof(TestCtx));
+    }
+    ASSERT_EQ(TestObjPool::free_list().ptrs.size(), TestObjPool::max_cached_per_thread);
+}
+
+TEST(ThreadLocalObjPoolTest, CrossThreadFree) {
+    auto const cached_before = TestObjPool::free_list().ptrs.size();
+    std::vector< void* > ptrs;
+    for (size_t i = 0; i < TestObjPool::max_cached_per_thread; ++i) {
+        ptrs.push_back(TestObjPool::alloc(sizeof(TestCtx)));
+    }
+    auto const cached_after_alloc = TestObjPool::free_list().ptrs.size();
+
+    // the freeing thread never allocates, it must not end up caching the blocks
+    size_t freeing_thread_cached{0};
+    std::thread t([&ptrs, &freeing_thread_cached]() {
+        for (auto p : ptrs) {
+            TestObjPool::free(p, sizeof(TestCtx));
+        }
+        freeing_thread_cached = TestObjPool::free_list().ptrs.size();
+    });
+    t.join();
+    ASSERT_EQ(freeing_thread_cached, 0);
+    ASSERT_EQ(TestObjPool::free_list().ptrs.size(), cached_after_alloc);
+    ASSERT_LE(cached_after_alloc, cached_before);
+
+    // and the blocks freed on the allocating thread are still recycled
+    auto p = TestObjPool::alloc(sizeof(TestCtx));
+    TestObjPool::free(p, sizeof(TestCtx));
+    ASSERT_EQ(TestObjPool::alloc(sizeof(TestCtx)), p);
+    TestObjPool::free(p, sizeof(TestCtx));
+}
+
+TEST(IoBufPoolTest, ReuseOnSameThread) {
+    auto buf = IoBufPool::alloc(4096, test_align);
+    auto const bytes = buf.cbytes();
+    IoBufPool::release(std::move(buf), test_align);
+    ASSERT_EQ(IoBufPool::cache().bytes, 4096);
+
+    // a different size or alignment is not served from the cached buffer
+    auto other = IoBufPool::alloc(8192, test_align);
+    ASSERT_NE(other.cbytes(), bytes);
+    ASSERT_EQ(IoBufPool::cache().bytes, 4096);
+
+    auto again = IoBufPool::alloc(4096, test_align);
+    ASSERT_EQ(again.cbytes(), bytes);
+    ASSERT_EQ(IoBufPool::cache().bytes, 0);
+}
+
+TEST(IoBufPoolTest, Caps) {
+    // too big to be pooled
+    IoBufPool::release(IoBufPool::alloc(IoBufPool::max_pooled_buf_size * 2, test_align), test_align);
+    ASSERT_EQ(IoBufPool::cache().bytes, 0);
+
+    std::vector< sisl::io_blob_safe > bufs;
+    auto const n = IoBufPool::max_pooled_bytes_per_thread / IoBufPool::max_pooled_buf_size + 4;
+    for (uint64_t i = 0; i < n; ++i) {
+        bufs.emplace_back(IoBufPool::alloc(IoBufPool::max_pooled_buf_size, test_align));
+    }
+    for (auto& b : bufs) {
+        IoBufPool::release(std::move(b), test_align);
+    }
+    ASSERT_EQ(IoBufPool::cache().bytes, IoBufPool::max_pooled_bytes_per_thread);
+
+    // drain the cache for the following tests
+    for (uint64_t i = 0; i < n; ++i) {
+        bufs[i] = IoBufPool::alloc(IoBufPool::max_pooled_buf_size, test_align);
+    }
+    ASSERT_EQ(IoBufPool::cache().bytes, 0);
+}
+
+TEST(IoBufPoolTest, CrossThreadRelease) {
+    std::vector< sisl::io_blob_safe > bufs;
+    auto const n = IoBufPool::max_pooled_bytes_per_thread / IoBufPool::max_pooled_buf_size + 4;
+    for (uint64_t i = 0; i < n; ++i) {
+        bufs.emplace_back(IoBufPool::alloc(IoBufPool::max_pooled_buf_size, test_align));
+    }
+
+    // the releasing thread never allocates, it must not end up caching the buffers
+    uint64_t releasing_thread_bytes{0};
+    std::thread t([&bufs, &releasing_thread_bytes]() {
+        for (auto& b : bufs) {
+            IoBufPool::release(std::move(b), test_align);
+        }
+        releasing_thread_bytes = IoBufPool::cache().bytes;
+    });
+    t.join();
+    ASSERT_EQ(releasing_thread_bytes, 0);
+    ASSERT_EQ(IoBufPool::cache().bytes, 0);
+    ASSERT_TRUE(IoBufPool::cache().lent.size() <= IoBufPool::max_lent_per_thread);
+
+    // and the buffers released on the allocating thread are still recycled
+    auto buf = IoBufPool::alloc(IoBufPool::max_pooled_buf_size, test_align);
+    auto const bytes = buf.cbytes();
+    IoBufPool::release(std::move(buf), test_align);
+    ASSERT_EQ(IoBufPool::cache().bytes, IoBufPool::max_pooled_buf_size);
+    buf = IoBufPool::alloc(IoBufPool::max_pooled_buf_size, test_align);
+    ASSERT_EQ(buf.cbytes(), bytes);
+    ASSERT_EQ(IoBufPool::cache().bytes, 0);
+}
+
+TEST(IoBufPoolTest, ForeignBufferNotCached) {
+    // a buffer this thread did not hand out, e.g. allocated by the caller, is not taken in
+    sisl::io_blob_safe buf(4096, test_align);
+    IoBufPool::release(std::move(buf), test_align);
+    ASSERT_EQ(IoBufPool::cache().bytes, 0);
+}
+
+int main(int argc, char* argv[]) {
+    int parsed_argc = argc;
+    ::testing::InitGoogleTest(&parsed_argc, argv);
+    SISL_OPTIONS_LOAD(parsed_argc, argv, logging);
+    sisl::logging::SetLogger(std::string(argv[0]));
+    spdlog::set_pattern("[%D %T.%e] [%n] [%^%l%$] [%t] %v");
+    parsed_argc = 1;
+    auto f = ::folly::Init(&parsed_argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
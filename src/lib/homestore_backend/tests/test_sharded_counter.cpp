@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <sisl/options/options.h>
+#include <sisl/logging/logging.h>
+#include <folly/init/Init.h>
+
+#include <thread>
+#include <vector>
+
+#include "homeobject/common.hpp"
+#define protected public
+#define private public
+#include "lib/homestore_backend/sharded_counter.hpp"
+
+SISL_LOGGING_DEF(HOMEOBJECT_LOG_MODS)
+SISL_LOGGING_INIT(HOMEOBJECT_LOG_MODS)
+SISL_OPTIONS_ENABLE(logging)
+
+using homeobject::ShardedCounter;
+
+TEST(ShardedCounterTest, SingleThread) {
+    ShardedCounter c;
+    ASSERT_EQ(c.get(), 0);
+    c.increment();
+    c.increment(10);
+    ASSERT_EQ(c.get(), 11);
+    c.decrement(4);
+    ASSERT_EQ(c.get(), 7);
+    ASSERT_EQ(c.get_stable(), 7);
+}
+
+TEST(ShardedCounterTest, ConcurrentUpdates) {
+    ShardedCounter c;
+    static constexpr uint32_t num_threads{16};
+    static constexpr uint32_t num_ops{100000};
+    std::vector< std::thread > threads;
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&c]() {
+            for (uint32_t i = 0; i < num_ops; ++i) {
+                c.increment();
+                if (i % 2) { c.decrement(); }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(c.get(), int64_t{num_threads} * num_ops / 2);
+    ASSERT_EQ(c.get_stable(), int64_t{num_threads} * num_ops / 2);
+}
+
+TEST(ShardedCounterTest, CrossThreadDecrement) {
+    ShardedCounter c;
+    static constexpr int64_t n{1000};
+    size_t inc_slot, dec_slot;
+    std::thread inc([&c, &inc_slot]() {
+        inc_slot = ShardedCounter::slot_index();
+        c.increment(n);
+    });
+    inc.join();
+
+    // e.g. requests issued on one core and completed on a future continuation on another
+    std::thread dec([&c, &dec_slot]() {
+        dec_slot = ShardedCounter::slot_index();
+        for (int64_t i = 0; i < n; ++i) {
+            c.decrement();
+        }
+    });
+    dec.join();
+
+    // the slot of the decrementing thread went negative, only the sum is meaningful
+    if (inc_slot != dec_slot) {
+        ASSERT_EQ(c.slots_[inc_slot].value.load(), n);
+        ASSERT_EQ(c.slots_[dec_slot].value.load(), -n);
+    }
+    ASSERT_EQ(c.get(), 0);
+    ASSERT_EQ(c.get_stable(), 0);
+}
+
+TEST(ShardedCounterTest, StableReadWhileUpdating) {
+    ShardedCounter c;
+    c.increment();
+    std::atomic_bool stop{false};
+    // keeps a balanced increment/decrement pair in flight on another slot
+    std::thread churn([&c, &stop]() {
+        while (!stop.load()) {
+            c.increment();
+            c.decrement();
+        }
+    });
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_GE(c.get_stable(), 1);
+    }
+    stop = true;
+    churn.join();
+    ASSERT_EQ(c.get_stable(), 1);
+}
+
+int main(int argc, char* argv[]) {
+    int parsed_argc = argc;
+    ::testing::InitGoogleTest(&parsed_argc, argv);
+    SISL_OPTIONS_LOAD(parsed_argc, argv, logging);
+    sisl::logging::SetLogger(std::string(argv[0]));
+    spdlog::set_pattern("[%D %T.%e] [%n] [%^%l%$] [%t] %v");
+    parsed_argc = 1;
+    auto f = ::folly::Init(&parsed_argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sisl/fds/buffer.hpp>
+
+namespace homeobject {
+
+/**
+ * Per-thread recycling of aligned io buffers.
+ *
+ * Buffers are cached by their exact (size, alignment), which is cheap to match since all the io buffers of the data
+ * path are rounded to io_align. Every thread records the buffers it hands out, that record is the owner tag of a
+ * buffer. Only a buffer released on its owning thread is cached, one released on any other thread is freed, as
+ * ThreadLocalObjPool does with its blocks. Buffers that are too big, or exceed the per thread cap, are freed as before.
+ */
+class IoBufPool {
+public:
+    static constexpr uint32_t max_pooled_buf_size{1024 * 1024};
+    static constexpr uint64_t max_pooled_bytes_per_thread{16 * 1024 * 1024};
+    // Buffers released on other threads stay in the record of their owner. It is dropped once it grows past this,
+    // which only makes buffers still out be freed rather than cached when they come back. A stale entry whose
+    // address the allocator reuses for a buffer of another thread lets that one buffer be cached here, no worse.
+    static constexpr size_t max_lent_per_thread{4096};
+
+    static sisl::io_blob_safe alloc(uint32_t size, uint32_t align) {
+        if (size > max_pooled_buf_size) { return sisl::io_blob_safe{size, align}; }
+        auto& c = cache();
+        sisl::io_blob_safe buf;
+        if (auto it = c.bufs.find(key(size, align)); it != c.bufs.end() && !it->second.empty()) {
+            buf = std::move(it->second.back());
+            it->second.pop_back();
+            c.bytes -= size;
+        } else {
+            buf = sisl::io_blob_safe{size, align};
+        }
+        if (c.lent.size() >= max_lent_per_thread) { c.lent.clear(); }
+        c.lent.insert(buf.cbytes());
+        return buf;
+    }
+
+    // Take the buffer back. Anything which can not be reused is freed when buf goes out of scope.
+    static void release(sisl::io_blob_safe&& buf, uint32_t align) {
+        if (buf.bytes() == nullptr || buf.size() > max_pooled_buf_size ||
+            (align && (reinterpret_cast< uintptr_t >(buf.cbytes()) % align) != 0)) {
+            return;
+        }
+        auto& c = cache();
+        // not handed out by this thread, give it back to the allocator
+        if (c.lent.erase(buf.cbytes()) == 0) { return; }
+        if (c.bytes + buf.size() > max_pooled_bytes_per_thread) { return; }
+        c.bytes += buf.size();
+        c.bufs[key(buf.size(), align)].emplace_back(std::move(buf));
+    }
+
+private:
+    struct ThreadCache {
+        std::unordered_map< uint64_t, std::vector< sisl::io_blob_safe > > bufs;
+        uint64_t bytes{0};
+        // buffers handed out by this thread and not yet released
+        std::unordered_set< uint8_t const* > lent;
+    };
+
+    static uint64_t key(uint32_t size, uint32_t align) { return (uint64_t{align} << 32) | size; }
+    static ThreadCache& cache() {
+        static thread_local ThreadCache c;
+        return c;
+    }
+};
+
+/**
+ * RAII holder of a buffer from IoBufPool, returned to the pool when the holder goes away.
+ */
+class pooled_io_buf {
+public:
+    pooled_io_buf(uint32_t size, uint32_t align) : buf_{IoBufPool::alloc(size, align)}, align_{align} {}
+    ~pooled_io_buf() { IoBufPool::release(std::move(buf_), align_); }
+    pooled_io_buf(pooled_io_buf&&) noexcept = default;
+    pooled_io_buf& operator=(pooled_io_buf&&) noexcept = default;
+    pooled_io_buf(const pooled_io_buf&) = delete;
+    pooled_io_buf& operator=(const pooled_io_buf&) = delete;
+
+    uint8_t* bytes() { return buf_.bytes(); }
+    uint8_t const* cbytes() const { return buf_.cbytes(); }
+    uint32_t size() const { return buf_.size(); }
+
+private:
+    sisl::io_blob_safe buf_;
+    uint32_t align_;
+};
+
+/**
+ * Per-thread free list of raw memory for objects of type T, meant to back the class specific operator new/delete of
+ * short-lived, frequently allocated request contexts.
+ *
+ * Every block is tagged with the free list of the thread which allocated it. A block freed on that thread is cached
+ * for its next allocation, a block freed on any other thread goes back to the global allocator: caching it there
+ * would fill the free list of a thread which does not allocate, while the allocating thread keeps allocating.
+ */
+template < typename T >
+class ThreadLocalObjPool {
+public:
+    static constexpr size_t max_cached_per_thread{1024};
+
+    static void* alloc(size_t size) {
+        if (size != sizeof(T)) { return ::operator new(size); }
+        auto& l = free_list();
+        void* block;
+        if (!l.ptrs.empty()) {
+            block = l.ptrs.back();
+            l.ptrs.pop_back();
+        } else {
+            block = ::operator new(block_size);
+        }
+        *static_cast< FreeList** >(block) = &l;
+        return static_cast< uint8_t* >(block) + tag_size;
+    }
+
+    static void free(void* p, size_t size) noexcept {
+        if (size != sizeof(T)) {
+            ::operator delete(p);
+            return;
+        }
+        void* block = static_cast< uint8_t* >(p) - tag_size;
+        auto& l = free_list();
+        // the owner is only compared against, never dereferenced: its thread may be gone
+        if (*static_cast< FreeList** >(block) == &l && l.ptrs.size() < max_cached_per_thread) {
+            // capacity is reserved upfront, push_back never reallocates here
+            l.ptrs.push_back(block);
+            return;
+        }
+        ::operator delete(block);
+    }
+
+private:
+    // the owner tag in front of every block, padded to keep T aligned
+    static constexpr size_t tag_size{alignof(std::max_align_t)};
+    static constexpr size_t block_size{tag_size + sizeof(T)};
+
+    struct FreeList {
+        FreeList() { ptrs.reserve(max_cached_per_thread); }
+        ~FreeList() {
+            for (auto p : ptrs) {
+                ::operator delete(p);
+            }
+        }
+        std::vector< void* > ptrs;
+    };
+
+    static FreeList& free_list() {
+        static thread_local FreeList l;
+        return l;
+    }
+};
+
+} // namespace homeobject
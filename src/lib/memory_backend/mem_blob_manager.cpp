@@ -1,5 +1,7 @@
 #include "mem_homeobject.hpp"
 
+#include <algorithm>
+
 namespace homeobject {
 
 #define WITH_SHARD                                                                                                     \
@@ -18,8 +20,9 @@ namespace homeobject {
 
 // Write (move) Blob to new BlobExt on heap and Insert BlobExt to Index
 BlobManager::AsyncResult< blob_id_t > MemoryHomeObject::_put_blob(ShardInfo const& _shard, Blob&& _blob,
-                                                                  trace_id_t tid) {
+                                                                  trace_id_t tid, op_deadline_t deadline) {
     (void)tid;
+    if (deadline_expired(deadline)) return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
     WITH_SHARD
     blob_id_t new_blob_id;
     {
@@ -39,19 +42,84 @@ BlobManager::AsyncResult< blob_id_t > MemoryHomeObject::_put_blob(ShardInfo cons
 
 // Lookup BlobExt and duplicate underyling Blob for user; only *safe* because we defer GC.
 BlobManager::AsyncResult< Blob > MemoryHomeObject::_get_blob(ShardInfo const& _shard, blob_id_t _blob, uint64_t off,
-                                                             uint64_t len, trace_id_t tid) const {
+                                                             uint64_t len, trace_id_t tid,
+                                                             op_deadline_t deadline) const {
     (void)off;
     (void)len;
     (void)tid;
+    if (deadline_expired(deadline)) return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
     WITH_SHARD
     WITH_ROUTE(_blob)
     IF_BLOB_ALIVE { return blob_it->second.blob_->clone(); }
     return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_BLOB));
 }
 
+// Copy the range of the Blob into the buffers of the caller
+BlobManager::AsyncResult< BlobRead > MemoryHomeObject::_get_blob_into(ShardInfo const& _shard, blob_id_t _blob,
+                                                                      sisl::sg_list const& dest, uint64_t off,
+                                                                      uint64_t len, trace_id_t tid,
+                                                                      op_deadline_t deadline) const {
+    if (deadline_expired(deadline)) return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    WITH_SHARD
+    WITH_ROUTE(_blob)
+    IF_BLOB_ALIVE {
+        auto const& blob = *blob_it->second.blob_;
+        if (off + len > blob.body.size()) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+        auto const size = len ? len : blob.body.size() - off;
+        if (size > dest.size) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+        copy_to_sg_list(dest, 0, blob.body.cbytes() + off, size);
+        return BlobRead{.size = size, .user_key = blob.user_key, .object_off = blob.object_off};
+    }
+    (void)tid;
+    return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_BLOB));
+}
+
+namespace {
+// Hands out a copy of the Blob in fixed size chunks, there is no read to overlap with in memory.
+class MemBlobStream : public BlobStream {
+public:
+    static constexpr uint64_t chunk_size{1 * Mi};
+
+    MemBlobStream(Blob&& blob, uint64_t off, uint64_t len) :
+            blob_(std::move(blob)), pos_(off), end_(off + len), size_(len) {}
+
+    std::string const& user_key() const override { return blob_.user_key; }
+    uint64_t object_off() const override { return blob_.object_off; }
+    uint64_t size() const override { return size_; }
+
+    AsyncResult< sisl::io_blob_safe > next() override {
+        auto const n = std::min(chunk_size, end_ - pos_);
+        auto chunk = sisl::io_blob_safe(n);
+        if (n) { std::memcpy(chunk.bytes(), blob_.body.cbytes() + pos_, n); }
+        pos_ += n;
+        return chunk;
+    }
+
+private:
+    Blob blob_;
+    uint64_t pos_;
+    uint64_t end_;
+    uint64_t size_;
+};
+} // namespace
+
+BlobManager::AsyncResult< std::unique_ptr< BlobStream > >
+MemoryHomeObject::_get_stream(ShardInfo const& _shard, blob_id_t _blob, uint64_t off, uint64_t len, trace_id_t tid,
+                              op_deadline_t deadline) const {
+    return _get_blob(_shard, _blob, 0, 0, tid, deadline)
+        .deferValue([off, len](auto&& r) -> BlobManager::Result< std::unique_ptr< BlobStream > > {
+            if (!r) return folly::makeUnexpected(r.error());
+            auto const size = r.value().body.size();
+            if (off + len > size) return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            return std::make_unique< MemBlobStream >(std::move(r.value()), off, len ? len : size - off);
+        });
+}
+
 // Tombstone BlobExt entry
-BlobManager::NullAsyncResult MemoryHomeObject::_del_blob(ShardInfo const& _shard, blob_id_t _blob, trace_id_t tid) {
+BlobManager::NullAsyncResult MemoryHomeObject::_del_blob(ShardInfo const& _shard, blob_id_t _blob, trace_id_t tid,
+                                                         op_deadline_t deadline) {
     (void)tid;
+    if (deadline_expired(deadline)) return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
     WITH_SHARD
     WITH_ROUTE(_blob)
     IF_BLOB_ALIVE {
@@ -61,4 +129,85 @@ BlobManager::NullAsyncResult MemoryHomeObject::_del_blob(ShardInfo const& _shard
     return folly::Unit();
 }
 
+// Duplicate the underlying Blob into the destination shard as a new BlobExt
+BlobManager::AsyncResult< blob_id_t > MemoryHomeObject::_copy_blob(ShardInfo const& _shard, blob_id_t _blob,
+                                                                   ShardInfo const& dst_shard, trace_id_t tid,
+                                                                   op_deadline_t deadline) {
+    if (deadline_expired(deadline)) return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    std::optional< Blob > blob;
+    {
+        WITH_SHARD
+        WITH_ROUTE(_blob)
+        IF_BLOB_ALIVE { blob = blob_it->second.blob_->clone(); }
+    }
+    if (!blob) return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_BLOB));
+    return _put_blob(dst_shard, std::move(*blob), tid, deadline);
+}
+
+BlobManager::AsyncResult< upload_id_t > MemoryHomeObject::_create_upload(ShardInfo const& _shard, trace_id_t tid) {
+    (void)tid;
+    auto lg = std::scoped_lock(upload_lock_);
+    auto const upload_id = next_upload_id_++;
+    uploads_.emplace(upload_id, Upload{.shard_id = _shard.id, .parts = {}});
+    return upload_id;
+}
+
+// Keep the part aside in the upload, a part uploaded again replaces the previous one
+BlobManager::AsyncResult< UploadedPart > MemoryHomeObject::_upload_part(ShardInfo const& _shard, upload_id_t upload,
+                                                                        uint32_t part_no, sisl::io_blob_safe&& data,
+                                                                        trace_id_t tid, op_deadline_t deadline) {
+    (void)tid;
+    if (deadline_expired(deadline)) return folly::makeUnexpected(BlobError(BlobErrorCode::DEADLINE_EXCEEDED));
+    auto const crc = static_cast< uint32_t >(
+        std::hash< std::string_view >{}(std::string_view{reinterpret_cast< char const* >(data.cbytes()), data.size()}));
+    auto const part = UploadedPart{.part_no = part_no, .size = data.size(), .crc = crc};
+    auto lg = std::scoped_lock(upload_lock_);
+    auto it = uploads_.find(upload);
+    if (uploads_.end() == it || it->second.shard_id != _shard.id)
+        return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+    it->second.parts.insert_or_assign(part_no, std::make_pair(part, std::move(data)));
+    return part;
+}
+
+// Concatenate the given parts into a single new Blob
+BlobManager::AsyncResult< blob_id_t > MemoryHomeObject::_complete_upload(ShardInfo const& _shard, upload_id_t upload,
+                                                                         std::vector< UploadedPart > const& parts,
+                                                                         std::string const& user_key,
+                                                                         uint64_t object_off, trace_id_t tid) {
+    sisl::io_blob_safe body;
+    {
+        auto lg = std::scoped_lock(upload_lock_);
+        auto it = uploads_.find(upload);
+        if (uploads_.end() == it || it->second.shard_id != _shard.id)
+            return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+        auto& uploaded = it->second.parts;
+        uint64_t object_size{0};
+        for (auto const& part : parts) {
+            auto p_it = uploaded.find(part.part_no);
+            if (uploaded.end() == p_it || p_it->second.first.size != part.size || p_it->second.first.crc != part.crc)
+                return folly::makeUnexpected(BlobError(BlobErrorCode::INVALID_ARG));
+            object_size += part.size;
+        }
+        body = sisl::io_blob_safe(object_size);
+        uint64_t off{0};
+        for (auto const& part : parts) {
+            std::memcpy(body.bytes() + off, uploaded[part.part_no].second.cbytes(), part.size);
+            off += part.size;
+        }
+        uploads_.erase(it);
+    }
+    return _put_blob(_shard, Blob(std::move(body), user_key, object_off), tid, {});
+}
+
+BlobManager::NullAsyncResult MemoryHomeObject::_abort_upload(ShardInfo const& _shard, upload_id_t upload,
+                                                             trace_id_t tid) {
+    (void)tid;
+    auto lg = std::scoped_lock(upload_lock_);
+    auto it = uploads_.find(upload);
+    if (uploads_.end() == it || it->second.shard_id != _shard.id)
+        return folly::makeUnexpected(BlobError(BlobErrorCode::UNKNOWN_UPLOAD));
+    uploads_.erase(it);
+    return folly::Unit();
+}
+
 } // namespace homeobject
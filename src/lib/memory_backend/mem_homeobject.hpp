@@ -1,6 +1,8 @@
 #pragma once
 
 #include <atomic>
+#include <map>
+#include <mutex>
 #include <utility>
 
 #include <folly/concurrency/ConcurrentHashMap.h>
@@ -32,16 +34,45 @@ class MemoryHomeObject : public HomeObjectImpl {
     index_svc index_;
     ///
 
+    /// Multi-part uploads in progress, parts are kept aside until the upload is completed into a single Blob
+    struct Upload {
+        shard_id_t shard_id;
+        std::map< uint32_t, std::pair< UploadedPart, sisl::io_blob_safe > > parts;
+    };
+    std::mutex upload_lock_;
+    std::map< upload_id_t, Upload > uploads_;
+    upload_id_t next_upload_id_{1};
+    ///
+
     /// Helpers
     // ShardManager
     ShardManager::AsyncResult< ShardInfo > _create_shard(pg_id_t, uint64_t size_bytes, trace_id_t tid) override;
     ShardManager::AsyncResult< ShardInfo > _seal_shard(ShardInfo const&, trace_id_t tid) override;
 
     // BlobManager
-    BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&, trace_id_t tid) override;
+    BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&, trace_id_t tid,
+                                                    op_deadline_t deadline) override;
     BlobManager::AsyncResult< Blob > _get_blob(ShardInfo const&, blob_id_t, uint64_t off, uint64_t len,
-                                               trace_id_t tid) const override;
-    BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t, trace_id_t tid) override;
+                                               trace_id_t tid, op_deadline_t deadline) const override;
+    BlobManager::AsyncResult< std::unique_ptr< BlobStream > > _get_stream(ShardInfo const&, blob_id_t, uint64_t off,
+                                                                          uint64_t len, trace_id_t tid,
+                                                                          op_deadline_t deadline) const override;
+    BlobManager::AsyncResult< BlobRead > _get_blob_into(ShardInfo const&, blob_id_t, sisl::sg_list const& dest,
+                                                        uint64_t off, uint64_t len, trace_id_t tid,
+                                                        op_deadline_t deadline) const override;
+    BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t, trace_id_t tid,
+                                           op_deadline_t deadline) override;
+    BlobManager::AsyncResult< blob_id_t > _copy_blob(ShardInfo const& src, blob_id_t, ShardInfo const& dst,
+                                                     trace_id_t tid, op_deadline_t deadline) override;
+    BlobManager::AsyncResult< upload_id_t > _create_upload(ShardInfo const&, trace_id_t tid) override;
+    BlobManager::AsyncResult< UploadedPart > _upload_part(ShardInfo const&, upload_id_t, uint32_t part_no,
+                                                          sisl::io_blob_safe&& data, trace_id_t tid,
+                                                          op_deadline_t deadline) override;
+    BlobManager::AsyncResult< blob_id_t > _complete_upload(ShardInfo const&, upload_id_t,
+                                                           std::vector< UploadedPart > const& parts,
+                                                           std::string const& user_key, uint64_t object_off,
+                                                           trace_id_t tid) override;
+    BlobManager::NullAsyncResult _abort_upload(ShardInfo const&, upload_id_t, trace_id_t tid) override;
     ///
 
     // PGManager
@@ -9,6 +9,16 @@ using homeobject::Blob;
 using homeobject::BlobError;
 using homeobject::BlobErrorCode;
 
+// A blob of 4Ki bytes of 1 followed by 4Ki bytes of 2
+static blob_id_t put_two_halves(std::shared_ptr< homeobject::BlobManager > bm, homeobject::shard_id_t shard) {
+    sisl::io_blob_safe body(8 * Ki, 512u);
+    std::memset(body.bytes(), 1, 4 * Ki);
+    std::memset(body.bytes() + 4 * Ki, 2, 4 * Ki);
+    auto p_e = bm->put(shard, Blob{std::move(body), "two_halves", 0ul}).get();
+    EXPECT_TRUE(!!p_e);
+    return p_e ? p_e.value() : 0;
+}
+
 TEST_F(TestFixture, BasicBlobTests) {
     auto const batch_sz = 4;
     std::mutex call_lock;
@@ -98,3 +108,119 @@ TEST_F(TestFixture, BasicBlobTests) {
     // Delete is Idempotent
     EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, _blob_id, tid).get());
 }
+
+TEST_F(TestFixture, CopyBlob) {
+    auto tid = homeobject::generateRandomTraceId();
+
+    // BLOB is copied with its user key and payload, under a new id
+    auto c_e = homeobj_->blob_manager()->copy(_shard_1.id, _blob_id, _shard_2.id, tid).get();
+    ASSERT_TRUE(!!c_e);
+    auto src_g = homeobj_->blob_manager()->get(_shard_1.id, _blob_id).get();
+    auto dst_g = homeobj_->blob_manager()->get(_shard_2.id, c_e.value()).get();
+    ASSERT_TRUE(!!src_g && !!dst_g);
+    ASSERT_EQ(src_g->body.size(), dst_g->body.size());
+    EXPECT_EQ(0, std::memcmp(src_g->body.cbytes(), dst_g->body.cbytes(), src_g->body.size()));
+    EXPECT_EQ(src_g->user_key, dst_g->user_key);
+
+    // BLOB can be copied out of a sealed shard, not into it
+    EXPECT_TRUE(homeobj_->shard_manager()->seal_shard(_shard_1.id).get());
+    EXPECT_TRUE(homeobj_->blob_manager()->copy(_shard_1.id, _blob_id, _shard_2.id, tid).get());
+    c_e = homeobj_->blob_manager()->copy(_shard_2.id, c_e.value(), _shard_1.id, tid).get();
+    ASSERT_FALSE(!!c_e);
+    EXPECT_EQ(BlobErrorCode::SEALED_SHARD, c_e.error().getCode());
+
+    // unknown source BLOB
+    c_e = homeobj_->blob_manager()->copy(_shard_2.id, _blob_id + 1000, _shard_2.id, tid).get();
+    ASSERT_FALSE(!!c_e);
+    EXPECT_EQ(BlobErrorCode::UNKNOWN_BLOB, c_e.error().getCode());
+}
+
+TEST_F(TestFixture, GetBlobInto) {
+    auto const blob_id = put_two_halves(homeobj_->blob_manager(), _shard_2.id);
+
+    // BLOB range is read into the buffers of the caller
+    auto into = homeobj_->blob_manager()->alloc_io_buf(4 * Ki);
+    sisl::sg_list into_sgs;
+    into_sgs.size = into.size();
+    into_sgs.iovs.emplace_back(iovec{.iov_base = into.bytes(), .iov_len = into.size()});
+    auto r_e = homeobj_->blob_manager()->get_into(_shard_2.id, blob_id, into_sgs, 2 * Ki, 4 * Ki).get();
+    ASSERT_TRUE(!!r_e);
+    EXPECT_EQ(4 * Ki, r_e->size);
+    EXPECT_EQ(1, into.cbytes()[2 * Ki - 1]);
+    EXPECT_EQ(2, into.cbytes()[2 * Ki]);
+
+    // the buffers have to hold the whole range
+    r_e = homeobj_->blob_manager()->get_into(_shard_2.id, blob_id, into_sgs).get();
+    ASSERT_FALSE(!!r_e);
+    EXPECT_EQ(BlobErrorCode::INVALID_ARG, r_e.error().getCode());
+
+    // unknown BLOB
+    r_e = homeobj_->blob_manager()->get_into(_shard_2.id, blob_id + 1000, into_sgs, 0, 4 * Ki).get();
+    ASSERT_FALSE(!!r_e);
+    EXPECT_EQ(BlobErrorCode::UNKNOWN_BLOB, r_e.error().getCode());
+    homeobj_->blob_manager()->release_io_buf(std::move(into));
+}
+
+TEST_F(TestFixture, GetBlobStream) {
+    auto const blob_id = put_two_halves(homeobj_->blob_manager(), _shard_2.id);
+
+    // BLOB range is streamed, an empty chunk marks its end
+    auto s_e = homeobj_->blob_manager()->get_stream(_shard_2.id, blob_id, 4 * Ki - 1, 2).get();
+    ASSERT_TRUE(!!s_e);
+    EXPECT_EQ(2u, s_e.value()->size());
+    auto chunk_e = s_e.value()->next().get();
+    ASSERT_TRUE(!!chunk_e);
+    ASSERT_EQ(2u, chunk_e->size());
+    EXPECT_EQ(1, chunk_e->cbytes()[0]);
+    EXPECT_EQ(2, chunk_e->cbytes()[1]);
+    chunk_e = s_e.value()->next().get();
+    ASSERT_TRUE(!!chunk_e);
+    EXPECT_EQ(0u, chunk_e->size());
+
+    // the whole BLOB by default
+    s_e = homeobj_->blob_manager()->get_stream(_shard_2.id, blob_id).get();
+    ASSERT_TRUE(!!s_e);
+    EXPECT_EQ(8 * Ki, s_e.value()->size());
+
+    // unknown BLOB
+    s_e = homeobj_->blob_manager()->get_stream(_shard_2.id, blob_id + 1000).get();
+    ASSERT_FALSE(!!s_e);
+    EXPECT_EQ(BlobErrorCode::UNKNOWN_BLOB, s_e.error().getCode());
+}
+
+TEST_F(TestFixture, MultipartUpload) {
+    auto tid = homeobject::generateRandomTraceId();
+
+    // the parts are assembled in the order of their part numbers
+    auto u_e = homeobj_->blob_manager()->create_upload(_shard_2.id, tid).get();
+    ASSERT_TRUE(!!u_e);
+    std::vector< homeobject::UploadedPart > parts;
+    for (uint32_t part_no = 1; part_no <= 2; ++part_no) {
+        sisl::io_blob_safe data(4 * Ki, 512u);
+        std::memset(data.bytes(), part_no, data.size());
+        auto part_e = homeobj_->blob_manager()->upload_part(_shard_2.id, u_e.value(), part_no, std::move(data)).get();
+        ASSERT_TRUE(!!part_e);
+        parts.push_back(part_e.value());
+    }
+    auto m_e = homeobj_->blob_manager()->complete_upload(_shard_2.id, u_e.value(), {parts[1], parts[0]}).get();
+    ASSERT_FALSE(!!m_e);
+    EXPECT_EQ(BlobErrorCode::INVALID_ARG, m_e.error().getCode());
+    m_e = homeobj_->blob_manager()->complete_upload(_shard_2.id, u_e.value(), parts, "mp_blob").get();
+    ASSERT_TRUE(!!m_e);
+    auto mp_g = homeobj_->blob_manager()->get(_shard_2.id, m_e.value()).get();
+    ASSERT_TRUE(!!mp_g);
+    ASSERT_EQ(8 * Ki, mp_g->body.size());
+    EXPECT_EQ(1, mp_g->body.cbytes()[4 * Ki - 1]);
+    EXPECT_EQ(2, mp_g->body.cbytes()[4 * Ki]);
+    EXPECT_EQ("mp_blob", mp_g->user_key);
+
+    // an aborted upload can not be completed
+    u_e = homeobj_->blob_manager()->create_upload(_shard_2.id, tid).get();
+    ASSERT_TRUE(!!u_e);
+    EXPECT_TRUE(homeobj_->blob_manager()->abort_upload(_shard_2.id, u_e.value(), tid).get());
+    EXPECT_FALSE(!!homeobj_->blob_manager()->complete_upload(_shard_2.id, u_e.value(), {}).get());
+
+    // no upload into a sealed shard
+    EXPECT_TRUE(homeobj_->shard_manager()->seal_shard(_shard_1.id).get());
+    EXPECT_FALSE(!!homeobj_->blob_manager()->create_upload(_shard_1.id, tid).get());
+}